@@ -0,0 +1,243 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * Kafka produce path benchmark
+ *
+ * Replays a BMP corpus through the BMP reader and the msgBus_kafka producer into a
+ * librdkafka mock cluster (test.mock.num.brokers), so no broker is needed.  Each
+ * combination of compression, batch.num.messages and queue.buffering.max.ms is run
+ * with a new producer and reported as one line.
+ *
+ * The corpus is a raw BMP stream as sent by a router, e.g. captured with
+ * "nc -l 5000 > corpus.bmp" while the router connects.
+ */
+
+#include <cerrno>
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Config.h"
+#include "Logger.h"
+#include "BMPListener.h"
+#include "BMPReader.h"
+#include "MsgBusImpl_kafka.h"
+#include "KafkaProduceStats.h"
+
+using namespace std;
+
+/**
+ * Split a comma separated list
+ */
+static vector<string> splitList(const char *arg) {
+    vector<string> list;
+    string value(arg);
+    size_t start = 0, end;
+
+    while ((end = value.find(',', start)) != string::npos) {
+        list.push_back(value.substr(start, end - start));
+        start = end + 1;
+    }
+
+    list.push_back(value.substr(start));
+    return list;
+}
+
+static void Usage(char *prog) {
+    printf("Usage: %s <options>\n", prog);
+    printf("\nREQUIRED OPTIONS:\n");
+    printf("     -f <file>          BMP corpus file (raw BMP stream)\n");
+    printf("\nOPTIONAL OPTIONS:\n");
+    printf("     -c <filename>      openbmpd config file (message format, topics, ...), brokers are ignored\n");
+    printf("     -z <list>          Compression codecs, comma separated (default: none,snappy,lz4,gzip)\n");
+    printf("     -b <list>          batch.num.messages values, comma separated (default: 100,1000,10000)\n");
+    printf("     -m <list>          queue.buffering.max.ms (linger) values, comma separated (default: 1,10,100)\n");
+    printf("     -n <brokers>       Mock cluster brokers (default: 3)\n");
+    printf("     -r <count>         Times to replay the corpus per setting (default: 1)\n");
+    printf("     -l <filename>      Log filename (default: /dev/null)\n");
+}
+
+/**
+ * Run one setting and print its results
+ *
+ * \param [in] logger   Logger
+ * \param [in] cfg      Configuration of the setting
+ * \param [in] corpus   BMP corpus
+ * \param [in] repeat   Times to replay the corpus
+ */
+static void runSetting(Logger *logger, Config &cfg, const string &corpus, int repeat) {
+    KafkaProduceStats stats;
+    msgBus_kafka *mbus = new msgBus_kafka(logger, &cfg, cfg.c_hash_id, &stats);
+
+    BMPReader reader(logger, &cfg);
+    BMPListener::ClientInfo client;
+    int sock_fds[2];
+
+    bzero(&client, sizeof(client));
+    snprintf(client.c_ip, sizeof(client.c_ip), "192.0.2.1");
+    snprintf(client.c_port, sizeof(client.c_port), "179");
+    memcpy(client.hash_id, cfg.c_hash_id, sizeof(client.hash_id));
+    client.c_sock = -1;
+
+    if (socketpair(PF_LOCAL, SOCK_STREAM, 0, sock_fds) != 0)
+        throw "Failed to create the corpus socket pair";
+
+    client.pipe_sock = sock_fds[0];
+
+    // Feed the corpus like the client thread feeds the router stream
+    std::thread writer([&] {
+        for (int i = 0; i < repeat; i++) {
+            for (size_t off = 0; off < corpus.size(); ) {
+                ssize_t n = write(sock_fds[1], corpus.data() + off, corpus.size() - off);
+                if (n <= 0 and errno != EINTR)
+                    break;
+                off += n > 0 ? n : 0;
+            }
+        }
+        close(sock_fds[1]);
+    });
+
+    uint64_t start_us = KafkaProduceStats::now();
+
+    // Returns once the corpus is consumed (end of stream disconnects the router)
+    bool run = true;
+    reader.readerThreadLoop(run, &client, mbus);
+    writer.join();
+
+    bool drained = mbus->flushProducer(60000);
+    uint64_t elapsed_us = KafkaProduceStats::now() - start_us;
+
+    close(sock_fds[0]);
+
+    double secs = elapsed_us / 1000000.0;
+
+    printf("%-8s %8d %8d %12.0f %12.0f %9.2f %9" PRIu32 " %9" PRIu32 " %9.2f %9.2f %8" PRIu64 " %8" PRIu64 "%s\n",
+           cfg.compression.c_str(), cfg.q_batch_num_msgs, cfg.q_buf_max_ms,
+           stats.produced / secs, stats.produced_rows / secs, stats.produced_bytes / secs / 1000000.0,
+           KafkaProduceStats::percentile(stats.enqueue_us, 50), KafkaProduceStats::percentile(stats.enqueue_us, 99),
+           KafkaProduceStats::percentile(stats.delivery_us, 50) / 1000.0,
+           KafkaProduceStats::percentile(stats.delivery_us, 99) / 1000.0,
+           stats.rejected, stats.failed, drained ? "" : " (not drained)");
+    fflush(stdout);
+
+    delete mbus;
+}
+
+int main(int argc, char **argv) {
+    const char *corpus_filename = NULL;
+    const char *cfg_filename = NULL;
+    const char *log_filename = "/dev/null";
+    vector<string> codecs = splitList("none,snappy,lz4,gzip");
+    vector<string> batches = splitList("100,1000,10000");
+    vector<string> lingers = splitList("1,10,100");
+    int brokers = 3;
+    int repeat = 1;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc and argv[i + 1][0] != '-';
+
+        if (!strcmp(argv[i], "-h") or !strcmp(argv[i], "--help")) {
+            Usage(argv[0]);
+            return 0;
+        } else if (not has_value) {
+            printf("INVALID ARG: %s expects a value\n", argv[i]);
+            Usage(argv[0]);
+            return 1;
+        } else if (!strcmp(argv[i], "-f"))
+            corpus_filename = argv[++i];
+        else if (!strcmp(argv[i], "-c"))
+            cfg_filename = argv[++i];
+        else if (!strcmp(argv[i], "-z"))
+            codecs = splitList(argv[++i]);
+        else if (!strcmp(argv[i], "-b"))
+            batches = splitList(argv[++i]);
+        else if (!strcmp(argv[i], "-m"))
+            lingers = splitList(argv[++i]);
+        else if (!strcmp(argv[i], "-n"))
+            brokers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-r"))
+            repeat = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-l"))
+            log_filename = argv[++i];
+        else {
+            printf("INVALID ARG: %s\n", argv[i]);
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (corpus_filename == NULL or brokers < 1 or repeat < 1) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    // Load the corpus
+    string corpus;
+    FILE *fp = fopen(corpus_filename, "rb");
+    if (fp == NULL) {
+        printf("ERROR: cannot open %s: %s\n", corpus_filename, strerror(errno));
+        return 1;
+    }
+
+    char buf[65536];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        corpus.append(buf, n);
+    fclose(fp);
+
+    // The corpus writer must not be killed if the reader stops early
+    signal(SIGPIPE, SIG_IGN);
+
+    try {
+        Logger *logger = new Logger(log_filename, NULL);
+
+        printf("corpus: %s, %zu bytes x %d, mock brokers: %d\n", corpus_filename, corpus.size(), repeat, brokers);
+        printf("%-8s %8s %8s %12s %12s %9s %9s %9s %9s %9s %8s %8s\n",
+               "codec", "batch", "linger", "msgs/s", "rows/s", "MB/s",
+               "enq_p50", "enq_p99", "dlv_p50", "dlv_p99", "rejected", "failed");
+        printf("%-8s %8s %8s %12s %12s %9s %9s %9s %9s %9s %8s %8s\n",
+               "", "(msgs)", "(ms)", "", "", "", "(us)", "(us)", "(ms)", "(ms)", "", "");
+
+        for (size_t z = 0; z < codecs.size(); z++) {
+            for (size_t b = 0; b < batches.size(); b++) {
+                for (size_t m = 0; m < lingers.size(); m++) {
+                    Config cfg;
+
+                    if (cfg_filename != NULL)
+                        cfg.load(cfg_filename);
+
+                    memset(cfg.c_hash_id, 0xBE, sizeof(cfg.c_hash_id));
+                    cfg.kafka_mock_brokers = brokers;
+                    cfg.compression = codecs[z];
+                    cfg.q_batch_num_msgs = atoi(batches[b].c_str());
+                    cfg.q_buf_max_ms = atoi(lingers[m].c_str());
+
+                    runSetting(logger, cfg, corpus, repeat);
+                }
+            }
+        }
+
+        delete logger;
+
+    } catch (char const *str) {
+        printf("ERROR: %s\n", str);
+        return 2;
+    }
+
+    return 0;
+}
@@ -0,0 +1,913 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * Router scale harness
+ *
+ * Opens N simulated BMP sessions against a running openbmpd.  Each session sends an
+ * initiation message, a peer up per peer, a synthetic table and then announces and
+ * withdraws random prefixes at a fixed rate (churn).  Sessions are bound to consecutive
+ * loopback source addresses (127.1.0.1, 127.1.0.2, ...) so the collector sees each one
+ * as a different router.
+ *
+ * While the sessions run, the collector RSS, thread count and open fds are sampled
+ * from /proc, and reported per session.  If brokers are given, the router topic is
+ * consumed to measure the time from the TCP handshake (the session is in the accept
+ * queue) to the first message published for the router.
+ */
+
+#include <atomic>
+#include <cerrno>
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <librdkafka/rdkafkacpp.h>
+
+#include "KafkaProduceStats.h"
+
+using namespace std;
+
+#define BMP_MSG_ROUTE_MON           0           ///< BMP route monitoring message type
+#define BMP_MSG_PEER_UP             3           ///< BMP peer up message type
+#define BMP_MSG_INIT                4           ///< BMP initiation message type
+
+#define ROUTER_AS                   65000       ///< AS of the simulated routers
+#define PEER_AS_BASE                64512       ///< AS of the first peer of a router
+#define ORIGIN_AS                   65100       ///< Origin AS of the synthetic prefixes
+#define PREFIX_BASE                 0x10000000  ///< First /24 of the synthetic table (16.0.0.0)
+#define PEER_ADDR_BASE              0xAC100000  ///< Address of the first peer (172.16.0.1 is base + 1)
+
+#define UPDATE_MAX_PREFIXES         500         ///< Prefixes per BGP update, keeps updates under 4096 bytes
+#define OUT_HIGH_WATER              65536       ///< Pending bytes per session before no more are queued
+
+/// Session states
+enum session_state {
+    SESS_IDLE=0,                                ///< Not started
+    SESS_CONNECTING,                            ///< Connect in progress
+    SESS_TABLE,                                 ///< Sending the initial table
+    SESS_CHURN,                                 ///< Table sent, sending churn
+    SESS_CLOSED                                 ///< Failed or closed by the collector
+};
+
+/**
+ * Simulated router session
+ */
+struct Session {
+    int                 fd;
+    session_state       state;
+    uint32_t            src_addr;               ///< Source address (host byte order)
+    char                ip[INET_ADDRSTRLEN];    ///< Source address string, as in the router messages
+    uint64_t            established_us;         ///< Time the TCP handshake completed
+    string              out;                    ///< Pending output
+    size_t              out_off;                ///< Offset of the next byte to send in out
+    uint32_t            next_peer;              ///< Table position: peer
+    uint32_t            next_prefix;            ///< Table position: prefix of the peer
+    uint64_t            next_churn_us;          ///< Time of the next churn update
+    uint32_t            med;                    ///< MED of the next announcement, changes each churn update
+    vector<bool>        withdrawn;              ///< Withdrawn prefixes, peers x prefixes
+};
+
+/**
+ * Collector process sample
+ */
+struct ProcSample {
+    long                rss_kb;                 ///< VmRSS
+    int                 threads;                ///< Threads
+    int                 fds;                    ///< Open file descriptors
+};
+
+/**
+ * First router message seen per session, filled by the consumer thread
+ */
+struct PublishWatch {
+    std::mutex                          lock;
+    std::atomic<bool>                   run;
+    vector<uint64_t>                    first_us;   ///< Time of the first message per session, 0 until seen
+    unordered_map<string, size_t>       ips;        ///< Source address to session index
+    size_t                              seen;       ///< Sessions with a message
+};
+
+static volatile sig_atomic_t stop_run = 0;
+
+static void signal_stop(int) {
+    stop_run = 1;
+}
+
+static void put8(string &b, uint8_t v) {
+    b.push_back((char)v);
+}
+
+static void put16(string &b, uint16_t v) {
+    put8(b, v >> 8);
+    put8(b, v);
+}
+
+static void put32(string &b, uint32_t v) {
+    put16(b, v >> 16);
+    put16(b, v);
+}
+
+static void set16(string &b, size_t off, uint16_t v) {
+    b[off] = (char)(v >> 8);
+    b[off + 1] = (char)v;
+}
+
+/**
+ * Append a BMP message (common header and body)
+ */
+static void appendBmp(string &out, uint8_t type, const string &body) {
+    put8(out, 3);
+    put32(out, 6 + body.size());
+    put8(out, type);
+    out.append(body);
+}
+
+/**
+ * Append the BMP per-peer header of a peer
+ */
+static void appendPeerHeader(string &b, uint32_t peer) {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+
+    put8(b, 0);                                 // global instance peer
+    put8(b, 0);                                 // IPv4, 4 octet AS path
+    b.append(8, '\0');                          // peer distinguisher
+    b.append(12, '\0');
+    put32(b, PEER_ADDR_BASE + peer + 1);
+    put32(b, PEER_AS_BASE + peer);
+    put32(b, PEER_ADDR_BASE + peer + 1);        // BGP ID
+    put32(b, tv.tv_sec);
+    put32(b, tv.tv_usec);
+}
+
+/**
+ * Append a BGP open message with the 4 octet AS and IPv4 unicast capabilities
+ */
+static void appendOpen(string &b, uint16_t asn, uint32_t bgp_id) {
+    b.append(16, (char)0xFF);
+    put16(b, 45);
+    put8(b, 1);                                 // OPEN
+    put8(b, 4);                                 // version
+    put16(b, asn);
+    put16(b, 180);                              // hold time
+    put32(b, bgp_id);
+    put8(b, 16);                                // optional parameters length
+
+    put8(b, 2); put8(b, 6);                     // capability: 4 octet AS
+    put8(b, 65); put8(b, 4);
+    put32(b, asn);
+
+    put8(b, 2); put8(b, 6);                     // capability: multiprotocol IPv4 unicast
+    put8(b, 1); put8(b, 4);
+    put16(b, 1); put8(b, 0); put8(b, 1);
+}
+
+/**
+ * Append a BGP update message of /24 prefixes
+ *
+ * \param [out] b           Buffer
+ * \param [in]  withdrawn   Withdrawn prefix indexes
+ * \param [in]  nlri        Announced prefix indexes
+ * \param [in]  peer        Peer index
+ * \param [in]  med         MED of the announced prefixes
+ */
+static void appendUpdate(string &b, const vector<uint32_t> &withdrawn, const vector<uint32_t> &nlri,
+                         uint32_t peer, uint32_t med) {
+    size_t start = b.size();
+
+    b.append(16, (char)0xFF);
+    put16(b, 0);                                // length, set below
+    put8(b, 2);                                 // UPDATE
+
+    put16(b, withdrawn.size() * 4);
+    for (size_t i = 0; i < withdrawn.size(); i++) {
+        put8(b, 24);
+        uint32_t addr = PREFIX_BASE + (withdrawn[i] << 8);
+        put8(b, addr >> 24); put8(b, addr >> 16); put8(b, addr >> 8);
+    }
+
+    if (nlri.size() > 0) {
+        put16(b, 4 + 13 + 7 + 7);               // path attributes length
+
+        put8(b, 0x40); put8(b, 1); put8(b, 1);  // ORIGIN IGP
+        put8(b, 0);
+
+        put8(b, 0x40); put8(b, 2); put8(b, 10); // AS_PATH, one AS_SEQUENCE of two
+        put8(b, 2); put8(b, 2);
+        put32(b, PEER_AS_BASE + peer);
+        put32(b, ORIGIN_AS);
+
+        put8(b, 0x40); put8(b, 3); put8(b, 4);  // NEXT_HOP
+        put32(b, PEER_ADDR_BASE + peer + 1);
+
+        put8(b, 0x80); put8(b, 4); put8(b, 4);  // MULTI_EXIT_DISC
+        put32(b, med);
+
+        for (size_t i = 0; i < nlri.size(); i++) {
+            put8(b, 24);
+            uint32_t addr = PREFIX_BASE + (nlri[i] << 8);
+            put8(b, addr >> 24); put8(b, addr >> 16); put8(b, addr >> 8);
+        }
+    } else
+        put16(b, 0);
+
+    set16(b, start + 16, b.size() - start);
+}
+
+/**
+ * Append a route monitoring message
+ */
+static void appendRouteMon(string &out, uint32_t peer, const vector<uint32_t> &withdrawn,
+                           const vector<uint32_t> &nlri, uint32_t med) {
+    string body;
+    appendPeerHeader(body, peer);
+    appendUpdate(body, withdrawn, nlri, peer, med);
+    appendBmp(out, BMP_MSG_ROUTE_MON, body);
+}
+
+/**
+ * Queue the initiation message and a peer up for each peer
+ */
+static void queueSessionStart(Session &s, size_t index, uint32_t peers) {
+    char name[64];
+    string body;
+
+    snprintf(name, sizeof(name), "scale-bench-%zu", index);
+
+    put16(body, 2);                             // sysName
+    put16(body, strlen(name));
+    body.append(name);
+    put16(body, 1);                             // sysDescr
+    put16(body, strlen("openbmpd scale bench"));
+    body.append("openbmpd scale bench");
+    appendBmp(s.out, BMP_MSG_INIT, body);
+
+    for (uint32_t p = 0; p < peers; p++) {
+        body.clear();
+        appendPeerHeader(body, p);
+        body.append(12, '\0');                  // local address
+        put32(body, s.src_addr);
+        put16(body, 179);                       // local port
+        put16(body, 50000 + p);                 // remote port
+        appendOpen(body, ROUTER_AS, s.src_addr);
+        appendOpen(body, PEER_AS_BASE + p, PEER_ADDR_BASE + p + 1);
+        appendBmp(s.out, BMP_MSG_PEER_UP, body);
+    }
+}
+
+/**
+ * Queue table updates until the session has OUT_HIGH_WATER bytes pending or the table is sent
+ *
+ * \return true when the table, including the End-of-RIB of each peer, is queued
+ */
+static bool queueTable(Session &s, uint32_t peers, uint32_t prefixes) {
+    vector<uint32_t> none, nlri;
+
+    while (s.out.size() - s.out_off < OUT_HIGH_WATER) {
+        if (s.next_peer >= peers)
+            return true;
+
+        nlri.clear();
+        while (s.next_prefix < prefixes and nlri.size() < UPDATE_MAX_PREFIXES)
+            nlri.push_back(s.next_prefix++);
+
+        if (nlri.size() > 0)
+            appendRouteMon(s.out, s.next_peer, none, nlri, s.med);
+
+        if (s.next_prefix >= prefixes) {
+            appendRouteMon(s.out, s.next_peer, none, none, 0);     // End-of-RIB
+            s.next_peer++;
+            s.next_prefix = 0;
+        }
+    }
+
+    return s.next_peer >= peers;
+}
+
+/**
+ * Queue one churn update: a random prefix of a random peer is withdrawn or announced with a new MED
+ */
+static void queueChurn(Session &s, mt19937 &rng, uint32_t peers, uint32_t prefixes, int withdraw_pct) {
+    vector<uint32_t> prefix(1), none;
+    uint32_t peer = rng() % peers;
+    prefix[0] = rng() % prefixes;
+
+    size_t idx = (size_t)peer * prefixes + prefix[0];
+
+    if (not s.withdrawn[idx] and (int)(rng() % 100) < withdraw_pct) {
+        s.withdrawn[idx] = true;
+        appendRouteMon(s.out, peer, prefix, none, 0);
+    } else {
+        s.withdrawn[idx] = false;
+        appendRouteMon(s.out, peer, none, prefix, ++s.med);
+    }
+}
+
+/**
+ * Start a non-blocking connect from the session source address
+ *
+ * \return false if the connect failed right away
+ */
+static bool startConnect(Session &s, const sockaddr_in &collector) {
+    sockaddr_in src;
+
+    if ((s.fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+        return false;
+
+    fcntl(s.fd, F_SETFL, fcntl(s.fd, F_GETFL) | O_NONBLOCK);
+
+    bzero(&src, sizeof(src));
+    src.sin_family = AF_INET;
+    src.sin_addr.s_addr = htonl(s.src_addr);
+
+    if (bind(s.fd, (sockaddr *)&src, sizeof(src)) != 0 or
+            (connect(s.fd, (sockaddr *)&collector, sizeof(collector)) != 0 and errno != EINPROGRESS)) {
+        close(s.fd);
+        s.fd = -1;
+        return false;
+    }
+
+    s.state = SESS_CONNECTING;
+    return true;
+}
+
+/**
+ * Sample RSS, threads and open fds of a process
+ *
+ * \return false if the process cannot be read
+ */
+static bool sampleProcess(pid_t pid, ProcSample &sample) {
+    char path[64], line[256];
+
+    sample.rss_kb = 0;
+    sample.threads = 0;
+    sample.fds = 0;
+
+    snprintf(path, sizeof(path), "/proc/%d/status", (int)pid);
+    FILE *fp = fopen(path, "r");
+    if (fp == NULL)
+        return false;
+
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        if (!strncmp(line, "VmRSS:", 6))
+            sample.rss_kb = atol(line + 6);
+        else if (!strncmp(line, "Threads:", 8))
+            sample.threads = atoi(line + 8);
+    }
+    fclose(fp);
+
+    snprintf(path, sizeof(path), "/proc/%d/fd", (int)pid);
+    DIR *dir = opendir(path);
+    if (dir != NULL) {
+        dirent *ent;
+        while ((ent = readdir(dir)) != NULL) {
+            if (ent->d_name[0] != '.')
+                sample.fds++;
+        }
+        closedir(dir);
+    }
+
+    return true;
+}
+
+/**
+ * Record the sessions named by a router message (TSV or JSON records)
+ */
+static void watchMessage(PublishWatch &watch, const char *data, size_t len) {
+    string payload(data, len);
+    uint64_t now_us = KafkaProduceStats::now();
+
+    // Skip the message headers
+    size_t pos = payload.find("\n\n");
+    pos = pos == string::npos ? 0 : pos + 2;
+
+    while (pos < payload.size()) {
+        size_t eol = payload.find('\n', pos);
+        if (eol == string::npos)
+            eol = payload.size();
+
+        string line = payload.substr(pos, eol - pos);
+        string ip;
+        pos = eol + 1;
+
+        if (line.size() > 0 and line[0] == '{') {
+            size_t start = line.find("\"ip_address\":\"");
+            if (start != string::npos) {
+                start += strlen("\"ip_address\":\"");
+                ip = line.substr(start, line.find('"', start) - start);
+            }
+        } else {
+            // action, seq, name, hash, ip_address, ...
+            size_t start = 0;
+            for (int field = 0; field < 4 and start != string::npos; field++) {
+                start = line.find('\t', start);
+                if (start != string::npos)
+                    start++;
+            }
+
+            if (start != string::npos)
+                ip = line.substr(start, line.find('\t', start) - start);
+        }
+
+        unordered_map<string, size_t>::iterator it = watch.ips.find(ip);
+        if (it != watch.ips.end()) {
+            std::lock_guard<std::mutex> guard(watch.lock);
+            if (watch.first_us[it->second] == 0) {
+                watch.first_us[it->second] = now_us;
+                watch.seen++;
+            }
+        }
+    }
+}
+
+/**
+ * Create a consumer of the router topic and wait until it has partitions assigned
+ *
+ * \return consumer or NULL on error
+ */
+static RdKafka::KafkaConsumer *createConsumer(const char *brokers, const char *topic) {
+    string errstr;
+    char group[64];
+    RdKafka::Conf *conf = RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL);
+
+    snprintf(group, sizeof(group), "openbmpd-scale-bench-%d", (int)getpid());
+
+    if (conf->set("metadata.broker.list", brokers, errstr) != RdKafka::Conf::CONF_OK or
+            conf->set("group.id", group, errstr) != RdKafka::Conf::CONF_OK or
+            conf->set("enable.auto.commit", "false", errstr) != RdKafka::Conf::CONF_OK or
+            conf->set("auto.offset.reset", "latest", errstr) != RdKafka::Conf::CONF_OK) {
+        printf("ERROR: consumer config: %s\n", errstr.c_str());
+        delete conf;
+        return NULL;
+    }
+
+    RdKafka::KafkaConsumer *consumer = RdKafka::KafkaConsumer::create(conf, errstr);
+    delete conf;
+
+    if (consumer == NULL) {
+        printf("ERROR: failed to create the consumer: %s\n", errstr.c_str());
+        return NULL;
+    }
+
+    vector<string> topics(1, topic);
+    if (consumer->subscribe(topics) != RdKafka::ERR_NO_ERROR) {
+        printf("ERROR: failed to subscribe to %s\n", topic);
+        delete consumer;
+        return NULL;
+    }
+
+    // Messages published before the assignment would be missed
+    for (int i = 0; i < 300 and not stop_run; i++) {
+        vector<RdKafka::TopicPartition *> parts;
+
+        delete consumer->consume(100);
+
+        consumer->assignment(parts);
+        bool assigned = parts.size() > 0;
+        RdKafka::TopicPartition::destroy(parts);
+
+        if (assigned)
+            return consumer;
+    }
+
+    printf("ERROR: no partitions of %s assigned after 30 seconds\n", topic);
+    consumer->close();
+    delete consumer;
+    return NULL;
+}
+
+static void Usage(char *prog) {
+    printf("Usage: %s <options>\n", prog);
+    printf("\nOPTIONAL OPTIONS:\n");
+    printf("     -a <address>       Collector address (default: 127.0.0.1)\n");
+    printf("     -p <port>          Collector BMP port (default: 5000)\n");
+    printf("     -n <sessions>      Number of BMP sessions (default: 1000)\n");
+    printf("     -s <address>       Source address of the first session, incremented per session (default: 127.1.0.1)\n");
+    printf("     -r <rate>          Sessions started per second, 0 for all at once (default: 100)\n");
+    printf("     -P <peers>         Peers per session (default: 2, max 1000)\n");
+    printf("     -x <prefixes>      Prefixes per peer (default: 1000, max 1000000)\n");
+    printf("     -u <rate>          Churn updates per second per session, after its table (default: 1)\n");
+    printf("     -w <percent>       Percent of churn updates that are withdrawals (default: 20)\n");
+    printf("     -d <seconds>       Run time after the last session is started (default: 60)\n");
+    printf("     -i <pid>           openbmpd process ID, for RSS, thread and fd accounting\n");
+    printf("     -I <seconds>       Sample interval (default: 5)\n");
+    printf("     -k <brokers>       Kafka brokers, to measure accept to first publish latency\n");
+    printf("     -t <topic>         Router topic (default: openbmp.parsed.router), TSV or JSON format\n");
+}
+
+int main(int argc, char **argv) {
+    const char *collector_addr = "127.0.0.1";
+    const char *src_base = "127.1.0.1";
+    const char *brokers = NULL;
+    const char *topic = "openbmp.parsed.router";
+    int port = 5000;
+    int sessions = 1000;
+    int connect_rate = 100;
+    int peers = 2;
+    int prefixes = 1000;
+    double churn_rate = 1;
+    int withdraw_pct = 20;
+    int duration = 60;
+    int sample_interval = 5;
+    pid_t pid = 0;
+
+    for (int i = 1; i < argc; i++) {
+        bool has_value = i + 1 < argc and argv[i + 1][0] != '-';
+
+        if (!strcmp(argv[i], "-h") or !strcmp(argv[i], "--help")) {
+            Usage(argv[0]);
+            return 0;
+        } else if (not has_value) {
+            printf("INVALID ARG: %s expects a value\n", argv[i]);
+            Usage(argv[0]);
+            return 1;
+        } else if (!strcmp(argv[i], "-a"))
+            collector_addr = argv[++i];
+        else if (!strcmp(argv[i], "-p"))
+            port = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n"))
+            sessions = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s"))
+            src_base = argv[++i];
+        else if (!strcmp(argv[i], "-r"))
+            connect_rate = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-P"))
+            peers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-x"))
+            prefixes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-u"))
+            churn_rate = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-w"))
+            withdraw_pct = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-d"))
+            duration = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-i"))
+            pid = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-I"))
+            sample_interval = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-k"))
+            brokers = argv[++i];
+        else if (!strcmp(argv[i], "-t"))
+            topic = argv[++i];
+        else {
+            printf("INVALID ARG: %s\n", argv[i]);
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    sockaddr_in collector;
+    in_addr src_addr;
+
+    bzero(&collector, sizeof(collector));
+    collector.sin_family = AF_INET;
+    collector.sin_port = htons(port);
+
+    if (inet_pton(AF_INET, collector_addr, &collector.sin_addr) != 1 or
+            inet_pton(AF_INET, src_base, &src_addr) != 1 or port < 1 or port > 65535 or
+            sessions < 1 or connect_rate < 0 or peers < 1 or peers > 1000 or prefixes < 1 or
+            prefixes > 1000000 or churn_rate < 0 or withdraw_pct < 0 or withdraw_pct > 100 or
+            duration < 0 or sample_interval < 1) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    // Each session is a socket
+    rlimit nofile;
+    if (getrlimit(RLIMIT_NOFILE, &nofile) == 0) {
+        nofile.rlim_cur = nofile.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &nofile);
+
+        if (nofile.rlim_cur < (rlim_t)sessions + 64)
+            printf("WARNING: open file limit %lu is too low for %d sessions\n", (unsigned long)nofile.rlim_cur, sessions);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, signal_stop);
+    signal(SIGTERM, signal_stop);
+
+    vector<Session> sess(sessions);
+    for (int i = 0; i < sessions; i++) {
+        in_addr addr;
+
+        sess[i].fd = -1;
+        sess[i].state = SESS_IDLE;
+        sess[i].src_addr = ntohl(src_addr.s_addr) + i;
+        sess[i].established_us = 0;
+        sess[i].out_off = 0;
+        sess[i].next_peer = 0;
+        sess[i].next_prefix = 0;
+        sess[i].next_churn_us = 0;
+        sess[i].med = 0;
+
+        addr.s_addr = htonl(sess[i].src_addr);
+        inet_ntop(AF_INET, &addr, sess[i].ip, sizeof(sess[i].ip));
+    }
+
+    // Watch the router topic for the first message of each session
+    PublishWatch watch;
+    RdKafka::KafkaConsumer *consumer = NULL;
+    std::thread consumer_thr;
+
+    watch.run = true;
+    watch.seen = 0;
+    watch.first_us.assign(sessions, 0);
+
+    if (brokers != NULL) {
+        for (int i = 0; i < sessions; i++)
+            watch.ips[sess[i].ip] = i;
+
+        if ((consumer = createConsumer(brokers, topic)) == NULL)
+            return 2;
+
+        consumer_thr = std::thread([&] {
+            while (watch.run) {
+                RdKafka::Message *msg = consumer->consume(100);
+
+                if (msg->err() == RdKafka::ERR_NO_ERROR)
+                    watchMessage(watch, (const char *)msg->payload(), msg->len());
+
+                delete msg;
+            }
+        });
+    }
+
+    ProcSample base, sample, peak;
+    bzero(&base, sizeof(base));
+    bzero(&peak, sizeof(peak));
+
+    if (pid > 0 and not sampleProcess(pid, base)) {
+        printf("ERROR: cannot read /proc/%d\n", (int)pid);
+        return 2;
+    }
+
+    printf("collector: %s:%d, sessions: %d from %s at %d/s, peers: %d x %d prefixes, churn: %.1f/s\n",
+           collector_addr, port, sessions, src_base, connect_rate, peers, prefixes, churn_rate);
+    if (pid > 0)
+        printf("collector pid %d baseline: rss %.1f MB, %d threads, %d fds\n",
+               (int)pid, base.rss_kb / 1024.0, base.threads, base.fds);
+
+    printf("%8s %8s %8s %8s %8s %8s %9s %8s %8s %9s %9s %8s %9s\n",
+           "elapsed", "started", "estab", "table", "publish", "backlog", "rss_MB", "threads", "fds",
+           "KB/sess", "thr/sess", "fd/sess", "sent_MB");
+
+    mt19937 rng(1);
+    vector<pollfd> pfds;
+    vector<size_t> pfd_sess;
+    char discard[4096];
+    uint64_t start_us = KafkaProduceStats::now();
+    uint64_t next_sample_us = start_us;
+    uint64_t last_start_us = 0;
+    uint64_t churn_interval_us = churn_rate > 0 ? (uint64_t)(1000000 / churn_rate) : 0;
+    uint64_t sent_bytes = 0;
+    int started = 0, failed = 0, closed = 0;
+
+    while (not stop_run) {
+        uint64_t now_us = KafkaProduceStats::now();
+
+        // Ramp up the sessions
+        while (started < sessions and
+               (connect_rate == 0 or now_us >= start_us + (uint64_t)started * 1000000 / connect_rate)) {
+            if (not startConnect(sess[started], collector)) {
+                sess[started].state = SESS_CLOSED;
+                failed++;
+            }
+            started++;
+
+            if (started == sessions)
+                last_start_us = now_us;
+        }
+
+        if (started == sessions and now_us - last_start_us >= (uint64_t)duration * 1000000)
+            break;
+
+        // Queue output and build the poll list
+        pfds.clear();
+        pfd_sess.clear();
+
+        int established = 0, table_done = 0, backlogged = 0;
+
+        for (size_t i = 0; i < sess.size(); i++) {
+            Session &s = sess[i];
+            pollfd pfd;
+
+            if (s.state == SESS_IDLE or s.state == SESS_CLOSED)
+                continue;
+
+            pfd.fd = s.fd;
+            pfd.events = POLLIN;
+            pfd.revents = 0;
+
+            if (s.state == SESS_CONNECTING)
+                pfd.events = POLLOUT;
+
+            else {
+                established++;
+
+                if (s.state == SESS_TABLE and queueTable(s, peers, prefixes)) {
+                    s.state = SESS_CHURN;
+                    s.next_churn_us = now_us + churn_interval_us;
+                }
+
+                if (s.state == SESS_CHURN) {
+                    table_done++;
+
+                    while (churn_interval_us > 0 and now_us >= s.next_churn_us) {
+                        if (s.out.size() - s.out_off < OUT_HIGH_WATER)
+                            queueChurn(s, rng, peers, prefixes, withdraw_pct);
+                        s.next_churn_us += churn_interval_us;
+                    }
+                }
+
+                if (s.out.size() > s.out_off)
+                    pfd.events |= POLLOUT;
+
+                if (s.out.size() - s.out_off >= OUT_HIGH_WATER)
+                    backlogged++;
+            }
+
+            pfds.push_back(pfd);
+            pfd_sess.push_back(i);
+        }
+
+        // Report
+        if (now_us >= next_sample_us) {
+            size_t published;
+            {
+                std::lock_guard<std::mutex> guard(watch.lock);
+                published = watch.seen;
+            }
+
+            bzero(&sample, sizeof(sample));
+            if (pid > 0 and sampleProcess(pid, sample)) {
+                peak.rss_kb = max(peak.rss_kb, sample.rss_kb);
+                peak.threads = max(peak.threads, sample.threads);
+                peak.fds = max(peak.fds, sample.fds);
+            }
+
+            // Sessions counted by the collector: those published if known, else those established
+            double count = brokers != NULL ? published : established;
+            if (count < 1)
+                count = 1;
+
+            printf("%8.1f %8d %8d %8d %8zu %8d %9.1f %8d %8d %9.1f %9.2f %8.2f %9.1f\n",
+                   (now_us - start_us) / 1000000.0, started, established, table_done, published, backlogged,
+                   sample.rss_kb / 1024.0, sample.threads, sample.fds,
+                   (sample.rss_kb - base.rss_kb) / count, (sample.threads - base.threads) / count,
+                   (sample.fds - base.fds) / count, sent_bytes / 1000000.0);
+            fflush(stdout);
+
+            next_sample_us += (uint64_t)sample_interval * 1000000;
+        }
+
+        if (poll(pfds.data(), pfds.size(), 10) < 0) {
+            if (errno == EINTR)
+                continue;
+            printf("ERROR: poll: %s\n", strerror(errno));
+            break;
+        }
+
+        now_us = KafkaProduceStats::now();
+
+        for (size_t i = 0; i < pfds.size(); i++) {
+            Session &s = sess[pfd_sess[i]];
+            bool error = false;
+
+            if (pfds[i].revents == 0)
+                continue;
+
+            if (s.state == SESS_CONNECTING) {
+                int err = 0;
+                socklen_t err_len = sizeof(err);
+
+                getsockopt(s.fd, SOL_SOCKET, SO_ERROR, &err, &err_len);
+                if (err != 0) {
+                    failed++;
+                    error = true;
+                } else {
+                    s.state = SESS_TABLE;
+                    s.established_us = now_us;
+                    s.withdrawn.assign((size_t)peers * prefixes, false);
+                    queueSessionStart(s, pfd_sess[i], peers);
+                }
+
+            } else {
+                if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                    ssize_t n = recv(s.fd, discard, sizeof(discard), 0);
+                    if (n == 0 or (n < 0 and errno != EAGAIN and errno != EINTR))
+                        error = true;
+                }
+
+                if (not error and (pfds[i].revents & POLLOUT)) {
+                    ssize_t n = send(s.fd, s.out.data() + s.out_off, s.out.size() - s.out_off, MSG_NOSIGNAL);
+
+                    if (n > 0) {
+                        s.out_off += n;
+                        sent_bytes += n;
+
+                        if (s.out_off == s.out.size()) {
+                            s.out.clear();
+                            s.out_off = 0;
+                        }
+                    } else if (n < 0 and errno != EAGAIN and errno != EINTR)
+                        error = true;
+                }
+
+                if (error)
+                    closed++;
+            }
+
+            if (error) {
+                close(s.fd);
+                s.fd = -1;
+                s.state = SESS_CLOSED;
+                string().swap(s.out);
+                vector<bool>().swap(s.withdrawn);
+            }
+        }
+    }
+
+    // Final sample before the sessions are closed
+    bzero(&sample, sizeof(sample));
+    if (pid > 0 and sampleProcess(pid, sample)) {
+        peak.rss_kb = max(peak.rss_kb, sample.rss_kb);
+        peak.threads = max(peak.threads, sample.threads);
+        peak.fds = max(peak.fds, sample.fds);
+    }
+
+    for (size_t i = 0; i < sess.size(); i++) {
+        if (sess[i].fd >= 0)
+            close(sess[i].fd);
+    }
+
+    if (consumer != NULL) {
+        watch.run = false;
+        consumer_thr.join();
+        consumer->close();
+        delete consumer;
+    }
+
+    // Summary
+    int established = 0;
+    vector<uint32_t> latency_us;
+
+    for (size_t i = 0; i < sess.size(); i++) {
+        if (sess[i].established_us == 0)
+            continue;
+
+        established++;
+        if (watch.first_us[i] > sess[i].established_us)
+            latency_us.push_back(watch.first_us[i] - sess[i].established_us);
+    }
+
+    printf("\nsessions: %d started, %d established, %d failed, %d closed by the collector\n",
+           started, established, failed, closed);
+
+    if (pid > 0)
+        printf("collector peak: rss %.1f MB, %d threads, %d fds\n",
+               peak.rss_kb / 1024.0, peak.threads, peak.fds);
+
+    if (brokers != NULL) {
+        size_t published = latency_us.size();
+
+        printf("accept to first publish: %zu published, %zu never published",
+               published, (size_t)established - published);
+
+        if (published > 0) {
+            uint32_t max_us = KafkaProduceStats::percentile(latency_us, 100);
+
+            printf(", p50 %.1f ms, p90 %.1f ms, p99 %.1f ms, max %.1f ms",
+                   KafkaProduceStats::percentile(latency_us, 50) / 1000.0,
+                   KafkaProduceStats::percentile(latency_us, 90) / 1000.0,
+                   KafkaProduceStats::percentile(latency_us, 99) / 1000.0, max_us / 1000.0);
+        }
+        printf("\n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,563 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "ArrowBatch.h"
+
+#include <chrono>
+
+namespace {
+
+    /*
+     * Arrow IPC format constants (Schema.fbs and Message.fbs of the Arrow format)
+     */
+    const int16_t   ARROW_METADATA_V5           = 4;
+    const uint8_t   ARROW_HEADER_SCHEMA         = 1;
+    const uint8_t   ARROW_HEADER_RECORD_BATCH   = 3;
+    const uint8_t   ARROW_TYPE_INT              = 2;
+    const uint8_t   ARROW_TYPE_UTF8             = 5;
+    const uint8_t   ARROW_TYPE_BOOL             = 6;
+    const uint8_t   ARROW_TYPE_TIMESTAMP        = 10;
+    const uint8_t   ARROW_TYPE_FIXED_BINARY     = 15;
+    const int16_t   ARROW_TIME_UNIT_MICROSECOND = 2;
+    const uint32_t  ARROW_CONTINUATION          = 0xFFFFFFFF;
+
+    /**
+     * Append a value in little endian byte order
+     */
+    template <typename T>
+    inline void put_le(std::string &s, T value) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        s.append((const char *)&value, sizeof(T));
+#else
+        for (size_t i = 0; i < sizeof(T); i++)
+            s.push_back((char)((uint64_t)value >> (8 * i)));
+#endif
+    }
+
+    /**
+     * Pad to a multiple of 8 bytes, the alignment of Arrow IPC messages and buffers
+     */
+    inline void pad8(std::string &s) {
+        s.append((8 - (s.size() & 7)) & 7, '\0');
+    }
+
+    /**
+     * \class   FbBuilder
+     *
+     * \brief   Minimal flatbuffer builder for the Arrow IPC metadata
+     * \details Same layout rules as the flatbuffers library: the buffer is built
+     *          back to front, so objects are referred to by their distance from the
+     *          end of the buffer, and children are created before their parent.
+     *          The metadata is small and built once per batch, so prepending to a
+     *          string is fast enough.
+     */
+    class FbBuilder {
+    public:
+        FbBuilder() : minalign(1), table_start(0) {
+        }
+
+        uint32_t size() const { return buf.size(); }
+
+        template <typename T>
+        void push(T value) {
+            prealign(sizeof(T), sizeof(T));
+
+            std::string le;
+            put_le(le, value);
+            buf.insert(0, le);
+        }
+
+        uint32_t string(const char *s) {
+            size_t n = strlen(s);
+
+            prealign(n + 1, 4);
+            buf.insert(0, 1, '\0');
+            buf.insert(0, s, n);
+            push<uint32_t>(n);
+            return size();
+        }
+
+        uint32_t offsetVector(const std::vector<uint32_t> &offsets) {
+            prealign(offsets.size() * 4, 4);
+
+            for (size_t i = offsets.size(); i-- > 0; )
+                push<uint32_t>(size() + 4 - offsets[i]);
+
+            push<uint32_t>(offsets.size());
+            return size();
+        }
+
+        uint32_t structVector(const std::string &elems, size_t count, size_t alignment) {
+            prealign(elems.size(), 4);
+            prealign(elems.size(), alignment);
+            buf.insert(0, elems);
+            push<uint32_t>(count);
+            return size();
+        }
+
+        void startTable() {
+            fields.clear();
+            table_start = size();
+        }
+
+        template <typename T>
+        void add(uint16_t id, T value) {
+            push(value);
+            fields.push_back(field(id, size()));
+        }
+
+        void addOffset(uint16_t id, uint32_t offset) {
+            prealign(4, 4);
+            push<uint32_t>(size() + 4 - offset);
+            fields.push_back(field(id, size()));
+        }
+
+        uint32_t endTable() {
+            push<int32_t>(0);                   // vtable offset, set below
+            uint32_t table = size();
+
+            uint16_t count = 0;
+            for (size_t i = 0; i < fields.size(); i++)
+                if (fields[i].first >= count)
+                    count = fields[i].first + 1;
+
+            std::vector<uint16_t> vtable(2 + count, 0);
+            vtable[0] = vtable.size() * 2;
+            vtable[1] = table - table_start;
+
+            for (size_t i = 0; i < fields.size(); i++)
+                vtable[2 + fields[i].first] = table - fields[i].second;
+
+            for (size_t i = vtable.size(); i-- > 0; )
+                push<uint16_t>(vtable[i]);
+
+            // The vtable is right before the table
+            std::string soffset;
+            put_le<int32_t>(soffset, size() - table);
+            buf.replace(buf.size() - table, 4, soffset);
+
+            return table;
+        }
+
+        /**
+         * Complete the buffer
+         *
+         * \return the flatbuffer, a multiple of 8 bytes
+         */
+        const std::string &finish(uint32_t root) {
+            prealign(4, minalign < 8 ? 8 : minalign);
+            push<uint32_t>(size() + 4 - root);
+            return buf;
+        }
+
+    private:
+        typedef std::pair<uint16_t, uint32_t> field;    ///< Field ID and its distance from the end
+
+        std::string         buf;
+        size_t              minalign;
+        uint32_t            table_start;
+        std::vector<field>  fields;
+
+        /**
+         * Pad so that len bytes prepended next end on the alignment
+         */
+        void prealign(size_t len, size_t alignment) {
+            if (alignment > minalign)
+                minalign = alignment;
+
+            buf.insert(0, (alignment - ((buf.size() + len) & (alignment - 1))) & (alignment - 1), '\0');
+        }
+    };
+
+    /**
+     * Append an encapsulated IPC message (continuation, metadata length, metadata)
+     */
+    void putMessage(std::string &out, const std::string &metadata) {
+        put_le<uint32_t>(out, ARROW_CONTINUATION);
+        put_le<int32_t>(out, metadata.size());
+        out.append(metadata);
+    }
+
+} /* namespace */
+
+/**
+ * Constructor for class
+ *
+ * \param [in] logPtr   Logger
+ * \param [in] defs     Column definitions, in row order
+ * \param [in] count    Number of columns
+ */
+ArrowBatch::ArrowBatch(Logger *logPtr, const column_def *defs, size_t count) : logger(logPtr), dropped(0) {
+    cols.resize(count);
+
+    for (size_t i = 0; i < count; i++) {
+        cols[i].name = defs[i].name;
+        cols[i].type = defs[i].type;
+    }
+
+    clear();
+}
+
+/**
+ * Current monotonic time in milliseconds
+ */
+uint64_t ArrowBatch::now() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Remove all rows
+ */
+void ArrowBatch::clear() {
+    for (size_t i = 0; i < cols.size(); i++) {
+        cols[i].values.clear();
+        cols[i].offsets.clear();
+
+        if (cols[i].type == COL_UTF8)
+            cols[i].offsets.push_back(0);
+    }
+
+    next_col = 0;
+    row_failed = false;
+    row_count = 0;
+    data_bytes = 0;
+    row_start_bytes = 0;
+    first_row_ms = 0;
+}
+
+/**
+ * Milliseconds until the batch is older than max_age_ms, -1 if it has no rows
+ */
+int ArrowBatch::msUntilAge(uint32_t max_age_ms) const {
+    if (row_count == 0)
+        return -1;
+
+    uint64_t expires = first_row_ms + max_age_ms;
+    uint64_t now_ms = now();
+
+    return expires > now_ms ? (int)(expires - now_ms) : 0;
+}
+
+/**
+ * Get the column of the next value
+ */
+ArrowBatch::column *ArrowBatch::next(column_type type) {
+    if (row_failed)
+        return NULL;
+
+    if (next_col >= cols.size() or cols[next_col].type != type) {
+        LOG_ERR("Arrow value of type %d does not match column %zu (%s)", type, next_col,
+                next_col < cols.size() ? cols[next_col].name : "none");
+        row_failed = true;
+        return NULL;
+    }
+
+    return &cols[next_col++];
+}
+
+/**
+ * Remove the values of the current row from the columns
+ *
+ * \details Columns before next_col have one value more than row_count.
+ */
+void ArrowBatch::dropRow() {
+    for (size_t i = 0; i < next_col; i++) {
+        column &c = cols[i];
+
+        switch (c.type) {
+            case COL_UTF8:
+                c.offsets.pop_back();
+                c.values.resize(c.offsets.back());
+                break;
+
+            case COL_BOOL:
+                if ((row_count & 7) == 0)
+                    c.values.resize(c.values.size() - 1);
+                else
+                    c.values[c.values.size() - 1] &= (1 << (row_count & 7)) - 1;
+                break;
+
+            case COL_UINT8:     c.values.resize(row_count);      break;
+            case COL_UINT16:    c.values.resize(row_count * 2);  break;
+            case COL_UINT32:    c.values.resize(row_count * 4);  break;
+            case COL_UINT64:
+            case COL_TIMESTAMP: c.values.resize(row_count * 8);  break;
+            case COL_HASH:      c.values.resize(row_count * 16); break;
+        }
+    }
+
+    data_bytes = row_start_bytes;
+    next_col = 0;
+    row_failed = false;
+    ++dropped;
+}
+
+/**
+ * Start a row
+ */
+ArrowBatch &ArrowBatch::begin() {
+    // A row without end() is incomplete
+    if (next_col > 0 or row_failed) {
+        LOG_ERR("Arrow row has %zu of %zu values", next_col, cols.size());
+        dropRow();
+    }
+
+    row_start_bytes = data_bytes;
+
+    if (row_count == 0)
+        first_row_ms = now();
+
+    return *this;
+}
+
+/**
+ * Complete the row started by begin()
+ */
+bool ArrowBatch::end() {
+    if (not row_failed and next_col != cols.size()) {
+        LOG_ERR("Arrow row has %zu of %zu values", next_col, cols.size());
+        row_failed = true;
+    }
+
+    if (row_failed) {
+        dropRow();
+        return false;
+    }
+
+    next_col = 0;
+    ++row_count;
+    return true;
+}
+
+ArrowBatch &ArrowBatch::str(const char *s, size_t n) {
+    column *c = next(COL_UTF8);
+
+    if (c == NULL)
+        return *this;
+
+    c->values.append(s, n);
+    c->offsets.push_back(c->values.size());
+    data_bytes += n + 4;
+    return *this;
+}
+
+ArrowBatch &ArrowBatch::str(const std::string &a, char sep, const std::string &b) {
+    column *c = next(COL_UTF8);
+
+    if (c == NULL)
+        return *this;
+
+    c->values.append(a).append(1, sep).append(b);
+    c->offsets.push_back(c->values.size());
+    data_bytes += a.size() + 1 + b.size() + 4;
+    return *this;
+}
+
+ArrowBatch &ArrowBatch::boolean(bool value) {
+    column *c = next(COL_BOOL);
+
+    if (c == NULL)
+        return *this;
+
+    if ((row_count & 7) == 0) {
+        c->values.push_back(0);
+        ++data_bytes;
+    }
+
+    if (value)
+        c->values[c->values.size() - 1] |= 1 << (row_count & 7);
+
+    return *this;
+}
+
+template <typename T>
+ArrowBatch &ArrowBatch::fixed(column_type type, T value) {
+    column *c = next(type);
+
+    if (c == NULL)
+        return *this;
+
+    put_le(c->values, value);
+    data_bytes += sizeof(T);
+    return *this;
+}
+
+ArrowBatch &ArrowBatch::u8(uint8_t value)       { return fixed(COL_UINT8, value); }
+ArrowBatch &ArrowBatch::u16(uint16_t value)     { return fixed(COL_UINT16, value); }
+ArrowBatch &ArrowBatch::u32(uint32_t value)     { return fixed(COL_UINT32, value); }
+ArrowBatch &ArrowBatch::u64(uint64_t value)     { return fixed(COL_UINT64, value); }
+
+ArrowBatch &ArrowBatch::ts(uint32_t secs, uint32_t us) {
+    return fixed(COL_TIMESTAMP, (int64_t)secs * 1000000 + us);
+}
+
+ArrowBatch &ArrowBatch::hash(const u_char *hash_id) {
+    static const u_char zero[16] = { 0 };
+    column *c = next(COL_HASH);
+
+    if (c == NULL)
+        return *this;
+
+    c->values.append((const char *)(hash_id != NULL ? hash_id : zero), 16);
+    data_bytes += 16;
+    return *this;
+}
+
+/**
+ * Build the encapsulated schema message
+ */
+void ArrowBatch::encodeSchema() {
+    FbBuilder fb;
+    std::vector<uint32_t> fields;
+
+    for (size_t i = 0; i < cols.size(); i++) {
+        uint32_t name = fb.string(cols[i].name);
+        uint32_t children = fb.offsetVector(std::vector<uint32_t>());
+        uint32_t type;
+        uint8_t  type_type;
+
+        switch (cols[i].type) {
+            case COL_UTF8:
+            case COL_BOOL:
+                type_type = cols[i].type == COL_UTF8 ? ARROW_TYPE_UTF8 : ARROW_TYPE_BOOL;
+                fb.startTable();
+                type = fb.endTable();
+                break;
+
+            case COL_HASH:
+                type_type = ARROW_TYPE_FIXED_BINARY;
+                fb.startTable();
+                fb.add<int32_t>(0, 16);                         // byteWidth
+                type = fb.endTable();
+                break;
+
+            case COL_TIMESTAMP: {
+                type_type = ARROW_TYPE_TIMESTAMP;
+                uint32_t tz = fb.string("UTC");
+                fb.startTable();
+                fb.addOffset(1, tz);                            // timezone
+                fb.add<int16_t>(0, ARROW_TIME_UNIT_MICROSECOND);
+                type = fb.endTable();
+                break;
+            }
+
+            default: {
+                static const int32_t widths[] = { 8, 16, 32, 64 };
+
+                type_type = ARROW_TYPE_INT;
+                fb.startTable();
+                fb.add<int32_t>(0, widths[cols[i].type - COL_UINT8]);  // bitWidth
+                fb.add<uint8_t>(1, 0);                          // is_signed
+                type = fb.endTable();
+                break;
+            }
+        }
+
+        fb.startTable();
+        fb.addOffset(0, name);
+        fb.addOffset(3, type);
+        fb.addOffset(5, children);
+        fb.add<uint8_t>(1, 0);                                  // nullable
+        fb.add<uint8_t>(2, type_type);
+        fields.push_back(fb.endTable());
+    }
+
+    uint32_t field_vector = fb.offsetVector(fields);
+
+    fb.startTable();
+    fb.addOffset(1, field_vector);
+    uint32_t schema = fb.endTable();
+
+    fb.startTable();
+    fb.addOffset(2, schema);
+    fb.add<int16_t>(0, ARROW_METADATA_V5);
+    fb.add<uint8_t>(1, ARROW_HEADER_SCHEMA);
+    uint32_t message = fb.endTable();
+
+    schema_msg.clear();
+    putMessage(schema_msg, fb.finish(message));
+}
+
+/**
+ * Encode the rows as an Arrow IPC stream and clear the batch
+ */
+void ArrowBatch::encode(std::string &out) {
+    if (schema_msg.empty())
+        encodeSchema();
+
+    /*
+     * Buffer layout of the body: an empty validity buffer per column (no nulls),
+     *      then the offsets (utf8) and values, each padded to 8 bytes.
+     */
+    std::string nodes, buffers;
+    uint64_t body_len = 0;
+
+    for (size_t i = 0; i < cols.size(); i++) {
+        put_le<int64_t>(nodes, row_count);
+        put_le<int64_t>(nodes, 0);                              // null_count
+
+        put_le<int64_t>(buffers, body_len);                     // validity
+        put_le<int64_t>(buffers, 0);
+
+        if (cols[i].type == COL_UTF8) {
+            uint64_t len = cols[i].offsets.size() * 4;
+
+            put_le<int64_t>(buffers, body_len);
+            put_le<int64_t>(buffers, len);
+            body_len += (len + 7) & ~7ULL;
+        }
+
+        put_le<int64_t>(buffers, body_len);
+        put_le<int64_t>(buffers, cols[i].values.size());
+        body_len += (cols[i].values.size() + 7) & ~7ULL;
+    }
+
+    FbBuilder fb;
+
+    uint32_t buffer_vector = fb.structVector(buffers, buffers.size() / 16, 8);
+    uint32_t node_vector = fb.structVector(nodes, nodes.size() / 16, 8);
+
+    fb.startTable();
+    fb.add<int64_t>(0, row_count);                              // length
+    fb.addOffset(1, node_vector);
+    fb.addOffset(2, buffer_vector);
+    uint32_t batch = fb.endTable();
+
+    fb.startTable();
+    fb.add<int64_t>(3, body_len);                               // bodyLength
+    fb.addOffset(2, batch);
+    fb.add<int16_t>(0, ARROW_METADATA_V5);
+    fb.add<uint8_t>(1, ARROW_HEADER_RECORD_BATCH);
+    uint32_t message = fb.endTable();
+
+    const std::string &metadata = fb.finish(message);
+
+    out.clear();
+    out.reserve(schema_msg.size() + metadata.size() + body_len + 16);
+    out.append(schema_msg);
+    putMessage(out, metadata);
+
+    for (size_t i = 0; i < cols.size(); i++) {
+        if (cols[i].type == COL_UTF8) {
+            for (size_t j = 0; j < cols[i].offsets.size(); j++)
+                put_le<int32_t>(out, cols[i].offsets[j]);
+            pad8(out);
+        }
+
+        out.append(cols[i].values);
+        pad8(out);
+    }
+
+    // End of stream
+    put_le<uint32_t>(out, ARROW_CONTINUATION);
+    put_le<int32_t>(out, 0);
+
+    clear();
+}
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef ARROWBATCH_H_
+#define ARROWBATCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "Logger.h"
+
+/**
+ * \class   ArrowBatch
+ *
+ * \brief   Columnar batch of rows encoded as an Apache Arrow IPC stream
+ * \details Rows are appended a column at a time, in schema order, straight into
+ *          the column buffers.  encode() writes the Arrow IPC streaming format
+ *          (schema message, one record batch and the end of stream marker), which
+ *          can be read by any Arrow implementation, e.g. pyarrow.ipc.open_stream().
+ *
+ *          Columns are not nullable; values that do not apply are written as
+ *          empty strings or zero, same as the TSV fields.
+ *
+ *          A row whose values do not match the column types is a programming
+ *          error; it is logged and dropped, leaving the batch as before the row.
+ *
+ *          Not thread safe.
+ */
+class ArrowBatch {
+public:
+    /// Column types and their Arrow types
+    enum column_type {
+        COL_UTF8=0,                         ///< Utf8
+        COL_BOOL,                           ///< Bool
+        COL_UINT8,                          ///< Int(8, unsigned)
+        COL_UINT16,                         ///< Int(16, unsigned)
+        COL_UINT32,                         ///< Int(32, unsigned)
+        COL_UINT64,                         ///< Int(64, unsigned)
+        COL_HASH,                           ///< FixedSizeBinary(16)
+        COL_TIMESTAMP                       ///< Timestamp(microsecond, "UTC")
+    };
+
+    /// Column definition of the schema
+    struct column_def {
+        const char      *name;              ///< Column name
+        column_type     type;               ///< Column type
+    };
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] logPtr   Logger
+     * \param [in] defs     Column definitions, in row order
+     * \param [in] count    Number of columns
+     */
+    ArrowBatch(Logger *logPtr, const column_def *defs, size_t count);
+
+    /**
+     * Start a row; values are then appended in column order and the row completed by end()
+     */
+    ArrowBatch &begin();
+
+    ArrowBatch &str(const char *s, size_t n);
+    ArrowBatch &str(const char *s)          { return str(s, strlen(s)); }
+    ArrowBatch &str(const std::string &s)   { return str(s.data(), s.size()); }
+
+    /**
+     * Two strings joined by a separator as one value (e.g. a route distinguisher)
+     */
+    ArrowBatch &str(const std::string &a, char sep, const std::string &b);
+
+    ArrowBatch &boolean(bool value);
+    ArrowBatch &u8(uint8_t value);
+    ArrowBatch &u16(uint16_t value);
+    ArrowBatch &u32(uint32_t value);
+    ArrowBatch &u64(uint64_t value);
+
+    /**
+     * 16 byte hash ID, all zeros if NULL
+     */
+    ArrowBatch &hash(const u_char *hash_id);
+
+    ArrowBatch &ts(uint32_t secs, uint32_t us);
+
+    /**
+     * Complete the row started by begin()
+     *
+     * \details The row is dropped if a value did not match its column type or
+     *          the row does not have a value for each column.
+     *
+     * \return true if the row was added, false if it was dropped
+     */
+    bool end();
+
+    /**
+     * Encode the rows as an Arrow IPC stream and clear the batch
+     *
+     * \param [out] out     Encoded stream
+     */
+    void encode(std::string &out);
+
+    /**
+     * Remove all rows
+     */
+    void clear();
+
+    /**
+     * Milliseconds until the batch is older than max_age_ms, -1 if it has no rows
+     */
+    int msUntilAge(uint32_t max_age_ms) const;
+
+    size_t rows() const                 { return row_count; }
+    size_t droppedRows() const          { return dropped; }
+
+    /**
+     * Size of the column data in bytes (the encoded stream adds the metadata and padding)
+     */
+    size_t bytes() const                { return data_bytes; }
+
+private:
+    /// Column of the batch
+    struct column {
+        const char              *name;
+        column_type             type;
+        std::string             values;     ///< Values (packed bits for bool, little endian integers)
+        std::vector<int32_t>    offsets;    ///< Utf8 value offsets, rows + 1
+    };
+
+    Logger                  *logger;        ///< Logging class pointer
+    std::vector<column>     cols;           ///< Columns in schema order
+    size_t                  next_col;       ///< Column of the next value of the current row
+    bool                    row_failed;     ///< True if a value of the current row did not match
+    size_t                  row_count;      ///< Number of complete rows
+    size_t                  dropped;        ///< Rows dropped since construction
+    size_t                  data_bytes;     ///< Size of the column data
+    size_t                  row_start_bytes;///< data_bytes when the current row started
+    uint64_t                first_row_ms;   ///< Time of the first row (steady clock)
+    std::string             schema_msg;     ///< Encoded schema message, built on first use
+
+    /**
+     * Get the column of the next value
+     *
+     * \return column, or NULL if the next column is not of the type (the row is dropped)
+     */
+    column *next(column_type type);
+
+    /**
+     * Remove the values of the current row from the columns
+     */
+    void dropRow();
+
+    /**
+     * Append a fixed width value in little endian byte order
+     */
+    template <typename T>
+    ArrowBatch &fixed(column_type type, T value);
+
+    /**
+     * Build the encapsulated schema message
+     */
+    void encodeSchema();
+
+    /**
+     * Current monotonic time in milliseconds
+     */
+    static uint64_t now();
+};
+
+#endif /* ARROWBATCH_H_ */
@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef BINARYFORMAT_H_
+#define BINARYFORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/types.h>
+#include <arpa/inet.h>
+
+/**
+ * Binary record encoding used by the message bus serializers
+ *
+ * \details Records are length prefixed and hold fixed width fields in network
+ *          byte order.  Field types (see docs/MESSAGE_BUS_API.md):
+ *
+ *              u8, u16, u32, u64   Unsigned integer in network byte order
+ *              hash                16 byte binary hash ID
+ *              addr                u8 length (0, 4 or 16) followed by the address
+ *              str                 u32 length followed by the bytes, not NULL terminated
+ *              ts                  u32 seconds since EPOC, u32 microseconds
+ *
+ *          A record is a u32 length of the fields that follow, so readers can
+ *          skip records or trailing fields added by a later schema version.
+ */
+namespace binfmt {
+
+    /**
+     * Parse an IPv4 or IPv6 address in printed form
+     *
+     * \param [in]  addr    Address in printed form
+     * \param [out] bin     16 byte buffer for the address
+     *
+     * \return length of the address (4 or 16), zero if empty or not valid
+     */
+    inline uint8_t parseAddr(const char *addr, u_char *bin) {
+        if (addr[0] == 0)
+            return 0;
+
+        if (strchr(addr, ':') != NULL)
+            return inet_pton(AF_INET6, addr, bin) == 1 ? 16 : 0;
+
+        return inet_pton(AF_INET, addr, bin) == 1 ? 4 : 0;
+    }
+
+    /**
+     * \class   Writer
+     *
+     * \brief   Appends binary records to a fixed size buffer
+     * \details Once an append does not fit, the writer is marked as overflowed and
+     *          further appends are ignored.
+     */
+    class Writer {
+    public:
+        Writer(char *buf, size_t size) : buf((u_char *)buf), size(size), len(0), record_start(0),
+                                         overflowed(false) {
+        }
+
+        /**
+         * Start a record; the length is filled in by end()
+         */
+        Writer &begin() {
+            record_start = len;
+            return u32(0);
+        }
+
+        /**
+         * Complete the record started by begin()
+         */
+        Writer &end() {
+            if (not overflowed) {
+                uint32_t value = htonl(len - record_start - 4);
+                memcpy(buf + record_start, &value, 4);
+            }
+            return *this;
+        }
+
+        Writer &bytes(const void *data, size_t n) {
+            if (reserve(n)) {
+                memcpy(buf + len, data, n);
+                len += n;
+            }
+            return *this;
+        }
+
+        Writer &u8(uint8_t value) {
+            if (reserve(1))
+                buf[len++] = value;
+            return *this;
+        }
+
+        Writer &u16(uint16_t value) {
+            value = htons(value);
+            return bytes(&value, 2);
+        }
+
+        Writer &u32(uint32_t value) {
+            value = htonl(value);
+            return bytes(&value, 4);
+        }
+
+        Writer &u64(uint64_t value) {
+            return u32(value >> 32).u32(value & 0xFFFFFFFF);
+        }
+
+        /**
+         * 16 byte hash ID, all zeros if NULL
+         */
+        Writer &hash(const u_char *hash_id) {
+            static const u_char zero[16] = { 0 };
+            return bytes(hash_id != NULL ? hash_id : zero, 16);
+        }
+
+        Writer &str(const char *s, size_t n) {
+            return u32(n).bytes(s, n);
+        }
+
+        Writer &str(const char *s)          { return str(s, strlen(s)); }
+        Writer &str(const std::string &s)   { return str(s.data(), s.size()); }
+
+        /**
+         * Address in binary form
+         *
+         * \param [in] addr     Address, IPv4 in the first 4 bytes
+         * \param [in] isIPv4   True if IPv4
+         */
+        Writer &addr(const u_char *addr, bool isIPv4) {
+            return u8(isIPv4 ? 4 : 16).bytes(addr, isIPv4 ? 4 : 16);
+        }
+
+        /**
+         * Address in printed form; an empty or invalid address is written with length zero
+         */
+        Writer &addr(const char *printed) {
+            u_char bin[16];
+            uint8_t n = parseAddr(printed, bin);
+
+            return u8(n).bytes(bin, n);
+        }
+
+        Writer &ts(uint32_t secs, uint32_t us) {
+            return u32(secs).u32(us);
+        }
+
+        /**
+         * Rewind to a previous length (e.g. to drop a partially written record)
+         */
+        void truncate(size_t new_len) {
+            if (new_len < len)
+                len = new_len;
+            overflowed = false;
+        }
+
+        size_t length() const       { return len; }
+        bool overflow() const       { return overflowed; }
+        const char *data() const    { return (const char *)buf; }
+
+    private:
+        u_char      *buf;           ///< Output buffer
+        size_t      size;           ///< Size of the output buffer
+        size_t      len;            ///< Length written
+        size_t      record_start;   ///< Offset of the length of the current record
+        bool        overflowed;     ///< True if an append did not fit
+
+        bool reserve(size_t n) {
+            if (overflowed or len + n > size) {
+                overflowed = true;
+                return false;
+            }
+            return true;
+        }
+    };
+
+} /* namespace binfmt */
+
+#endif /* BINARYFORMAT_H_ */
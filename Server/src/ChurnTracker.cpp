@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "ChurnTracker.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <sys/time.h>
+
+#include "TextFormat.h"
+
+/**
+ * Get the process wide tracker
+ */
+ChurnTracker &ChurnTracker::instance() {
+    return ProcessSingleton<ChurnTracker>::get();
+}
+
+/**
+ * Constructor for class
+ */
+ChurnTracker::ChurnTracker() : is_enabled(false), total_updates(0), total_withdraws(0) {
+    top_k = 0;
+    interval_start = time(NULL);
+}
+
+/**
+ * Enable the tracker
+ *
+ * \param [in] top_k        Number of prefixes, origin ASNs and peers to report
+ * \param [in] width        Counters per sketch row, split over the shards
+ */
+void ChurnTracker::enable(size_t top_k, size_t width) {
+    this->top_k = top_k;
+
+    for (size_t s = 0; s < CHURN_SHARDS; s++) {
+        std::lock_guard<std::mutex> lock(shards[s].mutex);
+
+        shards[s].prefix_sketch.resize(width / CHURN_SHARDS);
+        shards[s].origin_sketch.resize(width / CHURN_SHARDS);
+        shards[s].top_prefixes.resize(top_k);
+        shards[s].top_origins.resize(top_k);
+    }
+
+    interval_start = time(NULL);
+    is_enabled = true;
+}
+
+/**
+ * Record advertised or withdrawn prefixes
+ *
+ * \details Prefixes are hashed a chunk at a time and each shard used by the chunk
+ *          is locked once.
+ *
+ * \param [in] peer         Peer of the prefixes
+ * \param [in] rib          Prefixes
+ * \param [in] origin_as    Origin ASN of advertised prefixes
+ * \param [in] withdrawn    True if the prefixes are withdrawn
+ */
+void ChurnTracker::record(const MsgBusInterface::obj_bgp_peer &peer, const MsgBusInterface::rib_vector &rib,
+                          uint32_t origin_as, bool withdrawn) {
+    if (not is_enabled or rib.empty())
+        return;
+
+    const size_t CHUNK = 64;
+
+    uint32_t upd = withdrawn ? 0 : 1;
+    uint32_t wdr = withdrawn ? 1 : 0;
+    prefix_key_t keys[CHUNK];
+    uint64_t hashes[CHUNK];
+    uint8_t key_shard[CHUNK];
+
+    for (size_t base = 0; base < rib.size(); base += CHUNK) {
+        size_t n = std::min(CHUNK, rib.size() - base);
+        uint32_t used = 0;
+
+        for (size_t i = 0; i < n; i++) {
+            memcpy(keys[i].data, rib[base + i].prefix_bin, 16);
+            keys[i].data[16] = rib[base + i].prefix_len;
+            keys[i].data[17] = rib[base + i].isIPv4;
+
+            hashes[i] = BinaryKeyHash<18>()(keys[i]);
+            key_shard[i] = shardOf(hashes[i]);
+            used |= 1U << key_shard[i];
+        }
+
+        for (size_t s = 0; s < CHURN_SHARDS; s++) {
+            if (not (used & (1U << s)))
+                continue;
+
+            shard &sh = shards[s];
+            std::lock_guard<std::mutex> lock(sh.mutex);
+
+            for (size_t i = 0; i < n; i++) {
+                if (key_shard[i] != s)
+                    continue;
+
+                CountMinSketch::counts est = sh.prefix_sketch.add(hashes[i], upd, wdr);
+                sh.top_prefixes.offer(keys[i], (uint64_t)est.updates + est.withdraws);
+            }
+        }
+    }
+
+    /*
+     * Withdraws do not carry the origin; origin ASNs count advertisements only
+     */
+    if (not withdrawn) {
+        origin_key_t okey((const u_char *)&origin_as);
+        uint64_t hash = BinaryKeyHash<4>()(okey);
+        shard &sh = shards[shardOf(hash)];
+
+        {
+            std::lock_guard<std::mutex> lock(sh.mutex);
+
+            CountMinSketch::counts est = sh.origin_sketch.add(hash, rib.size(), 0);
+            sh.top_origins.offer(okey, est.updates);
+        }
+
+        total_updates += rib.size();
+    } else
+        total_withdraws += rib.size();
+
+    BinaryKey<16> pkey(peer.hash_id);
+    shard &sh = shards[shardOf(BinaryKeyHash<16>()(pkey))];
+    std::lock_guard<std::mutex> lock(sh.mutex);
+
+    peer_counts &pc = sh.peers[pkey];
+    if (pc.peer_addr[0] == 0) {
+        memcpy(pc.router_hash_id, peer.router_hash_id, sizeof(pc.router_hash_id));
+        snprintf(pc.peer_addr, sizeof(pc.peer_addr), "%s", peer.peer_addr);
+    }
+
+    pc.updates += upd * rib.size();
+    pc.withdraws += wdr * rib.size();
+}
+
+/**
+ * Sort rows by total count and append the first top_k to the report with their rank
+ */
+static void appendTop(std::vector<MsgBusInterface::obj_churn> &rows, size_t top_k,
+                      MsgBusInterface::obj_churn_report &report) {
+    size_t n = std::min(top_k, rows.size());
+
+    std::partial_sort(rows.begin(), rows.begin() + n, rows.end(),
+                      [](const MsgBusInterface::obj_churn &a, const MsgBusInterface::obj_churn &b) {
+                          return a.updates + a.withdraws > b.updates + b.withdraws;
+                      });
+
+    for (size_t i = 0; i < n; i++) {
+        rows[i].rank = i + 1;
+        report.rows.push_back(rows[i]);
+    }
+}
+
+/**
+ * Get the results of the current interval and start a new interval
+ *
+ * \details Each shard is read and cleared under its own lock, so records made
+ *          while the report runs go to either this or the next interval.
+ *
+ * \param [out] report      Report rows are replaced; interval and timestamp are set
+ */
+void ChurnTracker::report(MsgBusInterface::obj_churn_report &report) {
+    MsgBusInterface::obj_churn row;
+    std::vector<MsgBusInterface::obj_churn> prefix_rows, origin_rows, peer_rows;
+    timeval tv;
+
+    report.rows.clear();
+
+    gettimeofday(&tv, NULL);
+    report.timestamp_secs = tv.tv_sec;
+    report.timestamp_us = tv.tv_usec;
+
+    uint64_t now = (uint64_t)tv.tv_sec;
+
+    report.interval_secs = now > interval_start ? now - interval_start : 0;
+    interval_start = now;
+
+    // Totals
+    memset(&row, 0, sizeof(row));
+    row.type = MsgBusInterface::CHURN_TYPE_TOTAL;
+    row.updates = total_updates.exchange(0);
+    row.withdraws = total_withdraws.exchange(0);
+    report.rows.push_back(row);
+
+    for (size_t s = 0; s < CHURN_SHARDS; s++) {
+        shard &sh = shards[s];
+        std::lock_guard<std::mutex> lock(sh.mutex);
+
+        // Prefixes; counts are re-read from the sketch since the heap holds the sum
+        std::vector<TopK<prefix_key_t>::item> prefixes;
+        sh.top_prefixes.sorted(prefixes);
+
+        for (size_t i = 0; i < prefixes.size(); i++) {
+            const prefix_key_t &key = prefixes[i].key;
+            CountMinSketch::counts est = sh.prefix_sketch.estimate(BinaryKeyHash<18>()(key));
+
+            memset(&row, 0, sizeof(row));
+            row.type = MsgBusInterface::CHURN_TYPE_PREFIX;
+
+            size_t len = textfmt::ip(row.key, key.data, key.data[17]);
+            row.key[len++] = '/';
+            textfmt::u32(row.key + len, key.data[16]);
+
+            row.updates = est.updates;
+            row.withdraws = est.withdraws;
+            prefix_rows.push_back(row);
+        }
+
+        // Origin ASNs
+        std::vector<TopK<origin_key_t>::item> origins;
+        sh.top_origins.sorted(origins);
+
+        for (size_t i = 0; i < origins.size(); i++) {
+            uint32_t asn;
+            memcpy(&asn, origins[i].key.data, sizeof(asn));
+
+            memset(&row, 0, sizeof(row));
+            row.type = MsgBusInterface::CHURN_TYPE_ORIGIN_AS;
+            textfmt::u32(row.key, asn);
+            row.updates = origins[i].count;
+            origin_rows.push_back(row);
+        }
+
+        // Peers, exact counts
+        for (FlatHashMap<BinaryKey<16>, peer_counts>::iterator it = sh.peers.begin(); it != sh.peers.end(); ++it) {
+            const peer_counts &pc = it.value();
+
+            memset(&row, 0, sizeof(row));
+            row.type = MsgBusInterface::CHURN_TYPE_PEER;
+            snprintf(row.key, sizeof(row.key), "%s", pc.peer_addr);
+            memcpy(row.router_hash_id, pc.router_hash_id, sizeof(row.router_hash_id));
+            memcpy(row.peer_hash_id, it.key().data, sizeof(row.peer_hash_id));
+            row.updates = pc.updates;
+            row.withdraws = pc.withdraws;
+            peer_rows.push_back(row);
+        }
+
+        // Start the shard's next interval
+        sh.prefix_sketch.clear();
+        sh.origin_sketch.clear();
+        sh.top_prefixes.clear();
+        sh.top_origins.clear();
+        sh.peers.clear();
+    }
+
+    appendTop(prefix_rows, top_k, report);
+    appendTop(origin_rows, top_k, report);
+    appendTop(peer_rows, top_k, report);
+}
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef CHURNTRACKER_H_
+#define CHURNTRACKER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "MsgBusInterface.hpp"
+#include "StreamSketch.hpp"
+#include "FlatHashMap.hpp"
+#include "ProcessSingleton.hpp"
+
+#define CHURN_DEFAULT_TOP_K         50          // Default number of prefixes, origins and peers reported
+#define CHURN_DEFAULT_SKETCH_WIDTH  65536       // Default counters per sketch row
+#define CHURN_SHARD_BITS            4           // log2 of the number of tracker shards
+#define CHURN_SHARDS                (1 << CHURN_SHARD_BITS)
+
+/**
+ * \class   ChurnTracker
+ *
+ * \brief   Process wide streaming churn counters
+ * \details Counts advertisements and withdraws per prefix and per origin ASN in
+ *          count-min sketches, and keeps top-K heaps of the noisiest prefixes and
+ *          origin ASNs.  Peers are counted exactly.  Memory is bounded by the
+ *          sketch width and K, independent of the table size.
+ *
+ *          Keys are split over CHURN_SHARDS shards by hash, each with its own
+ *          lock, sketches and heaps, so router threads only contend when they
+ *          touch the same shard.  Each shard sketch is 1/CHURN_SHARDS of the
+ *          configured width and sees about 1/CHURN_SHARDS of the updates, so
+ *          memory and the error bound are unchanged.  Each shard keeps K keys;
+ *          the shards hold disjoint keys, so merging them at report() gives the
+ *          same top-K as one heap.  report() returns the interval's results and
+ *          starts a new interval.
+ */
+class ChurnTracker {
+public:
+    /**
+     * Get the process wide tracker
+     */
+    static ChurnTracker &instance();
+
+    /**
+     * Enable the tracker
+     *
+     * \details Must be called before router threads start.
+     *
+     * \param [in] top_k        Number of prefixes, origin ASNs and peers to report
+     * \param [in] width        Counters per sketch row
+     */
+    void enable(size_t top_k, size_t width);
+
+    bool enabled() const            { return is_enabled; }
+
+    /**
+     * Record advertised or withdrawn prefixes
+     *
+     * \param [in] peer         Peer of the prefixes
+     * \param [in] rib          Prefixes
+     * \param [in] origin_as    Origin ASN of advertised prefixes
+     * \param [in] withdrawn    True if the prefixes are withdrawn
+     */
+    void record(const MsgBusInterface::obj_bgp_peer &peer, const MsgBusInterface::rib_vector &rib,
+                uint32_t origin_as, bool withdrawn);
+
+    /**
+     * Get the results of the current interval and start a new interval
+     *
+     * \param [out] report      Report rows are replaced; interval and timestamp are set
+     */
+    void report(MsgBusInterface::obj_churn_report &report);
+
+private:
+    /// Prefix key: prefix (16), length (1) and AFI (1)
+    typedef BinaryKey<18> prefix_key_t;
+
+    /// Origin ASN key
+    typedef BinaryKey<4> origin_key_t;
+
+    /// Peer counters
+    struct peer_counts {
+        u_char      router_hash_id[16];     ///< Router hash ID
+        char        peer_addr[46];          ///< Peer address in printed form
+        uint64_t    updates;
+        uint64_t    withdraws;
+    };
+
+    /// One lock and its counters; a key always maps to the same shard
+    struct shard {
+        std::mutex                                  mutex;          ///< Protects all members below
+
+        CountMinSketch                              prefix_sketch;  ///< Per prefix counters
+        CountMinSketch                              origin_sketch;  ///< Per origin ASN counters
+        TopK<prefix_key_t>                          top_prefixes;   ///< Noisiest prefixes
+        TopK<origin_key_t>                          top_origins;    ///< Noisiest origin ASNs
+        FlatHashMap<BinaryKey<16>, peer_counts>     peers;          ///< Per peer counters, key is the peer hash
+
+        shard() : prefix_sketch(64), origin_sketch(64) { }
+    };
+
+    std::atomic<bool>                           is_enabled;     ///< True if enabled
+    size_t                                      top_k;          ///< Number of rows reported per type, set by enable()
+
+    shard                                       shards[CHURN_SHARDS];
+
+    std::atomic<uint64_t>                       total_updates;  ///< Advertisements in the interval
+    std::atomic<uint64_t>                       total_withdraws;///< Withdraws in the interval
+    uint64_t                                    interval_start; ///< Start of the interval (secs), used by report() only
+
+    /**
+     * Get the shard of a key hash
+     *
+     * \details Uses the top bits; the sketches index with the low bits of each half
+     */
+    static size_t shardOf(uint64_t hash)    { return hash >> (64 - CHURN_SHARD_BITS); }
+
+    friend class ProcessSingleton<ChurnTracker>;
+
+    ChurnTracker();
+    ChurnTracker(const ChurnTracker &);
+    ChurnTracker &operator=(const ChurnTracker &);
+};
+
+#endif /* CHURNTRACKER_H_ */
@@ -22,6 +22,9 @@
 
 #include "Config.h"
 #include "kafka/KafkaTopicSelector.h"
+#include "ChurnTracker.h"
+#include "PathAttrTable.h"
+#include "CpuPlacement.h"
 
 /*********************************************************************//**
  * Constructor for class
@@ -35,6 +38,38 @@ Config::Config() {
     debug_bmp           = false;
     debug_msgbus        = false;
     bmp_buffer_size     = 15 * 1024 * 1024; // 15MB
+    intern_cache_size   = 8 * 1024 * 1024;  // 8MB
+    attr_table_size     = PATH_ATTR_TABLE_DEFAULT_MAX_BYTES;
+    coalesce_window_ms  = 0;                // Disabled
+    rollup_interval     = 0;                // Disabled
+    best_path           = false;
+    best_path_pre_policy = false;
+    churn_interval      = 0;                // Disabled
+    churn_top_k         = CHURN_DEFAULT_TOP_K;
+    churn_sketch_width  = CHURN_DEFAULT_SKETCH_WIDTH;
+    rpki_reload_interval = 60;
+    query_max_rows      = 10000;
+    mrt_rotate_interval = 900;              // 15 minutes
+    mrt_compress        = true;
+    mrt_snapshot_interval = 0;
+    arrow_batch_rows    = 10000;
+    arrow_batch_ms      = 1000;             // 1 second
+    overload_enabled    = false;
+    overload_ring_pct   = 75;
+    overload_queue_pct  = 75;
+    overload_lag_ms     = 10000;            // 10 seconds
+    overload_raise_secs = 10;
+    overload_recover_secs = 30;
+    scheduler_enabled   = false;
+    scheduler_workers   = 0;                // Number of CPUs
+    scheduler_quantum_kb = 64;
+    affinity_enabled    = false;
+    affinity_irq_aware  = true;
+    shutdown_drain_secs = 10;
+    shutdown_flush_ms   = 2000;             // 2 seconds
+
+    for (int i = 0; i < OverloadControl::SHED_MAX; i++)
+        overload_levels.push_back((OverloadControl::shed_action)i);
     svr_ipv6            = false;
     svr_ipv4            = true;
     bind_ipv4           = "";
@@ -48,9 +83,12 @@ Config::Config() {
     q_buf_max_msgs      = 100000;
     q_buf_max_kbytes    = 1048576;
     q_buf_max_ms        = 1000;         // Default is 1 sec
+    q_batch_num_msgs    = 100;
+    kafka_mock_brokers  = 0;            // Disabled, set by the benchmark
     msg_send_max_retry  = 2;
     retry_backoff_ms    = 100;
     compression         = "snappy";
+    msg_format          = MSG_FORMAT_TSV;
     max_concurrent_routers = 2;
     initial_router_time = 60;
     calculate_baseline  = true;
@@ -74,6 +112,9 @@ Config::Config() {
     topic_names_map[MSGBUS_TOPIC_VAR_LS_PREFIX]        = MSGBUS_TOPIC_LS_PREFIX;
     topic_names_map[MSGBUS_TOPIC_VAR_L3VPN]            = MSGBUS_TOPIC_L3VPN;
     topic_names_map[MSGBUS_TOPIC_VAR_EVPN]             = MSGBUS_TOPIC_EVPN;
+    topic_names_map[MSGBUS_TOPIC_VAR_CHURN]            = MSGBUS_TOPIC_CHURN;
+    topic_names_map[MSGBUS_TOPIC_VAR_PEER_ROLLUP]      = MSGBUS_TOPIC_PEER_ROLLUP;
+    topic_names_map[MSGBUS_TOPIC_VAR_LOC_RIB]          = MSGBUS_TOPIC_LOC_RIB;
 }
 
 /*********************************************************************//**
@@ -106,6 +147,24 @@ void Config::load(const char *cfg_filename) {
                         parseKafka(node);
                     else if (key.compare("mapping") == 0)
                         parseMapping(node);
+                    else if (key.compare("churn") == 0)
+                        parseChurn(node);
+                    else if (key.compare("rpki") == 0)
+                        parseRpki(node);
+                    else if (key.compare("query") == 0)
+                        parseQuery(node);
+                    else if (key.compare("mrt") == 0)
+                        parseMrt(node);
+                    else if (key.compare("arrow") == 0)
+                        parseArrow(node);
+                    else if (key.compare("overload") == 0)
+                        parseOverload(node);
+                    else if (key.compare("scheduler") == 0)
+                        parseScheduler(node);
+                    else if (key.compare("affinity") == 0)
+                        parseAffinity(node);
+                    else if (key.compare("shutdown") == 0)
+                        parseShutdown(node);
 
                     else if (debug_general)
                         std::cout << "   Config: Key " << key << " Type " << node.Type() << std::endl;
@@ -225,6 +284,40 @@ void Config::parseBase(const YAML::Node &node) {
                 printWarning("buffers.router is not of type int", node["buffers"]["router"]);
             }
         }
+
+        if (node["buffers"]["attr_cache"]) {
+            try {
+                int size = node["buffers"]["attr_cache"].as<int>();
+
+                if (size < 0 || size > 1024)
+                    throw "invalid attribute cache size, not within range of 0 - 1024)";
+
+                intern_cache_size = (size_t)size * 1024 * 1024;  // MB to bytes
+
+                if (debug_general)
+                    std::cout << "   Config: attribute cache: " << intern_cache_size << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("buffers.attr_cache is not of type int", node["buffers"]["attr_cache"]);
+            }
+        }
+
+        if (node["buffers"]["attr_table"]) {
+            try {
+                int size = node["buffers"]["attr_table"].as<int>();
+
+                if (size < 1 || size > 65536)
+                    throw "invalid attribute table size, not within range of 1 - 65536)";
+
+                attr_table_size = (size_t)size * 1024 * 1024;  // MB to bytes
+
+                if (debug_general)
+                    std::cout << "   Config: attribute table: " << attr_table_size << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("buffers.attr_table is not of type int", node["buffers"]["attr_table"]);
+            }
+        }
     }
 
     if (node["heartbeat"]) {
@@ -246,6 +339,65 @@ void Config::parseBase(const YAML::Node &node) {
         }
     }
 
+    if (node["updates"]) {
+        if (node["updates"]["coalesce_window"]) {
+            try {
+                int window = node["updates"]["coalesce_window"].as<int>();
+
+                if (window < 0 || window > 60000)
+                    throw "invalid coalesce window, not within range of 0 - 60000)";
+
+                coalesce_window_ms = window;
+
+                if (debug_general)
+                    std::cout << "   Config: coalesce window: " << coalesce_window_ms << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("updates.coalesce_window is not of type int", node["updates"]["coalesce_window"]);
+            }
+        }
+
+        if (node["updates"]["rollup_interval"]) {
+            try {
+                int interval = node["updates"]["rollup_interval"].as<int>();
+
+                if (interval < 0 || interval > 3600)
+                    throw "invalid rollup interval, not within range of 0 - 3600)";
+
+                rollup_interval = interval;
+
+                if (debug_general)
+                    std::cout << "   Config: rollup interval: " << rollup_interval << std::endl;
+
+            } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("updates.rollup_interval is not of type int", node["updates"]["rollup_interval"]);
+            }
+        }
+
+        if (node["updates"]["best_path"]) {
+            try {
+                std::string value = node["updates"]["best_path"].as<std::string>();
+
+                if (value.compare("post_policy") == 0) {
+                    best_path = true;
+                    best_path_pre_policy = false;
+                } else if (value.compare("pre_policy") == 0) {
+                    best_path = true;
+                    best_path_pre_policy = true;
+                } else if (value.compare("none") == 0) {
+                    best_path = false;
+                } else
+                    throw "invalid best path, expected none, pre_policy or post_policy";
+
+                if (debug_general)
+                    std::cout << "   Config: best path: " << value << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("updates.best_path is not of type string", node["updates"]["best_path"]);
+            }
+        }
+    }
+
     if (node["startup"]) {
         if (node["startup"]["max_concurrent_routers"]) {
             try {
@@ -307,6 +459,393 @@ void Config::parseBase(const YAML::Node &node) {
 
 }
 
+/**
+ * Parse the churn analytics configuration
+ *
+ * \param [in] node     Reference to the yaml NODE
+ */
+void Config::parseChurn(const YAML::Node &node) {
+    if (node["interval"]) {
+        try {
+            int interval = node["interval"].as<int>();
+
+            if (interval < 0 || interval > 86400)
+                throw "invalid churn interval, not within range of 0 - 86400)";
+
+            churn_interval = interval;
+
+            if (debug_general)
+                std::cout << "   Config: churn interval: " << churn_interval << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("churn.interval is not of type int", node["interval"]);
+        }
+    }
+
+    if (node["top_k"]) {
+        try {
+            int top_k = node["top_k"].as<int>();
+
+            if (top_k < 1 || top_k > 10000)
+                throw "invalid churn top_k, not within range of 1 - 10000)";
+
+            churn_top_k = top_k;
+
+            if (debug_general)
+                std::cout << "   Config: churn top_k: " << churn_top_k << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("churn.top_k is not of type int", node["top_k"]);
+        }
+    }
+
+    if (node["sketch_width"]) {
+        try {
+            int width = node["sketch_width"].as<int>();
+
+            if (width < 1024 || width > 16777216)
+                throw "invalid churn sketch_width, not within range of 1024 - 16777216)";
+
+            churn_sketch_width = width;
+
+            if (debug_general)
+                std::cout << "   Config: churn sketch width: " << churn_sketch_width << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("churn.sketch_width is not of type int", node["sketch_width"]);
+        }
+    }
+}
+
+/**
+ * Parse the RPKI origin validation configuration
+ *
+ * \param [in] node     Reference to the yaml NODE
+ */
+void Config::parseRpki(const YAML::Node &node) {
+    if (node["file"]) {
+        try {
+            rpki_file = node["file"].as<std::string>();
+
+            if (debug_general)
+                std::cout << "   Config: rpki file: " << rpki_file << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("rpki.file is not of type string", node["file"]);
+        }
+    }
+
+    if (node["reload_interval"]) {
+        try {
+            int interval = node["reload_interval"].as<int>();
+
+            if (interval < 0 || interval > 86400)
+                throw "invalid rpki reload_interval, not within range of 0 - 86400)";
+
+            rpki_reload_interval = interval;
+
+            if (debug_general)
+                std::cout << "   Config: rpki reload interval: " << rpki_reload_interval << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("rpki.reload_interval is not of type int", node["reload_interval"]);
+        }
+    }
+}
+
+/**
+ * Parse the query interface configuration
+ *
+ * \param [in] node     Reference to the yaml NODE
+ */
+void Config::parseQuery(const YAML::Node &node) {
+    if (node["socket"]) {
+        try {
+            query_socket = node["socket"].as<std::string>();
+
+            if (debug_general)
+                std::cout << "   Config: query socket: " << query_socket << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("query.socket is not of type string", node["socket"]);
+        }
+    }
+
+    if (node["max_rows"]) {
+        try {
+            int rows = node["max_rows"].as<int>();
+
+            if (rows < 1 || rows > 10000000)
+                throw "invalid query max_rows, not within range of 1 - 10000000)";
+
+            query_max_rows = rows;
+
+            if (debug_general)
+                std::cout << "   Config: query max rows: " << query_max_rows << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("query.max_rows is not of type int", node["max_rows"]);
+        }
+    }
+}
+
+/**
+ * Parse the MRT archive configuration
+ *
+ * \param [in] node     Reference to the yaml NODE
+ */
+void Config::parseMrt(const YAML::Node &node) {
+    if (node["directory"]) {
+        try {
+            mrt_directory = node["directory"].as<std::string>();
+
+            // Remove trailing slashes, files are written to <directory>/<router>/
+            while (mrt_directory.size() > 1 and mrt_directory[mrt_directory.size() - 1] == '/')
+                mrt_directory.erase(mrt_directory.size() - 1);
+
+            if (debug_general)
+                std::cout << "   Config: mrt directory: " << mrt_directory << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("mrt.directory is not of type string", node["directory"]);
+        }
+    }
+
+    if (node["rotate_interval"]) {
+        try {
+            int interval = node["rotate_interval"].as<int>();
+
+            if (interval < 60 || interval > 86400)
+                throw "invalid mrt rotate_interval, not within range of 60 - 86400)";
+
+            mrt_rotate_interval = interval;
+
+            if (debug_general)
+                std::cout << "   Config: mrt rotate interval: " << mrt_rotate_interval << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("mrt.rotate_interval is not of type int", node["rotate_interval"]);
+        }
+    }
+
+    if (node["compression"]) {
+        try {
+            std::string value = node["compression"].as<std::string>();
+
+            if (value.compare("gzip") == 0)
+                mrt_compress = true;
+            else if (value.compare("none") == 0)
+                mrt_compress = false;
+            else
+                throw "invalid mrt compression, expected none or gzip";
+
+            if (debug_general)
+                std::cout << "   Config: mrt compression: " << value << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("mrt.compression is not of type string", node["compression"]);
+        }
+    }
+
+    if (node["snapshot_interval"]) {
+        try {
+            int interval = node["snapshot_interval"].as<int>();
+
+            if (interval != 0 and (interval < 300 || interval > 86400))
+                throw "invalid mrt snapshot_interval, not 0 or within range of 300 - 86400)";
+
+            mrt_snapshot_interval = interval;
+
+            if (debug_general)
+                std::cout << "   Config: mrt snapshot interval: " << mrt_snapshot_interval << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("mrt.snapshot_interval is not of type int", node["snapshot_interval"]);
+        }
+    }
+}
+
+/**
+ * Parse the Arrow batch configuration
+ *
+ * \param [in] node     Reference to the yaml NODE
+ */
+void Config::parseArrow(const YAML::Node &node) {
+    if (node["batch_rows"]) {
+        try {
+            int rows = node["batch_rows"].as<int>();
+
+            if (rows < 1 || rows > 1000000)
+                throw "invalid arrow batch_rows, not within range of 1 - 1000000)";
+
+            arrow_batch_rows = rows;
+
+            if (debug_general)
+                std::cout << "   Config: arrow batch rows: " << arrow_batch_rows << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("arrow.batch_rows is not of type int", node["batch_rows"]);
+        }
+    }
+
+    if (node["batch_ms"]) {
+        try {
+            int ms = node["batch_ms"].as<int>();
+
+            if (ms < 10 || ms > 60000)
+                throw "invalid arrow batch_ms, not within range of 10 - 60000)";
+
+            arrow_batch_ms = ms;
+
+            if (debug_general)
+                std::cout << "   Config: arrow batch ms: " << arrow_batch_ms << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("arrow.batch_ms is not of type int", node["batch_ms"]);
+        }
+    }
+
+    if (node["directory"]) {
+        try {
+            arrow_directory = node["directory"].as<std::string>();
+
+            // Remove trailing slashes, files are written to <directory>/<router>/
+            while (arrow_directory.size() > 1 and arrow_directory[arrow_directory.size() - 1] == '/')
+                arrow_directory.erase(arrow_directory.size() - 1);
+
+            if (debug_general)
+                std::cout << "   Config: arrow directory: " << arrow_directory << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("arrow.directory is not of type string", node["directory"]);
+        }
+    }
+}
+
+/**
+ * Parse the overload degradation configuration
+ *
+ * \param [in] node     Reference to the yaml NODE
+ */
+void Config::parseOverload(const YAML::Node &node) {
+    if (node["enabled"]) {
+        try {
+            overload_enabled = node["enabled"].as<bool>();
+
+            if (debug_general)
+                std::cout << "   Config: overload enabled: " << overload_enabled << std::endl;
+
+        } catch (YAML::TypedBadConversion<bool> err) {
+            printWarning("overload.enabled is not of type boolean", node["enabled"]);
+        }
+    }
+
+    if (node["ring_buffer_pct"]) {
+        try {
+            int pct = node["ring_buffer_pct"].as<int>();
+
+            if (pct < 1 || pct > 100)
+                throw "invalid overload ring_buffer_pct, not within range of 1 - 100)";
+
+            overload_ring_pct = pct;
+
+            if (debug_general)
+                std::cout << "   Config: overload ring buffer pct: " << overload_ring_pct << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("overload.ring_buffer_pct is not of type int", node["ring_buffer_pct"]);
+        }
+    }
+
+    if (node["producer_queue_pct"]) {
+        try {
+            int pct = node["producer_queue_pct"].as<int>();
+
+            if (pct < 1 || pct > 100)
+                throw "invalid overload producer_queue_pct, not within range of 1 - 100)";
+
+            overload_queue_pct = pct;
+
+            if (debug_general)
+                std::cout << "   Config: overload producer queue pct: " << overload_queue_pct << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("overload.producer_queue_pct is not of type int", node["producer_queue_pct"]);
+        }
+    }
+
+    if (node["parse_lag_ms"]) {
+        try {
+            int ms = node["parse_lag_ms"].as<int>();
+
+            if (ms < 100 || ms > 3600000)
+                throw "invalid overload parse_lag_ms, not within range of 100 - 3600000)";
+
+            overload_lag_ms = ms;
+
+            if (debug_general)
+                std::cout << "   Config: overload parse lag ms: " << overload_lag_ms << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("overload.parse_lag_ms is not of type int", node["parse_lag_ms"]);
+        }
+    }
+
+    if (node["raise_secs"]) {
+        try {
+            int secs = node["raise_secs"].as<int>();
+
+            if (secs < 1 || secs > 3600)
+                throw "invalid overload raise_secs, not within range of 1 - 3600)";
+
+            overload_raise_secs = secs;
+
+            if (debug_general)
+                std::cout << "   Config: overload raise secs: " << overload_raise_secs << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("overload.raise_secs is not of type int", node["raise_secs"]);
+        }
+    }
+
+    if (node["recover_secs"]) {
+        try {
+            int secs = node["recover_secs"].as<int>();
+
+            if (secs < 1 || secs > 3600)
+                throw "invalid overload recover_secs, not within range of 1 - 3600)";
+
+            overload_recover_secs = secs;
+
+            if (debug_general)
+                std::cout << "   Config: overload recover secs: " << overload_recover_secs << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("overload.recover_secs is not of type int", node["recover_secs"]);
+        }
+    }
+
+    if (node["levels"] && node["levels"].Type() == YAML::NodeType::Sequence) {
+        OverloadControl::shed_action action;
+
+        overload_levels.clear();
+
+        for (std::size_t i = 0; i < node["levels"].size(); i++) {
+            std::string value = node["levels"][i].Scalar();
+
+            if (not OverloadControl::actionByName(value, action))
+                printWarning("overload.levels entry is not a known action, ignored", node["levels"][i]);
+
+            else {
+                overload_levels.push_back(action);
+
+                if (debug_general)
+                    std::cout << "   Config: overload level " << overload_levels.size() << ": " << value << std::endl;
+            }
+        }
+    }
+}
+
 /**
  * Parse the debug configuration
  *
@@ -518,6 +1057,24 @@ void Config::parseKafka(const YAML::Node &node) {
         }
     }
 
+    if (node["batch.num.messages"] &&
+        node["batch.num.messages"].Type() == YAML::NodeType::Scalar) {
+        try {
+            q_batch_num_msgs = node["batch.num.messages"].as<int>();
+
+            if (q_batch_num_msgs < 1 || q_batch_num_msgs > 1000000)
+               throw "invalid batch num messages, should be "
+				"in range 1 - 1000000";
+            if (debug_general)
+                   std::cout << "   Config: batch num messages: " <<
+                                q_batch_num_msgs << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+                printWarning("q_batch_num_msgs is not of type int",
+				node["batch.num.messages"]);
+        }
+    }
+
     if (node["message.send.max.retries"]  && 
         node["message.send.max.retries"].Type() == YAML::NodeType::Scalar) {
         try {
@@ -573,6 +1130,29 @@ void Config::parseKafka(const YAML::Node &node) {
         }
     }
 
+    if (node["message_format"]) {
+        try {
+            std::string value = node["message_format"].as<std::string>();
+
+            if (value.compare("tsv") == 0)
+                msg_format = MSG_FORMAT_TSV;
+            else if (value.compare("binary") == 0)
+                msg_format = MSG_FORMAT_BINARY;
+            else if (value.compare("json") == 0)
+                msg_format = MSG_FORMAT_JSON;
+            else if (value.compare("arrow") == 0)
+                msg_format = MSG_FORMAT_ARROW;
+            else
+                throw "invalid kafka message_format, expected tsv, binary, json or arrow";
+
+            if (debug_general)
+                std::cout << "   Config: kafka message format: " << value << std::endl;
+
+        } catch (YAML::TypedBadConversion<std::string> err) {
+            printWarning("kafka.message_format is not of type string", node["message_format"]);
+        }
+    }
+
     if (node["topics"] && node["topics"].Type() == YAML::NodeType::Map) {
         parseTopics(node["topics"]);
     }
@@ -645,6 +1225,151 @@ void Config::parseTopics(const YAML::Node &node) {
     }
 }
 
+/**
+ * Parse the ingest scheduler configuration
+ *
+ * \param [in] node     Reference to the yaml NODE
+ */
+void Config::parseScheduler(const YAML::Node &node) {
+    if (node["enabled"]) {
+        try {
+            scheduler_enabled = node["enabled"].as<bool>();
+
+            if (debug_general)
+                std::cout << "   Config: scheduler enabled: " << scheduler_enabled << std::endl;
+
+        } catch (YAML::TypedBadConversion<bool> err) {
+            printWarning("scheduler.enabled is not of type boolean", node["enabled"]);
+        }
+    }
+
+    if (node["workers"]) {
+        try {
+            int workers = node["workers"].as<int>();
+
+            if (workers < 0 || workers > 1024)
+                throw "invalid scheduler workers, not within range of 0 - 1024)";
+
+            scheduler_workers = workers;
+
+            if (debug_general)
+                std::cout << "   Config: scheduler workers: " << scheduler_workers << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("scheduler.workers is not of type int", node["workers"]);
+        }
+    }
+
+    if (node["quantum_kb"]) {
+        try {
+            int kb = node["quantum_kb"].as<int>();
+
+            if (kb < 1 || kb > 65536)
+                throw "invalid scheduler quantum_kb, not within range of 1 - 65536)";
+
+            scheduler_quantum_kb = kb;
+
+            if (debug_general)
+                std::cout << "   Config: scheduler quantum kb: " << scheduler_quantum_kb << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("scheduler.quantum_kb is not of type int", node["quantum_kb"]);
+        }
+    }
+}
+
+/**
+ * Parse the CPU affinity configuration
+ *
+ * \param [in] node     Reference to the yaml NODE
+ */
+void Config::parseAffinity(const YAML::Node &node) {
+    if (node["enabled"]) {
+        try {
+            affinity_enabled = node["enabled"].as<bool>();
+
+            if (debug_general)
+                std::cout << "   Config: affinity enabled: " << affinity_enabled << std::endl;
+
+        } catch (YAML::TypedBadConversion<bool> err) {
+            printWarning("affinity.enabled is not of type boolean", node["enabled"]);
+        }
+    }
+
+    const char *keys[] = { "ingest_cpus", "parse_cpus", "produce_cpus" };
+    std::vector<int> *lists[] = { &affinity_ingest_cpus, &affinity_parse_cpus, &affinity_produce_cpus };
+
+    for (int i = 0; i < 3; i++) {
+        if (node[keys[i]]) {
+            try {
+                std::string list = node[keys[i]].as<std::string>();
+
+                if (not CpuPlacement::parseList(list, *lists[i]))
+                    throw "invalid affinity cpu list, should be like 0-3,8,10-11";
+
+                if (debug_general)
+                    std::cout << "   Config: affinity " << keys[i] << ": " << list << std::endl;
+
+            } catch (YAML::TypedBadConversion<std::string> err) {
+                printWarning("affinity cpu list is not of type string", node[keys[i]]);
+            }
+        }
+    }
+
+    if (node["irq_aware"]) {
+        try {
+            affinity_irq_aware = node["irq_aware"].as<bool>();
+
+            if (debug_general)
+                std::cout << "   Config: affinity irq aware: " << affinity_irq_aware << std::endl;
+
+        } catch (YAML::TypedBadConversion<bool> err) {
+            printWarning("affinity.irq_aware is not of type boolean", node["irq_aware"]);
+        }
+    }
+}
+
+/**
+ * Parse the shutdown configuration
+ *
+ * \param [in] node     Reference to the yaml NODE
+ */
+void Config::parseShutdown(const YAML::Node &node) {
+    if (node["drain_secs"]) {
+        try {
+            int secs = node["drain_secs"].as<int>();
+
+            if (secs < 1 || secs > 600)
+                throw "invalid shutdown drain_secs, not within range of 1 - 600)";
+
+            shutdown_drain_secs = secs;
+
+            if (debug_general)
+                std::cout << "   Config: shutdown drain secs: " << shutdown_drain_secs << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("shutdown.drain_secs is not of type int", node["drain_secs"]);
+        }
+    }
+
+    if (node["flush_ms"]) {
+        try {
+            int ms = node["flush_ms"].as<int>();
+
+            if (ms < 0 || ms > 60000)
+                throw "invalid shutdown flush_ms, not within range of 0 - 60000)";
+
+            shutdown_flush_ms = ms;
+
+            if (debug_general)
+                std::cout << "   Config: shutdown flush ms: " << shutdown_flush_ms << std::endl;
+
+        } catch (YAML::TypedBadConversion<int> err) {
+            printWarning("shutdown.flush_ms is not of type int", node["flush_ms"]);
+        }
+    }
+}
+
 /**
  * Parse the mapping configuration
  *
@@ -683,6 +1408,23 @@ void Config::parseMapping(const YAML::Node &node) {
 
                     } else if (cur_node["prefix_range"])
                         throw "Invalid mapping.groups.router_group.prefix_range, should be of type list/sequence";
+
+                    if (cur_node["weight"]) {
+                        try {
+                            int weight = cur_node["weight"].as<int>();
+
+                            if (weight < 1 || weight > 1000)
+                                throw "invalid mapping.groups.router_group.weight, not within range of 1 - 1000)";
+
+                            router_group_weight[name] = weight;
+
+                            if (debug_general)
+                                std::cout << "   Config: router_group " << name << " weight: " << weight << std::endl;
+
+                        } catch (YAML::TypedBadConversion<int> err) {
+                            printWarning("mapping.groups.router_group.weight is not of type int", cur_node["weight"]);
+                        }
+                    }
                 }
             }
         }
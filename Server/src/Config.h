@@ -17,6 +17,8 @@
 #include <boost/xpressive/xpressive.hpp>
 #include <boost/exception/all.hpp>
 
+#include "OverloadControl.h"
+
 #define MAX_THREADS 200
 
 using namespace boost::xpressive;
@@ -30,6 +32,14 @@ using namespace boost::xpressive;
  */
 class Config {
 public:
+    /// Format of the parsed message bus messages
+    enum msg_format_type {
+        MSG_FORMAT_TSV=0,                 ///< Tab separated rows (MSGBUS_API_VERSION)
+        MSG_FORMAT_BINARY,                ///< Length prefixed binary records
+        MSG_FORMAT_JSON,                  ///< JSON object per row
+        MSG_FORMAT_ARROW                  ///< Arrow IPC batches of the prefix and BGP-LS rows
+    };
+
     u_char      c_hash_id[16];            ///< Collector Hash ID (raw format)
     char        admin_id[64];             ///< Admin ID
 
@@ -39,6 +49,43 @@ public:
     std::string bind_ipv6;                ///< IP to listen on for IPv6
 
     int         bmp_buffer_size;          ///< BMP buffer size in bytes (min is 2M max is 128M)
+    size_t      intern_cache_size;        ///< Per router formatted attribute cache size in bytes (0 to disable)
+    size_t      attr_table_size;          ///< Shared path attribute table size in bytes before unused sets are swept
+    uint32_t    coalesce_window_ms;       ///< Per prefix update coalescing window in milliseconds (0 to disable)
+    uint32_t    rollup_interval;          ///< Per peer rollup window in seconds (0 to disable)
+    bool        best_path;                ///< Compute the per router best path (Loc-RIB) from the Adj-RIB-In
+    bool        best_path_pre_policy;     ///< Use the pre-policy instead of the post-policy Adj-RIB-In for the best path
+    int         churn_interval;           ///< Churn report interval in seconds (0 to disable)
+    int         churn_top_k;              ///< Number of prefixes, origin ASNs and peers in each churn report
+    int         churn_sketch_width;       ///< Counters per churn sketch row
+    std::string rpki_file;                ///< VRP set (CSV or JSON) for origin validation, empty to disable
+    int         rpki_reload_interval;     ///< Seconds between checks of the VRP file for changes (0 to disable)
+    std::string query_socket;             ///< UNIX domain socket path of the query interface, empty to disable
+    int         query_max_rows;           ///< Maximum rows per query response
+    std::string mrt_directory;            ///< MRT archive directory, empty to disable
+    uint32_t    mrt_rotate_interval;      ///< Seconds per MRT archive file
+    bool        mrt_compress;             ///< gzip the MRT archive files
+    uint32_t    mrt_snapshot_interval;    ///< Seconds between MRT RIB snapshots, zero to disable
+    uint32_t    arrow_batch_rows;         ///< Maximum rows per Arrow batch
+    uint32_t    arrow_batch_ms;           ///< Maximum age of an Arrow batch in milliseconds
+    std::string arrow_directory;          ///< Arrow batch file directory, empty to publish to Kafka
+    bool        overload_enabled;         ///< Step through the overload levels when routers fall behind
+    uint32_t    overload_ring_pct;        ///< Router ring buffer fill threshold in percent
+    uint32_t    overload_queue_pct;       ///< Router producer queue fill threshold in percent
+    uint32_t    overload_lag_ms;          ///< Threshold of the time since a router ring buffer was drained
+    uint32_t    overload_raise_secs;      ///< Seconds over a threshold before the next overload level
+    uint32_t    overload_recover_secs;    ///< Seconds under all thresholds before the previous overload level
+    std::vector<OverloadControl::shed_action> overload_levels;  ///< Action shed at each overload level
+    bool        scheduler_enabled;        ///< Schedule the parse work of the routers by deficit round robin
+    uint32_t    scheduler_workers;        ///< Routers parsing at the same time, zero for the number of CPUs
+    uint32_t    scheduler_quantum_kb;     ///< KB of messages a router may parse per turn and weight
+    bool        affinity_enabled;         ///< Pin the router threads and place them on NUMA nodes
+    std::vector<int> affinity_ingest_cpus;    ///< CPUs of the router socket threads
+    std::vector<int> affinity_parse_cpus;     ///< CPUs of the router parse threads
+    std::vector<int> affinity_produce_cpus;   ///< CPUs of the Kafka producer threads
+    bool        affinity_irq_aware;       ///< Place routers on the NUMA node receiving their packets
+    uint32_t    shutdown_drain_secs;      ///< Seconds for all routers to drain, term and flush on shutdown
+    uint32_t    shutdown_flush_ms;        ///< Milliseconds to wait for a producer to deliver its queue on close
     bool        svr_ipv4;                 ///< Indicates if server should listen for IPv4 connections
     bool        svr_ipv6;                 ///< Indicates if server should listen for IPv6 connections
 
@@ -55,9 +102,12 @@ public:
     int         q_buf_max_msgs;      ///< Max msgs allowed in producer queue
     int         q_buf_max_kbytes;    ///< Max kbytes allowed in producer queue
     int         q_buf_max_ms;		 ///< Max time for buffering msgs in queue
+    int         q_batch_num_msgs;        ///< Max msgs batched in one MessageSet
+    int         kafka_mock_brokers;      ///< Brokers of a librdkafka mock cluster to produce to instead (0 to disable)
     int         msg_send_max_retry;      ///< No. of times to resend failed msgs
     int         retry_backoff_ms;        ///< Backoff time before resending msgs  
     std::string compression;		 ///< Compression to use :none, gzip, snappy
+    msg_format_type msg_format;          ///< Format of the update_* messages
     int         max_concurrent_routers;  ///<Maximum allowed routers that can connect
     int         initial_router_time;     ///<Initial time in allowing another concurrent router
     bool        calculate_baseline;      ///<Indicates if router baseline time should be calculated
@@ -85,6 +135,11 @@ public:
     std::map<std::string, std::list<match_type_ip>> match_router_group_by_ip;
     typedef std::map<std::string, std::list<match_type_ip>>::iterator match_router_group_by_ip_iter;
 
+    /**
+     * Ingest scheduling weight of the router groups, groups not listed have weight 1
+     */
+    std::map<std::string, uint32_t> router_group_weight;
+
 
     /**
      * Matching peer group map - used to regex/ip match the peer to group name
@@ -157,6 +212,69 @@ private:
      */
     void parseTopics(const YAML::Node &node);
 
+    /**
+     * Parse the churn analytics configuration
+     *
+     * \param [in] node     Reference to the yaml NODE
+     */
+    void parseChurn(const YAML::Node &node);
+
+    /**
+     * Parse the RPKI origin validation configuration
+     *
+     * \param [in] node     Reference to the yaml NODE
+     */
+    void parseRpki(const YAML::Node &node);
+
+    /**
+     * Parse the query interface configuration
+     *
+     * \param [in] node     Reference to the yaml NODE
+     */
+    void parseQuery(const YAML::Node &node);
+
+    /**
+     * Parse the MRT archive configuration
+     *
+     * \param [in] node     Reference to the yaml NODE
+     */
+    void parseMrt(const YAML::Node &node);
+
+    /**
+     * Parse the Arrow batch configuration
+     *
+     * \param [in] node     Reference to the yaml NODE
+     */
+    void parseArrow(const YAML::Node &node);
+
+    /**
+     * Parse the overload degradation configuration
+     *
+     * \param [in] node     Reference to the yaml NODE
+     */
+    void parseOverload(const YAML::Node &node);
+
+    /**
+     * Parse the ingest scheduler configuration
+     *
+     * \param [in] node     Reference to the yaml NODE
+     */
+    void parseScheduler(const YAML::Node &node);
+
+    /**
+     * Parse the CPU affinity configuration
+     *
+     * \param [in] node     Reference to the yaml NODE
+     */
+    void parseAffinity(const YAML::Node &node);
+
+    /**
+     * Parse the shutdown configuration
+     *
+     * \param [in] node     Reference to the yaml NODE
+     */
+    void parseShutdown(const YAML::Node &node);
+
     /**
      * Parse the mapping configuration
      *
@@ -0,0 +1,291 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "CpuPlacement.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/socket.h>
+
+/**
+ * Get the process wide placement
+ */
+CpuPlacement &CpuPlacement::instance() {
+    return ProcessSingleton<CpuPlacement>::get();
+}
+
+/**
+ * Constructor for class
+ */
+CpuPlacement::CpuPlacement() {
+    is_enabled = false;
+    irq_aware = false;
+}
+
+/**
+ * Parse a CPU list as used by the kernel, e.g. "0-3,8,10-11"
+ *
+ * \param [in]  list        CPU list
+ * \param [out] cpus        CPUs of the list, in order
+ *
+ * \return false if the list is not valid
+ */
+bool CpuPlacement::parseList(const std::string &list, std::vector<int> &cpus) {
+    const char *p = list.c_str();
+    char *end;
+
+    cpus.clear();
+
+    while (*p != 0) {
+        while (*p == ' ')
+            p++;
+
+        if (*p < '0' or *p > '9')
+            return false;
+
+        long first = strtol(p, &end, 10);
+        long last = first;
+        p = end;
+
+        if (*p == '-') {
+            p++;
+            if (*p < '0' or *p > '9')
+                return false;
+
+            last = strtol(p, &end, 10);
+            p = end;
+        }
+
+        if (last < first or last >= CPU_SETSIZE)
+            return false;
+
+        for (long cpu = first; cpu <= last; cpu++)
+            cpus.push_back(cpu);
+
+        while (*p == ' ')
+            p++;
+
+        if (*p == ',')
+            p++;
+        else if (*p != 0)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Enable the placement
+ *
+ * \param [in] ingest_cpus      CPUs for the ingest (socket) threads
+ * \param [in] parse_cpus       CPUs for the parse threads
+ * \param [in] produce_cpus     CPUs for the Kafka producer threads
+ * \param [in] irq_aware        Place sessions on the node of the CPU receiving their packets
+ */
+void CpuPlacement::enable(const std::vector<int> &ingest_cpus, const std::vector<int> &parse_cpus,
+                          const std::vector<int> &produce_cpus, bool irq_aware) {
+    this->ingest_cpus = ingest_cpus;
+    this->parse_cpus = parse_cpus;
+    this->produce_cpus = produce_cpus;
+    this->irq_aware = irq_aware;
+
+    const std::vector<int> *lists[] = { &ingest_cpus, &parse_cpus, &produce_cpus };
+    for (size_t i = 0; i < 3; i++) {
+        for (size_t c = 0; c < lists[i]->size(); c++)
+            cpu_node[(*lists[i])[c]] = nodeOf((*lists[i])[c]);
+    }
+
+    // Sessions are placed on the nodes of the configured CPUs
+    for (std::map<int, int>::iterator it = cpu_node.begin(); it != cpu_node.end(); ++it)
+        node_sessions[it->second] = 0;
+
+    is_enabled = node_sessions.size() > 0;
+}
+
+/**
+ * Place a router session
+ *
+ * \param [in] sock         Accepted socket of the router
+ *
+ * \return placement, to be released with release()
+ */
+CpuPlacement::placement CpuPlacement::place(int sock) {
+    placement p;
+    p.node = p.ingest_cpu = p.parse_cpu = -1;
+
+    if (not is_enabled)
+        return p;
+
+    int node = -1;
+
+#ifdef SO_INCOMING_CPU
+    if (irq_aware) {
+        int cpu = -1;
+        socklen_t len = sizeof(cpu);
+
+        if (getsockopt(sock, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) == 0 and cpu >= 0)
+            node = nodeOf(cpu);
+    }
+#endif
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Without the receiving node, or if it has no configured CPUs, use the least used node
+    if (node < 0 or node_sessions.find(node) == node_sessions.end()) {
+        node = node_sessions.begin()->first;
+
+        for (std::map<int, uint32_t>::iterator it = node_sessions.begin(); it != node_sessions.end(); ++it) {
+            if (it->second < node_sessions[node])
+                node = it->first;
+        }
+    }
+
+    p.node = node;
+    p.ingest_cpu = pick(ingest_cpus, node);
+    p.parse_cpu = pick(parse_cpus, node);
+
+    ++node_sessions[node];
+
+    if (p.ingest_cpu >= 0)
+        ++cpu_sessions[p.ingest_cpu];
+
+    if (p.parse_cpu >= 0)
+        ++cpu_sessions[p.parse_cpu];
+
+    return p;
+}
+
+/**
+ * Release the placement of a session
+ */
+void CpuPlacement::release(const placement &p) {
+    if (p.node < 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    --node_sessions[p.node];
+
+    if (p.ingest_cpu >= 0)
+        --cpu_sessions[p.ingest_cpu];
+
+    if (p.parse_cpu >= 0)
+        --cpu_sessions[p.parse_cpu];
+}
+
+/**
+ * CPU of a list with the fewest sessions, on the node if it has any; mutex must be held
+ *
+ * \return CPU or -1 if the list is empty
+ */
+int CpuPlacement::pick(const std::vector<int> &cpus, int node) {
+    int best = -1;
+    bool best_local = false;
+
+    for (size_t i = 0; i < cpus.size(); i++) {
+        bool local = cpu_node[cpus[i]] == node;
+
+        if (best < 0 or (local and not best_local) or
+                (local == best_local and cpu_sessions[cpus[i]] < cpu_sessions[best])) {
+            best = cpus[i];
+            best_local = local;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * Pin the calling thread to a CPU
+ *
+ * \param [in] cpu          CPU, -1 to leave the thread unpinned
+ *
+ * \return false if the affinity could not be set
+ */
+bool CpuPlacement::pin(int cpu) {
+    if (cpu < 0)
+        return true;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+/**
+ * NUMA node of a CPU, zero if not known
+ */
+int CpuPlacement::nodeOf(int cpu) {
+    char path[64];
+    int node = 0;
+
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+
+    DIR *dir = opendir(path);
+    if (dir == NULL)
+        return 0;
+
+    // The CPU directory has a nodeN link to its node
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (strncmp(ent->d_name, "node", 4) == 0 and ent->d_name[4] >= '0' and ent->d_name[4] <= '9') {
+            node = atoi(ent->d_name + 4);
+            break;
+        }
+    }
+
+    closedir(dir);
+    return node;
+}
+
+/**
+ * Sets the affinity of the calling thread to the produce CPUs of its node
+ */
+CpuPlacement::ProduceScope::ProduceScope() {
+    CpuPlacement &cp = CpuPlacement::instance();
+    restore = false;
+
+    if (not cp.is_enabled or cp.produce_cpus.size() == 0)
+        return;
+
+    if (pthread_getaffinity_np(pthread_self(), sizeof(saved), &saved) != 0)
+        return;
+
+    int cpu = sched_getcpu();
+    int node = cpu >= 0 ? nodeOf(cpu) : -1;
+
+    cpu_set_t set, local;
+    CPU_ZERO(&set);
+    CPU_ZERO(&local);
+
+    for (size_t i = 0; i < cp.produce_cpus.size(); i++) {
+        CPU_SET(cp.produce_cpus[i], &set);
+
+        if (cp.cpu_node.at(cp.produce_cpus[i]) == node)
+            CPU_SET(cp.produce_cpus[i], &local);
+    }
+
+    // All produce CPUs if none is on the node of the session
+    if (CPU_COUNT(&local) > 0)
+        set = local;
+
+    restore = pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
+
+/**
+ * Restores the affinity of the calling thread
+ */
+CpuPlacement::ProduceScope::~ProduceScope() {
+    if (restore)
+        pthread_setaffinity_np(pthread_self(), sizeof(saved), &saved);
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef CPUPLACEMENT_H_
+#define CPUPLACEMENT_H_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sched.h>
+
+#include "ProcessSingleton.hpp"
+
+/**
+ * \class   CpuPlacement
+ *
+ * \brief   CPU and NUMA node placement of the router sessions
+ * \details Each router session is placed on a NUMA node, preferably the node of the
+ *          CPU that received its packets (NIC IRQ/RPS CPU), else the node with the
+ *          fewest sessions.  On that node, the ingest (socket) thread and the parse
+ *          thread are pinned to the configured CPUs with the fewest sessions.
+ *
+ *          The ingest thread pins itself before it allocates the session buffers
+ *          (ring buffer, parser, message bus), so with the kernel default first touch
+ *          policy they are allocated on the node of the session.  Kafka producer
+ *          threads are created with the affinity of the produce CPUs of the node.
+ */
+class CpuPlacement {
+public:
+    /// Placement of a router session
+    struct placement {
+        int     node;                       ///< NUMA node, -1 if not placed
+        int     ingest_cpu;                 ///< CPU of the ingest thread, -1 if not pinned
+        int     parse_cpu;                  ///< CPU of the parse thread, -1 if not pinned
+    };
+
+    /**
+     * Sets the affinity of the calling thread to the produce CPUs of its node
+     *
+     * \details Threads inherit the affinity of the thread that creates them, so the
+     *          Kafka producer is created in this scope.  The affinity is restored when
+     *          the scope ends.
+     */
+    class ProduceScope {
+    public:
+        ProduceScope();
+        ~ProduceScope();
+
+    private:
+        bool        restore;                ///< True if the affinity was changed
+        cpu_set_t   saved;                  ///< Affinity before the scope
+    };
+
+    /**
+     * Get the process wide placement
+     */
+    static CpuPlacement &instance();
+
+    /**
+     * Parse a CPU list as used by the kernel, e.g. "0-3,8,10-11"
+     *
+     * \param [in]  list        CPU list
+     * \param [out] cpus        CPUs of the list, in order
+     *
+     * \return false if the list is not valid
+     */
+    static bool parseList(const std::string &list, std::vector<int> &cpus);
+
+    /**
+     * Enable the placement
+     *
+     * \details Must be called before router threads start.  An empty CPU list leaves
+     *          the threads of that kind unpinned.
+     *
+     * \param [in] ingest_cpus      CPUs for the ingest (socket) threads
+     * \param [in] parse_cpus       CPUs for the parse threads
+     * \param [in] produce_cpus     CPUs for the Kafka producer threads
+     * \param [in] irq_aware        Place sessions on the node of the CPU receiving their packets
+     */
+    void enable(const std::vector<int> &ingest_cpus, const std::vector<int> &parse_cpus,
+                const std::vector<int> &produce_cpus, bool irq_aware);
+
+    bool enabled() const                    { return is_enabled; }
+
+    /**
+     * Place a router session
+     *
+     * \param [in] sock         Accepted socket of the router
+     *
+     * \return placement, to be released with release()
+     */
+    placement place(int sock);
+
+    /**
+     * Release the placement of a session
+     */
+    void release(const placement &p);
+
+    /**
+     * Pin the calling thread to a CPU
+     *
+     * \param [in] cpu          CPU, -1 to leave the thread unpinned
+     *
+     * \return false if the affinity could not be set
+     */
+    static bool pin(int cpu);
+
+    /**
+     * NUMA node of a CPU, zero if not known
+     */
+    static int nodeOf(int cpu);
+
+private:
+    bool                    is_enabled;     ///< True if enabled, set before threads start
+    bool                    irq_aware;      ///< Place on the node receiving the packets
+    std::vector<int>        ingest_cpus;    ///< CPUs of the ingest threads
+    std::vector<int>        parse_cpus;     ///< CPUs of the parse threads
+    std::vector<int>        produce_cpus;   ///< CPUs of the producer threads
+    std::map<int, int>      cpu_node;       ///< NUMA node of the configured CPUs
+
+    std::mutex              mutex;          ///< Protects the session counts
+    std::map<int, uint32_t> cpu_sessions;   ///< Sessions pinned to each CPU
+    std::map<int, uint32_t> node_sessions;  ///< Sessions placed on each node
+
+    /**
+     * CPU of a list with the fewest sessions, on the node if it has any; mutex must be held
+     *
+     * \return CPU or -1 if the list is empty
+     */
+    int pick(const std::vector<int> &cpus, int node);
+
+    friend class ProcessSingleton<CpuPlacement>;
+
+    CpuPlacement();
+    CpuPlacement(const CpuPlacement &);
+    CpuPlacement &operator=(const CpuPlacement &);
+};
+
+#endif /* CPUPLACEMENT_H_ */
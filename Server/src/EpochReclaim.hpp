@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef EPOCHRECLAIM_HPP_
+#define EPOCHRECLAIM_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * \class   EpochReclaim
+ *
+ * \brief   Epoch based reclamation of objects unlinked from lock free lists
+ * \details Readers walk the lists without locks inside a read section, which
+ *          publishes the global epoch in a reader slot.  Writers unlink objects
+ *          under their own locks and retire them; retiring advances the epoch.
+ *          An object retired in epoch R can only be seen by read sections that
+ *          entered with an epoch <= R, so it is freed once every active reader
+ *          slot holds a later epoch.
+ *
+ *          Reader slots are claimed either per read section or once per thread
+ *          (see claim()); a slot must not be shared by concurrent read sections.
+ *
+ * \tparam  T   Type of the retired objects, freed with delete
+ */
+template <typename T>
+class EpochReclaim {
+public:
+    typedef std::atomic<uint64_t> slot_t;
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] max_readers  Number of reader slots
+     */
+    explicit EpochReclaim(size_t max_readers) : max_readers(max_readers) {
+        readers = new slot_t[max_readers];
+        reader_used = new std::atomic<bool>[max_readers];
+
+        for (size_t i = 0; i < max_readers; i++) {
+            readers[i].store(0, std::memory_order_relaxed);
+            reader_used[i].store(false, std::memory_order_relaxed);
+        }
+
+        epoch.store(1);
+    }
+
+    /**
+     * Destructor for class; frees all retired objects
+     */
+    ~EpochReclaim() {
+        for (size_t i = 0; i < retired.size(); i++)
+            delete retired[i].second;
+
+        delete[] readers;
+        delete[] reader_used;
+    }
+
+    /**
+     * Claim a free reader slot
+     *
+     * \return slot, or NULL if all slots are in use
+     */
+    slot_t *claim() {
+        for (size_t i = 0; i < max_readers; i++) {
+            bool expected = false;
+
+            if (reader_used[i].compare_exchange_strong(expected, true, std::memory_order_acquire))
+                return &readers[i];
+        }
+
+        return NULL;
+    }
+
+    /**
+     * Release a claimed reader slot; the slot must not be in a read section
+     */
+    void unclaim(slot_t *slot) {
+        reader_used[slot - readers].store(false, std::memory_order_release);
+    }
+
+    /**
+     * Enter a read section in a claimed slot
+     */
+    void enter(slot_t *slot) {
+        slot->store(epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+
+        // Publish the slot before reading any list
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    /**
+     * Leave a read section
+     */
+    void leave(slot_t *slot) {
+        slot->store(0, std::memory_order_release);
+    }
+
+    /**
+     * Retire unlinked objects; all of them must be unlinked before the call
+     *
+     * \param [in,out] objs     Objects to free once no reader can see them, cleared
+     *
+     * \return number of retired objects waiting to be freed
+     */
+    size_t retire(std::vector<T *> &objs) {
+        std::lock_guard<std::mutex> lock(retired_mutex);
+
+        if (not objs.empty()) {
+            uint64_t retired_epoch = epoch.fetch_add(1, std::memory_order_seq_cst);
+
+            for (size_t i = 0; i < objs.size(); i++)
+                retired.push_back(std::make_pair(retired_epoch, objs[i]));
+
+            objs.clear();
+        }
+
+        return retired.size();
+    }
+
+    /**
+     * Free retired objects that no reader can see anymore
+     *
+     * \return number of retired objects still waiting to be freed
+     */
+    size_t reclaim() {
+        std::lock_guard<std::mutex> lock(retired_mutex);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        uint64_t min_epoch = UINT64_MAX;
+        for (size_t i = 0; i < max_readers; i++) {
+            uint64_t reader_epoch = readers[i].load(std::memory_order_seq_cst);
+
+            if (reader_epoch != 0 and reader_epoch < min_epoch)
+                min_epoch = reader_epoch;
+        }
+
+        size_t kept = 0;
+        for (size_t i = 0; i < retired.size(); i++) {
+            if (retired[i].first < min_epoch)
+                delete retired[i].second;
+            else
+                retired[kept++] = retired[i];
+        }
+        retired.resize(kept);
+
+        return kept;
+    }
+
+private:
+    const size_t            max_readers;        ///< Number of reader slots
+    slot_t                  *readers;           ///< Epoch of each active read section, 0 if idle
+    std::atomic<bool>       *reader_used;       ///< Reader slot claimed
+    std::atomic<uint64_t>   epoch;              ///< Global epoch
+
+    std::mutex              retired_mutex;      ///< Protects retired
+    std::vector<std::pair<uint64_t, T *> > retired;   ///< Retire epoch and object, waiting to be freed
+
+    EpochReclaim(const EpochReclaim &);
+    EpochReclaim &operator=(const EpochReclaim &);
+};
+
+#endif /* EPOCHRECLAIM_HPP_ */
@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+#ifndef FLATHASHMAP_HPP_
+#define FLATHASHMAP_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+
+/**
+ * Fixed size binary key (e.g. hash id, address + RD)
+ *
+ * \details Keys are compared and hashed as raw bytes, so the key must be fully
+ *          initialized (use the constructors or bzero before setting fields).
+ */
+template <size_t N>
+struct BinaryKey {
+    u_char data[N];
+
+    BinaryKey() {
+        memset(data, 0, N);
+    }
+
+    explicit BinaryKey(const u_char *bytes) {
+        memcpy(data, bytes, N);
+    }
+
+    bool operator==(const BinaryKey &other) const {
+        return memcmp(data, other.data, N) == 0;
+    }
+
+    bool operator!=(const BinaryKey &other) const {
+        return memcmp(data, other.data, N) != 0;
+    }
+};
+
+/**
+ * Hash for BinaryKey
+ *
+ * \details 64bit words are folded with a multiply/xor-shift mix. Keys that are
+ *          already MD5 hashes as well as address keys with long zero runs both
+ *          spread well over the table.
+ */
+template <size_t N>
+struct BinaryKeyHash {
+    size_t operator()(const BinaryKey<N> &key) const {
+        uint64_t h = 0x9E3779B97F4A7C15ULL ^ N;
+        uint64_t w;
+        size_t i = 0;
+
+        for (; i + sizeof(w) <= N; i += sizeof(w)) {
+            memcpy(&w, key.data + i, sizeof(w));
+            h = mix(h ^ w);
+        }
+
+        if (i < N) {
+            w = 0;
+            memcpy(&w, key.data + i, N - i);
+            h = mix(h ^ w);
+        }
+
+        return (size_t)h;
+    }
+
+    static uint64_t mix(uint64_t h) {
+        h ^= h >> 33;
+        h *= 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 33;
+        h *= 0xC4CEB9FE1A85EC53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+};
+
+/**
+ * \class   FlatHashMap
+ *
+ * \brief   Open addressing (linear probing) hash map
+ * \details Keys and values are stored inline in a single slot array, so a lookup
+ *          is one hash and normally one cache line; no per entry heap node is
+ *          allocated.  Erase uses backward shift deletion, so no tombstones are
+ *          left behind.
+ *
+ *          Pointers/references to values are only stable until the next insert
+ *          (operator[] of a missing key) or erase, which may move slots.
+ *
+ *          Not thread safe.
+ */
+template <typename Key, typename Value, typename Hash = BinaryKeyHash<sizeof(Key)> >
+class FlatHashMap {
+private:
+    struct slot {
+        Key     key;
+        Value   value;
+        bool    used;
+
+        slot() : key(), value(), used(false) { }
+    };
+
+    std::vector<slot>   slots;              ///< Slot array, size is always a power of 2
+    size_t              count;              ///< Number of used slots
+    size_t              mask;               ///< slots.size() - 1
+    Hash                hasher;
+
+    /**
+     * Find the slot index for key
+     *
+     * \return slot index if found, otherwise the index of the empty slot where it would be inserted
+     */
+    size_t probe(const Key &key, bool &found) const {
+        size_t i = hasher(key) & mask;
+
+        while (slots[i].used) {
+            if (slots[i].key == key) {
+                found = true;
+                return i;
+            }
+            i = (i + 1) & mask;
+        }
+
+        found = false;
+        return i;
+    }
+
+    /**
+     * Resize the slot array and reinsert all entries
+     *
+     * \param [in] new_size     New number of slots (power of 2)
+     */
+    void rehash(size_t new_size) {
+        std::vector<slot> old;
+        old.swap(slots);
+
+        slots.resize(new_size);
+        mask = new_size - 1;
+
+        bool found;
+        for (size_t i = 0; i < old.size(); i++) {
+            if (old[i].used) {
+                size_t idx = probe(old[i].key, found);
+                slots[idx].key = old[i].key;
+                slots[idx].value = std::move(old[i].value);
+                slots[idx].used = true;
+            }
+        }
+    }
+
+public:
+    /**
+     * Iterator over used slots, in slot order
+     */
+    template <typename MapT, typename SlotT>
+    class iterator_base {
+    public:
+        iterator_base(MapT *map, size_t idx) : map(map), idx(idx) {
+            skip();
+        }
+
+        const Key &key() const      { return map->slots[idx].key; }
+        SlotT &value() const        { return map->slots[idx].value; }
+
+        iterator_base &operator++() {
+            ++idx;
+            skip();
+            return *this;
+        }
+
+        bool operator==(const iterator_base &other) const { return idx == other.idx; }
+        bool operator!=(const iterator_base &other) const { return idx != other.idx; }
+
+    private:
+        MapT    *map;
+        size_t  idx;
+
+        void skip() {
+            while (idx < map->slots.size() and not map->slots[idx].used)
+                ++idx;
+        }
+    };
+
+    typedef iterator_base<FlatHashMap, Value>                   iterator;
+    typedef iterator_base<const FlatHashMap, const Value>       const_iterator;
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] initial_size     Initial number of slots, rounded up to a power of 2
+     */
+    explicit FlatHashMap(size_t initial_size=16) {
+        size_t size = 8;
+        while (size < initial_size)
+            size <<= 1;
+
+        slots.resize(size);
+        mask = size - 1;
+        count = 0;
+    }
+
+    /**
+     * Find the value for key
+     *
+     * \return pointer to the value or NULL if not found
+     */
+    Value *find(const Key &key) {
+        bool found;
+        size_t i = probe(key, found);
+        return found ? &slots[i].value : NULL;
+    }
+
+    const Value *find(const Key &key) const {
+        bool found;
+        size_t i = probe(key, found);
+        return found ? &slots[i].value : NULL;
+    }
+
+    /**
+     * Get the value for key, inserting a value initialized entry if missing
+     */
+    Value &operator[](const Key &key) {
+        bool found;
+        size_t i = probe(key, found);
+
+        if (found)
+            return slots[i].value;
+
+        // Keep load factor at or below 3/4
+        if ((count + 1) * 4 > slots.size() * 3) {
+            rehash(slots.size() << 1);
+            i = probe(key, found);
+        }
+
+        slots[i].key = key;
+        slots[i].value = Value();
+        slots[i].used = true;
+        ++count;
+
+        return slots[i].value;
+    }
+
+    /**
+     * Erase key from the map
+     *
+     * \return true if the key was found and erased
+     */
+    bool erase(const Key &key) {
+        bool found;
+        size_t i = probe(key, found);
+
+        if (not found)
+            return false;
+
+        /*
+         * Backward shift: move following entries of the same probe run back into
+         *      the hole until an empty slot or an entry already at its home slot.
+         */
+        size_t j = i;
+        while (true) {
+            j = (j + 1) & mask;
+
+            if (not slots[j].used)
+                break;
+
+            size_t home = hasher(slots[j].key) & mask;
+
+            // Entry at j may move to i only if its home is not cyclically within (i, j]
+            if (((j - home) & mask) >= ((j - i) & mask)) {
+                slots[i].key = slots[j].key;
+                slots[i].value = std::move(slots[j].value);
+                i = j;
+            }
+        }
+
+        slots[i].used = false;
+        slots[i].value = Value();
+        --count;
+
+        return true;
+    }
+
+    /**
+     * Remove all entries, keeping the allocated slots
+     */
+    void clear() {
+        for (size_t i = 0; i < slots.size(); i++) {
+            if (slots[i].used) {
+                slots[i].used = false;
+                slots[i].value = Value();
+            }
+        }
+        count = 0;
+    }
+
+    size_t size() const     { return count; }
+    bool empty() const      { return count == 0; }
+
+    iterator begin()                { return iterator(this, 0); }
+    iterator end()                  { return iterator(this, slots.size()); }
+    const_iterator begin() const    { return const_iterator(this, 0); }
+    const_iterator end() const      { return const_iterator(this, slots.size()); }
+};
+
+#endif /* FLATHASHMAP_HPP_ */
@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "IngestScheduler.h"
+
+#include <algorithm>
+
+namespace {
+
+/// Router added by the calling thread, for BlockingSection
+thread_local IngestScheduler::router *thread_router = NULL;
+
+} /* anonymous namespace */
+
+/*********************************************************************//**
+ * BlockingSection
+ *********************************************************************/
+IngestScheduler::BlockingSection::BlockingSection() : r(NULL) {
+    if (thread_router != NULL and thread_router->holding) {
+        r = thread_router;
+        IngestScheduler::instance().release(r);
+    }
+}
+
+IngestScheduler::BlockingSection::~BlockingSection() {
+    if (r != NULL)
+        IngestScheduler::instance().acquire(r);
+}
+
+/*********************************************************************//**
+ * IngestScheduler
+ *********************************************************************/
+
+/**
+ * Get the process wide scheduler
+ */
+IngestScheduler &IngestScheduler::instance() {
+    return ProcessSingleton<IngestScheduler>::get();
+}
+
+/**
+ * Constructor for class
+ */
+IngestScheduler::IngestScheduler() {
+    is_enabled = false;
+    quantum = 0;
+    free_slots = 0;
+}
+
+/**
+ * Enable the scheduler
+ *
+ * \param [in] workers      Number of worker slots
+ * \param [in] quantum      Bytes credited per grant, multiplied by the router weight
+ */
+void IngestScheduler::enable(uint32_t workers, uint32_t quantum) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    this->quantum = quantum;
+    free_slots = workers;
+    is_enabled = workers > 0;
+}
+
+/**
+ * Add the router of the calling thread
+ *
+ * \return router state, to be removed with remove() by the same thread
+ */
+IngestScheduler::router *IngestScheduler::add() {
+    router *r = new router;
+
+    r->weight = 1;
+    r->deficit = 0;
+    r->holding = false;
+
+    thread_router = r;
+    return r;
+}
+
+/**
+ * Remove a router, giving up its slot
+ */
+void IngestScheduler::remove(router *r) {
+    if (r == NULL)
+        return;
+
+    release(r);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        waiting.erase(std::remove(waiting.begin(), waiting.end(), r), waiting.end());
+    }
+
+    if (thread_router == r)
+        thread_router = NULL;
+
+    delete r;
+}
+
+/**
+ * Set the weight of a router, used from its next credit
+ */
+void IngestScheduler::setWeight(router *r, uint32_t weight) {
+    std::lock_guard<std::mutex> lock(mutex);
+    r->weight = weight > 0 ? weight : 1;
+}
+
+/**
+ * Wait for a slot, returns right away if the router already holds one
+ */
+void IngestScheduler::acquire(router *r) {
+    if (r->holding)
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (free_slots > 0 and waiting.empty()) {
+        --free_slots;
+        grant(r);
+        return;
+    }
+
+    waiting.push_back(r);
+    r->cv.wait(lock, [r] { return r->holding; });
+}
+
+/**
+ * Charge the bytes of a parsed message to the router credit
+ */
+void IngestScheduler::charge(router *r, size_t bytes) {
+    if (not r->holding)
+        return;
+
+    // Only the router thread changes the deficit while it holds the slot
+    r->deficit -= bytes;
+    if (r->deficit > 0)
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (waiting.empty()) {
+        r->deficit += (int64_t)quantum * r->weight;
+        return;
+    }
+
+    // Credit used; pass the slot on and wait for the next turn
+    r->holding = false;
+    handOff();
+
+    waiting.push_back(r);
+    r->cv.wait(lock, [r] { return r->holding; });
+}
+
+/**
+ * Give up the slot, if held, because the router has no complete message
+ */
+void IngestScheduler::release(router *r) {
+    if (not r->holding)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // An idle router does not keep its credit, only the overshoot of its last message
+    r->deficit = std::min(r->deficit, (int64_t)0);
+    r->holding = false;
+    handOff();
+}
+
+/**
+ * Grant a slot to a router; mutex must be held
+ */
+void IngestScheduler::grant(router *r) {
+    r->deficit += (int64_t)quantum * r->weight;
+    r->holding = true;
+}
+
+/**
+ * Hand a slot given up to the next waiting router or free it; mutex must be held
+ */
+void IngestScheduler::handOff() {
+    if (waiting.empty()) {
+        ++free_slots;
+        return;
+    }
+
+    router *next = waiting.front();
+    waiting.pop_front();
+
+    grant(next);
+    next->cv.notify_one();
+}
@@ -0,0 +1,150 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef INGESTSCHEDULER_H_
+#define INGESTSCHEDULER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "ProcessSingleton.hpp"
+
+/**
+ * \class   IngestScheduler
+ *
+ * \brief   Deficit round robin scheduling of the parse and produce work of the routers
+ * \details Router reader threads must hold one of a fixed number of worker slots
+ *          while they parse a message (parsing includes producing its messages).
+ *          A router that gets a slot is credited quantum x weight bytes; it keeps
+ *          the slot for further messages until the credit is used, and then passes
+ *          it to the next waiting router and queues behind the others.  The
+ *          overshoot of the last message is carried into the next credit.  When
+ *          no other router is waiting, the credit is renewed without a hand-off.
+ *
+ *          A router only asks for a slot once its next message is fully buffered
+ *          and gives it up as soon as it has no complete message, so idle or slow
+ *          senders never hold a slot.  Waits that may block, such as a message
+ *          bus reconnecting, run in a BlockingSection without the slot.
+ */
+class IngestScheduler {
+public:
+    /// Scheduling state of a router
+    struct router {
+        std::condition_variable cv;         ///< Signaled when the router is granted a slot
+        uint32_t                weight;     ///< Weight of the router (router group)
+        int64_t                 deficit;    ///< Bytes left of the credit
+        bool                    holding;    ///< True while the router holds a slot
+    };
+
+    /**
+     * \class   BlockingSection
+     *
+     * \brief   Gives up the slot of the calling thread's router while it may block
+     * \details If the router added by the calling thread holds a slot, the slot is
+     *          handed off for the lifetime of the section and the section end
+     *          waits for a slot again.  Does nothing on other threads.
+     */
+    class BlockingSection {
+    public:
+        BlockingSection();
+        ~BlockingSection();
+
+    private:
+        router  *r;                         ///< Router whose slot was given up, NULL if none
+
+        BlockingSection(const BlockingSection &);
+        BlockingSection &operator=(const BlockingSection &);
+    };
+
+    /**
+     * Get the process wide scheduler
+     */
+    static IngestScheduler &instance();
+
+    /**
+     * Enable the scheduler
+     *
+     * \details Must be called before router threads start.
+     *
+     * \param [in] workers      Number of worker slots
+     * \param [in] quantum      Bytes credited per grant, multiplied by the router weight
+     */
+    void enable(uint32_t workers, uint32_t quantum);
+
+    bool enabled() const                    { return is_enabled; }
+
+    /**
+     * Add the router of the calling thread
+     *
+     * \return router state, to be removed with remove() by the same thread
+     */
+    router *add();
+
+    /**
+     * Remove a router, giving up its slot
+     */
+    void remove(router *r);
+
+    /**
+     * Set the weight of a router, used from its next credit
+     */
+    void setWeight(router *r, uint32_t weight);
+
+    /**
+     * True if the router holds a slot; called by the router thread only
+     */
+    bool holding(const router *r) const     { return r->holding; }
+
+    /**
+     * Wait for a slot, returns right away if the router already holds one
+     */
+    void acquire(router *r);
+
+    /**
+     * Charge the bytes of a parsed message to the router credit
+     *
+     * \details When the credit is used and other routers are waiting, the slot is
+     *          handed to the next router and this call waits for the next turn.
+     */
+    void charge(router *r, size_t bytes);
+
+    /**
+     * Give up the slot, if held, because the router has no complete message
+     */
+    void release(router *r);
+
+private:
+    bool                    is_enabled;     ///< True if enabled, set before threads start
+    uint32_t                quantum;        ///< Bytes credited per grant and weight
+
+    std::mutex              mutex;          ///< Protects the members below and the router grants
+    uint32_t                free_slots;     ///< Slots not held
+    std::deque<router *>    waiting;        ///< Routers waiting for a slot, in arrival order
+
+    /**
+     * Grant a slot to a router; mutex must be held
+     */
+    void grant(router *r);
+
+    /**
+     * Hand a slot given up to the next waiting router or free it; mutex must be held
+     */
+    void handOff();
+
+    friend class ProcessSingleton<IngestScheduler>;
+
+    IngestScheduler();
+    IngestScheduler(const IngestScheduler &);
+    IngestScheduler &operator=(const IngestScheduler &);
+};
+
+#endif /* INGESTSCHEDULER_H_ */
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef JSONFORMAT_H_
+#define JSONFORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/types.h>
+
+#include "TextFormat.h"
+
+/**
+ * Key fragment for jsonfmt::Writer::key(), built at compile time
+ *
+ * \details The fragment is the separator, quoted key and colon (e.g. ,"seq":) so
+ *          each key is a single copy of a constant.
+ */
+#define JSON_KEY(name)      (",\"" name "\":")
+
+/**
+ * JSON record encoding used by the message bus serializers
+ *
+ * \details Objects are written straight into a textfmt::Writer buffer, one object
+ *          per line (JSON lines).  Numbers, hashes and timestamps use the textfmt
+ *          formatters.  Strings are escaped per RFC 8259.  Valid UTF-8 sequences
+ *          are copied as is; bytes that are not part of a valid sequence (e.g.
+ *          Latin-1 text from a router) are replaced by U+FFFD so the output is
+ *          always valid JSON.
+ */
+namespace jsonfmt {
+
+    /**
+     * \class   Writer
+     *
+     * \brief   Appends JSON objects to a text writer
+     * \details Overflow is tracked by the underlying textfmt::Writer.
+     */
+    class Writer {
+    public:
+        explicit Writer(textfmt::Writer &w) : w(w), first(true) {
+        }
+
+        /**
+         * Start an object
+         */
+        Writer &begin() {
+            first = true;
+            w.ch('{');
+            return *this;
+        }
+
+        /**
+         * Complete the object started by begin(), followed by a newline
+         */
+        Writer &end() {
+            w.str("}\n", 2);
+            return *this;
+        }
+
+        /**
+         * Key of the next value
+         *
+         * \param [in] frag     Key fragment from JSON_KEY()
+         */
+        template <size_t N>
+        Writer &key(const char (&frag)[N]) {
+            if (first) {
+                w.str(frag + 1, N - 2);
+                first = false;
+            } else
+                w.str(frag, N - 1);
+
+            return *this;
+        }
+
+        Writer &str(const char *s, size_t n) {
+            w.ch('"');
+            escaped(s, n);
+            w.ch('"');
+            return *this;
+        }
+
+        Writer &str(const char *s)          { return str(s, strlen(s)); }
+        Writer &str(const std::string &s)   { return str(s.data(), s.size()); }
+
+        /**
+         * Two strings joined by a separator as one string (e.g. a route distinguisher)
+         */
+        Writer &str(const std::string &a, char sep, const std::string &b) {
+            w.ch('"');
+            escaped(a.data(), a.size());
+            w.ch(sep);
+            escaped(b.data(), b.size());
+            w.ch('"');
+            return *this;
+        }
+
+        Writer &u32(uint32_t value)         { w.u32(value); return *this; }
+        Writer &u64(uint64_t value)         { w.u64(value); return *this; }
+        Writer &i64(int64_t value)          { w.i64(value); return *this; }
+
+        Writer &boolean(bool value) {
+            if (value)
+                w.str("true", 4);
+            else
+                w.str("false", 5);
+            return *this;
+        }
+
+        /**
+         * 16 byte hash ID as a hex string
+         */
+        Writer &hash(const u_char *hash_id) {
+            w.ch('"').hex(hash_id, 16).ch('"');
+            return *this;
+        }
+
+        /**
+         * Timestamp as "YYYY-MM-DD HH:MM:SS.uuuuuu" (UTC), same as the TSV timestamp
+         */
+        Writer &ts(uint32_t secs, uint32_t us) {
+            char tmp[TEXTFMT_TIMESTAMP_STRLEN];
+            w.ch('"').str(tmp, textfmt::timestamp(tmp, secs, us)).ch('"');
+            return *this;
+        }
+
+    private:
+        textfmt::Writer &w;         ///< Output
+        bool            first;      ///< True until the first key of the object
+
+        void escaped(const char *s, size_t n) {
+            size_t run = 0;
+
+            for (size_t i = 0; i < n; i++) {
+                u_char c = s[i];
+
+                if (c >= 0x20 and c < 0x80 and c != '"' and c != '\\')
+                    continue;
+
+                if (c >= 0x80) {
+                    size_t len = utf8Len((const u_char *)s + i, n - i);
+
+                    if (len > 0) {
+                        i += len - 1;
+                        continue;
+                    }
+
+                    // Invalid byte; replaced by U+FFFD
+                    w.str(s + run, i - run);
+                    w.str("\xEF\xBF\xBD", 3);
+                    run = i + 1;
+                    continue;
+                }
+
+                w.str(s + run, i - run);
+                escape(c);
+                run = i + 1;
+            }
+
+            w.str(s + run, n - run);
+        }
+
+        /**
+         * Length of the UTF-8 sequence starting with a byte of 0x80 or above
+         *
+         * \details Follows RFC 3629: overlong forms, surrogates and code points
+         *          above U+10FFFF are invalid.
+         *
+         * \return sequence length (2 - 4), or 0 if the sequence is not valid
+         */
+        static size_t utf8Len(const u_char *s, size_t n) {
+            size_t len;
+            u_char lo = 0x80, hi = 0xBF;                // Range of the second byte
+
+            if (s[0] >= 0xC2 and s[0] <= 0xDF)
+                len = 2;
+            else if (s[0] >= 0xE0 and s[0] <= 0xEF) {
+                len = 3;
+                if (s[0] == 0xE0)
+                    lo = 0xA0;
+                else if (s[0] == 0xED)
+                    hi = 0x9F;
+            } else if (s[0] >= 0xF0 and s[0] <= 0xF4) {
+                len = 4;
+                if (s[0] == 0xF0)
+                    lo = 0x90;
+                else if (s[0] == 0xF4)
+                    hi = 0x8F;
+            } else
+                return 0;
+
+            if (n < len or s[1] < lo or s[1] > hi)
+                return 0;
+
+            for (size_t i = 2; i < len; i++) {
+                if ((s[i] & 0xC0) != 0x80)
+                    return 0;
+            }
+
+            return len;
+        }
+
+        void escape(u_char c) {
+            static const char hex_digits[] = "0123456789abcdef";
+
+            switch (c) {
+                case '"':  w.str("\\\"", 2); break;
+                case '\\': w.str("\\\\", 2); break;
+                case '\n': w.str("\\n", 2);  break;
+                case '\r': w.str("\\r", 2);  break;
+                case '\t': w.str("\\t", 2);  break;
+                case '\b': w.str("\\b", 2);  break;
+                case '\f': w.str("\\f", 2);  break;
+                default: {
+                    char u[6] = { '\\', 'u', '0', '0', hex_digits[c >> 4], hex_digits[c & 0xF] };
+                    w.str(u, 6);
+                }
+            }
+        }
+    };
+
+} /* namespace jsonfmt */
+
+#endif /* JSONFORMAT_H_ */
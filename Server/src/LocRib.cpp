@@ -0,0 +1,399 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "LocRib.h"
+#include "TextFormat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <arpa/inet.h>
+
+namespace {
+
+/**
+ * Parse an IPv4 address in printed form to host order, zero if not valid
+ */
+uint32_t parseIPv4(const char *addr) {
+    in_addr value;
+
+    if (addr[0] == 0 or inet_pton(AF_INET, addr, &value) != 1)
+        return 0;
+
+    return ntohl(value.s_addr);
+}
+
+} /* anonymous namespace */
+
+/**
+ * Constructor for class
+ *
+ * \param [in] enabled      True to compute the best path
+ * \param [in] pre_policy   True to use the pre-policy Adj-RIB-In, false for post-policy
+ */
+LocRib::LocRib(bool enabled, bool pre_policy) : is_enabled(enabled), pre_policy(pre_policy) {
+}
+
+/**
+ * Get the index of a peer, adding it if new
+ */
+uint32_t LocRib::peerIndex(const MsgBusInterface::obj_bgp_peer &peer) {
+    BinaryKey<16> key(peer.hash_id);
+    uint32_t *idx = peer_index.find(key);
+
+    if (idx != NULL)
+        return *idx;
+
+    peers.resize(peers.size() + 1);
+    peer_entry &p = peers.back();
+
+    memcpy(p.hash_id, peer.hash_id, sizeof(p.hash_id));
+    memcpy(p.peer_addr, peer.peer_addr, sizeof(p.peer_addr));
+    memcpy(p.peer_addr_bin, peer.peer_addr_bin, sizeof(p.peer_addr_bin));
+    p.peer_as = peer.peer_as;
+    p.local_as = 0;
+    p.bgp_id = parseIPv4(peer.peer_bgp_id);
+
+    peer_index[key] = peers.size() - 1;
+    return peers.size() - 1;
+}
+
+/**
+ * Record the local ASN of a peer session (peer up)
+ *
+ * \details The peer up is not specific to the pre or post-policy Adj-RIB-In, so
+ *          it is recorded for any global instance peer.
+ */
+void LocRib::peerUp(const MsgBusInterface::obj_bgp_peer &peer, uint32_t local_asn) {
+    if (not is_enabled or peer.isLocRib or peer.isL3VPN)
+        return;
+
+    peers[peerIndex(peer)].local_as = local_asn;
+}
+
+/**
+ * Build the prefix key of a rib entry
+ */
+void LocRib::prefixKey(const MsgBusInterface::obj_rib &rib, prefix_key_t &key) {
+    memcpy(key.data, rib.prefix_bin, 16);
+    key.data[16] = rib.prefix_len;
+    key.data[17] = rib.isIPv4;
+    key.data[18] = rib.labels[0] != 0;
+}
+
+/**
+ * Add or replace advertised prefixes and publish best path changes
+ */
+void LocRib::advertise(MsgBusInterface *mbus_ptr, const MsgBusInterface::obj_bgp_peer &peer,
+                       const MsgBusInterface::rib_vector &rib, const PathAttrTable::ref &attr) {
+    if (not accepts(peer) or not attr)
+        return;
+
+    const MsgBusInterface::obj_path_attr &a = attr->attr;
+    prefix_key_t key;
+    path p;
+
+    /*
+     * Decision fields are the same for all prefixes of the update
+     */
+    p.peer_idx = peerIndex(peer);
+    p.attr = attr;
+    p.local_pref = a.local_pref_present ? a.local_pref : LOC_RIB_DEFAULT_LOCAL_PREF;
+    p.as_path_len = a.as_path_count;
+    p.med = a.med;
+    p.neighbor_as = a.neighbor_as;
+    p.router_id = a.originator_id[0] != 0 ? parseIPv4(a.originator_id) : peers[p.peer_idx].bgp_id;
+    p.ebgp = peers[p.peer_idx].local_as != 0 and peers[p.peer_idx].peer_as != peers[p.peer_idx].local_as;
+
+    if (strcmp(a.origin, "igp") == 0)
+        p.origin = 0;
+    else if (strcmp(a.origin, "egp") == 0)
+        p.origin = 1;
+    else
+        p.origin = 2;
+
+    memset(p.next_hop, 0, sizeof(p.next_hop));
+    if (a.next_hop[0] != 0)
+        inet_pton(a.nexthop_isIPv4 ? AF_INET : AF_INET6, a.next_hop, p.next_hop);
+
+    for (size_t i = 0; i < rib.size(); i++) {
+        prefixKey(rib[i], key);
+        prefix_entry &entry = prefixes[key];
+
+        p.path_id = rib[i].path_id;
+
+        // Replace the path of the peer, or add it
+        size_t j = 0;
+        while (j < entry.paths.size() and (entry.paths[j].peer_idx != p.peer_idx
+                                           or entry.paths[j].path_id != p.path_id))
+            ++j;
+
+        if (j < entry.paths.size())
+            entry.paths[j] = p;
+        else
+            entry.paths.push_back(p);
+
+        update(key, entry, peer);
+    }
+
+    publish(mbus_ptr);
+}
+
+/**
+ * Remove withdrawn prefixes and publish best path changes
+ */
+void LocRib::withdraw(MsgBusInterface *mbus_ptr, const MsgBusInterface::obj_bgp_peer &peer,
+                      const MsgBusInterface::rib_vector &rib) {
+    if (not accepts(peer))
+        return;
+
+    uint32_t *idx = peer_index.find(BinaryKey<16>(peer.hash_id));
+    if (idx == NULL)
+        return;
+
+    prefix_key_t key;
+
+    for (size_t i = 0; i < rib.size(); i++) {
+        prefixKey(rib[i], key);
+
+        prefix_entry *entry = prefixes.find(key);
+        if (entry == NULL)
+            continue;
+
+        for (size_t j = 0; j < entry->paths.size(); j++) {
+            if (entry->paths[j].peer_idx == *idx and entry->paths[j].path_id == rib[i].path_id) {
+                entry->paths[j] = entry->paths.back();
+                entry->paths.pop_back();
+
+                update(key, *entry, peer);
+
+                if (entry->paths.empty())
+                    prefixes.erase(key);
+                break;
+            }
+        }
+    }
+
+    publish(mbus_ptr);
+}
+
+/**
+ * Remove all paths of a peer (peer down) and publish best path changes
+ */
+void LocRib::removePeer(MsgBusInterface *mbus_ptr, const MsgBusInterface::obj_bgp_peer &peer) {
+    if (not accepts(peer))
+        return;
+
+    uint32_t *idx = peer_index.find(BinaryKey<16>(peer.hash_id));
+    if (idx == NULL)
+        return;
+
+    std::vector<prefix_key_t> empty;
+
+    for (FlatHashMap<prefix_key_t, prefix_entry>::iterator it = prefixes.begin(); it != prefixes.end(); ++it) {
+        prefix_entry &entry = it.value();
+        size_t count = entry.paths.size();
+
+        for (size_t j = 0; j < entry.paths.size(); ) {
+            if (entry.paths[j].peer_idx == *idx) {
+                entry.paths[j] = entry.paths.back();
+                entry.paths.pop_back();
+            } else
+                ++j;
+        }
+
+        if (entry.paths.size() == count)
+            continue;
+
+        update(it.key(), entry, peer);
+
+        // Entries are erased after the scan; erase moves entries
+        if (entry.paths.empty())
+            empty.push_back(it.key());
+    }
+
+    for (size_t i = 0; i < empty.size(); i++)
+        prefixes.erase(empty[i]);
+
+    publish(mbus_ptr);
+}
+
+/**
+ * Remove all paths without publishing (router termination)
+ */
+void LocRib::clear() {
+    prefixes.clear();
+    peers.clear();
+    peer_index.clear();
+    changes.clear();
+    change_attrs.clear();
+}
+
+/**
+ * Final tie breaks (steps 5 to 8)
+ */
+bool LocRib::tieBreakLess(const path &a, const path &b) const {
+    if (a.ebgp != b.ebgp)
+        return a.ebgp;
+
+    int cmp = memcmp(a.next_hop, b.next_hop, sizeof(a.next_hop));
+    if (cmp != 0)
+        return cmp < 0;
+
+    if (a.router_id != b.router_id)
+        return a.router_id < b.router_id;
+
+    cmp = memcmp(peers[a.peer_idx].peer_addr_bin, peers[b.peer_idx].peer_addr_bin,
+                 sizeof(peers[a.peer_idx].peer_addr_bin));
+    if (cmp != 0)
+        return cmp < 0;
+
+    return a.path_id < b.path_id;
+}
+
+/**
+ * Run the decision process over the candidate paths
+ */
+int LocRib::selectBest(const prefix_entry &entry) {
+    const std::vector<path> &paths = entry.paths;
+
+    if (paths.size() <= 1)
+        return paths.empty() ? -1 : 0;
+
+    /*
+     * Steps 1 to 3: local preference, AS path length and origin
+     */
+    candidates.clear();
+    for (uint32_t i = 0; i < paths.size(); i++) {
+        if (not candidates.empty()) {
+            const path &a = paths[i];
+            const path &b = paths[candidates[0]];
+
+            if (a.local_pref != b.local_pref) {
+                if (a.local_pref < b.local_pref)
+                    continue;
+                candidates.clear();
+
+            } else if (a.as_path_len != b.as_path_len) {
+                if (a.as_path_len > b.as_path_len)
+                    continue;
+                candidates.clear();
+
+            } else if (a.origin != b.origin) {
+                if (a.origin > b.origin)
+                    continue;
+                candidates.clear();
+            }
+        }
+
+        candidates.push_back(i);
+    }
+
+    /*
+     * Step 4: MED is not transitive across neighbor ASes; remove each path that has
+     *      a lower MED path of the same neighbor AS.
+     */
+    if (candidates.size() > 1) {
+        std::sort(candidates.begin(), candidates.end(), [&paths](uint32_t a, uint32_t b) {
+            if (paths[a].neighbor_as != paths[b].neighbor_as)
+                return paths[a].neighbor_as < paths[b].neighbor_as;
+            return paths[a].med < paths[b].med;
+        });
+
+        size_t kept = 0;
+        uint32_t group_med = 0;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            const path &p = paths[candidates[i]];
+
+            if (i == 0 or p.neighbor_as != paths[candidates[i - 1]].neighbor_as)
+                group_med = p.med;
+
+            if (p.med == group_med)
+                candidates[kept++] = candidates[i];
+        }
+        candidates.resize(kept);
+    }
+
+    /*
+     * Steps 5 to 8
+     */
+    uint32_t best = candidates[0];
+    for (size_t i = 1; i < candidates.size(); i++) {
+        if (tieBreakLess(paths[candidates[i]], paths[best]))
+            best = candidates[i];
+    }
+
+    return best;
+}
+
+/**
+ * Select the best path and queue a change if it is different than before
+ */
+void LocRib::update(const prefix_key_t &key, prefix_entry &entry, const MsgBusInterface::obj_bgp_peer &peer) {
+    int best = selectBest(entry);
+    MsgBusInterface::obj_loc_rib row;
+
+    if (best < 0) {
+        if (not entry.best_attr)
+            return;
+
+        entry.best_attr.reset();
+        row.action = MsgBusInterface::LOC_RIB_ACTION_DEL;
+        row.attr = NULL;
+        row.peer_addr[0] = 0;
+        row.peer_as = 0;
+        row.path_id = 0;
+        memset(row.peer_hash_id, 0, sizeof(row.peer_hash_id));
+
+    } else {
+        const path &p = entry.paths[best];
+
+        if (entry.best_attr and entry.best_attr.get() == p.attr.get() and entry.best_peer_idx == p.peer_idx
+                and entry.best_path_id == p.path_id)
+            return;
+
+        entry.best_attr = p.attr;
+        entry.best_peer_idx = p.peer_idx;
+        entry.best_path_id = p.path_id;
+
+        const peer_entry &pe = peers[p.peer_idx];
+
+        row.action = MsgBusInterface::LOC_RIB_ACTION_ADD;
+        row.attr = &p.attr->attr;
+        memcpy(row.peer_hash_id, pe.hash_id, sizeof(row.peer_hash_id));
+        memcpy(row.peer_addr, pe.peer_addr, sizeof(row.peer_addr));
+        row.peer_as = pe.peer_as;
+        row.path_id = p.path_id;
+
+        change_attrs.push_back(p.attr);
+    }
+
+    memcpy(row.router_hash_id, peer.router_hash_id, sizeof(row.router_hash_id));
+    textfmt::ip(row.prefix, key.data, key.data[17]);
+    row.prefix_len = key.data[16];
+    row.isIPv4 = key.data[17];
+    row.isLabeled = key.data[18];
+    row.paths = entry.paths.size();
+    row.timestamp_secs = peer.timestamp_secs;
+    row.timestamp_us = peer.timestamp_us;
+
+    changes.push_back(row);
+}
+
+/**
+ * Publish the queued changes
+ */
+void LocRib::publish(MsgBusInterface *mbus_ptr) {
+    if (changes.empty())
+        return;
+
+    mbus_ptr->update_LocRib(changes);
+
+    changes.clear();
+    change_attrs.clear();
+}
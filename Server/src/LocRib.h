@@ -0,0 +1,199 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef LOCRIB_H_
+#define LOCRIB_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MsgBusInterface.hpp"
+#include "PathAttrTable.h"
+#include "FlatHashMap.hpp"
+
+#define LOC_RIB_DEFAULT_LOCAL_PREF  100     // Local preference of paths without LOCAL_PREF
+
+/**
+ * \class   LocRib
+ *
+ * \brief   Per router best path (Loc-RIB) computed from the Adj-RIB-In of all peers
+ * \details Holds the unicast and labeled unicast paths of all global instance peers
+ *          of the router, for either the pre-policy or the post-policy Adj-RIB-In,
+ *          and runs the BGP decision process (RFC 4271 9.1.2.2) for each prefix
+ *          that changes.  Only changes of the best path are published.
+ *
+ *          Decision steps, in order:
+ *              1. Highest local preference (LOC_RIB_DEFAULT_LOCAL_PREF if not present)
+ *              2. Shortest AS path
+ *              3. Lowest origin (igp, egp, incomplete)
+ *              4. Lowest MED, compared only between paths of the same neighbor AS
+ *              5. eBGP over iBGP
+ *              6. Lowest next hop address (in place of the IGP cost, which is not known)
+ *              7. Lowest router ID (originator ID if present, else peer BGP ID)
+ *              8. Lowest peer address, then lowest path ID
+ *
+ *          A peer is eBGP if its ASN differs from the local ASN of the session,
+ *          taken from the sent OPEN of the peer up.  Peers without a peer up are
+ *          treated as iBGP.  Peers in another member AS of a confederation count
+ *          as eBGP, since the member ASes are not known.
+ *
+ *          Not thread safe.  Each BMP reader owns one Loc-RIB.
+ */
+class LocRib {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] enabled      True to compute the best path
+     * \param [in] pre_policy   True to use the pre-policy Adj-RIB-In, false for post-policy
+     */
+    LocRib(bool enabled, bool pre_policy);
+
+    /**
+     * Add or replace advertised prefixes and publish best path changes
+     *
+     * \param [in] mbus_ptr     Message bus
+     * \param [in] peer         Peer of the prefixes
+     * \param [in] rib          Advertised prefixes
+     * \param [in] attr         Shared path attributes of the prefixes
+     */
+    void advertise(MsgBusInterface *mbus_ptr, const MsgBusInterface::obj_bgp_peer &peer,
+                   const MsgBusInterface::rib_vector &rib, const PathAttrTable::ref &attr);
+
+    /**
+     * Record the local ASN of a peer session (peer up)
+     *
+     * \param [in] peer         Peer that came up
+     * \param [in] local_asn    Local ASN of the session, from the sent OPEN
+     */
+    void peerUp(const MsgBusInterface::obj_bgp_peer &peer, uint32_t local_asn);
+
+    /**
+     * Remove withdrawn prefixes and publish best path changes
+     *
+     * \param [in] mbus_ptr     Message bus
+     * \param [in] peer         Peer of the prefixes
+     * \param [in] rib          Withdrawn prefixes
+     */
+    void withdraw(MsgBusInterface *mbus_ptr, const MsgBusInterface::obj_bgp_peer &peer,
+                  const MsgBusInterface::rib_vector &rib);
+
+    /**
+     * Remove all paths of a peer (peer down) and publish best path changes
+     *
+     * \param [in] mbus_ptr     Message bus
+     * \param [in] peer         Peer that went down
+     */
+    void removePeer(MsgBusInterface *mbus_ptr, const MsgBusInterface::obj_bgp_peer &peer);
+
+    /**
+     * Remove all paths without publishing (router termination)
+     */
+    void clear();
+
+    /**
+     * Check if the paths of the peer are used
+     *
+     * \details Only the Adj-RIB-In of global instance peers; Adj-RIB-Out (RFC 8671)
+     *          paths are what the router sends, not candidates of its decision.
+     */
+    bool accepts(const MsgBusInterface::obj_bgp_peer &peer) const {
+        return is_enabled and peer.isAdjIn and not peer.isLocRib and not peer.isL3VPN
+               and peer.isPrePolicy == pre_policy;
+    }
+
+    bool enabled() const                { return is_enabled; }
+
+private:
+    /// Key: prefix (16), prefix length (1), IPv4 (1), labeled (1)
+    typedef BinaryKey<19> prefix_key_t;
+
+    /**
+     * Candidate path of a prefix, with the decision fields taken from the attributes
+     */
+    struct path {
+        uint32_t            peer_idx;           ///< Index of the peer in peers
+        uint32_t            path_id;            ///< Add path ID, zero if not used
+        PathAttrTable::ref  attr;               ///< Path attributes
+        uint32_t            local_pref;
+        uint32_t            as_path_len;
+        uint32_t            med;
+        uint32_t            neighbor_as;        ///< First ASN after the confederation segments, zero if none
+        uint32_t            router_id;          ///< Originator ID or peer BGP ID (host order)
+        uint8_t             origin;             ///< 0=igp, 1=egp, 2=incomplete
+        bool                ebgp;               ///< True if learned from an eBGP peer
+        uint8_t             next_hop[16];       ///< Next hop in binary form
+    };
+
+    struct prefix_entry {
+        std::vector<path>   paths;              ///< Candidate paths
+        PathAttrTable::ref  best_attr;          ///< Attributes of the published best path, empty if none
+        uint32_t            best_peer_idx;      ///< Peer of the published best path
+        uint32_t            best_path_id;       ///< Path ID of the published best path
+    };
+
+    struct peer_entry {
+        u_char              hash_id[16];
+        char                peer_addr[46];
+        uint8_t             peer_addr_bin[16];
+        uint32_t            peer_as;
+        uint32_t            local_as;           ///< Local ASN of the session, zero if not known
+        uint32_t            bgp_id;             ///< Peer BGP ID (host order)
+    };
+
+    bool                                        is_enabled;     ///< True if enabled
+    bool                                        pre_policy;     ///< Use pre-policy peers if true, else post-policy
+    FlatHashMap<prefix_key_t, prefix_entry>     prefixes;       ///< Candidate paths by prefix
+    std::vector<peer_entry>                     peers;          ///< Peers with paths
+    FlatHashMap<BinaryKey<16>, uint32_t>        peer_index;     ///< Peer hash to index in peers
+    std::vector<MsgBusInterface::obj_loc_rib>   changes;        ///< Best path changes not yet published
+    std::vector<PathAttrTable::ref>             change_attrs;   ///< Keeps the attributes of changes until published
+    std::vector<uint32_t>                       candidates;     ///< Working list of the decision process
+
+    /**
+     * Get the index of a peer, adding it if new
+     */
+    uint32_t peerIndex(const MsgBusInterface::obj_bgp_peer &peer);
+
+    /**
+     * Build the prefix key of a rib entry
+     */
+    static void prefixKey(const MsgBusInterface::obj_rib &rib, prefix_key_t &key);
+
+    /**
+     * Run the decision process over the candidate paths
+     *
+     * \return index of the best path, -1 if there are no paths
+     */
+    int selectBest(const prefix_entry &entry);
+
+    /**
+     * Final tie breaks (steps 5 to 8)
+     *
+     * \return true if path a is preferred over path b
+     */
+    bool tieBreakLess(const path &a, const path &b) const;
+
+    /**
+     * Select the best path and queue a change if it is different than before
+     *
+     * \param [in] key          Prefix key
+     * \param [in] entry        Prefix entry, erased by the caller if it has no paths left
+     * \param [in] peer         Peer of the update (timestamp of the change)
+     */
+    void update(const prefix_key_t &key, prefix_entry &entry, const MsgBusInterface::obj_bgp_peer &peer);
+
+    /**
+     * Publish the queued changes
+     */
+    void publish(MsgBusInterface *mbus_ptr);
+};
+
+#endif /* LOCRIB_H_ */
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "MrtFile.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * Create a directory and its parents
+ *
+ * \return true if the directory exists
+ */
+bool makeDirs(const std::string &dir) {
+    for (size_t pos = 1; pos <= dir.size(); pos++) {
+        if (pos == dir.size() or dir[pos] == '/') {
+            std::string part = dir.substr(0, pos);
+
+            if (mkdir(part.c_str(), 0755) != 0 and errno != EEXIST)
+                return false;
+        }
+    }
+
+    return true;
+}
+
+bool fileExists(const std::string &path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+} /* anonymous namespace */
+
+/**
+ * Constructor for class
+ *
+ * \param [in] logPtr       Pointer to existing Logger for app logging
+ * \param [in] compress     True to gzip the file
+ */
+MrtFile::MrtFile(Logger *logPtr, bool compress) : logger(logPtr), compress(compress) {
+    fd = -1;
+    gz = NULL;
+    buf = NULL;
+    buf_len = 0;
+}
+
+MrtFile::~MrtFile() {
+    close();
+    delete[] buf;
+}
+
+/**
+ * Open a new file
+ */
+bool MrtFile::open(const std::string &dir, const std::string &name) {
+    close();
+
+    if (not makeDirs(dir)) {
+        LOG_ERR("Failed to create MRT directory %s: %s", dir.c_str(), strerror(errno));
+        return false;
+    }
+
+    std::string base = dir + "/" + name;
+    const char *ext = compress ? ".gz" : "";
+
+    path = base + ext;
+    for (int n = 1; fileExists(path) or fileExists(path + ".tmp"); n++) {
+        char suffix[16];
+        snprintf(suffix, sizeof(suffix), ".%d", n);
+        path = base + suffix + ext;
+    }
+
+    std::string tmp_path = path + ".tmp";
+
+    if (compress) {
+        if ((gz = gzopen(tmp_path.c_str(), "wb")) != NULL)
+            gzbuffer(gz, MRT_GZ_BUF_SIZE);
+    } else
+        fd = ::open(tmp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    if (not isOpen()) {
+        LOG_ERR("Failed to open MRT file %s: %s", tmp_path.c_str(), strerror(errno));
+        return false;
+    }
+
+    if (buf == NULL)
+        buf = new u_char[MRT_WRITE_BUF_SIZE];
+
+    return true;
+}
+
+/**
+ * Get buffer space for a record
+ */
+u_char *MrtFile::reserve(size_t len) {
+    if (not isOpen() or len > MRT_WRITE_BUF_SIZE)
+        return NULL;
+
+    if (buf_len + len > MRT_WRITE_BUF_SIZE)
+        flushBuffer();
+
+    return buf + buf_len;
+}
+
+/**
+ * Write the buffer to the file
+ */
+void MrtFile::flushBuffer() {
+    if (buf_len == 0)
+        return;
+
+    if (gz != NULL) {
+        if (gzwrite(gz, buf, buf_len) != (int)buf_len)
+            LOG_ERR("Failed to write MRT file %s", path.c_str());
+
+    } else if (fd >= 0) {
+        size_t written = 0;
+
+        while (written < buf_len) {
+            ssize_t bytes = write(fd, buf + written, buf_len - written);
+
+            if (bytes < 0 and errno == EINTR)
+                continue;
+
+            if (bytes <= 0) {
+                LOG_ERR("Failed to write MRT file %s: %s", path.c_str(), strerror(errno));
+                break;
+            }
+
+            written += bytes;
+        }
+    }
+
+    buf_len = 0;
+}
+
+/**
+ * Write buffered records and complete the file
+ */
+void MrtFile::close() {
+    if (not isOpen())
+        return;
+
+    flushBuffer();
+
+    if (gz != NULL) {
+        gzclose(gz);
+        gz = NULL;
+    } else {
+        ::close(fd);
+        fd = -1;
+    }
+
+    std::string tmp_path = path + ".tmp";
+    if (rename(tmp_path.c_str(), path.c_str()) != 0)
+        LOG_ERR("Failed to rename MRT file %s: %s", tmp_path.c_str(), strerror(errno));
+}
+
+/**
+ * Close and remove an incomplete file
+ */
+void MrtFile::discard() {
+    if (not isOpen())
+        return;
+
+    buf_len = 0;
+
+    if (gz != NULL) {
+        gzclose(gz);
+        gz = NULL;
+    } else {
+        ::close(fd);
+        fd = -1;
+    }
+
+    std::string tmp_path = path + ".tmp";
+    unlink(tmp_path.c_str());
+}
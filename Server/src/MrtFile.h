@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef MRTFILE_H_
+#define MRTFILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/types.h>
+#include <arpa/inet.h>
+#include <zlib.h>
+
+#include "Logger.h"
+
+#define MRT_WRITE_BUF_SIZE          (1024 * 1024)   // Records are written to the file in chunks of this size
+#define MRT_GZ_BUF_SIZE             (256 * 1024)    // zlib buffer size
+
+/**
+ * \class   MrtFile
+ *
+ * \brief   Buffered output file of MRT (RFC 6396) records
+ * \details The file is written with a .tmp suffix that is removed once the file
+ *          is complete, so readers never pick up a partial file.  Records are
+ *          built in place in a buffer and written in large sequential writes.
+ *
+ *          Not thread safe.
+ */
+class MrtFile {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] logPtr       Pointer to existing Logger for app logging
+     * \param [in] compress     True to gzip the file
+     */
+    MrtFile(Logger *logPtr, bool compress);
+
+    ~MrtFile();
+
+    /**
+     * Open a new file
+     *
+     * \details The directory is created if needed.  If the name is taken, a
+     *          numbered name is used instead of replacing the earlier file.
+     *
+     * \param [in] dir          Directory of the file
+     * \param [in] name         File name, .gz is appended if compressed
+     *
+     * \return true if the file is open
+     */
+    bool open(const std::string &dir, const std::string &name);
+
+    /**
+     * Get buffer space for a record
+     *
+     * \details Call commit() once the record is written.
+     *
+     * \param [in] len          Length of the record, including the MRT header
+     *
+     * \return pointer to len bytes, or NULL if no file is open or the record is too large
+     */
+    u_char *reserve(size_t len);
+
+    /**
+     * Complete a record written to the space returned by reserve()
+     */
+    void commit(size_t len)             { buf_len += len; }
+
+    /**
+     * Write buffered records and complete the file
+     */
+    void close();
+
+    /**
+     * Close and remove an incomplete file
+     */
+    void discard();
+
+    bool isOpen() const                 { return fd >= 0 or gz != NULL; }
+
+    const std::string &getPath() const  { return path; }
+
+private:
+    Logger                  *logger;            ///< Logging class pointer
+    bool                    compress;           ///< gzip the file
+
+    int                     fd;                 ///< Open file (uncompressed), -1 if none
+    gzFile                  gz;                 ///< Open file (compressed), NULL if none
+    std::string             path;               ///< Final path of the open file
+
+    u_char                  *buf;               ///< Record buffer, allocated on first open
+    size_t                  buf_len;            ///< Bytes in the buffer
+
+    /**
+     * Write the buffer to the file
+     */
+    void flushBuffer();
+
+    MrtFile(const MrtFile &);
+    MrtFile &operator=(const MrtFile &);
+};
+
+/*
+ * Record encoding helpers, values are written in network byte order
+ */
+inline u_char *mrt_put16(u_char *p, uint16_t value) {
+    value = htons(value);
+    memcpy(p, &value, 2);
+    return p + 2;
+}
+
+inline u_char *mrt_put32(u_char *p, uint32_t value) {
+    value = htonl(value);
+    memcpy(p, &value, 4);
+    return p + 4;
+}
+
+#endif /* MRTFILE_H_ */
@@ -0,0 +1,656 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "MrtSnapshot.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+/*
+ * MRT types (RFC 6396, RFC 8050)
+ */
+#define MRT_TYPE_TABLE_DUMP_V2              13
+#define MRT_TD2_PEER_INDEX_TABLE            1
+#define MRT_TD2_RIB_IPV4_UNICAST            2
+#define MRT_TD2_RIB_IPV6_UNICAST            4
+#define MRT_TD2_RIB_IPV4_UNICAST_ADDPATH    8
+#define MRT_TD2_RIB_IPV6_UNICAST_ADDPATH    10
+
+#define MRT_PEER_TYPE_IPV6                  0x01
+#define MRT_PEER_TYPE_AS4                   0x02
+
+/*
+ * BGP path attributes (RFC 4271 and others)
+ */
+#define BGP_ATTR_FLAG_OPTIONAL              0x80
+#define BGP_ATTR_FLAG_TRANSITIVE            0x40
+#define BGP_ATTR_FLAG_EXT_LEN               0x10
+
+#define BGP_ATTR_ORIGIN                     1
+#define BGP_ATTR_AS_PATH                    2
+#define BGP_ATTR_NEXT_HOP                   3
+#define BGP_ATTR_MED                        4
+#define BGP_ATTR_LOCAL_PREF                 5
+#define BGP_ATTR_ATOMIC_AGGREGATE           6
+#define BGP_ATTR_AGGREGATOR                 7
+#define BGP_ATTR_COMMUNITIES                8
+#define BGP_ATTR_ORIGINATOR_ID              9
+#define BGP_ATTR_CLUSTER_LIST               10
+#define BGP_ATTR_MP_REACH_NLRI              14
+#define BGP_ATTR_LARGE_COMMUNITY            32
+
+#define BGP_AS_SET                          1
+#define BGP_AS_SEQUENCE                     2
+
+namespace {
+
+void append16(std::string &out, uint16_t value) {
+    out.push_back(value >> 8);
+    out.push_back(value & 0xFF);
+}
+
+void append32(std::string &out, uint32_t value) {
+    append16(out, value >> 16);
+    append16(out, value & 0xFFFF);
+}
+
+/**
+ * Append an IPv4 address in printed form, false if not valid
+ */
+bool appendIPv4(std::string &out, const char *addr) {
+    in_addr value;
+
+    if (inet_pton(AF_INET, addr, &value) != 1)
+        return false;
+
+    out.append((const char *)&value, 4);
+    return true;
+}
+
+/**
+ * Append an attribute with its header
+ */
+void appendAttr(std::string &out, uint8_t flags, uint8_t type, const std::string &value) {
+    if (value.size() > 0xFFFF)
+        return;
+
+    if (value.size() > 0xFF)
+        flags |= BGP_ATTR_FLAG_EXT_LEN;
+
+    out.push_back(flags);
+    out.push_back(type);
+
+    if (flags & BGP_ATTR_FLAG_EXT_LEN)
+        append16(out, value.size());
+    else
+        out.push_back(value.size());
+
+    out.append(value);
+}
+
+/**
+ * Append an AS path segment, split in segments of at most 255 ASNs
+ */
+void appendSegment(std::string &out, uint8_t type, const std::vector<uint32_t> &asns) {
+    for (size_t i = 0; i < asns.size(); i += 255) {
+        size_t count = std::min(asns.size() - i, (size_t)255);
+
+        out.push_back(type);
+        out.push_back(count);
+
+        for (size_t j = i; j < i + count; j++)
+            append32(out, asns[j]);
+    }
+}
+
+/**
+ * Encode an AS path in printed form (e.g. " 65001 65002 { 1 2 }") as AS_PATH segments
+ *
+ * \details Confederation segments are printed like the other segments and are
+ *          encoded as AS_SEQUENCE and AS_SET.
+ */
+void encodeAsPath(const std::string &as_path, std::string &out) {
+    std::vector<uint32_t> asns;
+    uint8_t type = BGP_AS_SEQUENCE;
+    const char *p = as_path.c_str();
+
+    while (*p != 0) {
+        if (*p == '{' or *p == '}') {
+            appendSegment(out, type, asns);
+            asns.clear();
+            type = *p == '{' ? BGP_AS_SET : BGP_AS_SEQUENCE;
+            ++p;
+
+        } else if (*p >= '0' and *p <= '9') {
+            char *end;
+            asns.push_back(strtoul(p, &end, 10));
+            p = end;
+
+        } else
+            ++p;
+    }
+
+    appendSegment(out, type, asns);
+}
+
+} /* anonymous namespace */
+
+/**
+ * Constructor for class
+ *
+ * \param [in] logPtr       Pointer to existing Logger for app logging
+ * \param [in] directory    Snapshot directory
+ * \param [in] interval     Seconds between snapshots
+ * \param [in] compress     True to gzip the files
+ */
+MrtSnapshot::MrtSnapshot(Logger *logPtr, const std::string &directory, uint32_t interval, bool compress)
+        : logger(logPtr), directory(directory), interval(interval), compress(compress) {
+    running = false;
+    thr = NULL;
+
+    if (this->interval == 0)
+        this->interval = 7200;
+}
+
+MrtSnapshot::~MrtSnapshot() {
+    stop();
+}
+
+/**
+ * Start writing snapshots, the first at the next interval boundary
+ */
+void MrtSnapshot::start() {
+    if (thr != NULL)
+        return;
+
+    running = true;
+    thr = new std::thread(&MrtSnapshot::run, this);
+
+    LOG_INFO("MRT snapshots every %u seconds to %s", interval, directory.c_str());
+}
+
+/**
+ * Stop writing snapshots; a snapshot in progress is abandoned
+ */
+void MrtSnapshot::stop() {
+    if (thr != NULL) {
+        running = false;
+        thr->join();
+        delete thr;
+        thr = NULL;
+    }
+}
+
+/**
+ * Write snapshots at each interval until stopped
+ */
+void MrtSnapshot::run() {
+    uint64_t next = ((uint64_t)time(NULL) / interval + 1) * interval;
+
+    while (running) {
+        uint64_t now = time(NULL);
+
+        if (now >= next) {
+            uint32_t start_secs = now / interval * interval;
+            next = (uint64_t)start_secs + interval;
+
+            if (writeSnapshot(start_secs))
+                LOG_INFO("MRT snapshot of %zu routers written in %lu seconds", routers.size(),
+                         (unsigned long)(time(NULL) - now));
+            else
+                LOG_NOTICE("MRT snapshot stopped before complete");
+
+            routers.clear();
+        }
+
+        // Wake up periodically to check if still running
+        sleep(1);
+    }
+}
+
+/**
+ * Write the snapshot of all routers
+ */
+bool MrtSnapshot::writeSnapshot(uint32_t start_secs) {
+    RibIndex &index = RibIndex::instance();
+    size_t slots = index.peerSlots();
+
+    /*
+     * Group the active peers by router; peers added after this point are not
+     *      in the snapshot.
+     */
+    routers.clear();
+    slot_router.assign(slots, -1);
+    slot_index.assign(slots, 0);
+
+    for (size_t i = 0; i < slots; i++) {
+        const RibIndex::peer &p = index.getPeer(i);
+
+        if (not p.active.load(std::memory_order_acquire))
+            continue;
+
+        size_t r = 0;
+        while (r < routers.size() and memcmp(routers[r].router_hash_id, p.router_hash_id, 16) != 0)
+            ++r;
+
+        if (r == routers.size()) {
+            routers.resize(r + 1);
+            memcpy(routers[r].router_hash_id, p.router_hash_id, 16);
+            routers[r].router_addr = p.router_addr;
+            routers[r].file = NULL;
+            routers[r].seq = 0;
+        }
+
+        if (routers[r].peers.size() >= 0xFFFF)
+            continue;
+
+        slot_router[i] = r;
+        slot_index[i] = routers[r].peers.size();
+        routers[r].peers.push_back(i);
+    }
+
+    char name[64];
+    time_t start = start_secs;
+    tm tm_start;
+    gmtime_r(&start, &tm_start);
+    strftime(name, sizeof(name), "rib.%Y%m%d.%H%M", &tm_start);
+
+    /*
+     * Routers are written in batches to limit the number of open files, each
+     *      batch in one pass over the index.
+     */
+    for (size_t first = 0; first < routers.size(); first += MRT_SNAPSHOT_MAX_FILES) {
+        size_t last = std::min(first + MRT_SNAPSHOT_MAX_FILES, routers.size());
+
+        for (size_t r = first; r < last; r++) {
+            router_file &rf = routers[r];
+
+            rf.file = new MrtFile(logger, compress);
+
+            if (rf.file->open(directory + "/" + rf.router_addr, name))
+                writePeerTable(rf, start_secs);
+        }
+
+        bool complete = writeRoutes(start_secs);
+
+        for (size_t r = first; r < last; r++) {
+            if (complete)
+                routers[r].file->close();
+            else
+                routers[r].file->discard();
+
+            delete routers[r].file;
+            routers[r].file = NULL;
+        }
+
+        if (not complete)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Write the routes of the routers with an open file in one pass over the index
+ */
+bool MrtSnapshot::writeRoutes(uint32_t start_secs) {
+    RibIndex &index = RibIndex::instance();
+    std::vector<const RibIndex::route *> scanned;
+    std::vector<const RibIndex::route *> routes;
+
+    /*
+     * Order routes by router, then prefix, then peer index table index, so the
+     *      routes of a prefix are adjacent.
+     */
+    auto routeLess = [this](const RibIndex::route *a, const RibIndex::route *b) {
+        if (slot_router[a->peer_idx] != slot_router[b->peer_idx])
+            return slot_router[a->peer_idx] < slot_router[b->peer_idx];
+        if (a->isIPv4 != b->isIPv4)
+            return a->isIPv4 > b->isIPv4;
+        if (a->prefix_len != b->prefix_len)
+            return a->prefix_len < b->prefix_len;
+
+        int cmp = memcmp(a->prefix_bin, b->prefix_bin, 16);
+        if (cmp != 0)
+            return cmp < 0;
+
+        if (slot_index[a->peer_idx] != slot_index[b->peer_idx])
+            return slot_index[a->peer_idx] < slot_index[b->peer_idx];
+        return a->path_id < b->path_id;
+    };
+
+    size_t bucket = 0;
+    while (bucket < RibIndex::bucketCount()) {
+        if (not running)
+            return false;
+
+        RibIndex::ReadGuard guard(index);
+
+        scanned.clear();
+        routes.clear();
+        attr_cache.clear();
+
+        bucket = index.scanBuckets(bucket, MRT_SNAPSHOT_SCAN_BUCKETS, scanned);
+
+        for (size_t i = 0; i < scanned.size(); i++) {
+            const RibIndex::route *r = scanned[i];
+
+            if (r->peer_idx >= slot_router.size() or slot_router[r->peer_idx] < 0 or not r->attr)
+                continue;
+
+            router_file &rf = routers[slot_router[r->peer_idx]];
+            if (rf.file != NULL and rf.file->isOpen())
+                routes.push_back(r);
+        }
+
+        std::sort(routes.begin(), routes.end(), routeLess);
+
+        for (size_t i = 0; i < routes.size(); ) {
+            const RibIndex::route *r = routes[i];
+            size_t j = i + 1;
+
+            while (j < routes.size() and slot_router[routes[j]->peer_idx] == slot_router[r->peer_idx]
+                   and routes[j]->isIPv4 == r->isIPv4 and routes[j]->prefix_len == r->prefix_len
+                   and memcmp(routes[j]->prefix_bin, r->prefix_bin, 16) == 0)
+                ++j;
+
+            writeRib(routers[slot_router[r->peer_idx]], &routes[i], j - i, start_secs);
+            i = j;
+        }
+    }
+
+    attr_cache.clear();
+    return true;
+}
+
+/**
+ * Write the peer index table of a router
+ */
+void MrtSnapshot::writePeerTable(router_file &rf, uint32_t start_secs) {
+    RibIndex &index = RibIndex::instance();
+
+    record.clear();
+
+    append32(record, 0);                                // Collector BGP ID, not known
+    append16(record, rf.router_addr.size());            // View name
+    record.append(rf.router_addr);
+    append16(record, rf.peers.size());
+
+    for (size_t i = 0; i < rf.peers.size(); i++) {
+        const RibIndex::peer &p = index.getPeer(rf.peers[i]);
+
+        record.push_back(MRT_PEER_TYPE_AS4 | (p.isIPv4 ? 0 : MRT_PEER_TYPE_IPV6));
+
+        if (not appendIPv4(record, p.peer_bgp_id))
+            append32(record, 0);
+
+        if (p.isIPv4)
+            record.append((const char *)p.peer_addr_bin + 12, 4);
+        else
+            record.append((const char *)p.peer_addr_bin, 16);
+
+        append32(record, p.peer_as);
+    }
+
+    u_char *out = rf.file->reserve(12 + record.size());
+    if (out == NULL) {
+        LOG_ERR("MRT peer index table of %s is too large", rf.router_addr.c_str());
+        return;
+    }
+
+    out = mrt_put32(out, start_secs);
+    out = mrt_put16(out, MRT_TYPE_TABLE_DUMP_V2);
+    out = mrt_put16(out, MRT_TD2_PEER_INDEX_TABLE);
+    out = mrt_put32(out, record.size());
+    memcpy(out, record.data(), record.size());
+
+    rf.file->commit(12 + record.size());
+}
+
+/**
+ * Write the RIB record of a prefix
+ */
+void MrtSnapshot::writeRib(router_file &rf, const RibIndex::route * const *routes, size_t count, uint32_t start_secs) {
+    const RibIndex::route *first = routes[0];
+    bool addpath = false;
+    uint16_t subtype;
+
+    for (size_t i = 0; i < count; i++) {
+        if (routes[i]->path_id != 0)
+            addpath = true;
+    }
+
+    if (first->isIPv4)
+        subtype = addpath ? MRT_TD2_RIB_IPV4_UNICAST_ADDPATH : MRT_TD2_RIB_IPV4_UNICAST;
+    else
+        subtype = addpath ? MRT_TD2_RIB_IPV6_UNICAST_ADDPATH : MRT_TD2_RIB_IPV6_UNICAST;
+
+    count = std::min(count, (size_t)0xFFFF);
+
+    record.clear();
+
+    append32(record, rf.seq);
+    record.push_back(first->prefix_len);
+    record.append((const char *)first->prefix_bin, (first->prefix_len + 7) / 8);
+    append16(record, count);
+
+    for (size_t i = 0; i < count; i++) {
+        const RibIndex::route *r = routes[i];
+        const std::string &attrs = encodedAttrs(r);
+
+        append16(record, slot_index[r->peer_idx]);
+        append32(record, r->timestamp_secs);
+
+        if (addpath)
+            append32(record, r->path_id);
+
+        append16(record, attrs.size());
+        record.append(attrs);
+    }
+
+    u_char *out = rf.file->reserve(12 + record.size());
+    if (out == NULL) {
+        LOG_NOTICE("MRT RIB record of %s is too large, skipped", rf.router_addr.c_str());
+        return;
+    }
+
+    out = mrt_put32(out, start_secs);
+    out = mrt_put16(out, MRT_TYPE_TABLE_DUMP_V2);
+    out = mrt_put16(out, subtype);
+    out = mrt_put32(out, record.size());
+    memcpy(out, record.data(), record.size());
+
+    rf.file->commit(12 + record.size());
+    rf.seq++;
+}
+
+/**
+ * Get the encoded attributes of a route
+ *
+ * \details Routes share attribute entries, so each entry is encoded once per
+ *          read section.  Entries cannot be freed and their address reused
+ *          while the read section that found them is active.
+ */
+const std::string &MrtSnapshot::encodedAttrs(const RibIndex::route *r) {
+    const PathAttrTable::entry *entry = r->attr.get();
+    attr_key_t key;
+
+    memcpy(key.data, &entry, sizeof(entry));
+    key.data[sizeof(entry)] = r->isIPv4;
+
+    std::string *cached = attr_cache.find(key);
+    if (cached != NULL)
+        return *cached;
+
+    std::string &value = attr_cache[key];
+    encodeAttrs(r->attr->attr, r->isIPv4, value);
+
+    return value;
+}
+
+/**
+ * Encode path attributes in BGP wire format (4 octet ASNs)
+ */
+void MrtSnapshot::encodeAttrs(const MsgBusInterface::obj_path_attr &attr, bool isIPv4, std::string &out) {
+    std::string value;
+    const char *p;
+    char *end;
+
+    out.clear();
+
+    // ORIGIN
+    value.assign(1, strcmp(attr.origin, "igp") == 0 ? 0 : (strcmp(attr.origin, "egp") == 0 ? 1 : 2));
+    appendAttr(out, BGP_ATTR_FLAG_TRANSITIVE, BGP_ATTR_ORIGIN, value);
+
+    // AS_PATH
+    value.clear();
+    encodeAsPath(attr.as_path, value);
+    appendAttr(out, BGP_ATTR_FLAG_TRANSITIVE, BGP_ATTR_AS_PATH, value);
+
+    /*
+     * NEXT_HOP for IPv4 next hops of IPv4 prefixes, else MP_REACH_NLRI with
+     *      only the next hop length and next hop (RFC 6396 4.3.4)
+     */
+    if (attr.next_hop[0] != 0) {
+        u_char nh[16];
+        bool nh_valid = inet_pton(attr.nexthop_isIPv4 ? AF_INET : AF_INET6, attr.next_hop, nh) == 1;
+        size_t nh_len = attr.nexthop_isIPv4 ? 4 : 16;
+
+        if (nh_valid and isIPv4 and attr.nexthop_isIPv4) {
+            value.assign((const char *)nh, 4);
+            appendAttr(out, BGP_ATTR_FLAG_TRANSITIVE, BGP_ATTR_NEXT_HOP, value);
+
+        } else if (nh_valid) {
+            value.assign(1, nh_len);
+            value.append((const char *)nh, nh_len);
+            appendAttr(out, BGP_ATTR_FLAG_OPTIONAL, BGP_ATTR_MP_REACH_NLRI, value);
+        }
+    }
+
+    // MED and LOCAL_PREF, only if present (zero is a valid value)
+    if (attr.med_present) {
+        value.clear();
+        append32(value, attr.med);
+        appendAttr(out, BGP_ATTR_FLAG_OPTIONAL, BGP_ATTR_MED, value);
+    }
+
+    if (attr.local_pref_present) {
+        value.clear();
+        append32(value, attr.local_pref);
+        appendAttr(out, BGP_ATTR_FLAG_TRANSITIVE, BGP_ATTR_LOCAL_PREF, value);
+    }
+
+    if (attr.atomic_agg) {
+        value.clear();
+        appendAttr(out, BGP_ATTR_FLAG_TRANSITIVE, BGP_ATTR_ATOMIC_AGGREGATE, value);
+    }
+
+    // AGGREGATOR, printed as "<asn> <ip>"
+    if (attr.aggregator[0] != 0) {
+        unsigned long asn = strtoul(attr.aggregator, &end, 10);
+
+        value.clear();
+        append32(value, asn);
+
+        if (*end == ' ' and appendIPv4(value, end + 1))
+            appendAttr(out, BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_TRANSITIVE, BGP_ATTR_AGGREGATOR, value);
+    }
+
+    // COMMUNITIES, printed as "<asn>:<value> ..."
+    if (not attr.community_list.empty()) {
+        value.clear();
+
+        for (p = attr.community_list.c_str(); *p != 0; ) {
+            unsigned long high = strtoul(p, &end, 10);
+            if (end == p or *end != ':')
+                break;
+
+            p = end + 1;
+            unsigned long low = strtoul(p, &end, 10);
+            if (end == p)
+                break;
+
+            append16(value, high);
+            append16(value, low);
+
+            for (p = end; *p == ' '; ++p);
+        }
+
+        if (not value.empty())
+            appendAttr(out, BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_TRANSITIVE, BGP_ATTR_COMMUNITIES, value);
+    }
+
+    if (attr.originator_id[0] != 0) {
+        value.clear();
+
+        if (appendIPv4(value, attr.originator_id))
+            appendAttr(out, BGP_ATTR_FLAG_OPTIONAL, BGP_ATTR_ORIGINATOR_ID, value);
+    }
+
+    // CLUSTER_LIST, printed as space separated IPv4 addresses
+    if (not attr.cluster_list.empty()) {
+        char cluster_id[16];
+
+        value.clear();
+
+        for (p = attr.cluster_list.c_str(); *p != 0; ) {
+            size_t len = strcspn(p, " ");
+
+            if (len > 0 and len < sizeof(cluster_id)) {
+                memcpy(cluster_id, p, len);
+                cluster_id[len] = 0;
+                appendIPv4(value, cluster_id);
+            }
+
+            for (p += len; *p == ' '; ++p);
+        }
+
+        if (not value.empty())
+            appendAttr(out, BGP_ATTR_FLAG_OPTIONAL, BGP_ATTR_CLUSTER_LIST, value);
+    }
+
+    // LARGE_COMMUNITY, printed as "<global>:<local1>:<local2> ..."
+    if (not attr.large_community_list.empty()) {
+        value.clear();
+
+        for (p = attr.large_community_list.c_str(); *p != 0; ) {
+            uint32_t parts[3];
+            size_t n = 0;
+
+            for (; n < 3; n++) {
+                parts[n] = strtoul(p, &end, 10);
+                if (end == p)
+                    break;
+
+                p = end;
+                if (n < 2) {
+                    if (*p != ':')
+                        break;
+                    ++p;
+                }
+            }
+
+            if (n != 3)
+                break;
+
+            append32(value, parts[0]);
+            append32(value, parts[1]);
+            append32(value, parts[2]);
+
+            for (; *p == ' '; ++p);
+        }
+
+        if (not value.empty())
+            appendAttr(out, BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_TRANSITIVE, BGP_ATTR_LARGE_COMMUNITY, value);
+    }
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef MRTSNAPSHOT_H_
+#define MRTSNAPSHOT_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "MsgBusInterface.hpp"
+#include "FlatHashMap.hpp"
+#include "RibIndex.h"
+#include "MrtFile.h"
+#include "Logger.h"
+
+#define MRT_SNAPSHOT_MAX_FILES      64          // Routers written per pass over the index
+#define MRT_SNAPSHOT_SCAN_BUCKETS   4096        // Index buckets per read section
+
+/**
+ * \class   MrtSnapshot
+ *
+ * \brief   Writes periodic TABLE_DUMP_V2 (RFC 6396) snapshots of the prefixes of each router
+ * \details The snapshot is taken from the in-memory prefix index (RibIndex), which
+ *          holds the unicast prefixes of all peers with their shared attributes.
+ *          The index is walked a few buckets at a time, each step in a short read
+ *          section, so router threads keep updating it while the snapshot is
+ *          written.  A snapshot is therefore not a single point in time; each
+ *          prefix is as of when its bucket was read.
+ *
+ *          Each router gets <directory>/<router ip>/rib.YYYYMMDD.HHMM[.gz] (UTC,
+ *          start of the snapshot interval) with a PEER_INDEX_TABLE of its peers,
+ *          followed by a RIB_IPV4_UNICAST or RIB_IPV6_UNICAST record per prefix
+ *          (the ADDPATH subtypes of RFC 8050 if a path has a path ID).  Records
+ *          are in index order, not sorted by prefix.
+ *
+ *          Attributes are re-encoded from the parsed attributes with 4 octet
+ *          ASNs: origin, AS path, next hop, MED, local preference, atomic
+ *          aggregate, aggregator, communities, originator ID, cluster list and
+ *          large communities.  Extended communities are not included.
+ */
+class MrtSnapshot {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] logPtr       Pointer to existing Logger for app logging
+     * \param [in] directory    Snapshot directory
+     * \param [in] interval     Seconds between snapshots
+     * \param [in] compress     True to gzip the files
+     */
+    MrtSnapshot(Logger *logPtr, const std::string &directory, uint32_t interval, bool compress);
+
+    ~MrtSnapshot();
+
+    /**
+     * Start writing snapshots, the first at the next interval boundary
+     */
+    void start();
+
+    /**
+     * Stop writing snapshots; a snapshot in progress is abandoned
+     */
+    void stop();
+
+private:
+    /// Snapshot file of a router
+    struct router_file {
+        u_char                  router_hash_id[16];
+        std::string             router_addr;        ///< Router address in printed form (sub directory)
+        std::vector<uint32_t>   peers;              ///< Index peer slots, in peer index table order
+        MrtFile                 *file;              ///< Open file, NULL if not in the current pass
+        uint32_t                seq;                ///< Next RIB record sequence number
+    };
+
+    /// Attribute encoding cache key: attribute entry address and prefix family
+    typedef BinaryKey<sizeof(void *) + 1> attr_key_t;
+
+    Logger                      *logger;            ///< Logging class pointer
+    std::string                 directory;          ///< Snapshot directory
+    uint32_t                    interval;           ///< Seconds between snapshots
+    bool                        compress;           ///< gzip the files
+
+    std::atomic<bool>           running;            ///< False to stop the thread
+    std::thread                 *thr;               ///< Snapshot thread
+
+    std::vector<router_file>    routers;            ///< Routers of the current snapshot
+    std::vector<int32_t>        slot_router;        ///< Router of each peer slot, -1 if not written
+    std::vector<uint16_t>       slot_index;         ///< Peer index table index of each peer slot
+    FlatHashMap<attr_key_t, std::string> attr_cache;    ///< Encoded attributes, valid within one read section
+    std::string                 record;             ///< RIB record being built
+
+    /**
+     * Write snapshots at each interval until stopped
+     */
+    void run();
+
+    /**
+     * Write the snapshot of all routers
+     *
+     * \param [in] start_secs   Start of the snapshot interval (file name and record timestamps)
+     *
+     * \return false if stopped before complete
+     */
+    bool writeSnapshot(uint32_t start_secs);
+
+    /**
+     * Write the routes of the routers with an open file in one pass over the index
+     *
+     * \return false if stopped before complete
+     */
+    bool writeRoutes(uint32_t start_secs);
+
+    /**
+     * Write the peer index table of a router
+     */
+    void writePeerTable(router_file &rf, uint32_t start_secs);
+
+    /**
+     * Write the RIB record of a prefix
+     *
+     * \param [in] rf           Router of the routes
+     * \param [in] routes       Routes of the prefix, all of the router
+     * \param [in] count        Number of routes
+     * \param [in] start_secs   Record timestamp
+     */
+    void writeRib(router_file &rf, const RibIndex::route * const *routes, size_t count, uint32_t start_secs);
+
+    /**
+     * Get the encoded attributes of a route
+     */
+    const std::string &encodedAttrs(const RibIndex::route *r);
+
+    /**
+     * Encode path attributes in BGP wire format (4 octet ASNs)
+     *
+     * \param [in]  attr         Parsed path attributes
+     * \param [in]  isIPv4       True if for an IPv4 prefix (NEXT_HOP), else the next hop is in MP_REACH_NLRI
+     * \param [out] out          Encoded attributes
+     */
+    static void encodeAttrs(const MsgBusInterface::obj_path_attr &attr, bool isIPv4, std::string &out);
+
+    friend class MrtSnapshotTest;                   ///< Writes snapshots without the thread
+};
+
+#endif /* MRTSNAPSHOT_H_ */
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "MrtWriter.h"
+
+#include <cstring>
+#include <ctime>
+#include <arpa/inet.h>
+#include <sys/time.h>
+
+/*
+ * MRT types (RFC 6396)
+ */
+#define MRT_TYPE_BGP4MP_ET                  17
+#define MRT_BGP4MP_STATE_CHANGE_AS4         5
+#define MRT_BGP4MP_MESSAGE                  1
+#define MRT_BGP4MP_MESSAGE_AS4              4
+
+#define MRT_BGP_STATE_IDLE                  1
+#define MRT_BGP_STATE_ESTABLISHED           6
+
+#define MRT_AS_TRANS                        23456
+
+namespace {
+
+/**
+ * Current time in milliseconds since EPOC
+ */
+uint64_t now_ms() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+} /* anonymous namespace */
+
+/**
+ * Constructor for class
+ *
+ * \param [in] logPtr           Pointer to existing Logger for app logging
+ * \param [in] directory        Archive directory, empty to disable
+ * \param [in] rotate_interval  Seconds per file
+ * \param [in] compress         True to gzip the files
+ */
+MrtWriter::MrtWriter(Logger *logPtr, const std::string &directory, uint32_t rotate_interval, bool compress)
+        : logger(logPtr), directory(directory), rotate_interval(rotate_interval), file(logPtr, compress) {
+    file_end = 0;
+    retry_after = 0;
+
+    if (this->rotate_interval == 0)
+        this->rotate_interval = 900;
+}
+
+MrtWriter::~MrtWriter() {
+    close();
+}
+
+/**
+ * Set the router of the archive (sub directory)
+ */
+void MrtWriter::setRouter(const char *router_addr) {
+    if (not enabled())
+        return;
+
+    std::string dir = directory + "/" + router_addr;
+
+    if (dir != router_dir) {
+        close();
+        router_dir = dir;
+    }
+}
+
+/**
+ * Open the file of the current rotation interval if needed
+ */
+bool MrtWriter::openFile(uint64_t now_secs) {
+    if (file.isOpen()) {
+        if (now_secs < file_end)
+            return true;
+
+        close();
+    }
+
+    if (router_dir.empty() or now_secs < retry_after)
+        return false;
+
+    uint64_t file_start = now_secs / rotate_interval * rotate_interval;
+    file_end = file_start + rotate_interval;
+
+    // Name by the start of the interval
+    char name[64];
+    time_t start = file_start;
+    tm tm_start;
+    gmtime_r(&start, &tm_start);
+    strftime(name, sizeof(name), "updates.%Y%m%d.%H%M", &tm_start);
+
+    if (not file.open(router_dir, name)) {
+        retry_after = file_end;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Write buffered records and complete the current file
+ */
+void MrtWriter::close() {
+    file.close();
+}
+
+/**
+ * Complete the current file if its rotation interval has ended
+ */
+void MrtWriter::rotateExpired() {
+    if (file.isOpen() and now_ms() / 1000 >= file_end)
+        close();
+}
+
+/**
+ * Milliseconds until the current file is rotated
+ */
+int MrtWriter::msUntilRotation() const {
+    if (not file.isOpen())
+        return -1;
+
+    uint64_t now = now_ms();
+    return now >= file_end * 1000 ? 0 : (int)(file_end * 1000 - now);
+}
+
+/**
+ * Append a BGP4MP_ET record
+ */
+void MrtWriter::writeRecord(const MsgBusInterface::obj_bgp_peer &peer, uint16_t subtype, const u_char *data,
+                            size_t len) {
+    uint64_t now = now_ms();
+
+    if (not openFile(now / 1000))
+        return;
+
+    bool as4 = subtype != MRT_BGP4MP_MESSAGE;
+    size_t addr_len = peer.isIPv4 ? 4 : 16;
+    size_t rec_len = 4 + (as4 ? 8 : 4) + 4 + addr_len * 2 + len;     // Length excludes the common header
+
+    u_char *p = file.reserve(12 + rec_len);
+    if (p == NULL)
+        return;
+
+    const local_info *local = locals.find(BinaryKey<16>(peer.hash_id));
+    uint32_t local_asn = local != NULL ? local->local_asn : 0;
+
+    // Timestamp of the BMP per peer header, receive time if the router does not set it
+    uint32_t secs = peer.timestamp_secs;
+    uint32_t usecs = peer.timestamp_us;
+    if (secs == 0) {
+        secs = now / 1000;
+        usecs = (now % 1000) * 1000;
+    }
+
+    p = mrt_put32(p, secs);
+    p = mrt_put16(p, MRT_TYPE_BGP4MP_ET);
+    p = mrt_put16(p, subtype);
+    p = mrt_put32(p, rec_len);
+    p = mrt_put32(p, usecs);
+
+    if (as4) {
+        p = mrt_put32(p, peer.peer_as);
+        p = mrt_put32(p, local_asn);
+    } else {
+        p = mrt_put16(p, peer.peer_as > 0xffff ? MRT_AS_TRANS : peer.peer_as);
+        p = mrt_put16(p, local_asn > 0xffff ? MRT_AS_TRANS : local_asn);
+    }
+
+    p = mrt_put16(p, 0);                                // Interface index
+    p = mrt_put16(p, peer.isIPv4 ? 1 : 2);              // AFI
+
+    // Peer address as received in the BMP per peer header (IPv4 in the last 4 bytes)
+    memcpy(p, peer.peer_addr_bin + (peer.isIPv4 ? 12 : 0), addr_len);
+    p += addr_len;
+
+    if (local != NULL and local->valid)
+        memcpy(p, local->local_ip, addr_len);
+    else
+        memset(p, 0, addr_len);
+    p += addr_len;
+
+    memcpy(p, data, len);
+    p += len;
+
+    file.commit(12 + rec_len);
+}
+
+/**
+ * Archive a BGP message of a route monitoring message
+ */
+void MrtWriter::message(const MsgBusInterface::obj_bgp_peer &peer, bool two_octet_asn, const u_char *data,
+                        size_t len) {
+    if (not enabled())
+        return;
+
+    writeRecord(peer, two_octet_asn ? MRT_BGP4MP_MESSAGE : MRT_BGP4MP_MESSAGE_AS4, data, len);
+}
+
+/**
+ * Archive a peer up as a state change to Established
+ */
+void MrtWriter::peerUp(const MsgBusInterface::obj_bgp_peer &peer, const MsgBusInterface::obj_peer_up_event &up_event) {
+    if (not enabled())
+        return;
+
+    local_info &local = locals[BinaryKey<16>(peer.hash_id)];
+
+    local.local_asn = up_event.local_asn;
+    local.valid = inet_pton(peer.isIPv4 ? AF_INET : AF_INET6, up_event.local_ip, local.local_ip) == 1;
+
+    u_char states[4];
+    mrt_put16(mrt_put16(states, MRT_BGP_STATE_IDLE), MRT_BGP_STATE_ESTABLISHED);
+
+    writeRecord(peer, MRT_BGP4MP_STATE_CHANGE_AS4, states, sizeof(states));
+}
+
+/**
+ * Archive a peer down as a state change to Idle
+ */
+void MrtWriter::peerDown(const MsgBusInterface::obj_bgp_peer &peer) {
+    if (not enabled())
+        return;
+
+    u_char states[4];
+    mrt_put16(mrt_put16(states, MRT_BGP_STATE_ESTABLISHED), MRT_BGP_STATE_IDLE);
+
+    writeRecord(peer, MRT_BGP4MP_STATE_CHANGE_AS4, states, sizeof(states));
+}
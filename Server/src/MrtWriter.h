@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef MRTWRITER_H_
+#define MRTWRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "MsgBusInterface.hpp"
+#include "FlatHashMap.hpp"
+#include "MrtFile.h"
+#include "Logger.h"
+
+/**
+ * \class   MrtWriter
+ *
+ * \brief   Archives the BMP messages of a router in MRT (RFC 6396) files
+ * \details Route monitoring messages are written as BGP4MP_ET MESSAGE records
+ *          (MESSAGE_AS4 unless the peer uses 2 octet ASNs) with the BMP per peer
+ *          timestamp; peer up and down are written as STATE_CHANGE_AS4 records
+ *          (Established/Idle).  MRT has no record type for the other BMP messages
+ *          (stats, initiation, termination), they are not archived.
+ *
+ *          Files are written to <directory>/<router ip>/updates.YYYYMMDD.HHMM[.gz]
+ *          (UTC, start of the rotation interval).
+ *
+ *          Not thread safe.  Each BMP reader owns one writer.
+ */
+class MrtWriter {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] logPtr           Pointer to existing Logger for app logging
+     * \param [in] directory        Archive directory, empty to disable
+     * \param [in] rotate_interval  Seconds per file
+     * \param [in] compress         True to gzip the files
+     */
+    MrtWriter(Logger *logPtr, const std::string &directory, uint32_t rotate_interval, bool compress);
+
+    ~MrtWriter();
+
+    /**
+     * Set the router of the archive (sub directory)
+     *
+     * \param [in] router_addr      Router IP address in printed form
+     */
+    void setRouter(const char *router_addr);
+
+    /**
+     * Archive a BGP message of a route monitoring message
+     *
+     * \param [in] peer             Peer of the message
+     * \param [in] two_octet_asn    True if the peer uses 2 octet ASNs
+     * \param [in] data             BGP message, including the BGP header
+     * \param [in] len              Length of the BGP message
+     */
+    void message(const MsgBusInterface::obj_bgp_peer &peer, bool two_octet_asn, const u_char *data, size_t len);
+
+    /**
+     * Archive a peer up as a state change to Established
+     *
+     * \param [in] peer             Peer
+     * \param [in] up_event         Peer up event, local address and ASN are kept for the peer
+     */
+    void peerUp(const MsgBusInterface::obj_bgp_peer &peer, const MsgBusInterface::obj_peer_up_event &up_event);
+
+    /**
+     * Archive a peer down as a state change to Idle
+     *
+     * \param [in] peer             Peer
+     */
+    void peerDown(const MsgBusInterface::obj_bgp_peer &peer);
+
+    /**
+     * Complete the current file if its rotation interval has ended
+     */
+    void rotateExpired();
+
+    /**
+     * Milliseconds until the current file is rotated
+     *
+     * \return milliseconds, or -1 if no file is open
+     */
+    int msUntilRotation() const;
+
+    /**
+     * Write buffered records and complete the current file
+     */
+    void close();
+
+    bool enabled() const                { return not directory.empty(); }
+
+private:
+    /// Local side of a peer session, from the peer up
+    struct local_info {
+        uint32_t    local_asn;
+        uint8_t     local_ip[16];
+        bool        valid;          ///< True if local_ip is of the peer address family
+    };
+
+    Logger                  *logger;            ///< Logging class pointer
+    std::string             directory;          ///< Archive directory
+    std::string             router_dir;         ///< Directory of the router files
+    uint32_t                rotate_interval;    ///< Seconds per file
+
+    MrtFile                 file;               ///< Open file of the current rotation interval
+    uint64_t                file_end;           ///< End of the rotation interval of the open file (secs)
+    uint64_t                retry_after;        ///< Do not try to open a file before this time after an error (secs)
+
+    FlatHashMap<BinaryKey<16>, local_info> locals;  ///< Local side of the peers by peer hash
+
+    /**
+     * Open the file of the current rotation interval if needed
+     *
+     * \return true if a file is open
+     */
+    bool openFile(uint64_t now_secs);
+
+    /**
+     * Append a BGP4MP_ET record
+     *
+     * \param [in] peer             Peer of the record (timestamp, addresses and ASN)
+     * \param [in] subtype          BGP4MP subtype
+     * \param [in] data             Data after the BGP4MP peer and local addresses
+     * \param [in] len              Length of data
+     */
+    void writeRecord(const MsgBusInterface::obj_bgp_peer &peer, uint16_t subtype, const u_char *data, size_t len);
+};
+
+#endif /* MRTWRITER_H_ */
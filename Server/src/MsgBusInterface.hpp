@@ -19,6 +19,11 @@
 #include <ctime>
 #include <sys/time.h>
 
+#include "ParseArena.h"
+#include "TextFormat.h"
+
+class MD5;
+
 /**
  * \class   MsgBusInterface
  *
@@ -52,6 +57,8 @@ public:
         uint32_t    router_count;           ///< Count of active/connected routers
         uint32_t    timestamp_secs;         ///< Timestamp in seconds since EPOC
         uint32_t    timestamp_us;           ///< Timestamp microseconds
+        uint32_t    overload_level;         ///< Overload degradation level, 0 is normal
+        char        overload_shed[128];     ///< Actions shed at the overload level delimited by comma
     };
 
     /// Collector action codes
@@ -60,6 +67,7 @@ public:
         COLLECTOR_ACTION_CHANGE,
         COLLECTOR_ACTION_HEARTBEAT,
         COLLECTOR_ACTION_STOPPED,
+        COLLECTOR_ACTION_OVERLOAD,
     };
 
     /**
@@ -104,6 +112,9 @@ public:
 
         char        peer_rd[32];            ///< Peer distinguisher ID (string/printed format)
         char        peer_addr[46];          ///< Peer IP address in printed form
+        u_char      peer_rd_bin[8];         ///< Peer distinguisher ID as received in the BMP peer header
+        u_char      peer_addr_bin[16];      ///< Peer IP address as received in the BMP peer header (IPv4 in last 4 bytes)
+        u_char      peer_type;              ///< BMP peer type
         char        peer_bgp_id[16];        ///< Peer BGP ID in printed form
         uint32_t    peer_as;                ///< Peer ASN
         bool        isL3VPN;                ///< true if peer is L3VPN, otherwise it is Global
@@ -183,13 +194,16 @@ public:
         uint16_t    as_path_count;          ///< Count of AS PATH's in the path (includes all in AS-SET)
 
         uint32_t    origin_as;              ///< Origin ASN
+        uint32_t    neighbor_as;            ///< First ASN after the confederation segments, zero if none
         bool        nexthop_isIPv4;         ///< True if IPv4, false if IPv6
         char        next_hop[40];           ///< Next-hop IP in printed form
         char        aggregator[40];         ///< Aggregator IP in printed form
         bool        atomic_agg;             ///< 0=false, 1=true for atomic_aggregate
 
         uint32_t    med;                    ///< bgp MED
+        bool        med_present;            ///< True if the MULTI_EXIT_DISC attribute is present
         uint32_t    local_pref;             ///< bgp local pref
+        bool        local_pref_present;     ///< True if the LOCAL_PREF attribute is present
 
         /**
          * standard community list.
@@ -213,6 +227,12 @@ public:
         std::string cluster_list;
 
         char        originator_id[16];      ///< Originator ID in printed form
+
+        /**
+         * MD5 state over the attribute fields of the hash (shared path attribute table),
+         *      NULL to compute it from the fields
+         */
+        const MD5   *attr_md5;
     };
 
     /// Base attribute action codes
@@ -225,6 +245,16 @@ public:
      *
      * Prefix rib table schema
      */
+    /**
+     * RPKI origin validation state of a prefix (RFC 6811)
+     */
+    enum rpki_state {
+        RPKI_STATE_NOT_CHECKED=0,           ///< No VRP set loaded, or not an advertisement
+        RPKI_STATE_VALID,
+        RPKI_STATE_INVALID,
+        RPKI_STATE_UNKNOWN                  ///< Not found; no VRP covers the prefix
+    };
+
     struct obj_rib {
         u_char      hash_id[16];            ///< hash of attr hash prefix, and prefix len
         u_char      path_attr_hash_id[16];  ///< path attrs hash_id
@@ -236,6 +266,7 @@ public:
         uint8_t     prefix_bcast_bin[16];   ///< Broadcast address/last address in binary form
         uint32_t    path_id;                ///< Add path ID - zero if not used
         char        labels[255];            ///< Labels delimited by comma
+        uint8_t     rpki_state;             ///< Origin validation state (rpki_state) of advertised prefixes
     };
 
     /// Rib extended with Route Distinguisher
@@ -264,6 +295,11 @@ public:
         int         mpls_label_2;
     };
 
+    /// Rib vectors passed to update_* - allocated from the active parse arena while parsing a message
+    typedef std::vector<obj_rib, ParseArenaAllocator<obj_rib> >    rib_vector;
+    typedef std::vector<obj_vpn, ParseArenaAllocator<obj_vpn> >    vpn_vector;
+    typedef std::vector<obj_evpn, ParseArenaAllocator<obj_evpn> >  evpn_vector;
+
     /// Unicast prefix action codes
     enum unicast_prefix_action_code {
         UNICAST_PREFIX_ACTION_ADD=0,
@@ -293,6 +329,88 @@ public:
         uint64_t        routes_loc_rib;         ///< type=8 number of routes in loc-rib
     };
 
+    /// Churn row types
+    enum churn_type {
+        CHURN_TYPE_TOTAL=0,                 ///< Exact totals for the interval
+        CHURN_TYPE_PREFIX,                  ///< Noisiest prefixes (sketch estimates)
+        CHURN_TYPE_ORIGIN_AS,               ///< Noisiest origin ASNs (sketch estimates)
+        CHURN_TYPE_PEER,                    ///< Noisiest peers (exact)
+    };
+
+    /**
+     * OBJECT: churn
+     *
+     * Churn report row schema
+     */
+    struct obj_churn {
+        churn_type  type;                   ///< Row type
+        uint32_t    rank;                   ///< Rank within the type, 1 is the noisiest
+        char        key[64];                ///< Prefix/len, origin ASN or peer address in printed form
+        u_char      router_hash_id[16];     ///< Router hash ID (peer rows only)
+        u_char      peer_hash_id[16];       ///< Peer hash ID (peer rows only)
+        uint64_t    updates;                ///< Advertisements in the interval
+        uint64_t    withdraws;              ///< Withdraws in the interval (not tracked by origin ASN)
+    };
+
+    /**
+     * OBJECT: peer_rollup
+     *
+     * Per peer and address family counters for one window
+     */
+    struct obj_peer_rollup {
+        u_char      router_hash_id[16];     ///< Router hash ID
+        u_char      peer_hash_id[16];       ///< Peer hash ID
+        char        peer_addr[46];          ///< Peer IP address in printed form
+        uint32_t    peer_as;                ///< Peer ASN
+        uint16_t    afi;                    ///< Address family
+        uint8_t     safi;                   ///< Subsequent address family
+        uint64_t    window_start;           ///< Start of the window, seconds since EPOC
+        uint32_t    interval;               ///< Window length in seconds
+        uint64_t    prefixes_added;         ///< Prefixes advertised
+        uint64_t    prefixes_withdrawn;     ///< Prefixes withdrawn
+        uint64_t    attr_sets;              ///< Path attribute sets received
+        uint64_t    messages;               ///< Update messages
+        uint64_t    bytes;                  ///< Update message bytes
+    };
+
+    /// Loc-RIB action codes
+    enum loc_rib_action_code {
+        LOC_RIB_ACTION_ADD=0,               ///< New or changed best path
+        LOC_RIB_ACTION_DEL                  ///< No path left for the prefix
+    };
+
+    /**
+     * OBJECT: loc_rib
+     *
+     * Best path change of a prefix, computed by the collector per router
+     */
+    struct obj_loc_rib {
+        loc_rib_action_code action;         ///< Action code
+        u_char      router_hash_id[16];     ///< Router hash ID
+        u_char      peer_hash_id[16];       ///< Peer hash ID of the best path (add only)
+        char        peer_addr[46];          ///< Peer IP address of the best path (add only)
+        uint32_t    peer_as;                ///< Peer ASN of the best path (add only)
+        char        prefix[46];             ///< IPv4/IPv6 prefix in printed form
+        u_char      prefix_len;             ///< Length of prefix in bits
+        u_char      isIPv4;                 ///< 0 if IPv6, 1 if IPv4
+        u_char      isLabeled;              ///< 1 if labeled unicast
+        uint32_t    path_id;                ///< Add path ID of the best path, zero if not used
+        uint32_t    paths;                  ///< Number of candidate paths of the prefix
+        uint32_t    timestamp_secs;         ///< Time of the update that changed the best path
+        uint32_t    timestamp_us;           ///< Microseconds
+        const obj_path_attr *attr;          ///< Attributes of the best path, NULL for del
+    };
+
+    /**
+     * Churn report for one interval
+     */
+    struct obj_churn_report {
+        uint32_t                interval_secs;  ///< Length of the interval in seconds
+        uint32_t                timestamp_secs; ///< End of the interval, seconds since EPOC
+        uint32_t                timestamp_us;   ///< End of the interval, microseconds
+        std::vector<obj_churn>  rows;           ///< Report rows
+    };
+
     /**
      * OBJECT: ls_node
      *
@@ -486,7 +604,7 @@ public:
      * \note        Caller must free any allocated memory, which is
      *              safe to do so when this method returns.
      *****************************************************************/
-    virtual void update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr,
+    virtual void update_unicastPrefix(obj_bgp_peer &peer, rib_vector &rib, obj_path_attr *attr,
                                       unicast_prefix_action_code code) = 0;
 
      /*****************************************************************//**
@@ -505,7 +623,7 @@ public:
      * \note        Caller must free any allocated memory, which is
      *              safe to do so when this method returns.
      *****************************************************************/
-    virtual void update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr,
+    virtual void update_L3Vpn(obj_bgp_peer &peer, vpn_vector &vpn, obj_path_attr *attr,
                             vpn_action_code code) = 0;
 
     /*****************************************************************//**
@@ -524,7 +642,7 @@ public:
      * \note        Caller must free any allocated memory, which is
      *              safe to do so when this method returns.
      *****************************************************************/
-    virtual void update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr,
+    virtual void update_eVPN(obj_bgp_peer &peer, evpn_vector &vpn, obj_path_attr *attr,
                             vpn_action_code code) = 0;
 
     /*****************************************************************//**
@@ -536,6 +654,33 @@ public:
      *****************************************************************/
     virtual void add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) = 0;
 
+    /*****************************************************************//**
+     * \brief       Add a churn report
+     *
+     * \details     Will generate a message with the churn rows of an interval.
+     *
+     * \param[in]   report     Churn report
+     *****************************************************************/
+    virtual void add_ChurnReport(obj_churn_report &report) = 0;
+
+    /*****************************************************************//**
+     * \brief       Add peer rollup rows
+     *
+     * \details     Will generate a message with the rows of one rollup window.
+     *
+     * \param[in]   rows       Rollup rows, all of the same router and window
+     *****************************************************************/
+    virtual void add_PeerRollup(std::vector<obj_peer_rollup> &rows) = 0;
+
+    /*****************************************************************//**
+     * \brief       Add/Delete best paths
+     *
+     * \details     Will generate a message with best path changes of a router.
+     *
+     * \param[in]   rows       Best path changes, all of the same router
+     *****************************************************************/
+    virtual void update_LocRib(std::vector<obj_loc_rib> &rows) = 0;
+
     /*****************************************************************//**
      * \brief       Add/Update BGP-LS nodes
      *
@@ -599,6 +744,30 @@ public:
      *****************************************************************/
     virtual void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len) = 0;
 
+    /*****************************************************************//**
+     * \brief       Milliseconds until buffered messages are due to be sent
+     *
+     * \details     Implementations that batch messages return the time until the
+     *              oldest batch is due, so the caller can call flush() in time.
+     *
+     * \returns     milliseconds, zero if due now or -1 if nothing is buffered
+     *****************************************************************/
+    virtual int msUntilFlush() { return -1; }
+
+    /*****************************************************************//**
+     * \brief       Send buffered messages that are due
+     *
+     * \param[in]   force      Send all buffered messages, due or not
+     *****************************************************************/
+    virtual void flush(bool /* force */=false) { }
+
+    /*****************************************************************//**
+     * \brief       Router group of the router, as resolved from the mapping
+     *
+     * \returns     router group name, empty if none
+     *****************************************************************/
+    virtual const std::string &routerGroup() { static const std::string none; return none; }
+
 
     /* ---------------------------------------------------------------------------
      * Commonly used methods
@@ -617,15 +786,9 @@ public:
      */
     static void hash_toStr(const u_char *hash_bin, std::string &hash_str){
 
-        int i;
         char s[33];
 
-        for (i=0; i<16; i++)
-            sprintf(s+i*2, "%02x", hash_bin[i]);
-
-        s[32]='\0';
-
-        hash_str = s;
+        hash_str.assign(s, textfmt::hex(s, hash_bin, 16));
     }
 
     /**
@@ -637,11 +800,10 @@ public:
      *
      */
     void getTimestamp(uint32_t time_secs, uint32_t time_us, std::string &ts_str){
-        char buf[48];
+        char buf[TEXTFMT_TIMESTAMP_STRLEN];
         timeval tv;
-        std::time_t secs;
+        uint32_t secs;
         uint32_t us;
-        tm *p_tm;
 
         if (time_secs <= 1000) {
             gettimeofday(&tv, NULL);
@@ -653,12 +815,7 @@ public:
             us = time_us;
         }
 
-        p_tm = std::gmtime(&secs);
-        std::strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", p_tm);
-        ts_str = buf;
-
-        sprintf(buf, ".%06u", us);
-        ts_str.append(buf);
+        ts_str.assign(buf, textfmt::timestamp(buf, secs, us));
     }
 
 protected:
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "OverloadControl.h"
+
+#include <chrono>
+
+/// Action names, in shed_action order
+static const char *shed_action_names[OverloadControl::SHED_MAX] = {
+        "bmp_raw", "pre_policy", "base_attribute", "route_monitoring" };
+
+/**
+ * Get the process wide control
+ */
+OverloadControl &OverloadControl::instance() {
+    return ProcessSingleton<OverloadControl>::get();
+}
+
+/**
+ * Constructor for class
+ */
+OverloadControl::OverloadControl() : cur_level(0), shed_mask(0) {
+    is_enabled = false;
+    limits.ring_pct = limits.queue_pct = limits.lag_ms = 0;
+    raise_ms = recover_ms = 0;
+    over_since = under_since = 0;
+}
+
+/**
+ * Name of an action as used in the configuration
+ */
+const char *OverloadControl::actionName(shed_action action) {
+    return action < SHED_MAX ? shed_action_names[action] : "unknown";
+}
+
+/**
+ * Get an action by its name
+ *
+ * \param [in]  name        Name of the action
+ * \param [out] action      Action
+ *
+ * \return false if the name is not an action
+ */
+bool OverloadControl::actionByName(const std::string &name, shed_action &action) {
+    for (int i = 0; i < SHED_MAX; i++) {
+        if (name.compare(shed_action_names[i]) == 0) {
+            action = (shed_action)i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Enable the control
+ *
+ * \param [in] levels           Action shed at each level, level 1 is the first
+ * \param [in] ring_pct         Ring buffer fill threshold
+ * \param [in] queue_pct        Producer queue fill threshold
+ * \param [in] lag_ms           Ring buffer drain lag threshold
+ * \param [in] raise_secs       Time over a threshold before the next level
+ * \param [in] recover_secs     Time under all thresholds before the previous level
+ */
+void OverloadControl::enable(const std::vector<shed_action> &levels, uint32_t ring_pct, uint32_t queue_pct,
+                             uint32_t lag_ms, uint32_t raise_secs, uint32_t recover_secs) {
+    this->levels = levels;
+    limits.ring_pct = ring_pct;
+    limits.queue_pct = queue_pct;
+    limits.lag_ms = lag_ms;
+    raise_ms = raise_secs * 1000;
+    recover_ms = recover_secs * 1000;
+
+    over_since = under_since = 0;
+    setLevel(0);
+
+    is_enabled = levels.size() > 0;
+}
+
+/**
+ * Actions shed at the current level, comma separated
+ */
+std::string OverloadControl::shedList() const {
+    std::string list;
+    int level = cur_level.load();
+
+    for (int i = 0; i < level and i < (int)levels.size(); i++) {
+        if (list.size() > 0)
+            list.append(",");
+
+        list.append(actionName(levels[i]));
+    }
+
+    return list;
+}
+
+/**
+ * Step the level from the worst backlog of the routers
+ *
+ * \param [in] worst        Worst backlog of the routers
+ * \param [in] now_ms       Current monotonic time in milliseconds
+ *
+ * \return true if the level changed
+ */
+bool OverloadControl::update(const backlog &worst, uint64_t now_ms) {
+    if (not is_enabled)
+        return false;
+
+    int level = cur_level.load();
+
+    bool over = worst.ring_pct >= limits.ring_pct or worst.queue_pct >= limits.queue_pct or
+                worst.lag_ms >= limits.lag_ms;
+
+    if (over) {
+        under_since = 0;
+
+        if (over_since == 0)
+            over_since = now_ms;
+
+        // Each further level needs another raise period over the threshold
+        if (level < (int)levels.size() and now_ms - over_since >= raise_ms) {
+            setLevel(level + 1);
+            over_since = now_ms;
+            return true;
+        }
+
+    } else {
+        over_since = 0;
+
+        if (level == 0)
+            return false;
+
+        if (under_since == 0)
+            under_since = now_ms;
+
+        if (now_ms - under_since >= recover_ms) {
+            setLevel(level - 1);
+            under_since = now_ms;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * Set the current level and its shed mask
+ */
+void OverloadControl::setLevel(int level) {
+    uint32_t mask = 0;
+
+    for (int i = 0; i < level and i < (int)levels.size(); i++)
+        mask |= 1U << levels[i];
+
+    shed_mask.store(mask);
+    cur_level.store(level);
+}
+
+/**
+ * Current monotonic time in milliseconds
+ */
+uint64_t OverloadControl::now() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef OVERLOADCONTROL_H_
+#define OVERLOADCONTROL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ProcessSingleton.hpp"
+
+/**
+ * \class   OverloadControl
+ *
+ * \brief   Process wide overload degradation level
+ * \details Router threads report their backlog (ring buffer fill, producer queue
+ *          fill and the time since the ring buffer was last drained).  The main
+ *          thread calls update() with the worst backlog of all routers; when it
+ *          stays above a threshold for raise_secs the level steps up, and when it
+ *          stays below all thresholds for recover_secs the level steps down.
+ *
+ *          Each level sheds one more action, in the configured order (e.g. bmp_raw,
+ *          then pre-policy duplicates, ...).  Router threads check shedding() in the
+ *          hot path; it is a single relaxed atomic load.
+ */
+class OverloadControl {
+public:
+    /// Work that can be shed
+    enum shed_action {
+        SHED_BMP_RAW=0,                     ///< Do not publish bmp_raw
+        SHED_PRE_POLICY,                    ///< Drop pre-policy route monitoring of peers that also send post-policy
+        SHED_BASE_ATTRIBUTE,                ///< Do not publish base_attribute (prefixes still carry the hash)
+        SHED_ROUTE_MON,                     ///< Do not parse route monitoring, only peer, router and stats events
+        SHED_MAX
+    };
+
+    /// Backlog of a router or the worst of all routers
+    struct backlog {
+        uint32_t    ring_pct;               ///< Ring buffer fill in percent
+        uint32_t    queue_pct;              ///< Producer queue fill in percent
+        uint32_t    lag_ms;                 ///< Time since the ring buffer was last drained
+    };
+
+    /**
+     * Get the process wide control
+     */
+    static OverloadControl &instance();
+
+    /**
+     * Name of an action as used in the configuration, e.g. "bmp_raw"
+     */
+    static const char *actionName(shed_action action);
+
+    /**
+     * Get an action by its name
+     *
+     * \return false if the name is not an action
+     */
+    static bool actionByName(const std::string &name, shed_action &action);
+
+    /**
+     * Enable the control
+     *
+     * \details Must be called before router threads start.
+     *
+     * \param [in] levels           Action shed at each level, level 1 is the first
+     * \param [in] ring_pct         Ring buffer fill threshold
+     * \param [in] queue_pct        Producer queue fill threshold
+     * \param [in] lag_ms           Ring buffer drain lag threshold
+     * \param [in] raise_secs       Time over a threshold before the next level
+     * \param [in] recover_secs     Time under all thresholds before the previous level
+     */
+    void enable(const std::vector<shed_action> &levels, uint32_t ring_pct, uint32_t queue_pct,
+                uint32_t lag_ms, uint32_t raise_secs, uint32_t recover_secs);
+
+    bool enabled() const                    { return is_enabled; }
+
+    /**
+     * True if the action is shed at the current level
+     */
+    bool shedding(shed_action action) const {
+        return (shed_mask.load(std::memory_order_relaxed) >> action) & 1;
+    }
+
+    int level() const                       { return cur_level.load(std::memory_order_relaxed); }
+
+    /**
+     * Actions shed at the current level, comma separated
+     */
+    std::string shedList() const;
+
+    /**
+     * Step the level from the worst backlog of the routers
+     *
+     * \details Called by the main thread only.
+     *
+     * \param [in] worst        Worst backlog of the routers
+     * \param [in] now_ms       Current monotonic time in milliseconds
+     *
+     * \return true if the level changed
+     */
+    bool update(const backlog &worst, uint64_t now_ms);
+
+    /**
+     * Current monotonic time in milliseconds
+     */
+    static uint64_t now();
+
+private:
+    bool                        is_enabled;     ///< True if enabled, set before threads start
+    std::vector<shed_action>    levels;         ///< Action shed at each level
+    backlog                     limits;         ///< Thresholds
+    uint32_t                    raise_ms;       ///< Time over a threshold before the next level
+    uint32_t                    recover_ms;     ///< Time under all thresholds before the previous level
+
+    std::atomic<int>            cur_level;      ///< Current level, 0 is normal
+    std::atomic<uint32_t>       shed_mask;      ///< Bit per shed_action shed at the current level
+
+    uint64_t                    over_since;     ///< Start of the backlog over a threshold, 0 if under
+    uint64_t                    under_since;    ///< Start of the backlog under all thresholds, 0 if over
+
+    /**
+     * Set the current level and its shed mask
+     */
+    void setLevel(int level);
+
+    friend class ProcessSingleton<OverloadControl>;
+
+    OverloadControl();
+    OverloadControl(const OverloadControl &);
+    OverloadControl &operator=(const OverloadControl &);
+};
+
+#endif /* OVERLOADCONTROL_H_ */
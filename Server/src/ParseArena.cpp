@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "ParseArena.h"
+
+#include <cstdlib>
+
+/**
+ * Arena active for the calling thread, set by ParseArena::Scope
+ */
+static thread_local ParseArena *active_arena = NULL;
+
+/**
+ * Activates the arena for the calling thread
+ *
+ * \param [in] arena    Arena to activate
+ */
+ParseArena::Scope::Scope(ParseArena *arena) : arena(arena) {
+    prev = active_arena;
+    active_arena = arena;
+}
+
+/**
+ * Restores the previously active arena and resets this one
+ */
+ParseArena::Scope::~Scope() {
+    active_arena = prev;
+
+    if (arena != NULL)
+        arena->reset();
+}
+
+/**
+ * Constructor for class
+ *
+ * \param [in] block_size   Size in bytes of each block allocated by the arena
+ */
+ParseArena::ParseArena(size_t block_size) {
+    this->block_size = block_size;
+    keep_bytes = (blockHeader() + block_size) * PARSE_ARENA_KEEP_BLOCKS;
+    reserved = 0;
+    offset = 0;
+    head = NULL;
+    cur = NULL;
+
+    head = cur = addBlock(block_size);
+}
+
+/**
+ * Destructor - Frees all blocks
+ */
+ParseArena::~ParseArena() {
+    block *blk = head;
+
+    while (blk != NULL) {
+        block *next = blk->next;
+        free(blk);
+        blk = next;
+    }
+}
+
+/**
+ * Get the arena that is active for the calling thread
+ *
+ * \return arena pointer or NULL if no arena is active
+ */
+ParseArena *ParseArena::current() {
+    return active_arena;
+}
+
+/**
+ * Allocate memory from the arena
+ *
+ * \param [in] size     Number of bytes to allocate
+ *
+ * \return pointer to memory aligned to PARSE_ARENA_ALIGN
+ */
+void *ParseArena::allocate(size_t size) {
+    size = (size + PARSE_ARENA_ALIGN - 1) & ~((size_t)PARSE_ARENA_ALIGN - 1);
+
+    if (offset + size > cur->size) {
+        /*
+         * Move to the next block that was kept from a previous message, if it
+         *    is large enough. Otherwise link a new block after the current one.
+         */
+        if (cur->next != NULL and cur->next->size >= size)
+            cur = cur->next;
+        else
+            cur = addBlock(size > block_size ? size : block_size);
+
+        offset = 0;
+    }
+
+    void *ptr = blockData(cur) + offset;
+    offset += size;
+
+    return ptr;
+}
+
+/**
+ * Rewind the arena, making all of its memory available again
+ */
+void ParseArena::reset() {
+    cur = head;
+    offset = 0;
+
+    if (reserved <= keep_bytes)
+        return;
+
+    /*
+     * Over the high-water size; keep the leading blocks that fit and free the rest.
+     *    The first block is always kept.
+     */
+    size_t kept = blockHeader() + head->size;
+    block *prev = head;
+
+    while (prev->next != NULL) {
+        block *blk = prev->next;
+
+        if (kept + blockHeader() + blk->size <= keep_bytes) {
+            kept += blockHeader() + blk->size;
+            prev = blk;
+            continue;
+        }
+
+        prev->next = blk->next;
+        reserved -= blockHeader() + blk->size;
+        free(blk);
+    }
+}
+
+/**
+ * Allocate a new block large enough to hold size bytes and link it after cur
+ *
+ * \param [in] size     Usable size of the block in bytes
+ *
+ * \return pointer to the new block
+ */
+ParseArena::block *ParseArena::addBlock(size_t size) {
+    size_t total = blockHeader() + size;
+
+    block *blk = static_cast<block *>(malloc(total));
+    if (blk == NULL)
+        throw std::bad_alloc();
+
+    blk->size = size;
+
+    if (cur != NULL) {
+        blk->next = cur->next;
+        cur->next = blk;
+    } else
+        blk->next = NULL;
+
+    reserved += total;
+
+    return blk;
+}
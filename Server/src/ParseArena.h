@@ -0,0 +1,197 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef PARSEARENA_H_
+#define PARSEARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <sys/types.h>
+
+#define PARSE_ARENA_BLOCK_SIZE      65536           // Default size in bytes of each arena block
+#define PARSE_ARENA_ALIGN           16              // Alignment of every allocation returned by the arena
+#define PARSE_ARENA_KEEP_BLOCKS     4               // Blocks worth of memory kept by reset(), the rest is freed
+
+/**
+ * \class   ParseArena
+ *
+ * \brief   Bump allocator for objects that only live for one BMP message
+ * \details Parse products (prefix lists, attribute maps, rib vectors, ...) are
+ *          allocated by bumping a pointer within a chain of blocks.  Nothing is
+ *          freed individually; reset() rewinds to the first block and the blocks
+ *          are reused for the next message.  Blocks beyond a high-water size
+ *          (PARSE_ARENA_KEEP_BLOCKS default blocks) are freed by reset(), so one
+ *          oversized message does not keep its peak memory for the connection.
+ *
+ *          The arena is not thread safe. Each BMP reader owns one arena and
+ *          activates it for its own thread using ParseArena::Scope.
+ */
+class ParseArena {
+public:
+    /**
+     * Activates an arena for the calling thread
+     *
+     * \details While the scope exists, containers that use ParseArenaAllocator
+     *          and are constructed on this thread will allocate from the arena.
+     *          The arena is reset when the scope ends, so every arena backed
+     *          object must be destroyed before then.
+     */
+    class Scope {
+    public:
+        explicit Scope(ParseArena *arena);
+        ~Scope();
+
+    private:
+        ParseArena *arena;                  ///< Arena activated by this scope
+        ParseArena *prev;                   ///< Previously active arena, restored on exit
+
+        Scope(const Scope &);
+        Scope &operator=(const Scope &);
+    };
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] block_size   Size in bytes of each block allocated by the arena
+     */
+    explicit ParseArena(size_t block_size=PARSE_ARENA_BLOCK_SIZE);
+    ~ParseArena();
+
+    /**
+     * Allocate memory from the arena
+     *
+     * \param [in] size     Number of bytes to allocate
+     *
+     * \return pointer to memory aligned to PARSE_ARENA_ALIGN
+     */
+    void *allocate(size_t size);
+
+    /**
+     * Rewind the arena, making all of its memory available again
+     *
+     * \details Blocks up to the high-water size are kept for reuse, the rest are
+     *          freed. Any pointer previously returned by allocate() is invalid
+     *          after this call.
+     */
+    void reset();
+
+    /**
+     * Get the number of bytes currently reserved by the arena blocks
+     */
+    size_t getBytesReserved() const { return reserved; }
+
+    /**
+     * Get the arena that is active for the calling thread
+     *
+     * \return arena pointer or NULL if no arena is active
+     */
+    static ParseArena *current();
+
+private:
+    struct block {
+        block       *next;                  ///< Next block in the chain
+        size_t      size;                   ///< Usable size of the block in bytes
+    };
+
+    block       *head;                      ///< First block in the chain
+    block       *cur;                       ///< Block currently being allocated from
+    size_t      offset;                     ///< Bytes used within the current block
+    size_t      block_size;                 ///< Default size for new blocks
+    size_t      keep_bytes;                 ///< High-water of the bytes reserved by the blocks kept by reset()
+    size_t      reserved;                   ///< Total bytes reserved by all blocks
+
+    /**
+     * Allocate a new block large enough to hold size bytes and link it after cur
+     */
+    block *addBlock(size_t size);
+
+    static size_t blockHeader() {
+        return (sizeof(block) + PARSE_ARENA_ALIGN - 1) & ~((size_t)PARSE_ARENA_ALIGN - 1);
+    }
+
+    static u_char *blockData(block *blk) {
+        return reinterpret_cast<u_char *>(blk) + blockHeader();
+    }
+
+    ParseArena(const ParseArena &);
+    ParseArena &operator=(const ParseArena &);
+};
+
+/**
+ * \class   ParseArenaAllocator
+ *
+ * \brief   STL allocator backed by the thread's active ParseArena
+ * \details The active arena is captured when the allocator is constructed. If no
+ *          arena is active, the allocator falls back to the global heap so the
+ *          same container types can be used outside of message parsing.
+ */
+template <typename T>
+class ParseArenaAllocator {
+public:
+    typedef T               value_type;
+    typedef T*              pointer;
+    typedef const T*        const_pointer;
+    typedef T&              reference;
+    typedef const T&        const_reference;
+    typedef std::size_t     size_type;
+    typedef std::ptrdiff_t  difference_type;
+
+    template <typename U>
+    struct rebind {
+        typedef ParseArenaAllocator<U> other;
+    };
+
+    ParseArenaAllocator() : arena(ParseArena::current()) { }
+
+    template <typename U>
+    ParseArenaAllocator(const ParseArenaAllocator<U> &other) : arena(other.arena) { }
+
+    T *allocate(std::size_t n, const void * = 0) {
+        if (arena != NULL)
+            return static_cast<T *>(arena->allocate(n * sizeof(T)));
+
+        return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, std::size_t) {
+        // Arena memory is released in bulk by ParseArena::reset()
+        if (arena == NULL)
+            ::operator delete(p);
+    }
+
+    std::size_t max_size() const {
+        return SIZE_MAX / sizeof(T);
+    }
+
+    template <typename U, typename... Args>
+    void construct(U *p, Args&&... args) {
+        ::new((void *)p) U(std::forward<Args>(args)...);
+    }
+
+    template <typename U>
+    void destroy(U *p) {
+        p->~U();
+    }
+
+    ParseArena *arena;                      ///< Arena to allocate from, NULL to use the heap
+};
+
+template <typename T, typename U>
+inline bool operator==(const ParseArenaAllocator<T> &a, const ParseArenaAllocator<U> &b) {
+    return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+inline bool operator!=(const ParseArenaAllocator<T> &a, const ParseArenaAllocator<U> &b) {
+    return a.arena != b.arena;
+}
+
+#endif /* PARSEARENA_H_ */
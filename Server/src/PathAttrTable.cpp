@@ -0,0 +1,403 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "PathAttrTable.h"
+#include "FlatHashMap.hpp"
+
+#include <cstring>
+
+namespace {
+
+/**
+ * Reader slot claimed by the calling thread, released when the thread exits
+ */
+struct reader_slot_holder {
+    EpochReclaim<PathAttrTable::entry>          *reclaimer;     ///< Owner of the slot
+    EpochReclaim<PathAttrTable::entry>::slot_t  *slot;          ///< Epoch slot, NULL if not claimed
+
+    reader_slot_holder() : reclaimer(NULL), slot(NULL) { }
+
+    ~reader_slot_holder() {
+        if (slot != NULL)
+            reclaimer->unclaim(slot);
+    }
+};
+
+thread_local reader_slot_holder reader_slot;
+
+/**
+ * Append a length prefixed field to the key
+ */
+inline void appendField(std::string &key, const char *data, size_t len) {
+    uint32_t field_len = len;
+    key.append((const char *)&field_len, sizeof(field_len));
+    key.append(data, len);
+}
+
+inline void appendField(std::string &key, const std::string &value) {
+    appendField(key, value.data(), value.size());
+}
+
+inline void appendField(std::string &key, const char *value) {
+    appendField(key, value, strlen(value));
+}
+
+template <typename T>
+inline void appendValue(std::string &key, T value) {
+    key.append((const char *)&value, sizeof(value));
+}
+
+} /* anonymous namespace */
+
+/**
+ * Constructor for entry
+ *
+ * \details The key and the strings of attr each hold the variable length fields
+ *          once, so the entry's memory is counted as its size plus twice the key.
+ */
+PathAttrTable::entry::entry(const MsgBusInterface::obj_path_attr &attr, const MD5 &attr_md5, uint64_t hash,
+                            const std::string &key)
+        : attr(sharedCopy(attr)), attr_md5(attr_md5), hash(hash), key(key),
+          bytes(sizeof(entry) + key.size() * 2), refcnt(1), next(NULL) {
+}
+
+/**
+ * Copy of attr as stored in the table (hash_id and attr_md5 cleared)
+ */
+MsgBusInterface::obj_path_attr PathAttrTable::entry::sharedCopy(const MsgBusInterface::obj_path_attr &attr) {
+    MsgBusInterface::obj_path_attr copy = attr;
+
+    bzero(copy.hash_id, sizeof(copy.hash_id));
+    copy.attr_md5 = NULL;
+
+    return copy;
+}
+
+/*********************************************************************//**
+ * ref
+ *********************************************************************/
+PathAttrTable::ref::ref(const ref &other) : e(other.e) {
+    if (e != NULL)
+        e->refcnt.fetch_add(1, std::memory_order_relaxed);
+}
+
+PathAttrTable::ref &PathAttrTable::ref::operator=(const ref &other) {
+    if (other.e != NULL)
+        other.e->refcnt.fetch_add(1, std::memory_order_relaxed);
+
+    if (e != NULL)
+        release(e);
+
+    e = other.e;
+    return *this;
+}
+
+PathAttrTable::ref::~ref() {
+    reset();
+}
+
+void PathAttrTable::ref::reset() {
+    if (e != NULL) {
+        release(e);
+        e = NULL;
+    }
+}
+
+/*********************************************************************//**
+ * ReadGuard
+ *********************************************************************/
+PathAttrTable::ReadGuard::ReadGuard(PathAttrTable &table) : reclaimer(table.reclaimer) {
+    slot = table.readerSlot();
+
+    if (slot != NULL)
+        reclaimer.enter(slot);
+}
+
+PathAttrTable::ReadGuard::~ReadGuard() {
+    if (slot != NULL)
+        reclaimer.leave(slot);
+}
+
+/*********************************************************************//**
+ * PathAttrTable
+ *********************************************************************/
+
+/**
+ * Get the process wide table
+ */
+PathAttrTable &PathAttrTable::instance() {
+    return ProcessSingleton<PathAttrTable>::get();
+}
+
+/**
+ * Constructor for class
+ */
+PathAttrTable::PathAttrTable() : reclaimer(PATH_ATTR_TABLE_MAX_READERS) {
+    buckets = new std::atomic<entry *>[PATH_ATTR_TABLE_BUCKETS];
+    for (size_t i = 0; i < PATH_ATTR_TABLE_BUCKETS; i++)
+        buckets[i].store(NULL, std::memory_order_relaxed);
+
+    count.store(0);
+    bytes.store(0);
+    max_bytes = PATH_ATTR_TABLE_DEFAULT_MAX_BYTES;
+    sweep_threshold.store(max_bytes);
+}
+
+/**
+ * Destructor for class
+ */
+PathAttrTable::~PathAttrTable() {
+    for (size_t i = 0; i < PATH_ATTR_TABLE_BUCKETS; i++) {
+        entry *e = buckets[i].load();
+        while (e != NULL) {
+            entry *next = e->next.load();
+            delete e;
+            e = next;
+        }
+    }
+
+    delete[] buckets;
+}
+
+/**
+ * Set the memory above which unreferenced entries are swept
+ *
+ * \param [in] max_bytes    Maximum memory of the entries in bytes
+ */
+void PathAttrTable::setMaxBytes(size_t max_bytes) {
+    this->max_bytes = max_bytes;
+    sweep_threshold.store(max_bytes, std::memory_order_relaxed);
+}
+
+/**
+ * Update MD5 with the attribute fields used by the base_attribute hash
+ */
+void PathAttrTable::hashAttrFields(MD5 &hash, const MsgBusInterface::obj_path_attr &attr) {
+    hash.update((unsigned char *) attr.as_path.c_str(), attr.as_path.length());
+    hash.update((unsigned char *) attr.next_hop, strlen(attr.next_hop));
+    hash.update((unsigned char *) attr.aggregator, strlen(attr.aggregator));
+    hash.update((unsigned char *) attr.origin, strlen(attr.origin));
+    hash.update((unsigned char *) &attr.med, sizeof(attr.med));
+    hash.update((unsigned char *) &attr.local_pref, sizeof(attr.local_pref));
+
+    hash.update((unsigned char *) attr.community_list.c_str(), attr.community_list.length());
+    hash.update((unsigned char *) attr.ext_community_list.c_str(), attr.ext_community_list.length());
+}
+
+/**
+ * Build the lookup key for an attribute set
+ *
+ * \details The key holds the base_attribute hash fields plus the fields that
+ *          hash leaves out, so different attribute sets never share an entry.
+ */
+void PathAttrTable::buildKey(const MsgBusInterface::obj_path_attr &attr, std::string &key, uint64_t &hash) {
+    key.reserve(attr.as_path.size() + attr.community_list.size() + attr.ext_community_list.size()
+                + attr.large_community_list.size() + attr.cluster_list.size() + 160);
+
+    appendField(key, attr.as_path);
+    appendField(key, attr.next_hop);
+    appendField(key, attr.aggregator);
+    appendField(key, attr.origin);
+    appendValue(key, attr.med);
+    appendValue(key, attr.local_pref);
+    appendField(key, attr.community_list);
+    appendField(key, attr.ext_community_list);
+
+    appendField(key, attr.large_community_list);
+    appendField(key, attr.cluster_list);
+    appendField(key, attr.originator_id);
+    appendValue(key, attr.as_path_count);
+    appendValue(key, attr.origin_as);
+    appendValue(key, attr.neighbor_as);
+    appendValue(key, (u_char)attr.atomic_agg);
+    appendValue(key, (u_char)attr.nexthop_isIPv4);
+    appendValue(key, (u_char)attr.med_present);
+    appendValue(key, (u_char)attr.local_pref_present);
+
+    // Hash 8 bytes at a time
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ key.size();
+    uint64_t w;
+    size_t i = 0;
+
+    for (; i + sizeof(w) <= key.size(); i += sizeof(w)) {
+        memcpy(&w, key.data() + i, sizeof(w));
+        h = BinaryKeyHash<8>::mix(h ^ w);
+    }
+
+    if (i < key.size()) {
+        w = 0;
+        memcpy(&w, key.data() + i, key.size() - i);
+        h = BinaryKeyHash<8>::mix(h ^ w);
+    }
+
+    hash = h;
+}
+
+/**
+ * Take a reference unless the entry has been removed
+ */
+bool PathAttrTable::acquire(entry *e) {
+    uint32_t cnt = e->refcnt.load(std::memory_order_relaxed);
+
+    while (not (cnt & ENTRY_DEAD)) {
+        if (e->refcnt.compare_exchange_weak(cnt, cnt + 1, std::memory_order_acquire, std::memory_order_relaxed))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Drop a reference
+ *
+ * \details Unreferenced entries are left in the table; sweep() removes them.
+ */
+void PathAttrTable::release(entry *e) {
+    e->refcnt.fetch_sub(1, std::memory_order_release);
+}
+
+/**
+ * Get the reader slot of the calling thread
+ *
+ * \details The slot is claimed on first use and kept until the thread exits.
+ *
+ * \return slot or NULL if all slots are in use
+ */
+EpochReclaim<PathAttrTable::entry>::slot_t *PathAttrTable::readerSlot() {
+    if (reader_slot.slot == NULL) {
+        reader_slot.slot = reclaimer.claim();
+        reader_slot.reclaimer = &reclaimer;
+    }
+
+    return reader_slot.slot;
+}
+
+/**
+ * Search a bucket and take a reference on the matching entry
+ *
+ * \return entry with a reference taken, or NULL if not found
+ */
+PathAttrTable::entry *PathAttrTable::lookup(uint64_t hash, const std::string &key) {
+    size_t bucket = hash & (PATH_ATTR_TABLE_BUCKETS - 1);
+    ReadGuard guard(*this);
+    std::unique_lock<std::mutex> lock;
+
+    // Without a reader slot the stripe lock keeps entries from being removed
+    if (not guard.active())
+        lock = std::unique_lock<std::mutex>(stripes[bucket & (PATH_ATTR_TABLE_STRIPES - 1)]);
+
+    for (entry *e = buckets[bucket].load(std::memory_order_acquire); e != NULL;
+         e = e->next.load(std::memory_order_acquire)) {
+
+        if (e->hash == hash and e->key == key and acquire(e))
+            return e;
+    }
+
+    return NULL;
+}
+
+/**
+ * Find an attribute set (lock free)
+ */
+PathAttrTable::ref PathAttrTable::find(const MsgBusInterface::obj_path_attr &attr) {
+    std::string key;
+    uint64_t hash;
+
+    buildKey(attr, key, hash);
+
+    return ref(lookup(hash, key));
+}
+
+/**
+ * Find or add an attribute set
+ */
+PathAttrTable::ref PathAttrTable::intern(const MsgBusInterface::obj_path_attr &attr) {
+    std::string key;
+    uint64_t hash;
+
+    buildKey(attr, key, hash);
+
+    entry *e = lookup(hash, key);
+    if (e != NULL)
+        return ref(e);
+
+    /*
+     * Not found - hash the attribute fields and insert under the stripe lock,
+     *      checking again in case another session added it in the meantime.
+     */
+    MD5 attr_md5;
+    hashAttrFields(attr_md5, attr);
+
+    size_t bucket = hash & (PATH_ATTR_TABLE_BUCKETS - 1);
+    {
+        std::lock_guard<std::mutex> lock(stripes[bucket & (PATH_ATTR_TABLE_STRIPES - 1)]);
+
+        for (e = buckets[bucket].load(std::memory_order_acquire); e != NULL;
+             e = e->next.load(std::memory_order_acquire)) {
+
+            if (e->hash == hash and e->key == key and acquire(e))
+                return ref(e);
+        }
+
+        e = new entry(attr, attr_md5, hash, key);
+        e->next.store(buckets[bucket].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        buckets[bucket].store(e, std::memory_order_release);
+    }
+
+    count.fetch_add(1, std::memory_order_relaxed);
+    if (bytes.fetch_add(e->bytes, std::memory_order_relaxed) + e->bytes > sweep_threshold.load(std::memory_order_relaxed))
+        sweep();
+
+    return ref(e);
+}
+
+/**
+ * Remove unreferenced entries and free retired entries no reader can see
+ *
+ * \details Only one thread sweeps at a time; others return immediately.
+ */
+void PathAttrTable::sweep() {
+    std::vector<entry *> removed;
+    std::unique_lock<std::mutex> sweep_lock(sweep_mutex, std::try_to_lock);
+    if (not sweep_lock.owns_lock())
+        return;
+
+    for (size_t s = 0; s < PATH_ATTR_TABLE_STRIPES; s++) {
+        std::lock_guard<std::mutex> lock(stripes[s]);
+
+        for (size_t b = s; b < PATH_ATTR_TABLE_BUCKETS; b += PATH_ATTR_TABLE_STRIPES) {
+            std::atomic<entry *> *prev = &buckets[b];
+            entry *e = prev->load(std::memory_order_relaxed);
+
+            while (e != NULL) {
+                entry *next = e->next.load(std::memory_order_relaxed);
+                uint32_t expected = 0;
+
+                // Unreferenced - mark dead so no reader can take a new reference, then unlink
+                if (e->refcnt.compare_exchange_strong(expected, ENTRY_DEAD, std::memory_order_acquire)) {
+                    prev->store(next, std::memory_order_release);
+                    removed.push_back(e);
+                    count.fetch_sub(1, std::memory_order_relaxed);
+                    bytes.fetch_sub(e->bytes, std::memory_order_relaxed);
+
+                } else
+                    prev = &e->next;
+
+                e = next;
+            }
+        }
+    }
+
+    reclaimer.retire(removed);
+    reclaimer.reclaim();
+
+    // Don't sweep again until the table has doubled, unless it is below the max
+    size_t live = bytes.load(std::memory_order_relaxed);
+    sweep_threshold.store(live * 2 > max_bytes ? live * 2 : max_bytes, std::memory_order_relaxed);
+}
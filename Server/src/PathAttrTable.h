@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef PATHATTRTABLE_H_
+#define PATHATTRTABLE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "MsgBusInterface.hpp"
+#include "md5.h"
+#include "EpochReclaim.hpp"
+#include "ProcessSingleton.hpp"
+
+#define PATH_ATTR_TABLE_BUCKETS         (1 << 18)   // Number of hash buckets (fixed, power of 2)
+#define PATH_ATTR_TABLE_STRIPES         256         // Number of writer lock stripes (power of 2)
+#define PATH_ATTR_TABLE_MAX_READERS     4096        // Maximum number of threads reading concurrently
+#define PATH_ATTR_TABLE_DEFAULT_MAX_BYTES (256 << 20) // Unreferenced entries are swept above this memory
+
+/**
+ * \class   PathAttrTable
+ *
+ * \brief   Process wide table of path attribute sets shared by all router sessions
+ * \details Routers that carry the same table from the same upstreams see the same
+ *          attribute sets.  The table keeps one immutable, reference counted copy
+ *          of each set along with the MD5 state over the fields used by the
+ *          base_attribute hash, so only the peer hash needs to be added per peer.
+ *
+ *          Lookups are lock free: buckets are singly linked lists of immutable
+ *          entries, published with release stores.  Inserts and removals take a
+ *          per stripe mutex.  Removed entries are reclaimed using epochs; an
+ *          entry is freed only once every reader that could have seen it has
+ *          left its read section.
+ *
+ *          Entries whose reference count drops to zero stay in the table so that
+ *          other sessions can reuse them, until the memory of the entries grows
+ *          above the maximum set by setMaxBytes() and unreferenced entries are
+ *          swept.  Referenced entries are never swept, so if they alone exceed
+ *          the maximum, the next sweep waits until the memory has doubled.
+ */
+class PathAttrTable {
+public:
+    /**
+     * Shared attribute set
+     */
+    struct entry {
+        const MsgBusInterface::obj_path_attr    attr;       ///< Attribute set, hash_id and attr_md5 are not set
+        const MD5                               attr_md5;   ///< MD5 state over the base_attribute hash fields
+
+        entry(const MsgBusInterface::obj_path_attr &attr, const MD5 &attr_md5, uint64_t hash,
+              const std::string &key);
+
+        /**
+         * Copy of attr as stored in the table (hash_id and attr_md5 cleared)
+         */
+        static MsgBusInterface::obj_path_attr sharedCopy(const MsgBusInterface::obj_path_attr &attr);
+
+    private:
+        friend class PathAttrTable;
+
+        uint64_t                hash;       ///< Hash of key
+        const std::string       key;        ///< Serialized attribute set
+        const size_t            bytes;      ///< Approximate memory of the entry
+        std::atomic<uint32_t>   refcnt;     ///< Reference count, ENTRY_DEAD once removed
+        std::atomic<entry *>    next;       ///< Next entry in bucket
+    };
+
+    /**
+     * \class   ref
+     *
+     * \brief   Reference to a table entry (like shared_ptr)
+     */
+    class ref {
+    public:
+        ref() : e(NULL) { }
+        ref(const ref &other);
+        ref &operator=(const ref &other);
+        ~ref();
+
+        const entry *get() const            { return e; }
+        const entry *operator->() const     { return e; }
+        explicit operator bool() const      { return e != NULL; }
+
+        /**
+         * Release the reference
+         */
+        void reset();
+
+    private:
+        friend class PathAttrTable;
+
+        explicit ref(entry *e) : e(e) { }   // Takes over an already counted reference
+
+        entry *e;
+    };
+
+    /**
+     * Get the process wide table
+     */
+    static PathAttrTable &instance();
+
+    /**
+     * Find or add an attribute set
+     *
+     * \param [in] attr     Attribute set
+     *
+     * \return reference to the shared entry
+     */
+    ref intern(const MsgBusInterface::obj_path_attr &attr);
+
+    /**
+     * Find an attribute set (lock free)
+     *
+     * \param [in] attr     Attribute set
+     *
+     * \return reference to the shared entry or empty reference if not found
+     */
+    ref find(const MsgBusInterface::obj_path_attr &attr);
+
+    /**
+     * Update MD5 with the attribute fields used by the base_attribute hash
+     *
+     * \details Peer hash is not included; it is added by the caller.
+     *
+     * \param [in,out] hash     MD5 to update
+     * \param [in]     attr     Attribute set
+     */
+    static void hashAttrFields(MD5 &hash, const MsgBusInterface::obj_path_attr &attr);
+
+    /**
+     * Set the memory above which unreferenced entries are swept
+     *
+     * \details Called before router threads start.
+     *
+     * \param [in] max_bytes    Maximum memory of the entries in bytes
+     */
+    void setMaxBytes(size_t max_bytes);
+
+    /**
+     * Number of entries in the table
+     */
+    size_t size() const         { return count.load(std::memory_order_relaxed); }
+
+    /**
+     * Approximate memory of the entries in bytes
+     */
+    size_t memoryBytes() const  { return bytes.load(std::memory_order_relaxed); }
+
+    ~PathAttrTable();
+
+private:
+    static const uint32_t ENTRY_DEAD = 0x80000000;
+
+    /**
+     * Lock free read section of the calling thread
+     *
+     * \details Publishes the current epoch in the thread's reader slot for the
+     *          lifetime of the guard.  If no reader slot is available, active()
+     *          is false and the caller must hold the stripe lock instead.
+     */
+    class ReadGuard {
+    public:
+        explicit ReadGuard(PathAttrTable &table);
+        ~ReadGuard();
+
+        bool active() const     { return slot != NULL; }
+
+    private:
+        EpochReclaim<entry>         &reclaimer;
+        EpochReclaim<entry>::slot_t *slot;
+    };
+
+    std::atomic<entry *>    *buckets;                               ///< Bucket heads
+    std::mutex              stripes[PATH_ATTR_TABLE_STRIPES];       ///< Writer locks, by bucket
+    std::atomic<size_t>     count;                                  ///< Number of entries
+    std::atomic<size_t>     bytes;                                  ///< Approximate memory of the entries
+    std::atomic<size_t>     sweep_threshold;                        ///< Memory at which to sweep
+    size_t                  max_bytes;                              ///< Memory above which to sweep
+
+    EpochReclaim<entry>     reclaimer;                              ///< Frees removed entries
+    std::mutex              sweep_mutex;                            ///< Held while sweeping
+
+    friend class ProcessSingleton<PathAttrTable>;
+
+    PathAttrTable();
+    PathAttrTable(const PathAttrTable &);
+    PathAttrTable &operator=(const PathAttrTable &);
+
+    /**
+     * Build the lookup key for an attribute set
+     */
+    static void buildKey(const MsgBusInterface::obj_path_attr &attr, std::string &key, uint64_t &hash);
+
+    /**
+     * Search a bucket and take a reference on the matching entry
+     */
+    entry *lookup(uint64_t hash, const std::string &key);
+
+    /**
+     * Take a reference unless the entry has been removed
+     */
+    static bool acquire(entry *e);
+
+    /**
+     * Drop a reference
+     */
+    static void release(entry *e);
+
+    /**
+     * Get the reader slot of the calling thread
+     */
+    EpochReclaim<entry>::slot_t *readerSlot();
+
+    /**
+     * Remove unreferenced entries and free retired entries no reader can see
+     */
+    void sweep();
+};
+
+#endif /* PATHATTRTABLE_H_ */
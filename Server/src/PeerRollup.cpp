@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "PeerRollup.h"
+
+#include <cstdio>
+#include <cstring>
+#include <sys/time.h>
+
+/**
+ * Constructor for class
+ *
+ * \param [in] interval     Window length in seconds, zero to disable
+ */
+PeerRollup::PeerRollup(uint32_t interval) : interval(interval) {
+    window_start = interval > 0 ? (now() / 1000) / interval * interval : 0;
+}
+
+/**
+ * Current time in milliseconds since EPOC
+ */
+uint64_t PeerRollup::now() {
+    timeval tv;
+    gettimeofday(&tv, NULL);
+
+    return (uint64_t)tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+/**
+ * Record the counts of one update message for an address family
+ */
+void PeerRollup::record(const MsgBusInterface::obj_bgp_peer &peer, uint16_t afi, uint8_t safi,
+                        uint32_t added, uint32_t withdrawn, uint32_t attr_sets, uint32_t messages,
+                        uint32_t bytes) {
+    rollup_key_t key;
+
+    memcpy(key.data, peer.hash_id, 16);
+    memcpy(key.data + 16, &afi, 2);
+    key.data[18] = safi;
+
+    // First activity of a window; windows without activity are skipped
+    if (rows.empty())
+        window_start = (now() / 1000) / interval * interval;
+
+    uint32_t *row_idx = index.find(key);
+    MsgBusInterface::obj_peer_rollup *row;
+
+    if (row_idx == NULL) {
+        rows.resize(rows.size() + 1);
+        index[key] = rows.size() - 1;
+
+        row = &rows.back();
+        memset(row, 0, sizeof(*row));
+        memcpy(row->router_hash_id, peer.router_hash_id, sizeof(row->router_hash_id));
+        memcpy(row->peer_hash_id, peer.hash_id, sizeof(row->peer_hash_id));
+        snprintf(row->peer_addr, sizeof(row->peer_addr), "%s", peer.peer_addr);
+        row->peer_as = peer.peer_as;
+        row->afi = afi;
+        row->safi = safi;
+
+    } else
+        row = &rows[*row_idx];
+
+    row->prefixes_added += added;
+    row->prefixes_withdrawn += withdrawn;
+    row->attr_sets += attr_sets;
+    row->messages += messages;
+    row->bytes += bytes;
+}
+
+/**
+ * Publish the rows and start the window containing now_ms
+ */
+void PeerRollup::publish(MsgBusInterface *mbus_ptr, uint64_t now_ms) {
+    if (rows.size() > 0) {
+        for (size_t i = 0; i < rows.size(); i++) {
+            rows[i].window_start = window_start;
+            rows[i].interval = interval;
+        }
+
+        mbus_ptr->add_PeerRollup(rows);
+
+        rows.clear();
+        index.clear();
+    }
+
+    window_start = (now_ms / 1000) / interval * interval;
+}
+
+/**
+ * Publish the window if it has closed
+ */
+void PeerRollup::flushExpired(MsgBusInterface *mbus_ptr) {
+    if (interval == 0)
+        return;
+
+    uint64_t now_ms = now();
+
+    if (now_ms >= (window_start + interval) * 1000)
+        publish(mbus_ptr, now_ms);
+}
+
+/**
+ * Publish the current (partial) window
+ */
+void PeerRollup::flushAll(MsgBusInterface *mbus_ptr) {
+    if (interval > 0)
+        publish(mbus_ptr, now());
+}
+
+/**
+ * Milliseconds until the current window closes
+ *
+ * \return milliseconds, or -1 if nothing has been recorded in the window
+ */
+int PeerRollup::msUntilExpiry() const {
+    if (interval == 0 or rows.empty())
+        return -1;
+
+    uint64_t end_ms = (window_start + interval) * 1000;
+    uint64_t now_ms = now();
+
+    return end_ms > now_ms ? (int)(end_ms - now_ms) : 0;
+}
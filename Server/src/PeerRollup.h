@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef PEERROLLUP_H_
+#define PEERROLLUP_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MsgBusInterface.hpp"
+#include "FlatHashMap.hpp"
+
+/**
+ * \class   PeerRollup
+ *
+ * \brief   Per (peer, AFI/SAFI) update counters published once per window
+ * \details Counts prefixes added and withdrawn, attribute sets, messages and
+ *          bytes for each peer and address family of the router.  Windows are
+ *          aligned to multiples of the interval (wall clock), and one row per
+ *          peer and address family with activity is published when the window
+ *          closes.
+ *
+ *          Not thread safe.  Each BMP reader owns one rollup.
+ */
+class PeerRollup {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] interval     Window length in seconds, zero to disable
+     */
+    explicit PeerRollup(uint32_t interval);
+
+    /**
+     * Record the counts of one update message for an address family
+     *
+     * \param [in] peer         Peer of the update
+     * \param [in] afi          Address family
+     * \param [in] safi         Subsequent address family
+     * \param [in] added        Prefixes advertised
+     * \param [in] withdrawn    Prefixes withdrawn
+     * \param [in] attr_sets    Attribute sets (0 or 1)
+     * \param [in] messages     Messages (0 or 1; counted once per update)
+     * \param [in] bytes        Message bytes
+     */
+    void record(const MsgBusInterface::obj_bgp_peer &peer, uint16_t afi, uint8_t safi,
+                uint32_t added, uint32_t withdrawn, uint32_t attr_sets, uint32_t messages, uint32_t bytes);
+
+    /**
+     * Publish the window if it has closed
+     *
+     * \param [in] mbus_ptr     Message bus
+     */
+    void flushExpired(MsgBusInterface *mbus_ptr);
+
+    /**
+     * Publish the current (partial) window
+     *
+     * \param [in] mbus_ptr     Message bus
+     */
+    void flushAll(MsgBusInterface *mbus_ptr);
+
+    /**
+     * Milliseconds until the current window closes
+     *
+     * \return milliseconds, or -1 if nothing has been recorded in the window
+     */
+    int msUntilExpiry() const;
+
+    bool enabled() const                { return interval > 0; }
+
+private:
+    /// Key: peer hash (16), AFI (2) and SAFI (1)
+    typedef BinaryKey<19> rollup_key_t;
+
+    uint32_t                                        interval;       ///< Window length in seconds
+    uint64_t                                        window_start;   ///< Start of the current window (secs)
+    FlatHashMap<rollup_key_t, uint32_t>             index;          ///< Key to row in rows
+    std::vector<MsgBusInterface::obj_peer_rollup>   rows;           ///< Rows of the current window
+
+    /**
+     * Current time in milliseconds since EPOC
+     */
+    static uint64_t now();
+
+    /**
+     * Publish the rows and start the window containing now_ms
+     */
+    void publish(MsgBusInterface *mbus_ptr, uint64_t now_ms);
+};
+
+#endif /* PEERROLLUP_H_ */
@@ -0,0 +1,33 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef PROCESSSINGLETON_HPP_
+#define PROCESSSINGLETON_HPP_
+
+/**
+ * \class   ProcessSingleton
+ *
+ * \brief   Process wide instance of a class, created on first use
+ * \details The instance is intentionally never destroyed.  Router threads that are
+ *          abandoned at shutdown can still be running during static destruction, so
+ *          shared state they use must outlive main().
+ *
+ *          Classes with a private constructor declare ProcessSingleton<T> a friend
+ *          and return get() from their own instance().
+ */
+template <typename T>
+class ProcessSingleton {
+public:
+    static T &get() {
+        static T *instance = new T();
+        return *instance;
+    }
+};
+
+#endif /* PROCESSSINGLETON_HPP_ */
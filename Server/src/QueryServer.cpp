@@ -0,0 +1,448 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "QueryServer.h"
+#include "TextFormat.h"
+
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+/**
+ * Parse a 32 character hex hash
+ */
+bool parseHash(const std::string &value, u_char *hash) {
+    if (value.size() != 32)
+        return false;
+
+    for (size_t i = 0; i < 16; i++) {
+        char byte[3] = { value[i * 2], value[i * 2 + 1], 0 };
+        char *end;
+
+        hash[i] = strtoul(byte, &end, 16);
+        if (*end != 0)
+            return false;
+    }
+
+    return true;
+}
+
+/**
+ * Parse an IPv4 or IPv6 address
+ */
+bool parseAddr(const std::string &value, uint8_t *addr, bool &isIPv4) {
+    memset(addr, 0, 16);
+    isIPv4 = value.find(':') == std::string::npos;
+
+    return inet_pton(isIPv4 ? AF_INET : AF_INET6, value.c_str(), addr) == 1;
+}
+
+} /* anonymous namespace */
+
+/**
+ * Constructor for class
+ *
+ * \param [in] logPtr       Pointer to existing Logger for app logging
+ * \param [in] path         Path of the UNIX domain socket
+ * \param [in] max_rows     Maximum number of rows per response
+ */
+QueryServer::QueryServer(Logger *logPtr, const std::string &path, size_t max_rows)
+        : logger(logPtr), path(path), max_rows(max_rows) {
+    sock = -1;
+    running = false;
+    thr = NULL;
+}
+
+QueryServer::~QueryServer() {
+    stop();
+}
+
+/**
+ * Create the socket and start serving
+ */
+void QueryServer::start() {
+    sockaddr_un addr;
+
+    if (path.size() >= sizeof(addr.sun_path))
+        throw "ERROR: Query socket path is too long";
+
+    if ((sock = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+        throw "ERROR: Cannot open query socket";
+
+    // Remove a stale socket from a previous run
+    unlink(path.c_str());
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    if (bind(sock, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(sock);
+        sock = -1;
+        throw "ERROR: Cannot bind to query socket path";
+    }
+
+    if (listen(sock, 16) < 0) {
+        close(sock);
+        sock = -1;
+        throw "ERROR: Cannot listen on query socket";
+    }
+
+    running = true;
+    thr = new std::thread(&QueryServer::serve, this);
+
+    LOG_INFO("Query socket listening on %s", path.c_str());
+}
+
+/**
+ * Stop serving and remove the socket
+ */
+void QueryServer::stop() {
+    if (thr != NULL) {
+        running = false;
+        thr->join();
+        delete thr;
+        thr = NULL;
+    }
+
+    for (size_t i = 0; i < clients.size(); i++)
+        close(clients[i].sock);
+    clients.clear();
+
+    if (sock >= 0) {
+        close(sock);
+        sock = -1;
+        unlink(path.c_str());
+    }
+}
+
+/**
+ * Serve connections until stopped
+ */
+void QueryServer::serve() {
+    std::vector<pollfd> fds;
+    char buf[4096];
+
+    while (running) {
+        fds.resize(clients.size() + 1);
+
+        fds[0].fd = sock;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+
+        // Requests are not read while a response is pending
+        for (size_t i = 0; i < clients.size(); i++) {
+            fds[i + 1].fd = clients[i].sock;
+            fds[i + 1].events = clients[i].out.empty() ? POLLIN : POLLOUT;
+            fds[i + 1].revents = 0;
+        }
+
+        // Wake up periodically to check if still running
+        if (poll(&fds[0], fds.size(), 1000) < 0)
+            continue;
+
+        time_t now = time(NULL);
+
+        // Handle clients first; accepting changes the client list
+        for (size_t i = clients.size(); i > 0; i--) {
+            client &c = clients[i - 1];
+            bool close_client = false;
+
+            if (fds[i].revents & (POLLERR | POLLNVAL))
+                close_client = true;
+
+            else if (fds[i].revents & POLLOUT)
+                close_client = not service(c);
+
+            else if (fds[i].revents & (POLLIN | POLLHUP)) {
+                ssize_t bytes = recv(c.sock, buf, sizeof(buf), 0);
+
+                if (bytes > 0) {
+                    c.in.append(buf, bytes);
+                    close_client = not service(c);
+
+                } else if (bytes == 0 or (errno != EAGAIN and errno != EINTR))
+                    close_client = true;
+            }
+
+            if (not close_client and not c.out.empty() and now - c.last_sent >= QUERY_SEND_TIMEOUT) {
+                LOG_INFO("Query client did not read its response in %d seconds, disconnecting",
+                         QUERY_SEND_TIMEOUT);
+                close_client = true;
+            }
+
+            if (close_client) {
+                close(c.sock);
+                clients.erase(clients.begin() + (i - 1));
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int c_sock = accept(sock, NULL, NULL);
+
+            if (c_sock >= 0) {
+                if (clients.size() >= QUERY_MAX_CLIENTS) {
+                    const char *msg = "ERR too many connections\n";
+
+                    // The new socket's buffer is empty, so this does not block
+                    send(c_sock, msg, strlen(msg), MSG_NOSIGNAL | MSG_DONTWAIT);
+                    close(c_sock);
+
+                } else if (fcntl(c_sock, F_SETFL, fcntl(c_sock, F_GETFL) | O_NONBLOCK) < 0) {
+                    close(c_sock);
+
+                } else {
+                    client c;
+                    c.sock = c_sock;
+                    c.out_sent = 0;
+                    c.last_sent = now;
+                    c.closing = false;
+                    clients.push_back(c);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * Send queued response data and handle received requests until a response
+ *      is pending or no complete request is left
+ *
+ * \return false if the client should be disconnected
+ */
+bool QueryServer::service(client &c) {
+    while (true) {
+        if (not flush(c))
+            return false;
+
+        // Wait for POLLOUT to send the rest
+        if (not c.out.empty())
+            return true;
+
+        if (c.closing)
+            return false;
+
+        size_t eol = c.in.find('\n');
+        if (eol == std::string::npos) {
+            if (c.in.size() > QUERY_MAX_LINE) {
+                c.out = "ERR request too long\n";
+                c.last_sent = time(NULL);
+                c.closing = true;
+                continue;
+            }
+
+            return true;
+        }
+
+        std::string line = c.in.substr(0, eol);
+
+        c.in.erase(0, eol + 1);
+        if (not line.empty() and line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+
+        handle(line, c.out);
+        c.last_sent = time(NULL);
+    }
+}
+
+/**
+ * Send as much of the queued response as the socket accepts
+ *
+ * \return false if the client should be disconnected
+ */
+bool QueryServer::flush(client &c) {
+    while (c.out_sent < c.out.size()) {
+        ssize_t bytes = send(c.sock, c.out.data() + c.out_sent, c.out.size() - c.out_sent, MSG_NOSIGNAL);
+
+        if (bytes < 0 and errno == EINTR)
+            continue;
+        if (bytes < 0 and (errno == EAGAIN or errno == EWOULDBLOCK))
+            return true;
+        if (bytes <= 0)
+            return false;
+
+        c.out_sent += bytes;
+        c.last_sent = time(NULL);
+    }
+
+    c.out.clear();
+    c.out_sent = 0;
+
+    return true;
+}
+
+/**
+ * Append a route row to the response
+ *
+ * \details The row is written directly to the response, sized from the route's
+ *          variable length attributes.
+ */
+void QueryServer::appendRoute(RibIndex &index, const RibIndex::route *r, std::string &out) {
+    const RibIndex::peer &p = index.getPeer(r->peer_idx);
+    const MsgBusInterface::obj_path_attr &attr = r->attr->attr;
+    char prefix[TEXTFMT_IPV6_STRLEN];
+
+    textfmt::ip(prefix, r->prefix_bin, r->isIPv4);
+
+    // 13 columns: hash, 3 fixed size strings, 2 strings and 7 numbers; 12 tabs, newline and NULL
+    size_t size = sizeof(p.hash_id) * 2 + sizeof(p.peer_addr) + sizeof(prefix) + sizeof(attr.next_hop)
+                  + attr.as_path.size() + attr.community_list.size() + 7 * TEXTFMT_U32_STRLEN + 14;
+    size_t start = out.size();
+
+    out.resize(start + size);
+    textfmt::Writer w(&out[start], size);
+
+    w.hex(p.hash_id, sizeof(p.hash_id)).tab().str(p.peer_addr).tab().u32(p.peer_as).tab();
+    w.str(prefix).tab().u32(r->prefix_len).tab().u32(r->path_id).tab().u32(r->origin_as).tab();
+    w.str(attr.next_hop).tab().str(attr.as_path).tab().u32(attr.local_pref).tab().u32(attr.med).tab();
+    w.str(attr.community_list).tab().u32(r->timestamp_secs).ch('\n');
+
+    out.resize(start + w.length());
+}
+
+/**
+ * Handle one request line
+ */
+void QueryServer::handle(const std::string &line, std::string &out) {
+    RibIndex &index = RibIndex::instance();
+    std::vector<const RibIndex::route *> routes;
+    std::vector<std::string> args;
+    std::istringstream in(line);
+    std::string arg;
+    bool truncated = false;
+    size_t rows = 0;
+
+    while (in >> arg)
+        args.push_back(arg);
+
+    if (args.empty()) {
+        out = "ERR empty request\n";
+        return;
+    }
+
+    const std::string &cmd = args[0];
+
+    /*
+     * Optional peer hash of exact and lpm
+     */
+    int peer_idx = -1;
+    if ((cmd == "exact" or cmd == "lpm") and args.size() > 2) {
+        u_char hash[16];
+
+        if (not parseHash(args[2], hash)) {
+            out = "ERR invalid peer hash\n";
+            return;
+        }
+
+        if ((peer_idx = index.findPeer(hash)) < 0) {
+            out = "END 0\n";
+            return;
+        }
+    }
+
+    if (cmd == "exact" and args.size() >= 2) {
+        size_t slash = args[1].find('/');
+        uint8_t prefix[16];
+        bool isIPv4;
+
+        if (slash == std::string::npos or not parseAddr(args[1].substr(0, slash), prefix, isIPv4)) {
+            out = "ERR invalid prefix\n";
+            return;
+        }
+
+        const char *len_str = args[1].c_str() + slash + 1;
+        char *end;
+        long len = strtol(len_str, &end, 10);
+
+        if (not isdigit((u_char)*len_str) or *end != 0 or len > (isIPv4 ? 32 : 128)) {
+            out = "ERR invalid prefix length\n";
+            return;
+        }
+
+        RibIndex::ReadGuard guard(index);
+
+        index.findExact(prefix, len, isIPv4, peer_idx, routes);
+        for (size_t i = 0; i < routes.size() and rows < max_rows; i++, rows++)
+            appendRoute(index, routes[i], out);
+        truncated = routes.size() > max_rows;
+
+    } else if (cmd == "lpm" and args.size() >= 2) {
+        uint8_t addr[16];
+        bool isIPv4;
+
+        if (not parseAddr(args[1], addr, isIPv4)) {
+            out = "ERR invalid address\n";
+            return;
+        }
+
+        RibIndex::ReadGuard guard(index);
+
+        index.findLongest(addr, isIPv4, peer_idx, routes);
+        for (size_t i = 0; i < routes.size() and rows < max_rows; i++, rows++)
+            appendRoute(index, routes[i], out);
+        truncated = routes.size() > max_rows;
+
+    } else if (cmd == "origin" and args.size() >= 2) {
+        char *end;
+        unsigned long asn = strtoul(args[1].c_str(), &end, 10);
+        size_t limit = max_rows;
+
+        if (*end != 0 or asn > UINT32_MAX) {
+            out = "ERR invalid ASN\n";
+            return;
+        }
+
+        if (args.size() > 2) {
+            limit = strtoul(args[2].c_str(), NULL, 10);
+            if (limit == 0 or limit > max_rows)
+                limit = max_rows;
+        }
+
+        RibIndex::ReadGuard guard(index);
+
+        truncated = index.findOrigin(asn, limit, routes);
+        for (size_t i = 0; i < routes.size(); i++, rows++)
+            appendRoute(index, routes[i], out);
+
+    } else if (cmd == "peers") {
+        char buf[512];
+        size_t slots = index.peerSlots();
+
+        for (size_t i = 0; i < slots and rows < max_rows; i++, rows++) {
+            const RibIndex::peer &p = index.getPeer(i);
+            textfmt::Writer w(buf, sizeof(buf));
+
+            w.hex(p.hash_id, sizeof(p.hash_id)).tab().hex(p.router_hash_id, sizeof(p.router_hash_id)).tab();
+            w.str(p.peer_addr).tab().u32(p.peer_as).tab().u32(p.active.load(std::memory_order_acquire) ? 1 : 0);
+            w.tab().u64(p.prefixes_v4.load(std::memory_order_relaxed));
+            w.tab().u64(p.prefixes_v6.load(std::memory_order_relaxed)).ch('\n');
+
+            out.append(w.c_str(), w.length());
+        }
+        truncated = slots > max_rows;
+
+    } else {
+        out = "ERR unknown request, expected exact, lpm, origin or peers\n";
+        return;
+    }
+
+    char end_line[64];
+    snprintf(end_line, sizeof(end_line), "END %zu%s\n", rows, truncated ? " truncated" : "");
+    out.append(end_line);
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef QUERYSERVER_H_
+#define QUERYSERVER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Logger.h"
+#include "RibIndex.h"
+
+#define QUERY_MAX_CLIENTS           32          // Maximum number of concurrent query connections
+#define QUERY_MAX_LINE              1024        // Maximum request line length
+#define QUERY_SEND_TIMEOUT          5           // Seconds a client may leave a response unread
+
+/**
+ * \class   QueryServer
+ *
+ * \brief   Read only query interface over a UNIX domain socket
+ * \details Answers from the in-memory RibIndex.  Requests are single lines; each
+ *          response is zero or more tab separated rows followed by a line
+ *          "END <rows>" (with " truncated" if max_rows was reached), or a single
+ *          line "ERR <reason>".
+ *
+ *          Requests:
+ *              exact <prefix>/<len> [<peer hash>]   Routes of the prefix
+ *              lpm <address> [<peer hash>]          Longest matching routes, per peer
+ *              origin <asn> [<max rows>]            Routes originated by the ASN
+ *              peers                                Per peer route counts
+ *
+ *          Route rows:  peer_hash, peer_addr, peer_asn, prefix, prefix_len, path_id,
+ *                       origin_as, next_hop, as_path, local_pref, med, communities,
+ *                       timestamp (secs)
+ *          Peer rows:   peer_hash, router_hash, peer_addr, peer_asn, active,
+ *                       ipv4 routes, ipv6 routes
+ *
+ *          All connections are served by one thread with non-blocking sockets.
+ *          Responses are queued per client and no further requests are read
+ *          from a client until its response is sent, so a client that does not
+ *          read only stalls itself.  It is disconnected once its response makes
+ *          no progress for QUERY_SEND_TIMEOUT seconds.
+ */
+class QueryServer {
+public:
+    /**
+     * Constructor for class
+     *
+     * \param [in] logPtr       Pointer to existing Logger for app logging
+     * \param [in] path         Path of the UNIX domain socket
+     * \param [in] max_rows     Maximum number of rows per response
+     */
+    QueryServer(Logger *logPtr, const std::string &path, size_t max_rows);
+
+    ~QueryServer();
+
+    /**
+     * Create the socket and start serving
+     *
+     * \throw (char const *str) message indicating the error
+     */
+    void start();
+
+    /**
+     * Stop serving and remove the socket
+     */
+    void stop();
+
+private:
+    struct client {
+        int             sock;
+        std::string     in;                 ///< Received data not yet processed
+        std::string     out;                ///< Response not yet sent
+        size_t          out_sent;           ///< Bytes of out already sent
+        time_t          last_sent;          ///< Time out was queued or last made progress
+        bool            closing;            ///< Disconnect once out is sent
+    };
+
+    Logger                  *logger;        ///< Logging class pointer
+    std::string             path;           ///< Socket path
+    size_t                  max_rows;       ///< Maximum rows per response
+
+    int                     sock;           ///< Listening socket
+    std::atomic<bool>       running;        ///< Cleared to stop the thread
+    std::thread             *thr;           ///< Serving thread
+    std::vector<client>     clients;        ///< Open connections
+
+    /**
+     * Serve connections until stopped
+     */
+    void serve();
+
+    /**
+     * Handle one request line
+     *
+     * \param [in]  line     Request
+     * \param [out] out      Response
+     */
+    void handle(const std::string &line, std::string &out);
+
+    /**
+     * Append a route row to the response
+     */
+    static void appendRoute(RibIndex &index, const RibIndex::route *r, std::string &out);
+
+    /**
+     * Send queued response data and handle received requests until a response
+     *      is pending or no complete request is left
+     *
+     * \return false if the client should be disconnected
+     */
+    bool service(client &c);
+
+    /**
+     * Send as much of the queued response as the socket accepts
+     *
+     * \return false if the client should be disconnected
+     */
+    static bool flush(client &c);
+};
+
+#endif /* QUERYSERVER_H_ */
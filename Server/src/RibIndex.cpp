@@ -0,0 +1,541 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "RibIndex.h"
+
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+/**
+ * Copy a prefix with the bits past the prefix length cleared
+ */
+inline void maskPrefix(const uint8_t *prefix_bin, uint8_t prefix_len, uint8_t *out) {
+    memset(out, 0, 16);
+    memcpy(out, prefix_bin, prefix_len / 8);
+
+    if (prefix_len % 8)
+        out[prefix_len / 8] = prefix_bin[prefix_len / 8] & (0xFF << (8 - prefix_len % 8));
+}
+
+} /* anonymous namespace */
+
+/*********************************************************************//**
+ * ReadGuard
+ *********************************************************************/
+
+/**
+ * Enter a read section
+ *
+ * \details Claims a reader slot, waiting for one if all are in use, and publishes
+ *          the current epoch in it.
+ */
+RibIndex::ReadGuard::ReadGuard(RibIndex &index) : reclaimer(index.reclaimer) {
+    while ((slot = reclaimer.claim()) == NULL)
+        std::this_thread::yield();
+
+    reclaimer.enter(slot);
+}
+
+RibIndex::ReadGuard::~ReadGuard() {
+    reclaimer.leave(slot);
+    reclaimer.unclaim(slot);
+}
+
+/*********************************************************************//**
+ * RibIndex
+ *********************************************************************/
+
+/**
+ * Get the process wide index
+ */
+RibIndex &RibIndex::instance() {
+    return ProcessSingleton<RibIndex>::get();
+}
+
+/**
+ * Constructor for class
+ */
+RibIndex::RibIndex() : reclaimer(RIB_INDEX_MAX_READERS) {
+    is_enabled = false;
+    buckets = NULL;
+    origin_buckets = NULL;
+    peers = NULL;
+
+    count.store(0);
+    peer_slots.store(0);
+
+    for (size_t i = 0; i < 33; i++)
+        len_count_v4[i].store(0);
+    for (size_t i = 0; i < 129; i++)
+        len_count_v6[i].store(0);
+}
+
+/**
+ * Enable the index, must be called before router threads start
+ */
+void RibIndex::enable() {
+    if (is_enabled)
+        return;
+
+    buckets = new std::atomic<route *>[RIB_INDEX_BUCKETS];
+    for (size_t i = 0; i < RIB_INDEX_BUCKETS; i++)
+        buckets[i].store(NULL, std::memory_order_relaxed);
+
+    origin_buckets = new std::atomic<route *>[RIB_INDEX_ORIGIN_BUCKETS];
+    for (size_t i = 0; i < RIB_INDEX_ORIGIN_BUCKETS; i++)
+        origin_buckets[i].store(NULL, std::memory_order_relaxed);
+
+    peers = new peer[RIB_INDEX_MAX_PEERS];
+
+    is_enabled = true;
+}
+
+/**
+ * Bucket of a prefix
+ */
+size_t RibIndex::bucketOf(const uint8_t *prefix_bin, uint8_t prefix_len, bool isIPv4) {
+    BinaryKey<18> key;
+
+    memcpy(key.data, prefix_bin, 16);
+    key.data[16] = prefix_len;
+    key.data[17] = isIPv4;
+
+    return BinaryKeyHash<18>()(key) & (RIB_INDEX_BUCKETS - 1);
+}
+
+/**
+ * Origin bucket of an origin ASN
+ */
+size_t RibIndex::originBucketOf(uint32_t origin_as) {
+    return BinaryKeyHash<8>::mix(origin_as) & (RIB_INDEX_ORIGIN_BUCKETS - 1);
+}
+
+/**
+ * Link a route into its origin bucket; the prefix stripe lock must be held
+ *
+ * \details Routes are added at the head.  Readers only follow origin_next;
+ *          origin_prev lets writers unlink a route without walking the bucket.
+ */
+void RibIndex::linkOrigin(route *r) {
+    size_t bucket = originBucketOf(r->origin_as);
+    std::lock_guard<std::mutex> lock(origin_stripes[bucket & (RIB_INDEX_ORIGIN_STRIPES - 1)]);
+
+    route *head = origin_buckets[bucket].load(std::memory_order_relaxed);
+
+    r->origin_next.store(head, std::memory_order_relaxed);
+    r->origin_prev = &origin_buckets[bucket];
+
+    if (head != NULL)
+        head->origin_prev = &r->origin_next;
+
+    origin_buckets[bucket].store(r, std::memory_order_release);
+}
+
+/**
+ * Unlink a route from its origin bucket; the prefix stripe lock must be held
+ *
+ * \details The route keeps its origin_next, so readers at it continue through
+ *          the bucket.
+ */
+void RibIndex::unlinkOrigin(route *r) {
+    size_t bucket = originBucketOf(r->origin_as);
+    std::lock_guard<std::mutex> lock(origin_stripes[bucket & (RIB_INDEX_ORIGIN_STRIPES - 1)]);
+
+    route *next = r->origin_next.load(std::memory_order_relaxed);
+
+    if (next != NULL)
+        next->origin_prev = r->origin_prev;
+
+    r->origin_prev->store(next, std::memory_order_release);
+}
+
+/**
+ * Check if a route is for the prefix
+ */
+bool RibIndex::samePrefix(const route *r, const uint8_t *prefix_bin, uint8_t prefix_len, bool isIPv4) {
+    return r->prefix_len == prefix_len and r->isIPv4 == (isIPv4 ? 1 : 0)
+           and memcmp(r->prefix_bin, prefix_bin, 16) == 0;
+}
+
+/**
+ * Update the route and length counters for a linked (+1) or unlinked (-1) route
+ */
+void RibIndex::countRoute(const route *r, int delta) {
+    peer &p = peers[r->peer_idx];
+
+    count.fetch_add(delta, std::memory_order_relaxed);
+
+    if (r->isIPv4) {
+        len_count_v4[r->prefix_len].fetch_add(delta, std::memory_order_relaxed);
+        p.prefixes_v4.fetch_add(delta, std::memory_order_relaxed);
+    } else {
+        len_count_v6[r->prefix_len].fetch_add(delta, std::memory_order_relaxed);
+        p.prefixes_v6.fetch_add(delta, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Get the slot of a peer, adding it if new
+ *
+ * \return peer index, or -1 if the peer slots are exhausted
+ */
+int RibIndex::peerSlot(const MsgBusInterface::obj_bgp_peer &peer, const char *router_addr) {
+    std::lock_guard<std::mutex> lock(peers_mutex);
+    BinaryKey<16> key(peer.hash_id);
+
+    uint32_t *idx = peer_index.find(key);
+    if (idx != NULL) {
+        if (not peers[*idx].active.load(std::memory_order_relaxed))
+            peers[*idx].active.store(true, std::memory_order_release);
+
+        return *idx;
+    }
+
+    size_t slot = peer_slots.load(std::memory_order_relaxed);
+    if (slot >= RIB_INDEX_MAX_PEERS)
+        return -1;
+
+    RibIndex::peer &p = peers[slot];
+    memcpy(p.hash_id, peer.hash_id, sizeof(p.hash_id));
+    memcpy(p.router_hash_id, peer.router_hash_id, sizeof(p.router_hash_id));
+    snprintf(p.router_addr, sizeof(p.router_addr), "%s", router_addr);
+    snprintf(p.peer_addr, sizeof(p.peer_addr), "%s", peer.peer_addr);
+    memcpy(p.peer_addr_bin, peer.peer_addr_bin, sizeof(p.peer_addr_bin));
+    p.isIPv4 = peer.isIPv4;
+    snprintf(p.peer_bgp_id, sizeof(p.peer_bgp_id), "%s", peer.peer_bgp_id);
+    p.peer_as = peer.peer_as;
+    p.prefixes_v4.store(0, std::memory_order_relaxed);
+    p.prefixes_v6.store(0, std::memory_order_relaxed);
+    p.active.store(true, std::memory_order_relaxed);
+
+    peer_index[key] = slot;
+    peer_slots.store(slot + 1, std::memory_order_release);
+
+    return slot;
+}
+
+/**
+ * Find the index of a peer
+ *
+ * \return peer index, or -1 if not indexed
+ */
+int RibIndex::findPeer(const u_char *peer_hash_id) {
+    size_t slots = peerSlots();
+
+    for (size_t i = 0; i < slots; i++) {
+        if (memcmp(peers[i].hash_id, peer_hash_id, sizeof(peers[i].hash_id)) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+/**
+ * Add or replace advertised prefixes
+ */
+void RibIndex::advertise(const MsgBusInterface::obj_bgp_peer &peer, const char *router_addr,
+                         const MsgBusInterface::rib_vector &rib, const PathAttrTable::ref &attr, uint32_t origin_as) {
+    std::vector<route *> unlinked;
+    int peer_idx = peerSlot(peer, router_addr);
+
+    if (peer_idx < 0)
+        return;
+
+    for (size_t i = 0; i < rib.size(); i++) {
+        if (rib[i].prefix_len > (rib[i].isIPv4 ? 32 : 128))
+            continue;
+
+        route *r = new route();
+
+        maskPrefix(rib[i].prefix_bin, rib[i].prefix_len, r->prefix_bin);
+        r->prefix_len = rib[i].prefix_len;
+        r->isIPv4 = rib[i].isIPv4 ? 1 : 0;
+        r->path_id = rib[i].path_id;
+        r->peer_idx = peer_idx;
+        r->origin_as = origin_as;
+        r->timestamp_secs = peer.timestamp_secs;
+        r->attr = attr;
+
+        size_t bucket = bucketOf(r->prefix_bin, r->prefix_len, r->isIPv4);
+        std::lock_guard<std::mutex> lock(stripes[bucket & (RIB_INDEX_STRIPES - 1)]);
+
+        std::atomic<route *> *prev = &buckets[bucket];
+        route *e = prev->load(std::memory_order_relaxed);
+
+        while (e != NULL and not (e->peer_idx == (uint32_t)peer_idx and e->path_id == r->path_id
+                                  and samePrefix(e, r->prefix_bin, r->prefix_len, r->isIPv4))) {
+            prev = &e->next;
+            e = prev->load(std::memory_order_relaxed);
+        }
+
+        if (e != NULL) {
+            // Replace in place; readers at e continue through e->next
+            r->next.store(e->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            prev->store(r, std::memory_order_release);
+            unlinkOrigin(e);
+            unlinked.push_back(e);
+
+        } else {
+            r->next.store(buckets[bucket].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            buckets[bucket].store(r, std::memory_order_release);
+            countRoute(r, 1);
+        }
+
+        linkOrigin(r);
+    }
+
+    retire(unlinked);
+}
+
+/**
+ * Remove withdrawn prefixes
+ */
+void RibIndex::withdraw(const MsgBusInterface::obj_bgp_peer &peer, const MsgBusInterface::rib_vector &rib) {
+    std::vector<route *> unlinked;
+    uint8_t prefix[16];
+    int peer_idx;
+
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex);
+        uint32_t *idx = peer_index.find(BinaryKey<16>(peer.hash_id));
+
+        if (idx == NULL)
+            return;
+
+        peer_idx = *idx;
+    }
+
+    for (size_t i = 0; i < rib.size(); i++) {
+        if (rib[i].prefix_len > (rib[i].isIPv4 ? 32 : 128))
+            continue;
+
+        maskPrefix(rib[i].prefix_bin, rib[i].prefix_len, prefix);
+
+        size_t bucket = bucketOf(prefix, rib[i].prefix_len, rib[i].isIPv4);
+        std::lock_guard<std::mutex> lock(stripes[bucket & (RIB_INDEX_STRIPES - 1)]);
+
+        std::atomic<route *> *prev = &buckets[bucket];
+        route *e = prev->load(std::memory_order_relaxed);
+
+        while (e != NULL) {
+            if (e->peer_idx == (uint32_t)peer_idx and e->path_id == rib[i].path_id
+                    and samePrefix(e, prefix, rib[i].prefix_len, rib[i].isIPv4)) {
+                prev->store(e->next.load(std::memory_order_relaxed), std::memory_order_release);
+                unlinkOrigin(e);
+                countRoute(e, -1);
+                unlinked.push_back(e);
+                break;
+            }
+
+            prev = &e->next;
+            e = prev->load(std::memory_order_relaxed);
+        }
+    }
+
+    retire(unlinked);
+}
+
+/**
+ * Remove all routes of a peer and mark it inactive (peer down)
+ */
+void RibIndex::removePeer(const u_char *peer_hash_id) {
+    std::vector<uint8_t> remove;
+
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex);
+        uint32_t *idx = peer_index.find(BinaryKey<16>(peer_hash_id));
+
+        if (idx == NULL)
+            return;
+
+        remove.resize(peer_slots.load(std::memory_order_relaxed), 0);
+        remove[*idx] = 1;
+    }
+
+    removePeers(remove);
+}
+
+/**
+ * Remove all routes of all peers of a router (router termination)
+ */
+void RibIndex::removeRouter(const u_char *router_hash_id) {
+    std::vector<uint8_t> remove;
+    bool found = false;
+
+    {
+        std::lock_guard<std::mutex> lock(peers_mutex);
+
+        remove.resize(peer_slots.load(std::memory_order_relaxed), 0);
+        for (size_t i = 0; i < remove.size(); i++) {
+            if (memcmp(peers[i].router_hash_id, router_hash_id, sizeof(peers[i].router_hash_id)) == 0) {
+                remove[i] = 1;
+                found = true;
+            }
+        }
+    }
+
+    if (found)
+        removePeers(remove);
+}
+
+/**
+ * Remove all routes of the marked peers and mark them inactive
+ *
+ * \details Scans every bucket; only used on peer down and router termination.
+ */
+void RibIndex::removePeers(const std::vector<uint8_t> &remove) {
+    std::vector<route *> unlinked;
+
+    for (size_t i = 0; i < remove.size(); i++) {
+        if (remove[i])
+            peers[i].active.store(false, std::memory_order_release);
+    }
+
+    for (size_t stripe = 0; stripe < RIB_INDEX_STRIPES; stripe++) {
+        std::lock_guard<std::mutex> lock(stripes[stripe]);
+
+        for (size_t bucket = stripe; bucket < RIB_INDEX_BUCKETS; bucket += RIB_INDEX_STRIPES) {
+            std::atomic<route *> *prev = &buckets[bucket];
+            route *e = prev->load(std::memory_order_relaxed);
+
+            while (e != NULL) {
+                route *next = e->next.load(std::memory_order_relaxed);
+
+                if (e->peer_idx < remove.size() and remove[e->peer_idx]) {
+                    prev->store(next, std::memory_order_release);
+                    unlinkOrigin(e);
+                    countRoute(e, -1);
+                    unlinked.push_back(e);
+                } else
+                    prev = &e->next;
+
+                e = next;
+            }
+        }
+    }
+
+    retire(unlinked);
+}
+
+/**
+ * Queue unlinked routes and free those no reader can see anymore
+ *
+ * \details Reclaiming scans the reader slots, so it is done in batches.
+ */
+void RibIndex::retire(std::vector<route *> &routes) {
+    if (routes.empty())
+        return;
+
+    if (reclaimer.retire(routes) >= RIB_INDEX_RECLAIM_BATCH)
+        reclaimer.reclaim();
+}
+
+/**
+ * Find the routes of a prefix; requires a ReadGuard
+ */
+void RibIndex::findExact(const uint8_t *prefix_bin, uint8_t prefix_len, bool isIPv4, int peer_idx,
+                         std::vector<const route *> &out) {
+    uint8_t prefix[16];
+
+    if (prefix_len > (isIPv4 ? 32 : 128))
+        return;
+
+    maskPrefix(prefix_bin, prefix_len, prefix);
+
+    const route *e = buckets[bucketOf(prefix, prefix_len, isIPv4)].load(std::memory_order_acquire);
+
+    for (; e != NULL; e = e->next.load(std::memory_order_acquire)) {
+        if ((peer_idx < 0 or e->peer_idx == (uint32_t)peer_idx) and samePrefix(e, prefix, prefix_len, isIPv4))
+            out.push_back(e);
+    }
+}
+
+/**
+ * Find the longest matching routes of an address; requires a ReadGuard
+ *
+ * \details Probes each prefix length that has routes, longest first.  A peer is
+ *          done once routes of it are found at a length; all of its paths at
+ *          that length are returned.
+ */
+void RibIndex::findLongest(const uint8_t *addr, bool isIPv4, int peer_idx, std::vector<const route *> &out) {
+    std::vector<uint8_t>    done(peerSlots(), 0);
+    std::vector<uint32_t>   found;
+    std::atomic<uint32_t>   *len_count = isIPv4 ? len_count_v4 : len_count_v6;
+    uint8_t                 prefix[16];
+
+    for (int len = isIPv4 ? 32 : 128; len >= 0; len--) {
+        if (len_count[len].load(std::memory_order_relaxed) == 0)
+            continue;
+
+        maskPrefix(addr, len, prefix);
+        found.clear();
+
+        const route *e = buckets[bucketOf(prefix, len, isIPv4)].load(std::memory_order_acquire);
+
+        for (; e != NULL; e = e->next.load(std::memory_order_acquire)) {
+            if (peer_idx >= 0 and e->peer_idx != (uint32_t)peer_idx)
+                continue;
+
+            if (e->peer_idx >= done.size())
+                done.resize(e->peer_idx + 1, 0);
+
+            if (not done[e->peer_idx] and samePrefix(e, prefix, len, isIPv4)) {
+                out.push_back(e);
+                found.push_back(e->peer_idx);
+            }
+        }
+
+        for (size_t i = 0; i < found.size(); i++)
+            done[found[i]] = 1;
+
+        if (peer_idx >= 0 and found.size() > 0)
+            break;
+    }
+}
+
+/**
+ * Find routes by origin ASN; requires a ReadGuard
+ *
+ * \details Walks the origin bucket of the ASN, which also holds the routes of
+ *          other origins that hash to it.
+ */
+bool RibIndex::findOrigin(uint32_t origin_as, size_t max_routes, std::vector<const route *> &out) {
+    const route *e = origin_buckets[originBucketOf(origin_as)].load(std::memory_order_acquire);
+
+    for (; e != NULL; e = e->origin_next.load(std::memory_order_acquire)) {
+        if (e->origin_as != origin_as)
+            continue;
+
+        if (out.size() >= max_routes)
+            return true;
+
+        out.push_back(e);
+    }
+
+    return false;
+}
+
+/**
+ * Get the routes of a range of buckets; requires a ReadGuard
+ */
+size_t RibIndex::scanBuckets(size_t start, size_t count, std::vector<const route *> &out) {
+    size_t end = start + count < RIB_INDEX_BUCKETS ? start + count : RIB_INDEX_BUCKETS;
+
+    for (size_t bucket = start; bucket < end; bucket++) {
+        const route *e = buckets[bucket].load(std::memory_order_acquire);
+
+        for (; e != NULL; e = e->next.load(std::memory_order_acquire))
+            out.push_back(e);
+    }
+
+    return end;
+}
@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef RIBINDEX_H_
+#define RIBINDEX_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "MsgBusInterface.hpp"
+#include "PathAttrTable.h"
+#include "FlatHashMap.hpp"
+#include "EpochReclaim.hpp"
+#include "ProcessSingleton.hpp"
+
+#define RIB_INDEX_BUCKETS           (1 << 20)   // Number of hash buckets (fixed, power of 2)
+#define RIB_INDEX_STRIPES           1024        // Number of writer lock stripes (power of 2)
+#define RIB_INDEX_ORIGIN_BUCKETS    (1 << 16)   // Number of origin ASN hash buckets (power of 2)
+#define RIB_INDEX_ORIGIN_STRIPES    256         // Number of origin bucket writer lock stripes (power of 2)
+#define RIB_INDEX_MAX_READERS       16          // Maximum number of concurrent read sections
+#define RIB_INDEX_MAX_PEERS         65536       // Maximum number of peers indexed
+#define RIB_INDEX_RECLAIM_BATCH     4096        // Retired routes before reclaiming
+
+/**
+ * \class   RibIndex
+ *
+ * \brief   Process wide in-memory index of the unicast prefixes of all peers
+ * \details Fed with the same advertised and withdrawn prefixes that are published
+ *          as unicast_prefix messages, and used to answer local queries without
+ *          the database.
+ *
+ *          Routes are keyed by prefix; a bucket holds the routes of all peers for
+ *          the prefixes that hash to it.  Routes are immutable once linked and
+ *          reference their attributes in the shared PathAttrTable.  Each route is
+ *          also linked into an origin bucket by its origin ASN, so routes of an
+ *          origin are found without scanning the prefix buckets.
+ *
+ *          Readers are lock free: they enter a read section (ReadGuard) and walk
+ *          the buckets with acquire loads.  Writers (router threads) take a per
+ *          stripe mutex, and replace or unlink routes with release stores.
+ *          Unlinked routes are freed using epochs, once no read section that
+ *          could have seen them is active.
+ */
+class RibIndex {
+public:
+    /**
+     * Indexed route, immutable once linked
+     */
+    struct route {
+        uint8_t                 prefix_bin[16];     ///< Prefix in binary form (IPv4 in first 4 bytes)
+        uint8_t                 prefix_len;         ///< Length of prefix in bits
+        uint8_t                 isIPv4;             ///< 1 if IPv4, 0 if IPv6
+        uint32_t                path_id;            ///< Add path ID, zero if not used
+        uint32_t                peer_idx;           ///< Index of the peer
+        uint32_t                origin_as;          ///< Origin ASN
+        uint32_t                timestamp_secs;     ///< Time of the update
+        PathAttrTable::ref      attr;               ///< Path attributes
+
+        std::atomic<route *>    next;               ///< Next route in bucket
+        std::atomic<route *>    origin_next;        ///< Next route in origin bucket
+        std::atomic<route *>    *origin_prev;       ///< Link to this route in its origin bucket, used by writers
+    };
+
+    /**
+     * Indexed peer; the slot of a peer is never reused for another peer
+     */
+    struct peer {
+        std::atomic<bool>       active;             ///< True while the peer is up, set after the fields below
+        u_char                  hash_id[16];        ///< Peer hash ID
+        u_char                  router_hash_id[16]; ///< Router hash ID
+        char                    router_addr[46];    ///< Router address in printed form
+        char                    peer_addr[46];      ///< Peer address in printed form
+        uint8_t                 peer_addr_bin[16];  ///< Peer address in binary form (IPv4 in last 4 bytes)
+        bool                    isIPv4;             ///< True if the peer address is IPv4
+        char                    peer_bgp_id[16];    ///< Peer BGP ID in printed form
+        uint32_t                peer_as;            ///< Peer ASN
+        std::atomic<uint64_t>   prefixes_v4;        ///< IPv4 routes
+        std::atomic<uint64_t>   prefixes_v6;        ///< IPv6 routes
+    };
+
+    /**
+     * Read section
+     *
+     * \details Routes and peers returned by the find methods are valid only for
+     *          the lifetime of the guard.  Read sections should be short; routes
+     *          unlinked while one is active are not freed until it ends.
+     */
+    class ReadGuard {
+    public:
+        explicit ReadGuard(RibIndex &index);
+        ~ReadGuard();
+
+    private:
+        EpochReclaim<route>         &reclaimer;
+        EpochReclaim<route>::slot_t *slot;
+
+        ReadGuard(const ReadGuard &);
+        ReadGuard &operator=(const ReadGuard &);
+    };
+
+    /**
+     * Get the process wide index
+     */
+    static RibIndex &instance();
+
+    /**
+     * Enable the index, must be called before router threads start
+     */
+    void enable();
+
+    bool enabled() const            { return is_enabled; }
+
+    /**
+     * Add or replace advertised prefixes
+     *
+     * \param [in] peer         Peer of the prefixes
+     * \param [in] router_addr  Router address of the peer in printed form
+     * \param [in] rib          Advertised prefixes
+     * \param [in] attr         Shared path attributes of the prefixes
+     * \param [in] origin_as    Origin ASN
+     */
+    void advertise(const MsgBusInterface::obj_bgp_peer &peer, const char *router_addr,
+                   const MsgBusInterface::rib_vector &rib, const PathAttrTable::ref &attr, uint32_t origin_as);
+
+    /**
+     * Remove withdrawn prefixes
+     *
+     * \param [in] peer         Peer of the prefixes
+     * \param [in] rib          Withdrawn prefixes
+     */
+    void withdraw(const MsgBusInterface::obj_bgp_peer &peer, const MsgBusInterface::rib_vector &rib);
+
+    /**
+     * Remove all routes of a peer and mark it inactive (peer down)
+     *
+     * \param [in] peer_hash_id     Peer hash ID
+     */
+    void removePeer(const u_char *peer_hash_id);
+
+    /**
+     * Remove all routes of all peers of a router (router termination)
+     *
+     * \param [in] router_hash_id   Router hash ID
+     */
+    void removeRouter(const u_char *router_hash_id);
+
+    /**
+     * Find the routes of a prefix; requires a ReadGuard
+     *
+     * \param [in]  prefix_bin   Prefix in binary form
+     * \param [in]  prefix_len   Length of prefix in bits
+     * \param [in]  isIPv4       True if IPv4
+     * \param [in]  peer_idx     Peer index, or -1 for all peers
+     * \param [out] out          Matching routes are appended
+     */
+    void findExact(const uint8_t *prefix_bin, uint8_t prefix_len, bool isIPv4, int peer_idx,
+                   std::vector<const route *> &out);
+
+    /**
+     * Find the longest matching routes of an address; requires a ReadGuard
+     *
+     * \details The longest match is per peer, so with all peers the result can
+     *          hold routes of different prefix lengths.
+     *
+     * \param [in]  addr         Address in binary form
+     * \param [in]  isIPv4       True if IPv4
+     * \param [in]  peer_idx     Peer index, or -1 for all peers
+     * \param [out] out          Matching routes are appended
+     */
+    void findLongest(const uint8_t *addr, bool isIPv4, int peer_idx, std::vector<const route *> &out);
+
+    /**
+     * Find routes by origin ASN; requires a ReadGuard
+     *
+     * \param [in]  origin_as    Origin ASN
+     * \param [in]  max_routes   Maximum number of routes to return
+     * \param [out] out          Matching routes are appended
+     *
+     * \return true if the result was truncated at max_routes
+     */
+    bool findOrigin(uint32_t origin_as, size_t max_routes, std::vector<const route *> &out);
+
+    /**
+     * Get the routes of a range of buckets; requires a ReadGuard
+     *
+     * \details Used to walk the whole index in steps, with a short read section
+     *          per step.  All routes of a prefix are in the same bucket.
+     *
+     * \param [in]  start        First bucket
+     * \param [in]  count        Number of buckets
+     * \param [out] out          Routes are appended
+     *
+     * \return first bucket after the range, bucketCount() once the index is done
+     */
+    size_t scanBuckets(size_t start, size_t count, std::vector<const route *> &out);
+
+    /**
+     * Number of buckets
+     */
+    static size_t bucketCount()     { return RIB_INDEX_BUCKETS; }
+
+    /**
+     * Find the index of a peer
+     *
+     * \return peer index, or -1 if not indexed
+     */
+    int findPeer(const u_char *peer_hash_id);
+
+    /**
+     * Number of peer slots in use; slots [0, peerSlots()) can be read
+     */
+    size_t peerSlots() const        { return peer_slots.load(std::memory_order_acquire); }
+
+    const peer &getPeer(size_t idx) const   { return peers[idx]; }
+
+    /**
+     * Number of indexed routes
+     */
+    size_t size() const             { return count.load(std::memory_order_relaxed); }
+
+private:
+    bool                    is_enabled;                             ///< True if enabled, set before threads start
+
+    std::atomic<route *>    *buckets;                               ///< Bucket heads
+    std::mutex              stripes[RIB_INDEX_STRIPES];             ///< Writer locks, by bucket
+    std::atomic<size_t>     count;                                  ///< Number of routes
+
+    std::atomic<route *>    *origin_buckets;                        ///< Origin bucket heads
+    std::mutex              origin_stripes[RIB_INDEX_ORIGIN_STRIPES]; ///< Origin bucket writer locks
+
+    /// Routes per prefix length; lengths without routes are skipped by longest match
+    std::atomic<uint32_t>   len_count_v4[33];
+    std::atomic<uint32_t>   len_count_v6[129];
+
+    peer                    *peers;                                 ///< Peer slots
+    std::atomic<size_t>     peer_slots;                             ///< Number of peer slots in use
+    std::mutex              peers_mutex;                            ///< Protects peer_index and slot allocation
+    FlatHashMap<BinaryKey<16>, uint32_t> peer_index;                ///< Peer hash to slot
+
+    EpochReclaim<route>     reclaimer;                              ///< Frees unlinked routes
+
+    friend class ProcessSingleton<RibIndex>;
+
+    RibIndex();
+    RibIndex(const RibIndex &);
+    RibIndex &operator=(const RibIndex &);
+
+    /**
+     * Get the slot of a peer, adding it if new
+     *
+     * \return peer index, or -1 if the peer slots are exhausted
+     */
+    int peerSlot(const MsgBusInterface::obj_bgp_peer &peer, const char *router_addr);
+
+    /**
+     * Remove all routes of the marked peers and mark them inactive
+     *
+     * \param [in] remove       Peer indexes to remove, non-zero if removed
+     */
+    void removePeers(const std::vector<uint8_t> &remove);
+
+    /**
+     * Bucket of a prefix
+     */
+    static size_t bucketOf(const uint8_t *prefix_bin, uint8_t prefix_len, bool isIPv4);
+
+    /**
+     * Origin bucket of an origin ASN
+     */
+    static size_t originBucketOf(uint32_t origin_as);
+
+    /**
+     * Link a route into its origin bucket; the prefix stripe lock must be held
+     */
+    void linkOrigin(route *r);
+
+    /**
+     * Unlink a route from its origin bucket; the prefix stripe lock must be held
+     */
+    void unlinkOrigin(route *r);
+
+    /**
+     * Check if a route is for the prefix
+     */
+    static bool samePrefix(const route *r, const uint8_t *prefix_bin, uint8_t prefix_len, bool isIPv4);
+
+    /**
+     * Update the route and length counters for a linked (+1) or unlinked (-1) route
+     */
+    void countRoute(const route *r, int delta);
+
+    /**
+     * Queue unlinked routes and free those no reader can see anymore
+     */
+    void retire(std::vector<route *> &routes);
+};
+
+#endif /* RIBINDEX_H_ */
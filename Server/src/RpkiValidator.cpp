@@ -0,0 +1,420 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "RpkiValidator.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <strings.h>
+#include <arpa/inet.h>
+#include <sys/stat.h>
+
+#define RPKI_MAX_LEN_UNSET      255         // Max length not given, defaults to the prefix length
+
+/**
+ * Get the process wide validator
+ */
+RpkiValidator &RpkiValidator::instance() {
+    return ProcessSingleton<RpkiValidator>::get();
+}
+
+/**
+ * Constructor for class
+ */
+RpkiValidator::RpkiValidator() {
+    mtime = 0;
+}
+
+/**
+ * Load the VRP set from a file, replacing the current set
+ */
+size_t RpkiValidator::load(const std::string &filename, size_t &skipped) {
+    std::lock_guard<std::mutex> lock(load_mutex);
+    struct stat st;
+
+    skipped = 0;
+
+    // Failed loads are retried once the file changes
+    this->filename = filename;
+
+    if (stat(filename.c_str(), &st) != 0) {
+        mtime = 0;
+        throw "unable to stat RPKI file";
+    }
+
+    mtime = st.st_mtime;
+
+    std::ifstream in(filename.c_str(), std::ios::in | std::ios::binary);
+    if (not in.is_open())
+        throw "unable to open RPKI file";
+
+    std::stringstream buf;
+    buf << in.rdbuf();
+    std::string data = buf.str();
+
+    // JSON exports start with an object or array, everything else is parsed as CSV
+    std::vector<std::pair<std::string, vrp> > entries;
+    size_t pos = data.find_first_not_of(" \t\r\n");
+
+    if (pos != std::string::npos and (data[pos] == '{' or data[pos] == '['))
+        parseJson(data, entries, skipped);
+    else
+        parseCsv(data, entries, skipped);
+
+    /*
+     * Build the trie; VRPs are collected per node first and then laid out
+     *      contiguously by node
+     */
+    std::shared_ptr<trie> t = std::make_shared<trie>();
+    std::vector<std::pair<uint32_t, vrp> > node_vrps;
+    node root = { { 0, 0 }, 0, 0 };
+
+    t->nodes.push_back(root);           // IPv4
+    t->nodes.push_back(root);           // IPv6
+    node_vrps.reserve(entries.size());
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (not insert(*t, node_vrps, entries[i].first, entries[i].second))
+            ++skipped;
+    }
+
+    if (node_vrps.empty())
+        throw "no valid VRPs found in RPKI file";
+
+    std::stable_sort(node_vrps.begin(), node_vrps.end(),
+                     [](const std::pair<uint32_t, vrp> &a, const std::pair<uint32_t, vrp> &b) {
+                         return a.first < b.first;
+                     });
+
+    t->vrps.reserve(node_vrps.size());
+    for (size_t i = 0; i < node_vrps.size(); i++) {
+        node &n = t->nodes[node_vrps[i].first];
+
+        if (n.vrp_count == 0)
+            n.vrp_start = t->vrps.size();
+
+        ++n.vrp_count;
+        t->vrps.push_back(node_vrps[i].second);
+    }
+
+    std::shared_ptr<const trie> loaded = t;
+    std::atomic_store(&current, loaded);
+
+    return node_vrps.size();
+}
+
+/**
+ * Check if the file has been modified since it was loaded
+ */
+bool RpkiValidator::changed() const {
+    std::lock_guard<std::mutex> lock(load_mutex);
+    struct stat st;
+
+    if (filename.empty())
+        return false;
+
+    if (stat(filename.c_str(), &st) != 0)
+        return mtime != 0;          // File removed; a reload reports it
+
+    return st.st_mtime != mtime;
+}
+
+/**
+ * True once a VRP set has been loaded
+ */
+bool RpkiValidator::enabled() const {
+    return std::atomic_load(&current) != NULL;
+}
+
+/**
+ * Set the origin validation state of advertised prefixes
+ */
+void RpkiValidator::validate(MsgBusInterface::rib_vector &rib, uint32_t origin_as) const {
+    std::shared_ptr<const trie> t = std::atomic_load(&current);
+
+    for (size_t i = 0; i < rib.size(); i++) {
+        if (t)
+            rib[i].rpki_state = find(*t, rib[i].prefix_bin, rib[i].prefix_len, rib[i].isIPv4, origin_as);
+        else
+            rib[i].rpki_state = MsgBusInterface::RPKI_STATE_NOT_CHECKED;
+    }
+}
+
+/**
+ * Get the origin validation state of a prefix
+ */
+MsgBusInterface::rpki_state RpkiValidator::lookup(const uint8_t *prefix_bin, uint8_t prefix_len, bool isIPv4,
+                                                  uint32_t origin_as) const {
+    std::shared_ptr<const trie> t = std::atomic_load(&current);
+
+    if (not t)
+        return MsgBusInterface::RPKI_STATE_NOT_CHECKED;
+
+    return find(*t, prefix_bin, prefix_len, isIPv4, origin_as);
+}
+
+/**
+ * Get the origin validation state of a prefix in a trie
+ *
+ * \details Walks the prefix bits from the root; every VRP on the way covers the
+ *          prefix.  The route is valid if a covering VRP matches the origin ASN
+ *          and allows the prefix length, invalid if only non-matching VRPs cover
+ *          it, and unknown (not found) if no VRP covers it.  An origin ASN of
+ *          zero never matches, since AS0 VRPs only invalidate (RFC 6483).
+ */
+MsgBusInterface::rpki_state RpkiValidator::find(const trie &t, const uint8_t *prefix_bin, uint8_t prefix_len,
+                                                bool isIPv4, uint32_t origin_as) {
+    uint32_t    n = isIPv4 ? 0 : 1;
+    bool        covered = false;
+
+    if (prefix_len > (isIPv4 ? 32 : 128))
+        return MsgBusInterface::RPKI_STATE_UNKNOWN;
+
+    for (int depth = 0; ; depth++) {
+        const node &nd = t.nodes[n];
+
+        for (uint32_t i = nd.vrp_start; i < nd.vrp_start + nd.vrp_count; i++) {
+            const vrp &v = t.vrps[i];
+
+            covered = true;
+            if (origin_as != 0 and v.asn == origin_as and prefix_len <= v.max_len)
+                return MsgBusInterface::RPKI_STATE_VALID;
+        }
+
+        if (depth == prefix_len)
+            break;
+
+        n = nd.child[(prefix_bin[depth >> 3] >> (7 - (depth & 7))) & 1];
+        if (n == 0)
+            break;
+    }
+
+    return covered ? MsgBusInterface::RPKI_STATE_INVALID : MsgBusInterface::RPKI_STATE_UNKNOWN;
+}
+
+/**
+ * Insert a VRP into a trie under construction
+ *
+ * \param [in,out] t            Trie, nodes are added as needed
+ * \param [in,out] node_vrps    Node index and VRP pairs
+ * \param [in]     prefix       Prefix in the form address/length
+ * \param [in]     v            VRP; max_len is RPKI_MAX_LEN_UNSET if not given
+ *
+ * \return false if the prefix or max length is invalid
+ */
+bool RpkiValidator::insert(trie &t, std::vector<std::pair<uint32_t, vrp> > &node_vrps,
+                           const std::string &prefix, vrp v) {
+    uint8_t     addr[16];
+    size_t      slash = prefix.find('/');
+
+    if (slash == std::string::npos or slash + 1 >= prefix.size())
+        return false;
+
+    std::string ip = prefix.substr(0, slash);
+    bool isIPv4 = ip.find(':') == std::string::npos;
+    int max_bits = isIPv4 ? 32 : 128;
+
+    if (inet_pton(isIPv4 ? AF_INET : AF_INET6, ip.c_str(), addr) != 1)
+        return false;
+
+    char *end;
+    long len = strtol(prefix.c_str() + slash + 1, &end, 10);
+    if (*end != 0 or len < 0 or len > max_bits)
+        return false;
+
+    if (v.max_len == RPKI_MAX_LEN_UNSET)
+        v.max_len = len;
+    else if (v.max_len < len or v.max_len > max_bits)
+        return false;
+
+    uint32_t n = isIPv4 ? 0 : 1;
+    for (int depth = 0; depth < len; depth++) {
+        int bit = (addr[depth >> 3] >> (7 - (depth & 7))) & 1;
+
+        if (t.nodes[n].child[bit] == 0) {
+            node child = { { 0, 0 }, 0, 0 };
+
+            t.nodes.push_back(child);
+            t.nodes[n].child[bit] = t.nodes.size() - 1;
+        }
+
+        n = t.nodes[n].child[bit];
+    }
+
+    node_vrps.push_back(std::make_pair(n, v));
+    return true;
+}
+
+/**
+ * Parse an ASN in the form "AS65000" or "65000"
+ */
+bool RpkiValidator::parseAsn(const std::string &value, uint32_t &asn) {
+    const char *str = value.c_str();
+    char *end;
+
+    if (strncasecmp(str, "AS", 2) == 0)
+        str += 2;
+
+    if (not isdigit((unsigned char)*str))
+        return false;
+
+    unsigned long num = strtoul(str, &end, 10);
+    if (*end != 0 or num > UINT32_MAX)
+        return false;
+
+    asn = num;
+    return true;
+}
+
+/**
+ * Parse VRPs from a CSV export
+ *
+ * \details Lines are ASN,IP Prefix,Max Length[,...]; empty lines, comments (#) and
+ *          a header line are ignored.  The max length is optional.
+ */
+void RpkiValidator::parseCsv(const std::string &data, std::vector<std::pair<std::string, vrp> > &out,
+                             size_t &skipped) {
+    std::istringstream  in(data);
+    std::string         line;
+    bool                first = true;
+
+    while (std::getline(in, line)) {
+        if (not line.empty() and line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+
+        if (line.empty() or line[0] == '#')
+            continue;
+
+        std::vector<std::string> fields;
+        std::istringstream line_in(line);
+        std::string field;
+
+        while (std::getline(line_in, field, ','))
+            fields.push_back(field);
+
+        vrp v;
+        v.max_len = RPKI_MAX_LEN_UNSET;
+
+        if (fields.size() < 2 or not parseAsn(fields[0], v.asn)) {
+            if (not first)                  // First line is allowed to be a header
+                ++skipped;
+
+            first = false;
+            continue;
+        }
+        first = false;
+
+        if (fields.size() > 2 and not fields[2].empty()) {
+            int max_len = atoi(fields[2].c_str());
+
+            if (max_len < 0 or max_len >= RPKI_MAX_LEN_UNSET) {
+                ++skipped;
+                continue;
+            }
+
+            v.max_len = max_len;
+        }
+
+        out.push_back(std::make_pair(fields[1], v));
+    }
+}
+
+/**
+ * Parse VRPs from a JSON export
+ *
+ * \details Scans for objects with "asn", "prefix" and "maxLength" (or "max_length")
+ *          members, which covers the routinator, rpki-client and RTR dump exports.
+ *          Other members and objects are ignored; the structure is not validated.
+ */
+void RpkiValidator::parseJson(const std::string &data, std::vector<std::pair<std::string, vrp> > &out,
+                              size_t &skipped) {
+    std::string key, asn, prefix, max_len;
+    bool        have_key = false;
+    size_t      pos = 0;
+
+    while (pos < data.size()) {
+        char c = data[pos];
+
+        if (c == '{') {
+            asn.clear(); prefix.clear(); max_len.clear();
+            have_key = false;
+            ++pos;
+
+        } else if (c == '}') {
+            if (not prefix.empty()) {
+                vrp v;
+                v.max_len = RPKI_MAX_LEN_UNSET;
+
+                if (not parseAsn(asn, v.asn))
+                    ++skipped;
+
+                else if (not max_len.empty() and (atoi(max_len.c_str()) < 0
+                                                  or atoi(max_len.c_str()) >= RPKI_MAX_LEN_UNSET))
+                    ++skipped;
+
+                else {
+                    if (not max_len.empty())
+                        v.max_len = atoi(max_len.c_str());
+
+                    out.push_back(std::make_pair(prefix, v));
+                }
+            }
+
+            asn.clear(); prefix.clear(); max_len.clear();
+            have_key = false;
+            ++pos;
+
+        } else if (c == '"' or c == '-' or isdigit((unsigned char)c)) {
+            std::string value;
+
+            if (c == '"') {
+                for (++pos; pos < data.size() and data[pos] != '"'; ++pos) {
+                    if (data[pos] == '\\' and pos + 1 < data.size())
+                        ++pos;
+                    value += data[pos];
+                }
+                ++pos;                      // closing quote
+
+            } else {
+                while (pos < data.size() and (isdigit((unsigned char)data[pos]) or strchr("-+.eE", data[pos])))
+                    value += data[pos++];
+            }
+
+            // A string followed by a colon is a member name
+            size_t next = data.find_first_not_of(" \t\r\n", pos);
+            if (c == '"' and not have_key and next != std::string::npos and data[next] == ':') {
+                key = value;
+                have_key = true;
+                pos = next + 1;
+                continue;
+            }
+
+            if (have_key) {
+                if (key == "asn")
+                    asn = value;
+                else if (key == "prefix")
+                    prefix = value;
+                else if (key == "maxLength" or key == "max_length")
+                    max_len = value;
+            }
+
+            have_key = false;
+
+        } else {
+            // Arrays, literals (true, false, null), separators and white space
+            if (c == '[' or c == ',' or isalpha((unsigned char)c))
+                have_key = false;
+            ++pos;
+        }
+    }
+}
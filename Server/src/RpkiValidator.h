@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef RPKIVALIDATOR_H_
+#define RPKIVALIDATOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "MsgBusInterface.hpp"
+#include "ProcessSingleton.hpp"
+
+/**
+ * \class   RpkiValidator
+ *
+ * \brief   Process wide route origin validation (RFC 6811) against a local VRP set
+ * \details Validated ROA payloads (prefix, max length, ASN) are loaded from a file
+ *          exported by a relying party or RTR cache, either as CSV
+ *          (ASN,IP Prefix,Max Length[,...]) or as JSON with a "roas" array of
+ *          objects with "asn", "prefix" and "maxLength".
+ *
+ *          VRPs are stored in a binary trie per address family; a lookup walks
+ *          at most prefix length nodes.  A loaded trie is immutable.  Reloads
+ *          build a new trie and swap it in, so router threads validate without
+ *          locking and keep using the previous set until the swap.
+ */
+class RpkiValidator {
+public:
+    /**
+     * Get the process wide validator
+     */
+    static RpkiValidator &instance();
+
+    /**
+     * Load the VRP set from a file, replacing the current set
+     *
+     * \details The current set is kept if the file cannot be read or has no VRPs.
+     *
+     * \param [in]  filename     CSV or JSON file
+     * \param [out] skipped      Number of entries that could not be parsed
+     *
+     * \return number of VRPs loaded
+     *
+     * \throw (char const *str) message indicating the error
+     */
+    size_t load(const std::string &filename, size_t &skipped);
+
+    /**
+     * Check if the file has been modified since it was loaded
+     */
+    bool changed() const;
+
+    /**
+     * True once a VRP set has been loaded
+     */
+    bool enabled() const;
+
+    /**
+     * Set the origin validation state of advertised prefixes
+     *
+     * \param [in,out] rib          Prefixes; rpki_state is set on each entry
+     * \param [in]     origin_as    Origin ASN, zero if none (e.g. AS_SET origin)
+     */
+    void validate(MsgBusInterface::rib_vector &rib, uint32_t origin_as) const;
+
+    /**
+     * Get the origin validation state of a prefix
+     *
+     * \param [in] prefix_bin   Prefix in binary form (IPv4 in the first 4 bytes)
+     * \param [in] prefix_len   Length of prefix in bits
+     * \param [in] isIPv4       True if IPv4
+     * \param [in] origin_as    Origin ASN, zero if none
+     *
+     * \return RPKI_STATE_VALID, RPKI_STATE_INVALID or RPKI_STATE_UNKNOWN
+     */
+    MsgBusInterface::rpki_state lookup(const uint8_t *prefix_bin, uint8_t prefix_len, bool isIPv4,
+                                       uint32_t origin_as) const;
+
+private:
+    /**
+     * Validated ROA payload
+     */
+    struct vrp {
+        uint32_t    asn;                    ///< Authorized origin ASN
+        uint8_t     max_len;                ///< Maximum length of covered prefixes
+    };
+
+    /**
+     * Trie node; VRPs of the node are vrps[vrp_start, vrp_start + vrp_count)
+     */
+    struct node {
+        uint32_t    child[2];               ///< Child node index, zero if none (root is never a child)
+        uint32_t    vrp_start;
+        uint32_t    vrp_count;
+    };
+
+    /**
+     * Immutable VRP trie; node 0 is the IPv4 root and node 1 the IPv6 root
+     */
+    struct trie {
+        std::vector<node>   nodes;
+        std::vector<vrp>    vrps;
+    };
+
+    std::shared_ptr<const trie>     current;        ///< Current set, accessed with atomic_load/atomic_store
+
+    mutable std::mutex              load_mutex;     ///< Serializes loads
+    std::string                     filename;       ///< File of the current set
+    time_t                          mtime;          ///< Modification time of the file when loaded
+
+    friend class ProcessSingleton<RpkiValidator>;
+
+    RpkiValidator();
+    RpkiValidator(const RpkiValidator &);
+    RpkiValidator &operator=(const RpkiValidator &);
+
+    /**
+     * Get the origin validation state of a prefix in a trie
+     */
+    static MsgBusInterface::rpki_state find(const trie &t, const uint8_t *prefix_bin, uint8_t prefix_len,
+                                            bool isIPv4, uint32_t origin_as);
+
+    /**
+     * Parse VRPs from a CSV export
+     */
+    static void parseCsv(const std::string &data, std::vector<std::pair<std::string, vrp> > &out, size_t &skipped);
+
+    /**
+     * Parse VRPs from a JSON export
+     */
+    static void parseJson(const std::string &data, std::vector<std::pair<std::string, vrp> > &out, size_t &skipped);
+
+    /**
+     * Parse an ASN in the form "AS65000" or "65000"
+     */
+    static bool parseAsn(const std::string &value, uint32_t &asn);
+
+    /**
+     * Insert a VRP into a trie under construction
+     *
+     * \return false if the prefix or max length is invalid
+     */
+    static bool insert(trie &t, std::vector<std::pair<uint32_t, vrp> > &node_vrps,
+                       const std::string &prefix, vrp v);
+};
+
+#endif /* RPKIVALIDATOR_H_ */
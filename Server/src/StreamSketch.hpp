@@ -0,0 +1,253 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef STREAMSKETCH_HPP_
+#define STREAMSKETCH_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "FlatHashMap.hpp"
+
+#define SKETCH_DEPTH        4               // Number of count-min rows
+
+/**
+ * \class   CountMinSketch
+ *
+ * \brief   Count-min sketch of (update, withdraw) counter pairs
+ * \details Memory is fixed at SKETCH_DEPTH * width counter pairs.  Estimates
+ *          never undercount; overcount is bounded by the total count divided
+ *          by the width.  Conservative update is used to reduce overcounting.
+ *
+ *          Not thread safe.
+ */
+class CountMinSketch {
+public:
+    /**
+     * Counter pair
+     */
+    struct counts {
+        uint32_t    updates;                ///< Advertisements
+        uint32_t    withdraws;              ///< Withdraws
+    };
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] width    Number of counters per row, rounded up to a power of 2
+     */
+    explicit CountMinSketch(size_t width=1024) {
+        resize(width);
+    }
+
+    /**
+     * Change the width, clearing all counters
+     */
+    void resize(size_t width) {
+        size_t size = 64;
+        while (size < width)
+            size <<= 1;
+
+        cells.assign(size * SKETCH_DEPTH, counts());
+        mask = size - 1;
+    }
+
+    /**
+     * Add to the counters of a key
+     *
+     * \param [in] hash         64 bit hash of the key
+     * \param [in] updates      Advertisements to add
+     * \param [in] withdraws    Withdraws to add
+     *
+     * \return estimated counts of the key after the add
+     */
+    counts add(uint64_t hash, uint32_t updates, uint32_t withdraws) {
+        counts *row_cells[SKETCH_DEPTH];
+        counts est = estimate(hash, row_cells);
+
+        est.updates += updates;
+        est.withdraws += withdraws;
+
+        // Conservative update: only raise counters that are below the new estimate
+        for (int i=0; i < SKETCH_DEPTH; i++) {
+            row_cells[i]->updates = std::max(row_cells[i]->updates, est.updates);
+            row_cells[i]->withdraws = std::max(row_cells[i]->withdraws, est.withdraws);
+        }
+
+        return est;
+    }
+
+    /**
+     * Get the estimated counts of a key
+     */
+    counts estimate(uint64_t hash) {
+        counts *row_cells[SKETCH_DEPTH];
+        return estimate(hash, row_cells);
+    }
+
+    /**
+     * Reset all counters
+     */
+    void clear() {
+        memset(&cells[0], 0, cells.size() * sizeof(counts));
+    }
+
+    size_t width() const        { return mask + 1; }
+
+private:
+    std::vector<counts>     cells;          ///< SKETCH_DEPTH rows of width counters
+    size_t                  mask;           ///< width - 1
+
+    /**
+     * Locate the cells of a key and return the minimum of each counter
+     *
+     * \details Row indexes are derived from two halves of the hash
+     *          (Kirsch-Mitzenmacher double hashing).
+     */
+    counts estimate(uint64_t hash, counts **row_cells) {
+        uint32_t h1 = (uint32_t)hash;
+        uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+        counts est = { UINT32_MAX, UINT32_MAX };
+
+        for (int i=0; i < SKETCH_DEPTH; i++) {
+            row_cells[i] = &cells[i * (mask + 1) + ((h1 + i * h2) & mask)];
+
+            est.updates = std::min(est.updates, row_cells[i]->updates);
+            est.withdraws = std::min(est.withdraws, row_cells[i]->withdraws);
+        }
+
+        return est;
+    }
+};
+
+/**
+ * \class   TopK
+ *
+ * \brief   Tracks the K keys with the highest counts
+ * \details Min-heap of K entries with an index from key to heap position.  A key
+ *          not in the heap replaces the minimum if its count is higher, so
+ *          with sketch estimates as counts the heap holds the heavy hitters.
+ *
+ *          Not thread safe.
+ */
+template <typename Key>
+class TopK {
+public:
+    struct item {
+        Key         key;
+        uint64_t    count;
+
+        bool operator>(const item &other) const { return count > other.count; }
+    };
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] k    Number of keys to track
+     */
+    explicit TopK(size_t k=10) : k(k) { }
+
+    /**
+     * Change the number of keys tracked, clearing the heap
+     */
+    void resize(size_t k) {
+        this->k = k;
+        clear();
+    }
+
+    /**
+     * Offer the current count of a key
+     *
+     * \param [in] key      Key
+     * \param [in] count    Current (estimated) count of key
+     */
+    void offer(const Key &key, uint64_t count) {
+        uint32_t *pos = index.find(key);
+
+        if (pos != NULL) {
+            // Counts only grow, so the entry can only move down the min-heap
+            heap[*pos].count = count;
+            siftDown(*pos);
+
+        } else if (heap.size() < k) {
+            item it = { key, count };
+            heap.push_back(it);
+            index[key] = heap.size() - 1;
+            siftUp(heap.size() - 1);
+
+        } else if (k > 0 and count > heap[0].count) {
+            index.erase(heap[0].key);
+            heap[0].key = key;
+            heap[0].count = count;
+            index[key] = 0;
+            siftDown(0);
+        }
+    }
+
+    /**
+     * Get the tracked keys, highest count first
+     */
+    void sorted(std::vector<item> &out) const {
+        out = heap;
+        std::sort(out.begin(), out.end(), std::greater<item>());
+    }
+
+    void clear() {
+        heap.clear();
+        index.clear();
+    }
+
+    size_t size() const             { return heap.size(); }
+
+private:
+    size_t                      k;          ///< Maximum number of keys
+    std::vector<item>           heap;       ///< Min-heap by count
+    FlatHashMap<Key, uint32_t>  index;      ///< Key to heap position
+
+    void swap(size_t a, size_t b) {
+        std::swap(heap[a], heap[b]);
+        index[heap[a].key] = a;
+        index[heap[b].key] = b;
+    }
+
+    void siftUp(size_t i) {
+        while (i > 0) {
+            size_t parent = (i - 1) / 2;
+            if (heap[parent].count <= heap[i].count)
+                break;
+
+            swap(i, parent);
+            i = parent;
+        }
+    }
+
+    void siftDown(size_t i) {
+        while (true) {
+            size_t smallest = i;
+            size_t l = i * 2 + 1, r = l + 1;
+
+            if (l < heap.size() and heap[l].count < heap[smallest].count)
+                smallest = l;
+            if (r < heap.size() and heap[r].count < heap[smallest].count)
+                smallest = r;
+
+            if (smallest == i)
+                break;
+
+            swap(i, smallest);
+            i = smallest;
+        }
+    }
+};
+
+#endif /* STREAMSKETCH_HPP_ */
@@ -0,0 +1,293 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "TextFormat.h"
+
+#include <ctime>
+
+namespace textfmt {
+
+namespace {
+
+/**
+ * Lookup tables, built once at startup
+ */
+struct format_tables {
+    char        digit_pairs[200];           ///< "00" "01" ... "99"
+    char        hex_pairs[512];             ///< "00" "01" ... "ff"
+    char        octet[256][4];              ///< Decimal form of 0..255, not NULL terminated
+    u_char      octet_len[256];             ///< Length of octet[i]
+
+    format_tables() {
+        static const char hex_digits[] = "0123456789abcdef";
+
+        for (int i=0; i < 100; i++) {
+            digit_pairs[i * 2]     = '0' + i / 10;
+            digit_pairs[i * 2 + 1] = '0' + i % 10;
+        }
+
+        for (int i=0; i < 256; i++) {
+            hex_pairs[i * 2]     = hex_digits[i >> 4];
+            hex_pairs[i * 2 + 1] = hex_digits[i & 0x0F];
+
+            if (i >= 100) {
+                octet[i][0] = '0' + i / 100;
+                octet[i][1] = '0' + (i / 10) % 10;
+                octet[i][2] = '0' + i % 10;
+                octet_len[i] = 3;
+            } else if (i >= 10) {
+                octet[i][0] = '0' + i / 10;
+                octet[i][1] = '0' + i % 10;
+                octet_len[i] = 2;
+            } else {
+                octet[i][0] = '0' + i;
+                octet_len[i] = 1;
+            }
+        }
+    }
+};
+
+const format_tables tables;
+
+/**
+ * Write value in decimal right to left, ending at end.  Returns start pointer.
+ */
+inline char *write_digits_reverse(char *end, uint64_t value) {
+    while (value >= 100) {
+        unsigned idx = (unsigned)(value % 100) * 2;
+        value /= 100;
+        *--end = tables.digit_pairs[idx + 1];
+        *--end = tables.digit_pairs[idx];
+    }
+
+    if (value >= 10) {
+        unsigned idx = (unsigned)value * 2;
+        *--end = tables.digit_pairs[idx + 1];
+        *--end = tables.digit_pairs[idx];
+    } else
+        *--end = '0' + (char)value;
+
+    return end;
+}
+
+/**
+ * Write value with a fixed number of digits (zero padded)
+ */
+inline void write_fixed(char *buf, uint32_t value, int digits) {
+    for (int i = digits - 1; i >= 0; i--) {
+        buf[i] = '0' + value % 10;
+        value /= 10;
+    }
+}
+
+/**
+ * Per thread cache of the formatted date/time for the last second formatted
+ */
+struct timestamp_cache {
+    int64_t     secs;                       ///< Seconds of the cached value, -1 if none
+    char        str[20];                    ///< "YYYY-MM-DD HH:MM:SS"
+};
+
+thread_local timestamp_cache ts_cache = { -1, { 0 } };
+
+} /* anonymous namespace */
+
+/**
+ * Format unsigned 32 bit integer in decimal
+ */
+size_t u32(char *buf, uint32_t value) {
+    return u64(buf, value);
+}
+
+/**
+ * Format unsigned 64 bit integer in decimal
+ */
+size_t u64(char *buf, uint64_t value) {
+    char tmp[TEXTFMT_U64_STRLEN];
+    char *end = tmp + sizeof(tmp);
+    char *start = write_digits_reverse(end, value);
+    size_t len = end - start;
+
+    memcpy(buf, start, len);
+    buf[len] = 0;
+
+    return len;
+}
+
+/**
+ * Format signed 64 bit integer in decimal
+ */
+size_t i64(char *buf, int64_t value) {
+    if (value < 0) {
+        buf[0] = '-';
+        return 1 + u64(buf + 1, (uint64_t)0 - (uint64_t)value);
+    }
+
+    return u64(buf, (uint64_t)value);
+}
+
+/**
+ * Format IPv4 address in dotted decimal
+ */
+size_t ipv4(char *buf, const u_char *addr) {
+    char *p = buf;
+
+    for (int i=0; i < 4; i++) {
+        if (i)
+            *p++ = '.';
+
+        // Copy 4 bytes; only octet_len are kept
+        memcpy(p, tables.octet[addr[i]], 4);
+        p += tables.octet_len[addr[i]];
+    }
+
+    *p = 0;
+    return p - buf;
+}
+
+/**
+ * Format IPv6 address (RFC5952 compressed form, same as inet_ntop)
+ */
+size_t ipv6(char *buf, const u_char *addr) {
+    uint16_t    words[8];
+    int         best_base = -1, best_len = 0;
+    int         cur_base = -1, cur_len = 0;
+    char        *p = buf;
+
+    for (int i=0; i < 8; i++)
+        words[i] = (uint16_t)addr[i * 2] << 8 | addr[i * 2 + 1];
+
+    // Find the longest run of zero words
+    for (int i=0; i < 8; i++) {
+        if (words[i] == 0) {
+            if (cur_base == -1) {
+                cur_base = i;
+                cur_len = 1;
+            } else
+                cur_len++;
+        } else if (cur_base != -1) {
+            if (best_base == -1 or cur_len > best_len) {
+                best_base = cur_base;
+                best_len = cur_len;
+            }
+            cur_base = -1;
+        }
+    }
+
+    if (cur_base != -1 and (best_base == -1 or cur_len > best_len)) {
+        best_base = cur_base;
+        best_len = cur_len;
+    }
+
+    if (best_base != -1 and best_len < 2)
+        best_base = -1;
+
+    for (int i=0; i < 8; i++) {
+        // Inside the compressed run of zeros
+        if (best_base != -1 and i >= best_base and i < (best_base + best_len)) {
+            if (i == best_base)
+                *p++ = ':';
+            continue;
+        }
+
+        if (i != 0)
+            *p++ = ':';
+
+        // IPv4 compatible or mapped address
+        if (i == 6 and best_base == 0 and (best_len == 6 or (best_len == 5 and words[5] == 0xffff))) {
+            p += ipv4(p, addr + 12);
+            return p - buf;
+        }
+
+        // Hex word without leading zeros
+        uint16_t w = words[i];
+        if (w >= 0x1000) {
+            memcpy(p, tables.hex_pairs + (w >> 8) * 2, 2);
+            memcpy(p + 2, tables.hex_pairs + (w & 0xFF) * 2, 2);
+            p += 4;
+        } else if (w >= 0x100) {
+            *p++ = tables.hex_pairs[(w >> 8) * 2 + 1];
+            memcpy(p, tables.hex_pairs + (w & 0xFF) * 2, 2);
+            p += 2;
+        } else if (w >= 0x10) {
+            memcpy(p, tables.hex_pairs + w * 2, 2);
+            p += 2;
+        } else
+            *p++ = tables.hex_pairs[w * 2 + 1];
+    }
+
+    // Trailing run of zeros
+    if (best_base != -1 and (best_base + best_len) == 8)
+        *p++ = ':';
+
+    *p = 0;
+    return p - buf;
+}
+
+/**
+ * Format MAC address as xx:xx:xx:xx:xx:xx
+ */
+size_t mac(char *buf, const u_char *addr) {
+    char *p = buf;
+
+    for (int i=0; i < 6; i++) {
+        if (i)
+            *p++ = ':';
+
+        memcpy(p, tables.hex_pairs + addr[i] * 2, 2);
+        p += 2;
+    }
+
+    *p = 0;
+    return p - buf;
+}
+
+/**
+ * Format binary data as lower case hex
+ */
+size_t hex(char *buf, const u_char *data, size_t len) {
+    for (size_t i=0; i < len; i++)
+        memcpy(buf + i * 2, tables.hex_pairs + data[i] * 2, 2);
+
+    buf[len * 2] = 0;
+    return len * 2;
+}
+
+/**
+ * Format timestamp as "YYYY-MM-DD HH:MM:SS.uuuuuu" (UTC)
+ */
+size_t timestamp(char *buf, uint32_t secs, uint32_t us) {
+
+    if (ts_cache.secs != (int64_t)secs) {
+        std::time_t t = secs;
+        std::tm tm_val;
+
+        gmtime_r(&t, &tm_val);
+
+        char *p = ts_cache.str;
+        write_fixed(p, tm_val.tm_year + 1900, 4);    p += 4;     *p++ = '-';
+        write_fixed(p, tm_val.tm_mon + 1, 2);        p += 2;     *p++ = '-';
+        write_fixed(p, tm_val.tm_mday, 2);           p += 2;     *p++ = ' ';
+        write_fixed(p, tm_val.tm_hour, 2);           p += 2;     *p++ = ':';
+        write_fixed(p, tm_val.tm_min, 2);            p += 2;     *p++ = ':';
+        write_fixed(p, tm_val.tm_sec, 2);            p += 2;
+        *p = 0;
+
+        ts_cache.secs = secs;
+    }
+
+    memcpy(buf, ts_cache.str, 19);
+    buf[19] = '.';
+    write_fixed(buf + 20, us % 1000000, 6);
+    buf[26] = 0;
+
+    return 26;
+}
+
+} /* namespace textfmt */
@@ -0,0 +1,211 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef TEXTFORMAT_H_
+#define TEXTFORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <sys/types.h>
+
+/**
+ * Table driven text formatters used by the parsers and message bus serializers
+ *
+ * \details Each formatter writes into the caller's buffer, NULL terminates it and
+ *          returns the length written (excluding the NULL).  Output is identical
+ *          to the libc routines they replace (inet_ntop, "%u", "%02x", strftime).
+ *
+ *          Minimum buffer sizes are given by the *_STRLEN defines.
+ */
+namespace textfmt {
+
+#define TEXTFMT_U32_STRLEN          11      // "4294967295" + NULL
+#define TEXTFMT_U64_STRLEN          21      // "18446744073709551615" + NULL
+#define TEXTFMT_IPV4_STRLEN         16      // "255.255.255.255" + NULL
+#define TEXTFMT_IPV6_STRLEN         46      // Same as INET6_ADDRSTRLEN
+#define TEXTFMT_MAC_STRLEN          18      // "xx:xx:xx:xx:xx:xx" + NULL
+#define TEXTFMT_TIMESTAMP_STRLEN    27      // "YYYY-MM-DD HH:MM:SS.uuuuuu" + NULL
+
+    /**
+     * Format unsigned 32 bit integer in decimal
+     */
+    size_t u32(char *buf, uint32_t value);
+
+    /**
+     * Format unsigned 64 bit integer in decimal
+     */
+    size_t u64(char *buf, uint64_t value);
+
+    /**
+     * Format signed 64 bit integer in decimal
+     */
+    size_t i64(char *buf, int64_t value);
+
+    /**
+     * Format IPv4 address in dotted decimal
+     *
+     * \param [out] buf     Output buffer of at least TEXTFMT_IPV4_STRLEN
+     * \param [in]  addr    4 byte address in network order
+     */
+    size_t ipv4(char *buf, const u_char *addr);
+
+    /**
+     * Format IPv6 address (RFC5952 compressed form, same as inet_ntop)
+     *
+     * \param [out] buf     Output buffer of at least TEXTFMT_IPV6_STRLEN
+     * \param [in]  addr    16 byte address in network order
+     */
+    size_t ipv6(char *buf, const u_char *addr);
+
+    /**
+     * Format IPv4 or IPv6 address
+     */
+    inline size_t ip(char *buf, const u_char *addr, bool isIPv4) {
+        return isIPv4 ? ipv4(buf, addr) : ipv6(buf, addr);
+    }
+
+    /**
+     * Format MAC address as xx:xx:xx:xx:xx:xx
+     */
+    size_t mac(char *buf, const u_char *addr);
+
+    /**
+     * Format binary data as lower case hex
+     *
+     * \param [out] buf     Output buffer of at least 2 * len + 1
+     * \param [in]  data    Data to format
+     * \param [in]  len     Length of data in bytes
+     */
+    size_t hex(char *buf, const u_char *data, size_t len);
+
+    /**
+     * Format timestamp as "YYYY-MM-DD HH:MM:SS.uuuuuu" (UTC)
+     *
+     * \details The date/time part is cached per thread and only rebuilt when the
+     *          second changes.
+     *
+     * \param [out] buf         Output buffer of at least TEXTFMT_TIMESTAMP_STRLEN
+     * \param [in]  secs        Seconds since epoch
+     * \param [in]  us          Microseconds
+     */
+    size_t timestamp(char *buf, uint32_t secs, uint32_t us);
+
+    /**
+     * Format unsigned 32 bit integer as a std::string
+     */
+    inline std::string str_u32(uint32_t value) {
+        char buf[TEXTFMT_U32_STRLEN];
+        return std::string(buf, u32(buf, value));
+    }
+
+    /**
+     * Append formatted values to a std::string
+     */
+    inline void append_u32(std::string &str, uint32_t value) {
+        char buf[TEXTFMT_U32_STRLEN];
+        str.append(buf, u32(buf, value));
+    }
+
+    inline void append_ipv4(std::string &str, const u_char *addr) {
+        char buf[TEXTFMT_IPV4_STRLEN];
+        str.append(buf, ipv4(buf, addr));
+    }
+
+    /**
+     * \class   Writer
+     *
+     * \brief   Appends text to a fixed size buffer
+     * \details Once an append does not fit, the writer is marked as overflowed and
+     *          further appends are ignored.  The buffer is always NULL terminated.
+     */
+    class Writer {
+    public:
+        Writer(char *buf, size_t size) : buf(buf), size(size), len(0), overflowed(false) {
+            if (size > 0)
+                buf[0] = 0;
+        }
+
+        Writer &str(const char *s, size_t n) {
+            if (reserve(n)) {
+                memcpy(buf + len, s, n);
+                len += n;
+                buf[len] = 0;
+            }
+            return *this;
+        }
+
+        Writer &str(const char *s)          { return str(s, strlen(s)); }
+        Writer &str(const std::string &s)   { return str(s.data(), s.size()); }
+
+        Writer &ch(char c) {
+            if (reserve(1)) {
+                buf[len++] = c;
+                buf[len] = 0;
+            }
+            return *this;
+        }
+
+        Writer &tab()                       { return ch('\t'); }
+
+        Writer &u32(uint32_t value) {
+            char tmp[TEXTFMT_U32_STRLEN];
+            return str(tmp, textfmt::u32(tmp, value));
+        }
+
+        Writer &u64(uint64_t value) {
+            char tmp[TEXTFMT_U64_STRLEN];
+            return str(tmp, textfmt::u64(tmp, value));
+        }
+
+        Writer &i64(int64_t value) {
+            char tmp[TEXTFMT_U64_STRLEN + 1];
+            return str(tmp, textfmt::i64(tmp, value));
+        }
+
+        Writer &hex(const u_char *data, size_t n) {
+            if (reserve(n * 2))
+                len += textfmt::hex(buf + len, data, n);
+            return *this;
+        }
+
+        /**
+         * Rewind to a previous length (e.g. to drop a partially written row)
+         */
+        void truncate(size_t new_len) {
+            if (new_len < len) {
+                len = new_len;
+                buf[len] = 0;
+            }
+            overflowed = false;
+        }
+
+        size_t length() const       { return len; }
+        bool overflow() const       { return overflowed; }
+        const char *c_str() const   { return buf; }
+
+    private:
+        char        *buf;           ///< Output buffer
+        size_t      size;           ///< Size of the output buffer
+        size_t      len;            ///< Length written, excluding the NULL
+        bool        overflowed;     ///< True if an append did not fit
+
+        bool reserve(size_t n) {
+            if (overflowed or len + n + 1 > size) {
+                overflowed = true;
+                return false;
+            }
+            return true;
+        }
+    };
+
+} /* namespace textfmt */
+
+#endif /* TEXTFORMAT_H_ */
@@ -0,0 +1,301 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "UpdateCoalescer.h"
+
+#include <chrono>
+#include <cstring>
+
+/**
+ * Constructor for class
+ *
+ * \param [in] window_ms    Coalescing window in milliseconds, zero to disable
+ */
+UpdateCoalescer::UpdateCoalescer(uint32_t window_ms) : window_ms(window_ms) {
+    memset(&stats, 0, sizeof(stats));
+}
+
+/**
+ * Current monotonic time in milliseconds
+ */
+uint64_t UpdateCoalescer::now() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Build the pending key of a prefix
+ */
+void UpdateCoalescer::makeKey(const MsgBusInterface::obj_rib &rib, pending_key_t &key) {
+    memcpy(key.data, rib.peer_hash_id, 16);
+    memcpy(key.data + 16, rib.prefix_bin, 16);
+    key.data[32] = rib.prefix_len;
+    key.data[33] = rib.isIPv4;
+    memcpy(key.data + 34, &rib.path_id, 4);
+}
+
+/**
+ * Get the index of the peer, updating the stored copy
+ */
+uint32_t UpdateCoalescer::peerIndex(const MsgBusInterface::obj_bgp_peer &peer) {
+    BinaryKey<16> key(peer.hash_id);
+    uint32_t *idx = peer_index.find(key);
+
+    if (idx != NULL) {
+        peers[*idx] = peer;
+        return *idx;
+    }
+
+    peers.push_back(peer);
+    peer_index[key] = peers.size() - 1;
+
+    return peers.size() - 1;
+}
+
+/**
+ * Add advertised prefixes
+ */
+void UpdateCoalescer::advertise(MsgBusInterface *mbus_ptr, const MsgBusInterface::obj_bgp_peer &peer,
+                                const MsgBusInterface::rib_vector &rib, const PathAttrTable::ref &attr) {
+    uint32_t peer_idx = peerIndex(peer);
+    uint64_t now_ms = now();
+
+    for (size_t i = 0; i < rib.size(); i++)
+        add(mbus_ptr, peer_idx, rib[i], &attr, now_ms);
+}
+
+/**
+ * Add withdrawn prefixes
+ */
+void UpdateCoalescer::withdraw(MsgBusInterface *mbus_ptr, const MsgBusInterface::obj_bgp_peer &peer,
+                               const MsgBusInterface::rib_vector &rib) {
+    uint32_t peer_idx = peerIndex(peer);
+    uint64_t now_ms = now();
+
+    for (size_t i = 0; i < rib.size(); i++)
+        add(mbus_ptr, peer_idx, rib[i], NULL, now_ms);
+}
+
+/**
+ * Add or replace the pending state of a prefix
+ */
+void UpdateCoalescer::add(MsgBusInterface *mbus_ptr, uint32_t peer_idx, const MsgBusInterface::obj_rib &rib,
+                          const PathAttrTable::ref *attr, uint64_t now_ms) {
+    const MsgBusInterface::obj_bgp_peer &peer = peers[peer_idx];
+    pending_key_t key;
+
+    makeKey(rib, key);
+
+    ++stats.received;
+
+    uint32_t *existing = index.find(key);
+    uint32_t slot;
+
+    if (existing != NULL) {
+        // Replace the pending state; the window stays as opened by the first change
+        slot = *existing;
+
+        ++stats.coalesced;
+        if (entries[slot].advertised != (attr != NULL))
+            ++stats.flaps;
+
+    } else {
+        // Bound memory by publishing the oldest windows early
+        if (order.size() >= UPDATE_COALESCE_MAX_PENDING)
+            publish(mbus_ptr, order.size() - UPDATE_COALESCE_MAX_PENDING + 1, UINT64_MAX);
+
+        if (not free_slots.empty()) {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        } else {
+            slot = entries.size();
+            entries.resize(entries.size() + 1);
+        }
+
+        entries[slot].peer_idx = peer_idx;
+        entries[slot].expires = now_ms + window_ms;
+
+        index[key] = slot;
+        order.push_back(slot);
+    }
+
+    pending &p = entries[slot];
+
+    p.rib = rib;
+    p.advertised = attr != NULL;
+    if (attr != NULL)
+        p.attr = *attr;
+    else
+        p.attr.reset();
+
+    p.ts_secs = peer.timestamp_secs;
+    p.ts_us = peer.timestamp_us;
+}
+
+/**
+ * Send a batch of prefixes that share peer, action, attributes and timestamp
+ */
+void UpdateCoalescer::send(MsgBusInterface *mbus_ptr, const pending &first, MsgBusInterface::rib_vector &rib_list) {
+    MsgBusInterface::obj_bgp_peer peer = peers[first.peer_idx];
+
+    peer.timestamp_secs = first.ts_secs;
+    peer.timestamp_us = first.ts_us;
+
+    stats.published += rib_list.size();
+
+    if (first.advertised) {
+        MsgBusInterface::obj_path_attr attr = first.attr->attr;
+
+        memcpy(attr.hash_id, first.rib.path_attr_hash_id, sizeof(attr.hash_id));
+        attr.attr_md5 = &first.attr->attr_md5;
+
+        mbus_ptr->update_unicastPrefix(peer, rib_list, &attr, mbus_ptr->UNICAST_PREFIX_ACTION_ADD);
+
+    } else
+        mbus_ptr->update_unicastPrefix(peer, rib_list, NULL, mbus_ptr->UNICAST_PREFIX_ACTION_DEL);
+
+    rib_list.clear();
+}
+
+/**
+ * Publish pending entries from the front of order
+ *
+ * \param [in] mbus_ptr     Message bus
+ * \param [in] count        Maximum number of entries to publish
+ * \param [in] now_ms       Entries whose window closes after now_ms are left pending
+ */
+void UpdateCoalescer::publish(MsgBusInterface *mbus_ptr, size_t count, uint64_t now_ms) {
+    std::vector<uint32_t> slots;
+
+    while (count > 0 and not order.empty()) {
+        if (entries[order.front()].expires > now_ms)
+            break;
+
+        slots.push_back(order.front());
+        order.pop_front();
+        --count;
+    }
+
+    publishSlots(mbus_ptr, slots);
+}
+
+/**
+ * Publish and free pending slots, which are already removed from order
+ *
+ * \param [in] mbus_ptr     Message bus
+ * \param [in] slots        Slots in publish order
+ */
+void UpdateCoalescer::publishSlots(MsgBusInterface *mbus_ptr, const std::vector<uint32_t> &slots) {
+    MsgBusInterface::rib_vector     rib_list;
+    std::vector<uint32_t>           batch;          // Slots in rib_list, freed once sent
+    uint64_t                        cur_ms = now();
+
+    for (size_t n = 0; n < slots.size(); n++) {
+        uint32_t slot = slots[n];
+        pending &p = entries[slot];
+
+        // Consecutive entries usually come from the same update and are sent together
+        if (not batch.empty()) {
+            const pending &first = entries[batch.front()];
+
+            if (first.peer_idx != p.peer_idx or first.advertised != p.advertised
+                    or first.attr.get() != p.attr.get() or first.ts_secs != p.ts_secs
+                    or first.ts_us != p.ts_us) {
+                send(mbus_ptr, first, rib_list);
+
+                for (size_t i = 0; i < batch.size(); i++) {
+                    entries[batch[i]].attr.reset();
+                    free_slots.push_back(batch[i]);
+                }
+                batch.clear();
+            }
+        }
+
+        if (p.expires > cur_ms)
+            ++stats.forced;
+
+        pending_key_t key;
+        makeKey(p.rib, key);
+        index.erase(key);
+
+        rib_list.push_back(p.rib);
+        batch.push_back(slot);
+    }
+
+    if (not batch.empty()) {
+        send(mbus_ptr, entries[batch.front()], rib_list);
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            entries[batch[i]].attr.reset();
+            free_slots.push_back(batch[i]);
+        }
+    }
+}
+
+/**
+ * Publish pending prefixes whose window has closed
+ */
+void UpdateCoalescer::flushExpired(MsgBusInterface *mbus_ptr) {
+    if (not order.empty())
+        publish(mbus_ptr, order.size(), now());
+}
+
+/**
+ * Publish all pending prefixes
+ */
+void UpdateCoalescer::flushAll(MsgBusInterface *mbus_ptr) {
+    if (not order.empty())
+        publish(mbus_ptr, order.size(), UINT64_MAX);
+
+    // Nothing references the stored peers anymore
+    peers.clear();
+    peer_index.clear();
+}
+
+/**
+ * Publish the pending prefixes of a peer
+ */
+void UpdateCoalescer::flushPeer(MsgBusInterface *mbus_ptr, const u_char *peer_hash) {
+    uint32_t *peer_idx = peer_index.find(BinaryKey<16>(peer_hash));
+
+    if (peer_idx == NULL or order.empty())
+        return;
+
+    // Other peers keep their place in order; the stored peer stays for reuse on peer up
+    std::deque<uint32_t>    keep;
+    std::vector<uint32_t>   slots;
+
+    for (size_t i = 0; i < order.size(); i++) {
+        if (entries[order[i]].peer_idx == *peer_idx)
+            slots.push_back(order[i]);
+        else
+            keep.push_back(order[i]);
+    }
+
+    if (slots.empty())
+        return;
+
+    order.swap(keep);
+    publishSlots(mbus_ptr, slots);
+}
+
+/**
+ * Milliseconds until the oldest pending window closes
+ *
+ * \return milliseconds, or -1 if nothing is pending
+ */
+int UpdateCoalescer::msUntilExpiry() const {
+    if (order.empty())
+        return -1;
+
+    uint64_t expires = entries[order.front()].expires;
+    uint64_t now_ms = now();
+
+    return expires > now_ms ? (int)(expires - now_ms) : 0;
+}
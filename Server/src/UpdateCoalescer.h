@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef UPDATECOALESCER_H_
+#define UPDATECOALESCER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "MsgBusInterface.hpp"
+#include "PathAttrTable.h"
+#include "FlatHashMap.hpp"
+
+#define UPDATE_COALESCE_MAX_PENDING     1000000     // Oldest entries are published early above this count
+
+/**
+ * \class   UpdateCoalescer
+ *
+ * \brief   Per prefix coalescing window for unicast prefix updates
+ * \details Oscillating routes and path hunting during convergence advertise and
+ *          withdraw the same prefix several times within a short period.  When
+ *          a window is configured, the first change of a prefix opens a window;
+ *          later changes within the window replace the pending state and only
+ *          the final state is published when the window closes.
+ *
+ *          Prefixes are keyed by peer hash, AFI, prefix, length and path id.
+ *          Pending states are published in the order their windows were opened.
+ *          Advertised attributes are held as references into the shared
+ *          PathAttrTable.
+ *
+ *          Not thread safe.  Each BMP reader owns one coalescer.
+ */
+class UpdateCoalescer {
+public:
+    /**
+     * Coalescing counters
+     */
+    struct counters {
+        uint64_t    received;               ///< Prefix updates received
+        uint64_t    coalesced;              ///< Prefix updates replaced by a later update within the window
+        uint64_t    flaps;                  ///< Coalesced updates that reversed advertise/withdraw
+        uint64_t    published;              ///< Prefix updates published
+        uint64_t    forced;                 ///< Prefix updates published before their window closed
+    };
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] window_ms    Coalescing window in milliseconds, zero to disable
+     */
+    explicit UpdateCoalescer(uint32_t window_ms);
+
+    /**
+     * Add advertised prefixes
+     *
+     * \param [in] mbus_ptr     Message bus, used if pending entries must be published early
+     * \param [in] peer         Peer of the prefixes
+     * \param [in] rib          Advertised prefixes
+     * \param [in] attr         Shared path attributes of the prefixes
+     */
+    void advertise(MsgBusInterface *mbus_ptr, const MsgBusInterface::obj_bgp_peer &peer,
+                   const MsgBusInterface::rib_vector &rib, const PathAttrTable::ref &attr);
+
+    /**
+     * Add withdrawn prefixes
+     *
+     * \param [in] mbus_ptr     Message bus, used if pending entries must be published early
+     * \param [in] peer         Peer of the prefixes
+     * \param [in] rib          Withdrawn prefixes
+     */
+    void withdraw(MsgBusInterface *mbus_ptr, const MsgBusInterface::obj_bgp_peer &peer,
+                  const MsgBusInterface::rib_vector &rib);
+
+    /**
+     * Publish pending prefixes whose window has closed
+     *
+     * \param [in] mbus_ptr     Message bus
+     */
+    void flushExpired(MsgBusInterface *mbus_ptr);
+
+    /**
+     * Publish all pending prefixes
+     *
+     * \details Used before router termination so that the final prefix states
+     *          are published before the session state change.
+     *
+     * \param [in] mbus_ptr     Message bus
+     */
+    void flushAll(MsgBusInterface *mbus_ptr);
+
+    /**
+     * Publish the pending prefixes of a peer
+     *
+     * \details Used before peer down so that the final prefix states of the peer
+     *          are published before the peer down.  Pending prefixes of other
+     *          peers keep their windows.
+     *
+     * \param [in] mbus_ptr     Message bus
+     * \param [in] peer_hash    Hash ID of the peer
+     */
+    void flushPeer(MsgBusInterface *mbus_ptr, const u_char *peer_hash);
+
+    /**
+     * Milliseconds until the oldest pending window closes
+     *
+     * \return milliseconds, or -1 if nothing is pending
+     */
+    int msUntilExpiry() const;
+
+    bool enabled() const                    { return window_ms > 0; }
+    size_t size() const                     { return order.size(); }
+    const counters &getCounters() const     { return stats; }
+
+private:
+    /**
+     * Pending key: peer hash (16), prefix (16), length (1), AFI (1) and path id (4)
+     */
+    typedef BinaryKey<38> pending_key_t;
+
+    struct pending {
+        MsgBusInterface::obj_rib    rib;            ///< Latest state of the prefix
+        PathAttrTable::ref          attr;           ///< Attributes if advertised, empty if withdrawn
+        bool                        advertised;     ///< True if the latest state is advertised
+        uint32_t                    peer_idx;       ///< Index in peers
+        uint32_t                    ts_secs;        ///< Timestamp of the latest update
+        uint32_t                    ts_us;
+        uint64_t                    expires;        ///< Time the window closes (ms, monotonic)
+    };
+
+    uint32_t                                    window_ms;      ///< Coalescing window
+    counters                                    stats;          ///< Counters
+
+    std::vector<pending>                        entries;        ///< Pending entry slots
+    std::vector<uint32_t>                       free_slots;     ///< Unused entry slots
+    std::deque<uint32_t>                        order;          ///< Pending slots, oldest window first
+    FlatHashMap<pending_key_t, uint32_t>        index;          ///< Prefix to pending slot
+
+    std::vector<MsgBusInterface::obj_bgp_peer>  peers;          ///< Peers of pending entries
+    FlatHashMap<BinaryKey<16>, uint32_t>        peer_index;     ///< Peer hash to index in peers
+
+    /**
+     * Current monotonic time in milliseconds
+     */
+    static uint64_t now();
+
+    /**
+     * Build the pending key of a prefix
+     */
+    static void makeKey(const MsgBusInterface::obj_rib &rib, pending_key_t &key);
+
+    /**
+     * Add or replace the pending state of a prefix
+     */
+    void add(MsgBusInterface *mbus_ptr, uint32_t peer_idx, const MsgBusInterface::obj_rib &rib,
+             const PathAttrTable::ref *attr, uint64_t now_ms);
+
+    /**
+     * Get the index of the peer, updating the stored copy
+     */
+    uint32_t peerIndex(const MsgBusInterface::obj_bgp_peer &peer);
+
+    /**
+     * Publish pending entries from the front of order
+     *
+     * \param [in] mbus_ptr     Message bus
+     * \param [in] count        Maximum number of entries to publish
+     * \param [in] now_ms       Entries whose window closes after now_ms are left pending
+     */
+    void publish(MsgBusInterface *mbus_ptr, size_t count, uint64_t now_ms);
+
+    /**
+     * Publish and free pending slots, which are already removed from order
+     *
+     * \param [in] mbus_ptr     Message bus
+     * \param [in] slots        Slots in publish order
+     */
+    void publishSlots(MsgBusInterface *mbus_ptr, const std::vector<uint32_t> &slots);
+
+    /**
+     * Send a batch of prefixes that share peer, action, attributes and timestamp
+     */
+    void send(MsgBusInterface *mbus_ptr, const pending &first, MsgBusInterface::rib_vector &rib_list);
+};
+
+#endif /* UPDATECOALESCER_H_ */
@@ -0,0 +1,174 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "AttrInternCache.h"
+
+namespace bgp_msg {
+
+/**
+ * Constructor for class
+ *
+ * \param [in] max_bytes    Maximum memory in bytes used by cached entries
+ */
+AttrInternCache::AttrInternCache(size_t max_bytes) : max_bytes(max_bytes) {
+    used_bytes = 0;
+    clock_hand = 0;
+    hit_count = 0;
+    miss_count = 0;
+}
+
+/**
+ * Hash the attribute key
+ */
+uint64_t AttrInternCache::hashKey(uint8_t attr_type, uint8_t asn_octets, const u_char *data, uint16_t len) {
+    uint64_t h = BinaryKeyHash<8>::mix(0x9E3779B97F4A7C15ULL ^ ((uint64_t)attr_type << 56)
+                                       ^ ((uint64_t)asn_octets << 48) ^ len);
+    uint64_t w;
+    size_t i = 0;
+
+    for (; i + sizeof(w) <= len; i += sizeof(w)) {
+        memcpy(&w, data + i, sizeof(w));
+        h = BinaryKeyHash<8>::mix(h ^ w);
+    }
+
+    if (i < len) {
+        w = 0;
+        memcpy(&w, data + i, len - i);
+        h = BinaryKeyHash<8>::mix(h ^ w);
+    }
+
+    return h;
+}
+
+/**
+ * Lookup an attribute
+ */
+AttrInternCache::value_ptr AttrInternCache::find(uint8_t attr_type, uint8_t asn_octets,
+                                                 const u_char *data, uint16_t len) {
+    uint64_t hash = hashKey(attr_type, asn_octets, data, len);
+    uint32_t *slot = index.find(BinaryKey<8>((const u_char *)&hash));
+
+    if (slot != NULL) {
+        entry &e = entries[*slot];
+
+        if (e.attr_type == attr_type and e.asn_octets == asn_octets and e.key.size() == len
+                and memcmp(e.key.data(), data, len) == 0) {
+            e.referenced = true;
+            ++hit_count;
+            return e.value;
+        }
+    }
+
+    ++miss_count;
+    return value_ptr();
+}
+
+/**
+ * Add an attribute
+ */
+void AttrInternCache::insert(uint8_t attr_type, uint8_t asn_octets, const u_char *data, uint16_t len,
+                             const interned_attr &value) {
+    if (len > ATTR_INTERN_MAX_ATTR_LEN)
+        return;
+
+    uint64_t hash = hashKey(attr_type, asn_octets, data, len);
+    BinaryKey<8> hash_key((const u_char *)&hash);
+
+    // Replace an existing entry with the same hash (update or hash collision)
+    uint32_t *existing = index.find(hash_key);
+    if (existing != NULL)
+        evict(*existing);
+
+    if (not makeRoom(ATTR_INTERN_ENTRY_OVERHEAD + len + value.value.size()))
+        return;
+
+    uint32_t slot;
+    if (not free_slots.empty()) {
+        slot = free_slots.back();
+        free_slots.pop_back();
+    } else {
+        slot = entries.size();
+        entries.resize(entries.size() + 1);
+    }
+
+    entry &e = entries[slot];
+    e.hash = hash;
+    e.attr_type = attr_type;
+    e.asn_octets = asn_octets;
+    e.used = true;
+    e.referenced = false;
+    e.key.assign((const char *)data, len);
+    e.value = std::make_shared<interned_attr>(value);
+
+    used_bytes += entryBytes(e);
+    index[hash_key] = slot;
+}
+
+/**
+ * Remove entry in slot
+ */
+void AttrInternCache::evict(uint32_t slot) {
+    entry &e = entries[slot];
+
+    if (not e.used)
+        return;
+
+    used_bytes -= entryBytes(e);
+    index.erase(BinaryKey<8>((const u_char *)&e.hash));
+
+    e.used = false;
+    e.referenced = false;
+    std::string().swap(e.key);
+    e.value.reset();
+
+    free_slots.push_back(slot);
+}
+
+/**
+ * Evict entries until needed bytes fit within max_bytes
+ */
+bool AttrInternCache::makeRoom(size_t needed) {
+    if (needed > max_bytes)
+        return false;
+
+    /*
+     * CLOCK: referenced entries get a second chance; at most two passes
+     *      over the slots are needed to find a victim.
+     */
+    while (used_bytes + needed > max_bytes and not index.empty()) {
+        if (clock_hand >= entries.size())
+            clock_hand = 0;
+
+        entry &e = entries[clock_hand];
+
+        if (e.used) {
+            if (e.referenced)
+                e.referenced = false;
+            else
+                evict(clock_hand);
+        }
+
+        ++clock_hand;
+    }
+
+    return true;
+}
+
+/**
+ * Remove all entries
+ */
+void AttrInternCache::clear() {
+    entries.clear();
+    free_slots.clear();
+    index.clear();
+    used_bytes = 0;
+    clock_hand = 0;
+}
+
+} /* namespace bgp_msg */
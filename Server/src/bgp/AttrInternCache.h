@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef ATTRINTERNCACHE_H_
+#define ATTRINTERNCACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+#include "FlatHashMap.hpp"
+
+#define ATTR_INTERN_CACHE_SIZE      (8 * 1024 * 1024)   // Default cache size in bytes
+#define ATTR_INTERN_MAX_ATTR_LEN    4096                // Larger attributes are not cached
+#define ATTR_INTERN_ENTRY_OVERHEAD  128                 // Bytes charged per entry in addition to key/value
+
+namespace bgp_msg {
+
+/**
+ * \class   AttrInternCache
+ *
+ * \brief   Bounded cache of formatted path attribute strings
+ * \details Communities, extended/large communities, cluster lists and AS paths
+ *          repeat heavily across updates and peers.  The cache is keyed on the
+ *          attribute type, ASN width and raw attribute bytes and returns the
+ *          previously formatted value, so a repeated attribute costs one hash
+ *          and compare instead of a decode.
+ *
+ *          Memory is bounded by max_bytes; entries are evicted using the CLOCK
+ *          (second chance) algorithm.  Values are immutable and shared, so a
+ *          value obtained by find() stays valid after it is evicted.
+ *
+ *          Not thread safe.  Each BMP reader owns one cache.
+ */
+class AttrInternCache {
+public:
+    /**
+     * Interned attribute value
+     */
+    struct interned_attr {
+        std::string value;                  ///< Formatted attribute
+        uint16_t    as_path_count;          ///< AS_PATH only: count of ASNs in the path
+        uint32_t    origin_as;              ///< AS_PATH only: origin ASN
+        uint32_t    neighbor_as;            ///< AS_PATH only: neighbor ASN
+
+        interned_attr() : as_path_count(0), origin_as(0), neighbor_as(0) { }
+    };
+
+    typedef std::shared_ptr<const interned_attr> value_ptr;
+
+    /**
+     * Constructor for class
+     *
+     * \param [in] max_bytes    Maximum memory in bytes used by cached entries
+     */
+    explicit AttrInternCache(size_t max_bytes=ATTR_INTERN_CACHE_SIZE);
+
+    /**
+     * Lookup an attribute
+     *
+     * \param [in] attr_type    Attribute type
+     * \param [in] asn_octets   ASN width used to decode (2 or 4), zero if not relevant
+     * \param [in] data         Raw attribute data
+     * \param [in] len          Length of data
+     *
+     * \return value or empty pointer if not cached
+     */
+    value_ptr find(uint8_t attr_type, uint8_t asn_octets, const u_char *data, uint16_t len);
+
+    /**
+     * Add an attribute
+     *
+     * \details Attributes larger than ATTR_INTERN_MAX_ATTR_LEN are not added.
+     *
+     * \param [in] attr_type    Attribute type
+     * \param [in] asn_octets   ASN width used to decode (2 or 4), zero if not relevant
+     * \param [in] data         Raw attribute data
+     * \param [in] len          Length of data
+     * \param [in] value        Formatted value
+     */
+    void insert(uint8_t attr_type, uint8_t asn_octets, const u_char *data, uint16_t len,
+                const interned_attr &value);
+
+    /**
+     * Remove all entries
+     */
+    void clear();
+
+    size_t size() const             { return index.size(); }
+    size_t bytes() const            { return used_bytes; }
+    uint64_t hits() const           { return hit_count; }
+    uint64_t misses() const         { return miss_count; }
+
+private:
+    /**
+     * Identity hash, the key already is a 64bit hash of the attribute
+     */
+    struct HashKeyHash {
+        size_t operator()(const BinaryKey<8> &key) const {
+            uint64_t h;
+            memcpy(&h, key.data, sizeof(h));
+            return (size_t)h;
+        }
+    };
+
+    struct entry {
+        uint64_t        hash;               ///< Hash of type, asn width and data
+        uint8_t         attr_type;          ///< Attribute type
+        uint8_t         asn_octets;         ///< ASN width
+        bool            used;               ///< True if the entry holds a value
+        bool            referenced;         ///< CLOCK reference bit, set on hit
+        std::string     key;                ///< Raw attribute data
+        value_ptr       value;              ///< Interned value
+
+        entry() : hash(0), attr_type(0), asn_octets(0), used(false), referenced(false) { }
+    };
+
+    std::vector<entry>                                  entries;    ///< Entry slots
+    std::vector<uint32_t>                               free_slots; ///< Unused entry slots
+    FlatHashMap<BinaryKey<8>, uint32_t, HashKeyHash>    index;      ///< Hash to entry slot
+
+    size_t      max_bytes;                  ///< Memory limit
+    size_t      used_bytes;                 ///< Memory charged to current entries
+    size_t      clock_hand;                 ///< Next slot to check for eviction
+    uint64_t    hit_count;                  ///< Number of find() hits
+    uint64_t    miss_count;                 ///< Number of find() misses
+
+    /**
+     * Hash the attribute key
+     */
+    static uint64_t hashKey(uint8_t attr_type, uint8_t asn_octets, const u_char *data, uint16_t len);
+
+    /**
+     * Bytes charged for an entry
+     */
+    static size_t entryBytes(const entry &e) {
+        return ATTR_INTERN_ENTRY_OVERHEAD + e.key.size() + (e.value ? e.value->value.size() : 0);
+    }
+
+    /**
+     * Remove entry in slot
+     */
+    void evict(uint32_t slot);
+
+    /**
+     * Evict entries until needed bytes fit within max_bytes
+     *
+     * \return false if the entry can never fit
+     */
+    bool makeRoom(size_t needed);
+};
+
+} /* namespace bgp_msg */
+
+#endif /* ATTRINTERNCACHE_H_ */
@@ -355,7 +355,7 @@ namespace bgp_msg {
                         data_pointer++;
 
                         // MAC Address (6 byte)
-                        tuple.mac.assign(bgp::parse_mac(data_pointer));
+                        tuple.mac.assign(bgp::parse_mac(data_pointer).c_str());
                         data_pointer += 6;
 
                         // IP Address Length (1 byte)
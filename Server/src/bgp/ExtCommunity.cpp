@@ -12,9 +12,11 @@
 #include <sstream>
 #include <iostream>
 #include <arpa/inet.h>
+#include <cstdio>
 
 #include "UpdateMsg.h"
 #include "ExtCommunity.h"
+#include "TextFormat.h"
 
 namespace bgp_msg {
     /**
@@ -134,10 +136,14 @@ namespace bgp_msg {
      * \return  Decoded string value
      */
     std::string ExtCommunity::decodeType_common(const extcomm_hdr &ec_hdr, bool isGlobal4Bytes, bool isGlobalIPv4) {
-        std::stringstream   val_ss;
+        std::string         decodeStr;
         uint16_t            val_16b;
         uint32_t            val_32b;
-        char                ipv4_char[16] = {0};
+        char                ipv4_char[TEXTFMT_IPV4_STRLEN] = {0};
+        const char          *name = NULL;
+        bool                globalIPv4 = isGlobalIPv4;      // Print global field as IPv4 for this subtype
+        bool                global4Bytes = isGlobal4Bytes;  // Print global field as 4 bytes for this subtype
+        bool                hexLocal = false;               // Print local field in hex
 
         /*
          * Decode values based on bit size
@@ -150,7 +156,7 @@ namespace bgp_msg {
             bgp::SWAP_BYTES(&val_16b);
 
             if (isGlobalIPv4) {
-                inet_ntop(AF_INET, &val_32b, ipv4_char, sizeof(ipv4_char));
+                textfmt::ipv4(ipv4_char, (const u_char *)&val_32b);
             } else
                 bgp::SWAP_BYTES(&val_32b);
 
@@ -170,124 +176,79 @@ namespace bgp_msg {
         switch (ec_hdr.low_type) {
 
             case EXT_COMMON_BGP_DATA_COL :
-                if (isGlobal4Bytes)
-                    val_ss << "colc=" << val_32b << ":" << val_16b;
-
-                else
-                    val_ss << "colc=" << val_16b << ":" << val_32b;
-
+                name = "colc=";
+                globalIPv4 = false;
                 break;
 
             case EXT_COMMON_ROUTE_ORIGIN :
-                if (isGlobalIPv4)
-                    val_ss << "soo=" << ipv4_char << ":" << val_16b;
-
-                else if (isGlobal4Bytes)
-                    val_ss << "soo=" << val_32b << ":" << val_16b;
-
-                else
-                    val_ss << "soo=" << val_16b << ":" << val_32b;
+                name = "soo=";
                 break;
 
             case EXT_COMMON_ROUTE_TARGET :
-                if (isGlobalIPv4)
-                    val_ss << "rt=" << ipv4_char << ":" << val_16b;
-
-                else if (isGlobal4Bytes)
-                    val_ss << "rt=" << val_32b << ":" << val_16b;
-
-                else
-                    val_ss << "rt=" << val_16b << ":" << val_32b;
+                name = "rt=";
                 break;
 
             case EXT_COMMON_SOURCE_AS :
-                if (isGlobal4Bytes)
-                    val_ss << "sas=" << val_32b << ":" << val_16b;
-
-                else
-                    val_ss << "sas=" << val_16b << ":" << val_32b;
-
+                name = "sas=";
+                globalIPv4 = false;
                 break;
 
             case EXT_COMMON_CISCO_VPN_ID :
-                if (isGlobalIPv4)
-                    val_ss << "vpn-id=" << ipv4_char << ":0x" << std::hex << val_16b;
-
-                else if (isGlobal4Bytes)
-                    val_ss << "vpn-id=" << val_32b << ":0x" << std::hex << val_16b;
-
-                else
-                    val_ss << "vpn-id=" << val_16b << ":0x" << std::hex << val_32b;
-
-                break;
-
             case EXT_COMMON_L2VPN_ID :
-                if (isGlobalIPv4)
-                    val_ss << "vpn-id=" << ipv4_char << ":0x" << std::hex << val_16b;
-
-                else if (isGlobal4Bytes)
-                    val_ss << "vpn-id=" << val_32b << ":0x" << std::hex << val_16b;
-
-                else
-                    val_ss << "vpn-id=" << val_16b << ":0x" << std::hex << val_32b;
-
+                name = "vpn-id=";
+                hexLocal = true;
                 break;
 
             case EXT_COMMON_LINK_BANDWIDTH : // is same as EXT_COMMON_GENERIC
-                if (isGlobal4Bytes)
-                    val_ss << "link-bw=" << val_32b << ":" << val_16b;
-
-                else
-                    val_ss << "link-bw=" << val_16b << ":" << val_32b;
-
+                name = "link-bw=";
+                globalIPv4 = false;
                 break;
 
             case EXT_COMMON_OSPF_DOM_ID :
-                if (isGlobalIPv4)
-                    val_ss << "ospf-did=" << ipv4_char << ":" << val_16b;
-                else if (isGlobal4Bytes)
-                    val_ss << "ospf-did=" << val_32b << ":" << val_16b;
-                else
-                    val_ss << "ospf-did=" << val_16b << ":" << val_32b;
+                name = "ospf-did=";
                 break;
 
             case EXT_COMMON_VRF_IMPORT :
-                if (isGlobalIPv4)
-                    val_ss << "import=" << ipv4_char << ":" << val_16b;
-
-                else if (isGlobalIPv4)
-                    val_ss << "import=" << val_32b << ":" << val_16b;
-
-                else
-                    val_ss << "import=" << val_16b << ":" << val_32b;
-
-                break;
-
             case EXT_COMMON_IA_P2MP_SEG_NH :
-                if (isGlobalIPv4)
-                    val_ss << "p2mp-nh=" << ipv4_char << ":" << val_16b;
-
-                else
-                    val_ss << "p2mp-nh=" << val_16b << ":" << val_32b;
-
+                name = ec_hdr.low_type == EXT_COMMON_VRF_IMPORT ? "import=" : "p2mp-nh=";
+                global4Bytes = false;
                 break;
 
             case EXT_COMMON_OSPF_ROUTER_ID :
-                if (isGlobalIPv4)
-                    val_ss << "ospf-rid=" << ipv4_char << ":" << val_16b;
-                else if (isGlobal4Bytes)
-                    val_ss << "ospf-rid=" << val_32b << ":" << val_16b;
-                else
-                    val_ss << "ospf-rid=" << val_16b << ":" << val_32b;
+                name = "ospf-rid=";
                 break;
 
             default :
                 LOG_INFO("%s: Extended community common type %d subtype = %d is not yet supported", peer_addr.c_str(),
                         ec_hdr.high_type, ec_hdr.low_type);
-                break;
+                return decodeStr;
         }
 
-        return val_ss.str();
+        /*
+         * Print as name=<global>:<local>
+         */
+        decodeStr.append(name);
+
+        if (globalIPv4)
+            decodeStr.append(ipv4_char);
+        else if (global4Bytes)
+            textfmt::append_u32(decodeStr, val_32b);
+        else
+            textfmt::append_u32(decodeStr, val_16b);
+
+        uint32_t local = (globalIPv4 or global4Bytes) ? val_16b : val_32b;
+
+        if (hexLocal) {
+            char hex_char[16];
+            snprintf(hex_char, sizeof(hex_char), ":0x%x", local);
+            decodeStr.append(hex_char);
+
+        } else {
+            decodeStr.push_back(':');
+            textfmt::append_u32(decodeStr, local);
+        }
+
+        return decodeStr;
     }
 
     /**
@@ -155,19 +155,24 @@ void MPUnReachAttr::parseAfi_IPv4IPv6(bool isIPv4, mp_unreach_nlri &nlri, Update
         case bgp::BGP_SAFI_UNICAST: // Unicast IP address prefix
 
             // Data is an IP address - parse the address and save it
-            MPReachAttr::parseNlriData_IPv4IPv6(isIPv4, nlri.nlri_data, nlri.nlri_len, peer_info,
-                                                parsed_data.withdrawn);
+            if (not peer_info->decoders.unicast[UpdateDecoders::afiIndex(isIPv4)](nlri.nlri_data, nlri.nlri_len,
+                                                                                 parsed_data.unicast_withdrawn))
+                LOG_NOTICE("%s: MP_UNREACH unicast NLRI data is invalid or truncated, ignoring the rest of it",
+                           peer_addr.c_str());
             break;
 
         case bgp::BGP_SAFI_NLRI_LABEL: // Labeled unicast
-            MPReachAttr::parseNlriData_LabelIPv4IPv6(isIPv4, nlri.nlri_data, nlri.nlri_len, peer_info,
-                                                     parsed_data.withdrawn);
+            if (not peer_info->decoders.labeled[UpdateDecoders::afiIndex(isIPv4)](nlri.nlri_data, nlri.nlri_len,
+                                                                                 parsed_data.withdrawn))
+                LOG_NOTICE("%s: MP_UNREACH labeled NLRI data is invalid or truncated, ignoring the rest of it",
+                           peer_addr.c_str());
             break;
 
         case bgp::BGP_SAFI_MPLS: // MPLS (vpnv4/vpnv6)
-            MPReachAttr::parseNlriData_LabelIPv4IPv6(isIPv4, nlri.nlri_data, nlri.nlri_len, peer_info,
-                                                     parsed_data.vpn_withdrawn);
-
+            if (not peer_info->decoders.vpn[UpdateDecoders::afiIndex(isIPv4)](nlri.nlri_data, nlri.nlri_len,
+                                                                             parsed_data.vpn_withdrawn))
+                LOG_NOTICE("%s: MP_UNREACH VPN NLRI data is invalid or truncated, ignoring the rest of it",
+                           peer_addr.c_str());
             break;
 
         default :
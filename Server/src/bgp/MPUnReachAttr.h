@@ -14,7 +14,7 @@
 #include <list>
 #include <string>
 
-#include "AddPathDataContainer.h"
+#include "PeerCapabilities.h"
 #include "MPReachAttr.h"
 #include "BMPReader.h"
 
@@ -7,7 +7,7 @@
  *
  */
 #include "OpenMsg.h"
-#include "AddPathDataContainer.h"
+#include "PeerCapabilities.h"
 #include "BMPReader.h"
 
 #include <string>
@@ -179,6 +179,8 @@ size_t OpenMsg::parseCapabilities(u_char *data, size_t size, bool openMessageIsS
                             bgp::SWAP_BYTES(&asn);
                             snprintf(capStr, sizeof(capStr), "4 Octet ASN (%d)", BGP_CAP_4OCTET_ASN);
                             capabilities.push_back(capStr);
+
+                            this->peer_info->capabilities.setFourOctetAsn(openMessageIsSent);
                         } else {
                             LOG_NOTICE("%s: 4 octet ASN capability length is invalid %d expected 4", peer_addr.c_str(), cap->len);
                         }
@@ -250,8 +252,8 @@ size_t OpenMsg::parseCapabilities(u_char *data, size_t size, bool openMessageIsS
                                         break;
                                 }
 
-                                this->peer_info->add_path_capability.addAddPath(data.afi, data.safi, data.send_recieve,
-                                                                                 openMessageIsSent);
+                                this->peer_info->capabilities.setAddPath(data.afi, data.safi, data.send_recieve,
+                                                                         openMessageIsSent);
 
                                 capabilities.push_back(decodeStr);
                             }
@@ -15,7 +15,7 @@
 
 #include <list>
 #include <bmp/BMPReader.h>
-#include "AddPathDataContainer.h"
+#include "PeerCapabilities.h"
 
 namespace bgp_msg {
 
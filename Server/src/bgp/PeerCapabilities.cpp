@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "PeerCapabilities.h"
+#include "OpenMsg.h"
+
+PeerCapabilities::PeerCapabilities() {
+    clear();
+}
+
+/**
+ * Reset all capabilities, called when the peer comes up
+ */
+void PeerCapabilities::clear() {
+    sent_receive.reset();
+    recv_send.reset();
+    add_path_enabled.reset();
+
+    sent_four_octet_asn = false;
+    recv_four_octet_asn = false;
+}
+
+/**
+ * Set Add Path capability for AFI/SAFI
+ *
+ * \param [in] afi              Afi code from RFC
+ * \param [in] safi             Safi code form RFC
+ * \param [in] send_receive     Send Recieve code from RFC
+ * \param [in] sent_open        Is obtained from sent open message. False if from recieved
+ */
+void PeerCapabilities::setAddPath(int afi, int safi, int send_receive, bool sent_open) {
+    int idx = index(afi, safi);
+
+    if (idx < 0)
+        return;
+
+    // Following the rule:
+    // add_path_<afi/safi> = true IF (SENT_OPEN has ADD-PATH sent or both) AND (RECV_OPEN has ADD-PATH recv or both)
+    if (sent_open) {
+        sent_receive[idx] = (send_receive == bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_RECEIVE or
+                             send_receive == bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_SEND_RECEIVE);
+    } else {
+        recv_send[idx] = (send_receive == bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_SEND or
+                          send_receive == bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_SEND_RECEIVE);
+    }
+
+    add_path_enabled[idx] = sent_receive[idx] and recv_send[idx];
+}
+
+/**
+ * Set 4 octet ASN capability as advertised in an open message
+ *
+ * \param [in] sent_open        Is obtained from sent open message. False if from recieved
+ */
+void PeerCapabilities::setFourOctetAsn(bool sent_open) {
+    if (sent_open)
+        sent_four_octet_asn = true;
+    else
+        recv_four_octet_asn = true;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef OPENBMP_PEERCAPABILITIES_H
+#define OPENBMP_PEERCAPABILITIES_H
+
+#include "bgp_common.h"
+
+#include <bitset>
+
+/**
+ * \class   PeerCapabilities
+ *
+ * \brief   Negotiated capabilities of a peer that affect how updates are decoded
+ * \details Filled by the OPEN message parser on peer up.  Add-Path state is kept
+ *          as bits indexed by AFI/SAFI so that lookups in the NLRI parse loops
+ *          are a single bit test.
+ */
+class PeerCapabilities {
+public:
+    PeerCapabilities();
+
+    /**
+     * Reset all capabilities, called when the peer comes up
+     */
+    void clear();
+
+    /**
+     * Set Add Path capability for AFI/SAFI
+     *
+     * \param [in] afi              Afi code from RFC
+     * \param [in] safi             Safi code form RFC
+     * \param [in] send_receive     Send Recieve code from RFC
+     * \param [in] sent_open        Is obtained from sent open message. False if from recieved
+     */
+    void setAddPath(int afi, int safi, int send_receive, bool sent_open);
+
+    /**
+     * Is add path capability enabled for such AFI and SAFI
+     *
+     * \param [in] afi              Afi code from RFC
+     * \param [in] safi             Safi code form RFC
+     *
+     * \return is enabled
+     */
+    bool isAddPathEnabled(int afi, int safi) const {
+        int idx = index(afi, safi);
+        return idx >= 0 and add_path_enabled[idx];
+    }
+
+    /**
+     * Set 4 octet ASN capability as advertised in an open message
+     *
+     * \param [in] sent_open        Is obtained from sent open message. False if from recieved
+     */
+    void setFourOctetAsn(bool sent_open);
+
+    /**
+     * Is 4 octet ASN negotiated (both sent and received open advertised it)
+     */
+    bool isFourOctetAsn() const {
+        return sent_four_octet_asn and recv_four_octet_asn;
+    }
+
+    bool isFourOctetAsnSent() const      { return sent_four_octet_asn; }
+    bool isFourOctetAsnReceived() const  { return recv_four_octet_asn; }
+
+private:
+    /**
+     * Supported AFI's, indexes into the bit tables
+     */
+    enum AFI_INDEX {
+        AFI_INDEX_IPV4=0,
+        AFI_INDEX_IPV6,
+        AFI_INDEX_L2VPN,
+        AFI_INDEX_BGPLS,
+
+        AFI_INDEX_MAX
+    };
+
+    enum { TABLE_SIZE = AFI_INDEX_MAX * 256 };
+
+    std::bitset<TABLE_SIZE>  sent_receive;          ///< Sent OPEN advertised add-path receive (or send/receive)
+    std::bitset<TABLE_SIZE>  recv_send;             ///< Received OPEN advertised add-path send (or send/receive)
+    std::bitset<TABLE_SIZE>  add_path_enabled;      ///< sent_receive AND recv_send
+
+    bool        sent_four_octet_asn;                ///< 4 octet ASN advertised in sent OPEN
+    bool        recv_four_octet_asn;                ///< 4 octet ASN advertised in received OPEN
+
+    /**
+     * Get the bit table index for AFI/SAFI
+     *
+     * \return index or -1 if the AFI/SAFI is not supported
+     */
+    static int index(int afi, int safi) {
+        int afi_idx;
+
+        switch (afi) {
+            case bgp::BGP_AFI_IPV4  : afi_idx = AFI_INDEX_IPV4;  break;
+            case bgp::BGP_AFI_IPV6  : afi_idx = AFI_INDEX_IPV6;  break;
+            case bgp::BGP_AFI_L2VPN : afi_idx = AFI_INDEX_L2VPN; break;
+            case bgp::BGP_AFI_BGPLS : afi_idx = AFI_INDEX_BGPLS; break;
+            default:
+                return -1;
+        }
+
+        if (safi < 0 or safi > 255)
+            return -1;
+
+        return afi_idx << 8 | safi;
+    }
+};
+
+
+#endif //OPENBMP_PEERCAPABILITIES_H
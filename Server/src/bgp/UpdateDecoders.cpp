@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#include "UpdateDecoders.h"
+#include "EVPN.h"
+#include "TextFormat.h"
+
+#include <cstdio>
+#include <type_traits>
+#include <arpa/inet.h>
+
+namespace bgp_msg {
+
+namespace {
+
+/**
+ * Parse the route distinguisher into the tuple - only VPN tuples have one
+ */
+inline void parseRd(u_char *, bgp::prefix_tuple &) {
+}
+
+inline void parseRd(u_char *data, bgp::vpn_tuple &tuple) {
+    EVPN::parseRouteDistinguisher(data, &tuple.rd_type, &tuple.rd_assigned_number,
+                                  &tuple.rd_administrator_subfield);
+}
+
+/**
+ * Masks that keep the first N bytes of an address, N = 0..16
+ */
+struct addr_byte_masks {
+    uint32_t    v4[5];
+    uint64_t    v6[17][2];
+
+    addr_byte_masks() {
+        u_char bytes[16];
+
+        for (int n=0; n <= 16; n++) {
+            memset(bytes, 0xFF, n);
+            memset(bytes + n, 0, 16 - n);
+
+            memcpy(v6[n], bytes, 16);
+            if (n <= 4)
+                memcpy(&v4[n], bytes, 4);
+        }
+    }
+};
+
+const addr_byte_masks masks;
+
+/**
+ * Bulk decode unicast NLRI (RFC4271 Section 4.3 / RFC4760 Section 5)
+ *
+ * \details Prefixes are appended in binary form to the prefix array columns.
+ *          The address is read with one (IPv4) or two (IPv6) wide loads and the
+ *          bytes past the prefix length are masked off; only the last prefixes
+ *          of the buffer, where a wide load would overrun, are copied by length.
+ *
+ * \param [in]   data       Pointer to the start of the prefixes to be parsed
+ * \param [in]   len        Length of the data in bytes to be read
+ * \param [out]  prefixes   Reference to the prefix array to be updated with entries
+ */
+template <bool IPV4, bool ADD_PATH>
+bool decodeUnicast(u_char *data, uint16_t len, bgp::prefix_array &prefixes) {
+    const int           max_bytes = IPV4 ? 4 : 16;
+    u_char              *end = data + len;
+    int                 addr_bytes;
+    uint8_t             bits;
+    uint32_t            path_id = 0;
+    size_t              idx;
+
+    if (data == NULL)
+        return true;
+
+    // Estimate the count using typical prefix sizes (/24 IPv4, /48 IPv6)
+    prefixes.reserve(prefixes.size() + len / (IPV4 ? 4 : 7) + 1);
+
+    while (data < end) {
+        if (ADD_PATH and (end - data) >= 4) {
+            path_id = (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+            data += 4;
+
+            if (data >= end)
+                return false;
+        } else
+            path_id = 0;
+
+        // set the address in bits length
+        bits = *data++;
+
+        addr_bytes = (bits + 7) >> 3;
+        if (addr_bytes > max_bytes or addr_bytes > (end - data))
+            return false;
+
+        idx = prefixes.addr.size();
+        prefixes.addr.resize(idx + bgp::prefix_array::ADDR_SIZE);
+        u_char *dst = &prefixes.addr[idx];
+
+        if ((end - data) >= max_bytes) {
+            if (IPV4) {
+                uint32_t w;
+                memcpy(&w, data, 4);
+                w &= masks.v4[addr_bytes];
+                memcpy(dst, &w, 4);
+
+            } else {
+                uint64_t w[2];
+                memcpy(w, data, 16);
+                w[0] &= masks.v6[addr_bytes][0];
+                w[1] &= masks.v6[addr_bytes][1];
+                memcpy(dst, w, 16);
+            }
+        } else
+            memcpy(dst, data, addr_bytes);
+
+        data += addr_bytes;
+
+        prefixes.len.push_back(bits);
+        prefixes.path_id.push_back(path_id);
+        prefixes.isIPv4.push_back(IPV4 ? 1 : 0);
+    }
+
+    return true;
+}
+
+/**
+ * Decode labeled and VPN NLRI (RFC3107 Section 3 / RFC4364 Section 4.3.4)
+ *
+ * \details Add-path is not used for VPN prefixes.
+ *
+ * \param [in]   data       Pointer to the start of the label + prefixes to be parsed
+ * \param [in]   len        Length of the data in bytes to be read
+ * \param [out]  prefixes   Reference to a list<label, prefix_tuple> to be updated with entries
+ */
+template <typename PREFIX_TUPLE, bool IPV4, bool ADD_PATH>
+bool decodeLabeled(u_char *data, uint16_t len, std::list<PREFIX_TUPLE, ParseArenaAllocator<PREFIX_TUPLE> > &prefixes) {
+    const bool          is_vpn = std::is_same<PREFIX_TUPLE, bgp::vpn_tuple>::value;
+    const int           max_bytes = IPV4 ? 4 : 16;
+    u_char              *end = data + len;
+    char                ip_char[TEXTFMT_IPV6_STRLEN];
+    int                 addr_bytes;
+    uint16_t            label_bytes;
+    PREFIX_TUPLE        tuple;
+
+    if (data == NULL)
+        return true;
+
+    tuple.type = IPV4 ? bgp::PREFIX_LABEL_UNICAST_V4 : bgp::PREFIX_LABEL_UNICAST_V6;
+    tuple.isIPv4 = IPV4;
+    tuple.path_id = 0;
+
+    while (data < end) {
+        if (ADD_PATH and not is_vpn and (end - data) >= 4) {
+            memcpy(&tuple.path_id, data, 4);
+            bgp::SWAP_BYTES(&tuple.path_id);
+            data += 4;
+
+            if (data >= end)
+                return false;
+        } else
+            tuple.path_id = 0;
+
+        // set the address in bits length
+        tuple.len = *data++;
+
+        addr_bytes = (tuple.len + 7) >> 3;
+        if (addr_bytes > (end - data))
+            return false;
+
+        label_bytes = UpdateDecoders::decodeLabel(data, addr_bytes, tuple.labels);
+
+        tuple.len -= (8 * label_bytes);     // Update prefix len to not include the label(s)
+        data += label_bytes;                // move data pointer past labels
+        addr_bytes -= label_bytes;
+
+        // Parse RD if VPN
+        if (is_vpn and addr_bytes >= 8) {
+            parseRd(data, tuple);
+            data += 8;
+            addr_bytes -= 8;
+            tuple.len -= 64;
+        }
+
+        if (addr_bytes < 0 or addr_bytes > max_bytes)
+            return false;
+
+        bzero(tuple.prefix_bin, sizeof(tuple.prefix_bin));
+
+        // Parse the prefix if it isn't a default route
+        if (addr_bytes > 0) {
+            memcpy(tuple.prefix_bin, data, addr_bytes);
+            data += addr_bytes;
+
+            // Convert the IP to string printed format
+            tuple.prefix.assign(ip_char, textfmt::ip(ip_char, tuple.prefix_bin, IPV4));
+
+        } else {
+            tuple.prefix.assign(IPV4 ? "0.0.0.0" : "::");
+        }
+
+        prefixes.push_back(tuple);
+    }
+
+    return true;
+}
+
+/**
+ * Decode AS_PATH segments using a fixed ASN octet size
+ */
+template <int ASN_OCTETS>
+bool decodeAsPath(u_char *data, int path_len, std::string &decoded_path,
+                  uint16_t &as_path_cnt, uint32_t &last_asn, uint32_t &neighbor_asn) {
+    char        asn_char[1 + TEXTFMT_U32_STRLEN] = { ' ' };    // Leading space separates the ASNs
+    bool        neighbor_found = false;
+    u_char      seg_type;
+    u_char      seg_len;
+    uint32_t    seg_asn;
+
+    neighbor_asn = 0;
+
+    /*
+     * Loop through each path segment
+     */
+    while (path_len > 0) {
+        if (path_len < 2)
+            return false;
+
+        seg_type = *data++;
+        seg_len  = *data++;                  // Count of AS's, not bytes
+        path_len -= 2;
+
+        if ((seg_len * ASN_OCTETS) > path_len)
+            return false;
+
+        if (seg_type == 1)                   // If AS-SET open with a brace
+            decoded_path.append(" {");
+
+        // Confederation segments (RFC 5065) are skipped; a leading AS_SET has no neighbor AS
+        bool neighbor_seg = not neighbor_found and seg_type != 3 and seg_type != 4 and seg_len > 0;
+        if (neighbor_seg)
+            neighbor_found = true;
+
+        // The rest of the data is the as path sequence, in blocks of 2 or 4 bytes
+        for (; seg_len > 0; seg_len--) {
+            if (ASN_OCTETS == 4)
+                seg_asn = (uint32_t)data[0] << 24 | (uint32_t)data[1] << 16 | (uint32_t)data[2] << 8 | data[3];
+            else
+                seg_asn = (uint32_t)data[0] << 8 | data[1];
+
+            data += ASN_OCTETS;
+            path_len -= ASN_OCTETS;
+
+            decoded_path.append(asn_char, 1 + textfmt::u32(asn_char + 1, seg_asn));
+
+            if (neighbor_seg and seg_type == 2) {
+                neighbor_asn = seg_asn;
+                neighbor_seg = false;
+            }
+
+            last_asn = seg_asn;
+            ++as_path_cnt;
+        }
+
+        if (seg_type == 1)                   // If AS-SET close with a brace
+            decoded_path.append(" }");
+    }
+
+    return true;
+}
+
+} /* anonymous namespace */
+
+/**
+ * Constructor for class - selects the decoders without add-path
+ */
+UpdateDecoders::UpdateDecoders() {
+    select(PeerCapabilities());
+}
+
+/**
+ * Select the decoders based on the negotiated capabilities
+ *
+ * \param [in] caps     Peer capabilities, as parsed from the sent/received OPEN messages
+ */
+void UpdateDecoders::select(const PeerCapabilities &caps) {
+    if (caps.isAddPathEnabled(bgp::BGP_AFI_IPV4, bgp::BGP_SAFI_UNICAST))
+        unicast[AFI_INDEX_IPV4] = &decodeUnicast<true, true>;
+    else
+        unicast[AFI_INDEX_IPV4] = &decodeUnicast<true, false>;
+
+    if (caps.isAddPathEnabled(bgp::BGP_AFI_IPV6, bgp::BGP_SAFI_UNICAST))
+        unicast[AFI_INDEX_IPV6] = &decodeUnicast<false, true>;
+    else
+        unicast[AFI_INDEX_IPV6] = &decodeUnicast<false, false>;
+
+    if (caps.isAddPathEnabled(bgp::BGP_AFI_IPV4, bgp::BGP_SAFI_NLRI_LABEL))
+        labeled[AFI_INDEX_IPV4] = &decodeLabeled<bgp::prefix_tuple, true, true>;
+    else
+        labeled[AFI_INDEX_IPV4] = &decodeLabeled<bgp::prefix_tuple, true, false>;
+
+    if (caps.isAddPathEnabled(bgp::BGP_AFI_IPV6, bgp::BGP_SAFI_NLRI_LABEL))
+        labeled[AFI_INDEX_IPV6] = &decodeLabeled<bgp::prefix_tuple, false, true>;
+    else
+        labeled[AFI_INDEX_IPV6] = &decodeLabeled<bgp::prefix_tuple, false, false>;
+
+    vpn[AFI_INDEX_IPV4] = &decodeLabeled<bgp::vpn_tuple, true, false>;
+    vpn[AFI_INDEX_IPV6] = &decodeLabeled<bgp::vpn_tuple, false, false>;
+
+    as_path_4octet = &decodeAsPath<4>;
+    as_path_2octet = &decodeAsPath<2>;
+}
+
+/**
+ * Decode label from NLRI data
+ *
+ * \details
+ *      Decodes the labels from the NLRI data into labels string
+ *
+ * \param [in]   data                   Pointer to the start of the label + prefixes to be parsed
+ * \param [in]   len                    Length of the data in bytes to be read
+ * \param [out]  labels                 Reference to string that will be updated with labels delimited by comma
+ *
+ * \returns number of bytes read to decode the label(s) and updates string labels
+ *
+ */
+uint16_t UpdateDecoders::decodeLabel(u_char *data, uint16_t len, bgp::arena_string &labels) {
+    int read_size = 0;
+    typedef union {
+        struct {
+            uint8_t   ttl     : 8;          // TTL - not present since only 3 octets are used
+            uint8_t   bos     : 1;          // Bottom of stack
+            uint8_t   exp     : 3;          // EXP - not really used
+            uint32_t  value   : 20;         // Label value
+        } decode;
+        uint32_t  data;                 // Raw label - 3 octets only per RFC3107
+    } mpls_label;
+
+    mpls_label label;
+    char       label_char[TEXTFMT_U32_STRLEN];
+
+    labels.clear();
+
+    u_char *data_ptr = data;
+
+    // the label is 3 octets long
+    while (read_size + 3 <= len)
+    {
+        bzero(&label, sizeof(label));
+
+        memcpy(&label.data, data_ptr, 3);
+        bgp::SWAP_BYTES(&label.data);     // change to host order
+
+        data_ptr += 3;
+        read_size += 3;
+
+        labels.append(label_char, textfmt::u32(label_char, label.decode.value));
+
+        if (label.decode.bos == 1 or label.data == 0x80000000 /* withdrawn label as 32bits instead of 24 */
+                or label.data == 0 /* l3vpn seems to use zero instead of rfc3107 suggested value */) {
+            break;               // Reached EoS
+
+        } else {
+            labels.append(",");
+        }
+    }
+
+    return read_size;
+}
+
+} /* namespace bgp_msg */
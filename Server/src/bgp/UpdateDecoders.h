@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef UPDATEDECODERS_H_
+#define UPDATEDECODERS_H_
+
+#include "bgp_common.h"
+#include "PeerCapabilities.h"
+
+#include <string>
+
+namespace bgp_msg {
+
+/**
+ * \class   UpdateDecoders
+ *
+ * \brief   Per peer dispatch table of specialized NLRI and AS_PATH decoders
+ * \details Each decoder is a template instantiation for one combination of
+ *          add-path, AFI, labeled/VPN and ASN octet size.  The table is selected
+ *          once per peer session from the negotiated capabilities, so the per
+ *          prefix/ASN loops don't re-check any of these.
+ *
+ *          NLRI decoders return false if the NLRI data is malformed/truncated;
+ *          prefixes decoded before the error are kept.
+ */
+class UpdateDecoders {
+public:
+    typedef bool (*unicast_decoder)(u_char *data, uint16_t len, bgp::prefix_array &prefixes);
+    typedef bool (*prefix_decoder)(u_char *data, uint16_t len, bgp::prefix_list &prefixes);
+    typedef bool (*vpn_decoder)(u_char *data, uint16_t len, bgp::vpn_list &prefixes);
+
+    /**
+     * AS_PATH decoder
+     *
+     * \param [in]   data           Pointer to the AS_PATH attribute data
+     * \param [in]   path_len       Length of the attribute data
+     * \param [out]  decoded_path   Printed AS path, appended to
+     * \param [out]  as_path_cnt    Number of ASN's in the path
+     * \param [out]  last_asn       Last (origin) ASN in the path
+     * \param [out]  neighbor_asn   Neighbor ASN (RFC 4271 9.1.2.2); first ASN of the path after
+     *                              the confederation segments, zero if it starts with an AS_SET
+     *
+     * \return false if a segment doesn't fit in path_len using this ASN size
+     */
+    typedef bool (*as_path_decoder)(u_char *data, int path_len, std::string &decoded_path,
+                                    uint16_t &as_path_cnt, uint32_t &last_asn, uint32_t &neighbor_asn);
+
+    /**
+     * AFI index into the NLRI decoder tables
+     */
+    enum AFI_INDEX {
+        AFI_INDEX_IPV4=0,
+        AFI_INDEX_IPV6,
+
+        AFI_INDEX_MAX
+    };
+
+    unicast_decoder unicast[AFI_INDEX_MAX];         ///< Unicast (SAFI 1) bulk decoders
+    prefix_decoder  labeled[AFI_INDEX_MAX];         ///< Labeled unicast (SAFI 4) decoders
+    vpn_decoder     vpn[AFI_INDEX_MAX];             ///< MPLS VPN (SAFI 128) decoders
+    as_path_decoder as_path_4octet;                 ///< AS_PATH decoder using 4 octet ASN's
+    as_path_decoder as_path_2octet;                 ///< AS_PATH decoder using 2 octet ASN's
+
+    /**
+     * Constructor for class - selects the decoders without add-path
+     */
+    UpdateDecoders();
+
+    /**
+     * Select the decoders based on the negotiated capabilities
+     *
+     * \param [in] caps     Peer capabilities, as parsed from the sent/received OPEN messages
+     */
+    void select(const PeerCapabilities &caps);
+
+    /**
+     * Get the AFI index for the NLRI decoder tables
+     */
+    static inline int afiIndex(bool isIPv4) {
+        return isIPv4 ? AFI_INDEX_IPV4 : AFI_INDEX_IPV6;
+    }
+
+    /**
+     * Decode label from NLRI data
+     *
+     * \param [in]   data                   Pointer to the start of the label + prefixes to be parsed
+     * \param [in]   len                    Length of the data in bytes to be read
+     * \param [out]  labels                 Reference to string that will be updated with labels delimited by comma
+     *
+     * \returns number of bytes read to decode the label(s) and updates string labels
+     */
+    static uint16_t decodeLabel(u_char *data, uint16_t len, bgp::arena_string &labels);
+};
+
+} /* namespace bgp_msg */
+
+#endif /* UPDATEDECODERS_H_ */
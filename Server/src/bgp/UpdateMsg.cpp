@@ -18,6 +18,8 @@
 #include "MPReachAttr.h"
 #include "MPUnReachAttr.h"
 #include "MPLinkStateAttr.h"
+#include "TextFormat.h"
+#include "AttrInternCache.h"
 
 namespace bgp_msg {
 
@@ -46,7 +48,7 @@ UpdateMsg::UpdateMsg(Logger *logPtr, std::string peerAddr, std::string routerAdd
 //        four_octet_asn = false;
 //    else
 
-    four_octet_asn = peer_info->recv_four_octet_asn and peer_info->sent_four_octet_asn;
+    four_octet_asn = peer_info->capabilities.isFourOctetAsn();
 }
 
 UpdateMsg::~UpdateMsg() {
@@ -73,6 +75,8 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
     parsed_data.advertised.clear();
     parsed_data.attrs.clear();
     parsed_data.withdrawn.clear();
+    parsed_data.unicast_advertised.clear();
+    parsed_data.unicast_withdrawn.clear();
 
 
     /* ---------------------------------------------------------
@@ -135,7 +139,7 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
          */
         SELF_DEBUG("%s: rtr=%s: Getting the IPv4 withdrawn data", peer_addr.c_str(), router_addr.c_str());
         if (uHdr.withdrawn_len > 0)
-            parseNlriData_v4(uHdr.withdrawnPtr, uHdr.withdrawn_len, parsed_data.withdrawn);
+            parseNlriData_v4(uHdr.withdrawnPtr, uHdr.withdrawn_len, parsed_data.unicast_withdrawn);
 
 
         /* ---------------------------------------------------------
@@ -151,7 +155,7 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
          */
         SELF_DEBUG("%s: rtr=%s: Getting the IPv4 NLRI data, size = %d", peer_addr.c_str(), router_addr.c_str(), (size - read_size));
         if ((size - read_size) > 0) {
-            parseNlriData_v4(uHdr.nlriPtr, (size - read_size), parsed_data.advertised);
+            parseNlriData_v4(uHdr.nlriPtr, (size - read_size), parsed_data.unicast_advertised);
             read_size = size;
         }
     }
@@ -168,71 +172,21 @@ size_t UpdateMsg::parseUpdateMsg(u_char *data, size_t size, parsed_update_data &
  *
  * \param [in]   data       Pointer to the start of the prefixes to be parsed
  * \param [in]   len        Length of the data in bytes to be read
- * \param [out]  prefixes   Reference to a list<prefix_tuple> to be updated with entries
+ * \param [out]  prefixes   Reference to the prefix array to be updated with entries
  */
-void UpdateMsg::parseNlriData_v4(u_char *data, uint16_t len, std::list<bgp::prefix_tuple> &prefixes) {
-    u_char       ipv4_raw[4];
-    char         ipv4_char[16];
-    u_char       addr_bytes;
-
-    bgp::prefix_tuple tuple;
+void UpdateMsg::parseNlriData_v4(u_char *data, uint16_t len, bgp::prefix_array &prefixes) {
 
     if (len <= 0 or data == NULL)
         return;
 
     // TODO: Can extend this to support multicast, but right now we set it to unicast v4
-    // Set the type for all to be unicast V4
-    tuple.type = bgp::PREFIX_UNICAST_V4;
-    tuple.isIPv4 = true;
-
-    // Loop through all prefixes
-    for (size_t read_size=0; read_size < len; read_size++) {
-
-        bzero(ipv4_raw, sizeof(ipv4_raw));
-        bzero(tuple.prefix_bin, sizeof(tuple.prefix_bin));
-
-        // Parse add-paths if enabled
-        if (peer_info->add_path_capability.isAddPathEnabled(bgp::BGP_AFI_IPV4, bgp::BGP_SAFI_UNICAST)
-                and (len - read_size) >= 4) {
-            memcpy(&tuple.path_id, data, 4);
-            bgp::SWAP_BYTES(&tuple.path_id);
-            data += 4; read_size += 4;
-        } else
-            tuple.path_id = 0;
-
-        // set the address in bits length
-        tuple.len = *data++;
-
-        // Figure out how many bytes the bits requires
-        addr_bytes = tuple.len / 8;
-        if (tuple.len % 8)
-            ++addr_bytes;
-
-        SELF_DEBUG("%s: rtr=%s: Reading NLRI data prefix bits=%d bytes=%d", peer_addr.c_str(),
-                    router_addr.c_str(), tuple.len, addr_bytes);
-
-        if (addr_bytes <= 4) {
-            memcpy(ipv4_raw, data, addr_bytes);
-            read_size += addr_bytes;
-            data += addr_bytes;
-
-            // Convert the IP to string printed format
-            inet_ntop(AF_INET, ipv4_raw, ipv4_char, sizeof(ipv4_char));
-            tuple.prefix.assign(ipv4_char);
-            SELF_DEBUG("%s: rtr=%s: Adding prefix %s len %d", peer_addr.c_str(),
-                        router_addr.c_str(), ipv4_char, tuple.len);
-
-            // set the raw/binary address
-            memcpy(tuple.prefix_bin, ipv4_raw, sizeof(ipv4_raw));
-
-            // Add tuple to prefix list
-            prefixes.push_back(tuple);
-
-        } else if (addr_bytes > 4) {
-            LOG_NOTICE("%s: rtr=%s: NRLI v4 address is larger than 4 bytes bytes=%d len=%d",
-                       peer_addr.c_str(), router_addr.c_str(), addr_bytes, tuple.len);
-        }
+    if (not peer_info->decoders.unicast[UpdateDecoders::AFI_INDEX_IPV4](data, len, prefixes)) {
+        LOG_NOTICE("%s: rtr=%s: NLRI v4 data is invalid or truncated, ignoring the rest of it",
+                   peer_addr.c_str(), router_addr.c_str());
     }
+
+    SELF_DEBUG("%s: rtr=%s: Parsed %lu NLRI v4 prefixes", peer_addr.c_str(), router_addr.c_str(),
+               (unsigned long) prefixes.size());
 }
 
 /**
@@ -320,6 +274,7 @@ void UpdateMsg::parseAttributes(u_char *data, uint16_t len, parsed_update_data &
  * \param [out]  parsed_data    Reference to parsed_update_data; will be updated with all parsed data
  */
 void UpdateMsg::parseAttrData(u_char attr_type, uint16_t attr_len, u_char *data, parsed_update_data &parsed_data) {
+    const u_char *attr_data     = data;     // Start of the attribute data, used as the intern cache key
     std::string decodeStr       = "";
     u_char      ipv4_raw[4];
     char        ipv4_char[16];
@@ -347,26 +302,21 @@ void UpdateMsg::parseAttrData(u_char attr_type, uint16_t attr_len, u_char *data,
 
         case ATTR_TYPE_NEXT_HOP : // Next hop v4
             memcpy(ipv4_raw, data, 4);
-            inet_ntop(AF_INET, ipv4_raw, ipv4_char, sizeof(ipv4_char));
-            parsed_data.attrs[ATTR_TYPE_NEXT_HOP] = std::string(ipv4_char);
+            parsed_data.attrs[ATTR_TYPE_NEXT_HOP].assign(ipv4_char, textfmt::ipv4(ipv4_char, ipv4_raw));
             break;
 
         case ATTR_TYPE_MED : // MED value
         {
             memcpy(&value32bit, data, 4);
             bgp::SWAP_BYTES(&value32bit);
-            std::ostringstream numString;
-            numString << value32bit;
-            parsed_data.attrs[ATTR_TYPE_MED] = numString.str();
+            parsed_data.attrs[ATTR_TYPE_MED] = textfmt::str_u32(value32bit);
             break;
         }
         case ATTR_TYPE_LOCAL_PREF : // local pref value
         {
             memcpy(&value32bit, data, 4);
             bgp::SWAP_BYTES(&value32bit);
-            std::ostringstream numString;
-            numString << value32bit;
-            parsed_data.attrs[ATTR_TYPE_LOCAL_PREF] = numString.str();
+            parsed_data.attrs[ATTR_TYPE_LOCAL_PREF] = textfmt::str_u32(value32bit);
             break;
         }
         case ATTR_TYPE_ATOMIC_AGGREGATE : // Atomic aggregate
@@ -379,54 +329,66 @@ void UpdateMsg::parseAttrData(u_char attr_type, uint16_t attr_len, u_char *data,
 
         case ATTR_TYPE_ORIGINATOR_ID : // Originator ID
             memcpy(ipv4_raw, data, 4);
-            inet_ntop(AF_INET, ipv4_raw, ipv4_char, sizeof(ipv4_char));
-            parsed_data.attrs[ATTR_TYPE_ORIGINATOR_ID] = std::string(ipv4_char);
+            parsed_data.attrs[ATTR_TYPE_ORIGINATOR_ID].assign(ipv4_char, textfmt::ipv4(ipv4_char, ipv4_raw));
             break;
 
         case ATTR_TYPE_CLUSTER_LIST : // Cluster List (RFC 4456)
+            if (getInternedAttr(ATTR_TYPE_CLUSTER_LIST, attr_len, attr_data, parsed_data.attrs))
+                break;
+
             // According to RFC 4456, the value is a sequence of cluster id's
+            decodeStr.reserve(attr_len / 4 * TEXTFMT_IPV4_STRLEN);
             for (int i=0; i < attr_len; i += 4) {
                 memcpy(ipv4_raw, data, 4);
                 data += 4;
-                inet_ntop(AF_INET, ipv4_raw, ipv4_char, sizeof(ipv4_char));
-                decodeStr.append(ipv4_char);
-                decodeStr.append(" ");
+                textfmt::append_ipv4(decodeStr, ipv4_raw);
+                decodeStr.push_back(' ');
             }
 
             parsed_data.attrs[ATTR_TYPE_CLUSTER_LIST] = decodeStr;
+            putInternedAttr(ATTR_TYPE_CLUSTER_LIST, attr_len, attr_data, decodeStr);
             break;
 
         case ATTR_TYPE_COMMUNITIES : // Community list
         {
-            for (int i = 0; i < attr_len; i += 4) {
-                std::ostringstream numString;
+            if (getInternedAttr(ATTR_TYPE_COMMUNITIES, attr_len, attr_data, parsed_data.attrs))
+                break;
 
+            decodeStr.reserve(attr_len / 4 * 12);
+            for (int i = 0; i < attr_len; i += 4) {
                 // Add space between entries
                 if (i)
-                    decodeStr.append(" ");
+                    decodeStr.push_back(' ');
 
                 // Add entry
                 memcpy(&value16bit, data, 2);
                 data += 2;
                 bgp::SWAP_BYTES(&value16bit);
-                numString << value16bit;
-                numString << ":";
+                textfmt::append_u32(decodeStr, value16bit);
+                decodeStr.push_back(':');
 
                 memcpy(&value16bit, data, 2);
                 data += 2;
                 bgp::SWAP_BYTES(&value16bit);
-                numString << value16bit;
-                decodeStr.append(numString.str());
+                textfmt::append_u32(decodeStr, value16bit);
             }
 
             parsed_data.attrs[ATTR_TYPE_COMMUNITIES] = decodeStr;
+            putInternedAttr(ATTR_TYPE_COMMUNITIES, attr_len, attr_data, decodeStr);
 
             break;
         }
         case ATTR_TYPE_EXT_COMMUNITY : // extended community list (RFC 4360)
         {
+            if (getInternedAttr(ATTR_TYPE_EXT_COMMUNITY, attr_len, attr_data, parsed_data.attrs))
+                break;
+
             ExtCommunity ec(logger, peer_addr, debug);
             ec.parseExtCommunities(attr_len, data, parsed_data);
+
+            parsed_attrs_map::iterator it = parsed_data.attrs.find(ATTR_TYPE_EXT_COMMUNITY);
+            if (it != parsed_data.attrs.end())
+                putInternedAttr(ATTR_TYPE_EXT_COMMUNITY, attr_len, attr_data, it->second);
             break;
         }
 
@@ -480,37 +442,38 @@ void UpdateMsg::parseAttrData(u_char attr_type, uint16_t attr_len, u_char *data,
         case ATTR_TYPE_LARGE_COMMUNITY: {
             // RFC8092
             if (attr_len >= 12) {
-                for (int i = 0; i < attr_len; i += 12) {
-                    std::ostringstream numString;
+                if (getInternedAttr(ATTR_TYPE_LARGE_COMMUNITY, attr_len, attr_data, parsed_data.attrs))
+                    break;
 
+                decodeStr.reserve(attr_len / 12 * 33);
+                for (int i = 0; i < attr_len; i += 12) {
                     // Add space between entries
                     if (i)
-                        decodeStr.append(" ");
+                        decodeStr.push_back(' ');
 
                     // Global Administrator
                     memcpy(&value32bit, data, 4);
                     data += 4;
                     bgp::SWAP_BYTES(&value32bit);
-                    numString << value32bit;
-                    numString << ":";
+                    textfmt::append_u32(decodeStr, value32bit);
+                    decodeStr.push_back(':');
 
                     // Local Data Part 1
                     memcpy(&value32bit, data, 4);
                     data += 4;
                     bgp::SWAP_BYTES(&value32bit);
-                    numString << value32bit;
-                    numString << ":";
+                    textfmt::append_u32(decodeStr, value32bit);
+                    decodeStr.push_back(':');
 
                     // Local Data Part 2
                     memcpy(&value32bit, data, 4);
                     data += 4;
                     bgp::SWAP_BYTES(&value32bit);
-                    numString << value32bit;
-
-                    decodeStr.append(numString.str());
+                    textfmt::append_u32(decodeStr, value32bit);
                 }
 
                 parsed_data.attrs[ATTR_TYPE_LARGE_COMMUNITY] = decodeStr;
+                putInternedAttr(ATTR_TYPE_LARGE_COMMUNITY, attr_len, attr_data, decodeStr);
             }
 
             break;
@@ -536,32 +499,26 @@ void UpdateMsg::parseAttr_Aggegator(uint16_t attr_len, u_char *data, parsed_attr
     uint32_t    value32bit = 0;
     uint16_t    value16bit = 0;
     u_char      ipv4_raw[4];
-    char        ipv4_char[16];
 
     // If using RFC6793, the len will be 8 instead of 6
      if (attr_len == 8) { // RFC6793 ASN of 4 octets
          memcpy(&value32bit, data, 4); data += 4;
          bgp::SWAP_BYTES(&value32bit);
-         std::ostringstream numString;
-         numString << value32bit;
-         decodeStr.assign(numString.str());
+         textfmt::append_u32(decodeStr, value32bit);
 
      } else if (attr_len == 6) {
          memcpy(&value16bit, data, 2); data += 2;
          bgp::SWAP_BYTES(&value16bit);
-         std::ostringstream numString;
-         numString << value16bit;
-         decodeStr.assign(numString.str());
+         textfmt::append_u32(decodeStr, value16bit);
 
      } else {
          LOG_ERR("%s: rtr=%s: path attribute is not the correct size of 6 or 8 octets.", peer_addr.c_str(), router_addr.c_str());
          return;
      }
 
-     decodeStr.append(" ");
+     decodeStr.push_back(' ');
      memcpy(ipv4_raw, data, 4);
-     inet_ntop(AF_INET, ipv4_raw, ipv4_char, sizeof(ipv4_char));
-     decodeStr.append(ipv4_char);
+     textfmt::append_ipv4(decodeStr, ipv4_raw);
 
      attrs[ATTR_TYPE_AGGEGATOR] = decodeStr;
 }
@@ -575,14 +532,9 @@ void UpdateMsg::parseAttr_Aggegator(uint16_t attr_len, u_char *data, parsed_attr
  */
 void UpdateMsg::parseAttr_AsPath(uint16_t attr_len, u_char *data, parsed_attrs_map &attrs) {
     std::string decoded_path;
-    int         path_len    = attr_len;
     uint16_t    as_path_cnt = 0;
-
-    u_char      seg_type;
-    u_char      seg_len;
     uint32_t    seg_asn = 0;
-
-    u_char *data_ptr = data;
+    uint32_t    neighbor_asn = 0;
 
     /*
      * We first must try to parse using four octet since the RFC says that the peer header
@@ -591,61 +543,36 @@ void UpdateMsg::parseAttr_AsPath(uint16_t attr_len, u_char *data, parsed_attrs_m
      */
     char asn_octet_size = (peer_info->using_2_octet_asn /* and not four_octet_asn */) ? 2 : 4;
 
-    if (path_len < asn_octet_size) // Nothing to parse if length doesn't include at least one asn
+    if (attr_len < asn_octet_size) // Nothing to parse if length doesn't include at least one asn
         return;
 
-    /*
-     * Loop through each path segment
-     */
-    while (path_len > 0) {
-
-        seg_type = *data++;
-        seg_len  = *data++;                  // Count of AS's, not bytes
-        path_len -= 2;
-
-        if (seg_type == 1) {                 // If AS-SET open with a brace
-            decoded_path.append(" {");
-        }
-
-        SELF_DEBUG("%s: rtr=%s: as_path seg_len = %d seg_type = %d, path_len = %d total_len = %d as_octet_size = %d",
-                   peer_addr.c_str(), router_addr.c_str(),
-                   seg_len, seg_type, path_len, attr_len, asn_octet_size);
-
-        if ((seg_len * asn_octet_size) > path_len){
-
-            LOG_NOTICE("%s: rtr=%s: Could not parse the AS PATH due to update message buffer being too short when using ASN octet size %d (%d > %d)",
-                       peer_addr.c_str(), router_addr.c_str(), asn_octet_size, (seg_len * asn_octet_size), path_len);
-
-            if (not peer_info->using_2_octet_asn) {
-                LOG_NOTICE("%s: rtr=%s: switching encoding size to 2-octet",
-                           peer_addr.c_str(), router_addr.c_str());
+    AttrInternCache::value_ptr interned;
+    if (peer_info->intern_cache != NULL
+            and (interned = peer_info->intern_cache->find(ATTR_TYPE_AS_PATH, asn_octet_size, data, attr_len))) {
+        attrs[ATTR_TYPE_AS_PATH] = interned->value;
+        attrs[ATTR_TYPE_INTERNAL_AS_COUNT] = textfmt::str_u32(interned->as_path_count);
+        attrs[ATTR_TYPE_INTERNAL_AS_ORIGIN] = textfmt::str_u32(interned->origin_as);
+        attrs[ATTR_TYPE_INTERNAL_AS_NEIGHBOR] = textfmt::str_u32(interned->neighbor_as);
+        return;
+    }
 
-                peer_info->using_2_octet_asn = true;
+    UpdateDecoders::as_path_decoder decode = peer_info->using_2_octet_asn ? peer_info->decoders.as_path_2octet
+                                                                          : peer_info->decoders.as_path_4octet;
 
-                parseAttr_AsPath(attr_len, data_ptr, attrs);
-            }
-            return;
-        }
+    if (not decode(data, attr_len, decoded_path, as_path_cnt, seg_asn, neighbor_asn)) {
 
-        // The rest of the data is the as path sequence, in blocks of 2 or 4 bytes
-        for (; seg_len > 0; seg_len--) {
-            seg_asn = 0;
-            memcpy(&seg_asn, data, asn_octet_size);  data += asn_octet_size;
-            path_len -= asn_octet_size;                               // Adjust the path length for what was read
+        LOG_NOTICE("%s: rtr=%s: Could not parse the AS PATH due to update message buffer being too short when using ASN octet size %d",
+                   peer_addr.c_str(), router_addr.c_str(), asn_octet_size);
 
-            bgp::SWAP_BYTES(&seg_asn, asn_octet_size);
-            decoded_path.append(" ");
-            std::ostringstream numString;
-            numString << seg_asn;
-            decoded_path.append(numString.str());
+        if (not peer_info->using_2_octet_asn) {
+            LOG_NOTICE("%s: rtr=%s: switching encoding size to 2-octet",
+                       peer_addr.c_str(), router_addr.c_str());
 
-            // Increase the as path count
-            ++as_path_cnt;
-        }
+            peer_info->using_2_octet_asn = true;
 
-        if (seg_type == 1) {            // If AS-SET close with a brace
-            decoded_path.append(" }");
+            parseAttr_AsPath(attr_len, data, attrs);
         }
+        return;
     }
 
     SELF_DEBUG("%s: rtr=%s: Parsed AS_PATH count %hu : %s", peer_addr.c_str(), router_addr.c_str(), as_path_cnt, decoded_path.c_str());
@@ -655,21 +582,66 @@ void UpdateMsg::parseAttr_AsPath(uint16_t attr_len, u_char *data, parsed_attrs_m
      */
     attrs[ATTR_TYPE_AS_PATH] = decoded_path;
 
-    {
-        std::ostringstream numString;
-        numString << as_path_cnt;
-        attrs[ATTR_TYPE_INTERNAL_AS_COUNT] = numString.str();
-    }
+    attrs[ATTR_TYPE_INTERNAL_AS_COUNT] = textfmt::str_u32(as_path_cnt);
 
     /*
      * Get the last ASN and update the attributes map
      */
-    {
-        std::ostringstream numString;
-        numString << seg_asn;
-        attrs[ATTR_TYPE_INTERNAL_AS_ORIGIN] = numString.str();
+    attrs[ATTR_TYPE_INTERNAL_AS_ORIGIN] = textfmt::str_u32(seg_asn);
+    attrs[ATTR_TYPE_INTERNAL_AS_NEIGHBOR] = textfmt::str_u32(neighbor_asn);
+
+    if (peer_info->intern_cache != NULL) {
+        AttrInternCache::interned_attr value;
+        value.value = decoded_path;
+        value.as_path_count = as_path_cnt;
+        value.origin_as = seg_asn;
+        value.neighbor_as = neighbor_asn;
+
+        peer_info->intern_cache->insert(ATTR_TYPE_AS_PATH, asn_octet_size, data, attr_len, value);
     }
 
 }
 
+/**
+ * Get a previously formatted attribute from the peer's intern cache
+ *
+ * \param [in]   attr_type      Attribute type
+ * \param [in]   attr_len       Length of the attribute data
+ * \param [in]   data           Pointer to the attribute data
+ * \param [out]  attrs          Reference to the parsed attr map - updated if found
+ *
+ * \return true if found and attrs was updated, false if the attribute needs to be decoded
+ */
+bool UpdateMsg::getInternedAttr(UPDATE_ATTR_TYPES attr_type, uint16_t attr_len, const u_char *data,
+                                parsed_attrs_map &attrs) {
+    if (peer_info->intern_cache == NULL)
+        return false;
+
+    AttrInternCache::value_ptr interned = peer_info->intern_cache->find(attr_type, 0, data, attr_len);
+    if (not interned)
+        return false;
+
+    attrs[attr_type] = interned->value;
+    return true;
+}
+
+/**
+ * Add a formatted attribute to the peer's intern cache
+ *
+ * \param [in]   attr_type      Attribute type
+ * \param [in]   attr_len       Length of the attribute data
+ * \param [in]   data           Pointer to the attribute data
+ * \param [in]   value          Formatted attribute
+ */
+void UpdateMsg::putInternedAttr(UPDATE_ATTR_TYPES attr_type, uint16_t attr_len, const u_char *data,
+                                const std::string &value) {
+    if (peer_info->intern_cache == NULL)
+        return;
+
+    AttrInternCache::interned_attr interned;
+    interned.value = value;
+
+    peer_info->intern_cache->insert(attr_type, 0, data, attr_len, interned);
+}
+
 } /* namespace bgp_msg */
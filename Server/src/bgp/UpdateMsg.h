@@ -13,7 +13,7 @@
 #include "Logger.h"
 #include "bgp_common.h"
 #include "MsgBusInterface.hpp"
-#include "AddPathDataContainer.h"
+#include "PeerCapabilities.h"
 
 #include <string>
 #include <list>
@@ -63,7 +63,8 @@ enum UPDATE_ATTR_TYPES {
              * Below attribute types are for internal use only... These are derived/added based on other attributes
              */
             ATTR_TYPE_INTERNAL_AS_COUNT=9000,        // AS path count - number of AS's
-            ATTR_TYPE_INTERNAL_AS_ORIGIN             // The AS that originated the entry
+            ATTR_TYPE_INTERNAL_AS_ORIGIN,            // The AS that originated the entry
+            ATTR_TYPE_INTERNAL_AS_NEIGHBOR           // First AS after the confederation segments
 };
 
 
@@ -113,14 +114,16 @@ public:
     };
 
     /**
-     * parsed path attributes map
+     * parsed path attributes map - map nodes are allocated from the active parse arena
      */
-    std::map<bgp_msg::UPDATE_ATTR_TYPES, std::string>            parsed_attrs;
-    typedef std::pair<bgp_msg::UPDATE_ATTR_TYPES, std::string>   parsed_attrs_pair;
-    typedef std::map<bgp_msg::UPDATE_ATTR_TYPES, std::string>    parsed_attrs_map;
+    typedef std::pair<const bgp_msg::UPDATE_ATTR_TYPES, std::string>   parsed_attrs_pair;
+    typedef std::map<bgp_msg::UPDATE_ATTR_TYPES, std::string, std::less<bgp_msg::UPDATE_ATTR_TYPES>,
+                     ParseArenaAllocator<parsed_attrs_pair> >          parsed_attrs_map;
 
     // Parsed bgp-ls attributes map
-    typedef  std::map<uint16_t, std::array<uint8_t, 255>>        parsed_ls_attrs_map;
+    typedef std::pair<const uint16_t, std::array<uint8_t, 255> >      parsed_ls_attrs_pair;
+    typedef std::map<uint16_t, std::array<uint8_t, 255>, std::less<uint16_t>,
+                     ParseArenaAllocator<parsed_ls_attrs_pair> >        parsed_ls_attrs_map;
 
     /**
      * Parsed data structure for BGP-LS
@@ -136,15 +139,17 @@ public:
      */
     struct parsed_update_data {
         parsed_attrs_map              attrs;              ///< Parsed attrbutes
-        std::list<bgp::prefix_tuple>  withdrawn;          ///< List of withdrawn prefixes
-        std::list<bgp::prefix_tuple>  advertised;         ///< List of advertised prefixes
+        bgp::prefix_array             unicast_withdrawn;  ///< Unicast withdrawn prefixes (bulk decoded)
+        bgp::prefix_array             unicast_advertised; ///< Unicast advertised prefixes (bulk decoded)
+        bgp::prefix_list              withdrawn;          ///< List of withdrawn prefixes (labeled unicast)
+        bgp::prefix_list              advertised;         ///< List of advertised prefixes (labeled unicast)
         parsed_ls_attrs_map           ls_attrs;           ///< BGP-LS specific attributes
         parsed_data_ls                ls;                 ///< REACH: Link state parsed data
         parsed_data_ls                ls_withdrawn;       ///< UNREACH: Parsed Withdrawn data
-        std::list<bgp::vpn_tuple>     vpn;                ///< List of vpn prefixes advertised
-        std::list<bgp::vpn_tuple>     vpn_withdrawn;      ///< List of vpn prefixes withdrawn
-        std::list<bgp::evpn_tuple>    evpn;               ///< List of evpn nlris advertised
-        std::list<bgp::evpn_tuple>    evpn_withdrawn;     ///< List of evpn nlris withdrawn
+        bgp::vpn_list                 vpn;                ///< List of vpn prefixes advertised
+        bgp::vpn_list                 vpn_withdrawn;      ///< List of vpn prefixes withdrawn
+        bgp::evpn_list                evpn;               ///< List of evpn nlris advertised
+        bgp::evpn_list                evpn_withdrawn;     ///< List of evpn nlris withdrawn
     };
 
 
@@ -197,9 +202,9 @@ private:
      *
      * \param [in]   data       Pointer to the start of the prefixes to be parsed
      * \param [in]   len        Length of the data in bytes to be read
-     * \param [out]  prefixes   Reference to a list<prefix_tuple> to be updated with entries
+     * \param [out]  prefixes   Reference to the prefix array to be updated with entries
      */
-    void parseNlriData_v4(u_char *data, uint16_t len, std::list<bgp::prefix_tuple> &prefixes);
+    void parseNlriData_v4(u_char *data, uint16_t len, bgp::prefix_array &prefixes);
 
     /**
      * Parses the BGP attributes in the update
@@ -245,6 +250,30 @@ private:
      */
     void parseAttr_Aggegator(uint16_t attr_len, u_char *data, parsed_attrs_map &attrs);
 
+    /**
+     * Get a previously formatted attribute from the peer's intern cache
+     *
+     * \param [in]   attr_type      Attribute type
+     * \param [in]   attr_len       Length of the attribute data
+     * \param [in]   data           Pointer to the attribute data
+     * \param [out]  attrs          Reference to the parsed attr map - updated if found
+     *
+     * \return true if found and attrs was updated, false if the attribute needs to be decoded
+     */
+    bool getInternedAttr(UPDATE_ATTR_TYPES attr_type, uint16_t attr_len, const u_char *data,
+                         parsed_attrs_map &attrs);
+
+    /**
+     * Add a formatted attribute to the peer's intern cache
+     *
+     * \param [in]   attr_type      Attribute type
+     * \param [in]   attr_len       Length of the attribute data
+     * \param [in]   data           Pointer to the attribute data
+     * \param [in]   value          Formatted attribute
+     */
+    void putInternedAttr(UPDATE_ATTR_TYPES attr_type, uint16_t attr_len, const u_char *data,
+                         const std::string &value);
+
 };
 
 } /* namespace bgp_msg */
@@ -11,12 +11,17 @@
 #define BGPCOMMON_H_
 
 #include <string>
+#include <list>
+#include <vector>
 #include <cstdint>
 #include <sstream>
 #include <cinttypes>
 #include <cstring>
 #include <sys/types.h>
 
+#include "ParseArena.h"
+#include "TextFormat.h"
+
 namespace bgp {
     #define BGP_MAX_MSG_SIZE        65535                   // Max payload size - Larger than RFC4271 of 4096
     #define BGP_MSG_HDR_LEN         19                      // BGP message header size
@@ -109,6 +114,11 @@ namespace bgp {
                 // Add BGP-LS types
     };
 
+    /**
+     * String that allocates from the active parse arena; used for per message parse products
+     */
+    typedef std::basic_string<char, std::char_traits<char>, ParseArenaAllocator<char> >  arena_string;
+
     /**
       * struct is used for nlri prefixes
       */
@@ -119,12 +129,12 @@ namespace bgp {
         */
         PREFIX_TYPE   type;                 ///< Prefix type - RIB type
         unsigned char len;                  ///< Length of prefix in bits
-        std::string   prefix;               ///< Printed form of the IP address
+        arena_string  prefix;               ///< Printed form of the IP address
         uint8_t       prefix_bin[16];       ///< Prefix in binary form
         uint32_t      path_id;              ///< Path ID (add path draft-ietf-idr-add-paths-15)
         bool          isIPv4;               ///< True if IPv4, false if IPv6
 
-        std::string   labels;               ///< Labels in the format of label, label, ...
+        arena_string  labels;               ///< Labels in the format of label, label, ...
     };
 
     /**
@@ -150,13 +160,54 @@ namespace bgp {
         std::string     ethernet_segment_identifier;
         std::string     ethernet_tag_id_hex;
         uint8_t         mac_len;
-        std::string     mac;
+        arena_string    mac;
         uint8_t         ip_len;
-        std::string     ip;
+        arena_string    ip;
         int             mpls_label_1;
         int             mpls_label_2;
         uint8_t         originating_router_ip_len;
-        std::string     originating_router_ip;
+        arena_string    originating_router_ip;
+    };
+
+    /**
+     * Lists of parsed NLRI's - nodes are allocated from the active parse arena
+     */
+    typedef std::list<prefix_tuple, ParseArenaAllocator<prefix_tuple> >  prefix_list;
+    typedef std::list<vpn_tuple, ParseArenaAllocator<vpn_tuple> >        vpn_list;
+    typedef std::list<evpn_tuple, ParseArenaAllocator<evpn_tuple> >      evpn_list;
+
+    /**
+     * Unicast prefixes decoded in bulk, stored as a struct of arrays
+     *
+     * \details Entry i is made of the columns at index i.  The printed form is not
+     *          stored; it is only produced when the entry is consumed.  Memory is
+     *          allocated from the active parse arena.
+     */
+    struct prefix_array {
+        enum { ADDR_SIZE = 16 };
+
+        std::vector<uint8_t,  ParseArenaAllocator<uint8_t> >  addr;     ///< ADDR_SIZE bytes per prefix, zero padded (IPv4 in first 4 bytes)
+        std::vector<uint8_t,  ParseArenaAllocator<uint8_t> >  len;      ///< Length of prefix in bits
+        std::vector<uint32_t, ParseArenaAllocator<uint32_t> > path_id;  ///< Path ID (add path), zero if not used
+        std::vector<uint8_t,  ParseArenaAllocator<uint8_t> >  isIPv4;   ///< 1 if IPv4, 0 if IPv6
+
+        size_t size() const                         { return len.size(); }
+        bool empty() const                          { return len.empty(); }
+        const uint8_t *prefix_bin(size_t i) const   { return &addr[i * ADDR_SIZE]; }
+
+        void reserve(size_t n) {
+            addr.reserve(n * ADDR_SIZE);
+            len.reserve(n);
+            path_id.reserve(n);
+            isIPv4.reserve(n);
+        }
+
+        void clear() {
+            addr.clear();
+            len.clear();
+            path_id.clear();
+            isIPv4.clear();
+        }
     };
 
     /*********************************************************************//**
@@ -168,18 +219,9 @@ namespace bgp {
      * @param [in]     size  Size of var - Default is size of var
      *********************************************************************/
     inline std::string parse_mac(u_char *data_pointer) {
-        u_char *pointer = data_pointer;
-
-        std::ostringstream mac_stringstream;
-
-        for (int i = 0; i < 6; ++i) {
-            if (i != 0) mac_stringstream << ':';
-            mac_stringstream.width(2);
-            mac_stringstream.fill('0');
-            mac_stringstream << std::hex << (int)(pointer[i]);
-        }
+        char mac_char[TEXTFMT_MAC_STRLEN];
 
-        return mac_stringstream.str();
+        return std::string(mac_char, textfmt::mac(mac_char, data_pointer));
     }
 
     /*********************************************************************//**
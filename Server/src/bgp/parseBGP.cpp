@@ -29,6 +29,10 @@
 #include "OpenMsg.h"
 #include "UpdateMsg.h"
 #include "bgp_common.h"
+#include "TextFormat.h"
+#include "ChurnTracker.h"
+#include "RpkiValidator.h"
+#include "RibIndex.h"
 
 using namespace std;
 
@@ -58,6 +62,8 @@ parseBGP::parseBGP(Logger *logPtr, MsgBusInterface *mbus_ptr, MsgBusInterface::o
 
     bzero(&common_hdr, sizeof(common_hdr));
 
+    base_attr.attr_md5 = NULL;
+
     // Set our mysql pointer
     this->mbus_ptr = mbus_ptr;
 
@@ -104,6 +110,9 @@ bool parseBGP::handleUpdate(u_char *data, size_t size) {
 
         data_bytes_remaining -= read_size;
 
+        if (p_info != NULL and p_info->rollup != NULL)
+            RollupUpdate(parsed_data, size);
+
         /*
          * Update the DB with the update data
          */
@@ -113,6 +122,81 @@ bool parseBGP::handleUpdate(u_char *data, size_t size) {
     return false;
 }
 
+/**
+ * Record the update in the per peer rollup counters
+ *
+ * \param  parsed_data          Reference to the parsed update data
+ * \param  size                 Size of the BGP message
+ */
+void parseBGP::RollupUpdate(bgp_msg::UpdateMsg::parsed_update_data &parsed_data, size_t size) {
+    enum { FAM_V4, FAM_V6, FAM_LABEL_V4, FAM_LABEL_V6, FAM_VPN_V4, FAM_VPN_V6, FAM_EVPN, FAM_LS, FAM_MAX };
+
+    static const struct { uint16_t afi; uint8_t safi; } families[FAM_MAX] = {
+            { bgp::BGP_AFI_IPV4,    bgp::BGP_SAFI_UNICAST },
+            { bgp::BGP_AFI_IPV6,    bgp::BGP_SAFI_UNICAST },
+            { bgp::BGP_AFI_IPV4,    bgp::BGP_SAFI_NLRI_LABEL },
+            { bgp::BGP_AFI_IPV6,    bgp::BGP_SAFI_NLRI_LABEL },
+            { bgp::BGP_AFI_IPV4,    bgp::BGP_SAFI_MPLS },
+            { bgp::BGP_AFI_IPV6,    bgp::BGP_SAFI_MPLS },
+            { bgp::BGP_AFI_L2VPN,   bgp::BGP_SAFI_EVPN },
+            { bgp::BGP_AFI_BGPLS,   bgp::BGP_SAFI_BGPLS },
+    };
+
+    uint32_t added[FAM_MAX] = { 0 };
+    uint32_t withdrawn[FAM_MAX] = { 0 };
+
+    for (size_t i = 0; i < parsed_data.unicast_advertised.size(); i++)
+        ++added[parsed_data.unicast_advertised.isIPv4[i] ? FAM_V4 : FAM_V6];
+
+    for (size_t i = 0; i < parsed_data.unicast_withdrawn.size(); i++)
+        ++withdrawn[parsed_data.unicast_withdrawn.isIPv4[i] ? FAM_V4 : FAM_V6];
+
+    for (bgp::prefix_list::iterator it = parsed_data.advertised.begin(); it != parsed_data.advertised.end(); it++)
+        ++added[it->isIPv4 ? FAM_LABEL_V4 : FAM_LABEL_V6];
+
+    for (bgp::prefix_list::iterator it = parsed_data.withdrawn.begin(); it != parsed_data.withdrawn.end(); it++)
+        ++withdrawn[it->isIPv4 ? FAM_LABEL_V4 : FAM_LABEL_V6];
+
+    for (bgp::vpn_list::iterator it = parsed_data.vpn.begin(); it != parsed_data.vpn.end(); it++)
+        ++added[it->isIPv4 ? FAM_VPN_V4 : FAM_VPN_V6];
+
+    for (bgp::vpn_list::iterator it = parsed_data.vpn_withdrawn.begin(); it != parsed_data.vpn_withdrawn.end(); it++)
+        ++withdrawn[it->isIPv4 ? FAM_VPN_V4 : FAM_VPN_V6];
+
+    added[FAM_EVPN] = parsed_data.evpn.size();
+    withdrawn[FAM_EVPN] = parsed_data.evpn_withdrawn.size();
+
+    added[FAM_LS] = parsed_data.ls.nodes.size() + parsed_data.ls.links.size() + parsed_data.ls.prefixes.size();
+    withdrawn[FAM_LS] = parsed_data.ls_withdrawn.nodes.size() + parsed_data.ls_withdrawn.links.size()
+                        + parsed_data.ls_withdrawn.prefixes.size();
+
+    /*
+     * The message and its bytes are counted once, against the first family with NLRI.  The
+     *      attribute set is counted against the first family with advertised NLRI.  An update
+     *      without NLRI (e.g. End-of-RIB) is counted as IPv4 unicast.
+     */
+    bool msg_counted = false;
+    bool attrs_counted = parsed_data.attrs.empty();
+
+    for (int fam = 0; fam < FAM_MAX; fam++) {
+        if (added[fam] == 0 and withdrawn[fam] == 0)
+            continue;
+
+        uint32_t attr_sets = 0;
+        if (not attrs_counted and added[fam] > 0) {
+            attr_sets = 1;
+            attrs_counted = true;
+        }
+
+        p_info->rollup->record(*p_entry, families[fam].afi, families[fam].safi, added[fam], withdrawn[fam],
+                               attr_sets, msg_counted ? 0 : 1, msg_counted ? 0 : size);
+        msg_counted = true;
+    }
+
+    if (not msg_counted)
+        p_info->rollup->record(*p_entry, bgp::BGP_AFI_IPV4, bgp::BGP_SAFI_UNICAST, 0, 0, 0, 1, size);
+}
+
 /**
  * handle BGP notify event - updates the down event with parsed data
  *
@@ -174,8 +258,8 @@ int parseBGP::handleUpEvent(u_char *data, size_t size, MsgBusInterface::obj_peer
     size_t              read_size;
     int                 total_read_size = 0;
 
-    p_info->recv_four_octet_asn = false;
-    p_info->sent_four_octet_asn = false;
+    // Capabilities are renegotiated on every peer up
+    p_info->capabilities.clear();
     p_info->using_2_octet_asn = false;
 
 
@@ -209,10 +293,6 @@ int parseBGP::handleUpEvent(u_char *data, size_t size, MsgBusInterface::obj_peer
             if ( it != cap_list.begin())
                 cap_str.append(", ");
 
-            // Check for 4 octet ASN support
-            if ((*it).find("4 Octet ASN") != std::string::npos)
-                p_info->sent_four_octet_asn = true;
-
             cap_str.append((*it));
         }
 
@@ -254,10 +334,6 @@ int parseBGP::handleUpEvent(u_char *data, size_t size, MsgBusInterface::obj_peer
             if ( it != cap_list.begin())
                 cap_str.append(", ");
 
-            // Check for 4 octet ASN support - reset to false if
-            if ((*it).find("4 Octet ASN") != std::string::npos)
-                p_info->recv_four_octet_asn = true;
-
             cap_str.append((*it));
         }
 
@@ -269,6 +345,9 @@ int parseBGP::handleUpEvent(u_char *data, size_t size, MsgBusInterface::obj_peer
         throw "ERROR: Invalid BGP MSG for BMP Received OPEN message, expected OPEN message.";
     }
 
+    // Both OPEN messages are parsed, select the update decoders for the negotiated capabilities
+    p_info->decoders.select(p_info->capabilities);
+
     return total_read_size;
 }
 
@@ -361,7 +440,7 @@ void parseBGP::UpdateDB(bgp_msg::UpdateMsg::parsed_update_data &parsed_data) {
     /*
      * Update the advertised prefixes (both ipv4 and ipv6)
      */
-    UpdateDBAdvPrefixes(parsed_data.advertised, parsed_data.attrs);
+    UpdateDBAdvPrefixes(parsed_data.unicast_advertised, parsed_data.advertised, parsed_data.attrs);
 
     UpdateDBL3Vpn(false,parsed_data.vpn, parsed_data.attrs);
     UpdateDBL3Vpn(true,parsed_data.vpn_withdrawn, parsed_data.attrs);
@@ -372,10 +451,19 @@ void parseBGP::UpdateDB(bgp_msg::UpdateMsg::parsed_update_data &parsed_data) {
     /*
      * Update withdraws (both ipv4 and ipv6)
      */
-    UpdateDBWdrawnPrefixes(parsed_data.withdrawn);
+    UpdateDBWdrawnPrefixes(parsed_data.unicast_withdrawn, parsed_data.withdrawn);
 
 }
 
+/**
+ * True if a consumer of the advertised prefixes keeps references to the shared
+ *      attribute set (RIB index, Loc-RIB or update coalescer)
+ */
+bool parseBGP::retainsAttrRefs() const {
+    return RibIndex::instance().enabled() or
+           (p_info != NULL and (p_info->loc_rib != NULL or p_info->coalescer != NULL));
+}
+
 /**
  * Update the Database path attributes
  *
@@ -385,6 +473,9 @@ void parseBGP::UpdateDB(bgp_msg::UpdateMsg::parsed_update_data &parsed_data) {
  */
 void parseBGP::UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
 
+    // Drop the previous update's shared entry
+    base_attr_ref.reset();
+
     /*
      * Setup the record
      */
@@ -396,12 +487,16 @@ void parseBGP::UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
 
     base_attr.atomic_agg               = ((string)attrs[bgp_msg::ATTR_TYPE_ATOMIC_AGGREGATE]).compare("1") == 0 ? true : false;
 
-    if (((string)attrs[bgp_msg::ATTR_TYPE_LOCAL_PREF]).length() > 0)
+    base_attr.local_pref_present       = ((string)attrs[bgp_msg::ATTR_TYPE_LOCAL_PREF]).length() > 0;
+
+    if (base_attr.local_pref_present)
         base_attr.local_pref = std::stoul(((string)attrs[bgp_msg::ATTR_TYPE_LOCAL_PREF]));
     else
         base_attr.local_pref = 0;
 
-    if (((string)attrs[bgp_msg::ATTR_TYPE_MED]).length() > 0)
+    base_attr.med_present              = ((string)attrs[bgp_msg::ATTR_TYPE_MED]).length() > 0;
+
+    if (base_attr.med_present)
         base_attr.med = std::stoul(((string)attrs[bgp_msg::ATTR_TYPE_MED]));
     else
         base_attr.med = 0;
@@ -416,6 +511,11 @@ void parseBGP::UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
     else
         base_attr.origin_as = 0;
 
+    if (((string)attrs[bgp_msg::ATTR_TYPE_INTERNAL_AS_NEIGHBOR]).length() > 0)
+        base_attr.neighbor_as = std::stoul(((string)attrs[bgp_msg::ATTR_TYPE_INTERNAL_AS_NEIGHBOR]));
+    else
+        base_attr.neighbor_as = 0;
+
     if (((string)attrs[bgp_msg::ATTR_TYPE_ORIGINATOR_ID]).length() > 0)
         strncpy(base_attr.originator_id, ((string)attrs[bgp_msg::ATTR_TYPE_ORIGINATOR_ID]).c_str(), sizeof(base_attr.originator_id));
     else
@@ -444,9 +544,22 @@ void parseBGP::UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
         SELF_DEBUG("%s: no next-hop, must be unreach; not sending attributes to message bus", p_entry->peer_addr);
         bzero(base_attr.next_hop, sizeof(base_attr.next_hop));
         bzero(path_hash_id, sizeof(path_hash_id));
+        base_attr.attr_md5 = NULL;
         return;
     }
 
+    /*
+     * Share the attribute set with the other router sessions when a consumer keeps
+     *      references to it; the table entry also carries the MD5 state of the
+     *      attribute fields for the path hash.  Otherwise the message bus hashes
+     *      the fields itself.
+     */
+    base_attr.attr_md5 = NULL;
+    if (retainsAttrRefs()) {
+        base_attr_ref = PathAttrTable::instance().intern(base_attr);
+        base_attr.attr_md5 = &base_attr_ref->attr_md5;
+    }
+
     SELF_DEBUG("%s: adding attributes to message bus", p_entry->peer_addr);
 
     // Update the DB entry
@@ -465,9 +578,9 @@ void parseBGP::UpdateDBAttrs(bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
  * \param [in] prefixes        Reference to the list<vpn_tuple> of advertised vpns
  * \param [in] attrs           Reference to the parsed attributes map
  */
-void parseBGP::UpdateDBL3Vpn(bool remove, std::list<bgp::vpn_tuple> &prefixes,
+void parseBGP::UpdateDBL3Vpn(bool remove, bgp::vpn_list &prefixes,
                              bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
-    vector<MsgBusInterface::obj_vpn> rib_list;
+    MsgBusInterface::vpn_vector      rib_list;
     MsgBusInterface::obj_vpn         rib_entry;
     uint32_t                         value_32bit;
     uint64_t                         value_64bit;
@@ -475,7 +588,7 @@ void parseBGP::UpdateDBL3Vpn(bool remove, std::list<bgp::vpn_tuple> &prefixes,
     /*
      * Loop through all vpn and add/update them in the DB
      */
-    for (std::list<bgp::vpn_tuple>::iterator it = prefixes.begin();
+    for (bgp::vpn_list::iterator it = prefixes.begin();
                                                 it != prefixes.end();
                                                 it++) {
         bgp::vpn_tuple &tuple = (*it);
@@ -567,16 +680,16 @@ void parseBGP::UpdateDBL3Vpn(bool remove, std::list<bgp::vpn_tuple> &prefixes,
  * \param [in] nlris           Reference to the list<evpn_tuple>
  * \param [in] attrs           Reference to the parsed attributes map
  */
-void parseBGP::UpdateDBeVPN(bool remove, std::list<bgp::evpn_tuple> &nlris,
+void parseBGP::UpdateDBeVPN(bool remove, bgp::evpn_list &nlris,
                            bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
 
-    vector<MsgBusInterface::obj_evpn> rib_list;
+    MsgBusInterface::evpn_vector      rib_list;
     MsgBusInterface::obj_evpn         rib_entry;
 
     /*
      * Loop through all vpn and add/update them in the DB
      */
-    for (std::list<bgp::evpn_tuple>::iterator it = nlris.begin();
+    for (bgp::evpn_list::iterator it = nlris.begin();
          it != nlris.end();
          it++) {
         bgp::evpn_tuple &tuple = (*it);
@@ -619,98 +732,175 @@ void parseBGP::UpdateDBeVPN(bool remove, std::list<bgp::evpn_tuple> &nlris,
 }
 
 
+/**
+ * Set the prefix fields of a rib entry from the binary prefix
+ *
+ * \details Sets the printed prefix, length, binary and broadcast (last address) forms
+ *
+ * \param [out] rib_entry      Rib entry to update
+ * \param [in]  isIPv4         True if IPv4, false if IPv6
+ * \param [in]  len            Prefix length in bits
+ * \param [in]  prefix_bin     Prefix in binary form (16 bytes, IPv4 in first 4 bytes)
+ * \param [in]  prefix         Printed form of the prefix if already known, NULL to print prefix_bin
+ */
+void parseBGP::setRibPrefix(MsgBusInterface::obj_rib &rib_entry, bool isIPv4, uint8_t len,
+                            const uint8_t *prefix_bin, const char *prefix) {
+    uint32_t                         value_32bit;
+    uint64_t                         value_64bit;
+
+    if (prefix != NULL)
+        strncpy(rib_entry.prefix, prefix, sizeof(rib_entry.prefix));
+    else
+        textfmt::ip(rib_entry.prefix, prefix_bin, isIPv4);
+
+    rib_entry.prefix_len     = len;
+
+    rib_entry.isIPv4 = isIPv4 ? 1 : 0;
+
+    memcpy(rib_entry.prefix_bin, prefix_bin, sizeof(rib_entry.prefix_bin));
+
+    // Add the ending IP for the prefix based on bits
+    if (rib_entry.isIPv4) {
+        if (len < 32) {
+            memcpy(&value_32bit, prefix_bin, 4);
+            bgp::SWAP_BYTES(&value_32bit);
+
+            value_32bit |= 0xFFFFFFFF >> len;
+            bgp::SWAP_BYTES(&value_32bit);
+            memcpy(rib_entry.prefix_bcast_bin, &value_32bit, 4);
+
+        } else
+            memcpy(rib_entry.prefix_bcast_bin, prefix_bin, sizeof(rib_entry.prefix_bcast_bin));
+
+    } else {
+        if (len < 128) {
+            if (len >= 64) {
+                // High order bytes are left alone
+                memcpy(rib_entry.prefix_bcast_bin, prefix_bin, 8);
+
+                // Low order bytes are updated
+                memcpy(&value_64bit, &prefix_bin[8], 8);
+                bgp::SWAP_BYTES(&value_64bit);
+
+                value_64bit |= 0xFFFFFFFFFFFFFFFF >> (len - 64);
+                bgp::SWAP_BYTES(&value_64bit);
+                memcpy(&rib_entry.prefix_bcast_bin[8], &value_64bit, 8);
+
+            } else {
+                // Low order types are all ones
+                value_64bit = 0xFFFFFFFFFFFFFFFF;
+                memcpy(&rib_entry.prefix_bcast_bin[8], &value_64bit, 8);
+
+                // High order bypes are updated
+                memcpy(&value_64bit, prefix_bin, 8);
+                bgp::SWAP_BYTES(&value_64bit);
+
+                value_64bit |= 0xFFFFFFFFFFFFFFFF >> len;
+                bgp::SWAP_BYTES(&value_64bit);
+                memcpy(rib_entry.prefix_bcast_bin, &value_64bit, 8);
+            }
+        } else
+            memcpy(rib_entry.prefix_bcast_bin, prefix_bin, sizeof(rib_entry.prefix_bcast_bin));
+    }
+}
+
 /**
  * Update the Database advertised prefixes
  *
  * \details This method will update the database for the supplied advertised prefixes
  *
- * \param  adv_prefixes         Reference to the list<prefix_tuple> of advertised prefixes
+ * \param  unicast_prefixes     Reference to the bulk decoded unicast prefixes
+ * \param  adv_prefixes         Reference to the list<prefix_tuple> of advertised (labeled) prefixes
  * \param  attrs            Reference to the parsed attributes map
  */
-void parseBGP::UpdateDBAdvPrefixes(std::list<bgp::prefix_tuple> &adv_prefixes,
+void parseBGP::UpdateDBAdvPrefixes(bgp::prefix_array &unicast_prefixes, bgp::prefix_list &adv_prefixes,
                                    bgp_msg::UpdateMsg::parsed_attrs_map &attrs) {
-    vector<MsgBusInterface::obj_rib> rib_list;
+    MsgBusInterface::rib_vector      rib_list;
     MsgBusInterface::obj_rib         rib_entry;
-    uint32_t                         value_32bit;
-    uint64_t                         value_64bit;
+
+    rib_list.reserve(unicast_prefixes.size() + adv_prefixes.size());
+
+    memcpy(rib_entry.path_attr_hash_id, path_hash_id, sizeof(rib_entry.path_attr_hash_id));
+    memcpy(rib_entry.peer_hash_id, p_entry->hash_id, sizeof(rib_entry.peer_hash_id));
 
     /*
-     * Loop through all prefixes and add/update them in the DB
+     * Loop through all labeled prefixes.  They come from MP_REACH, which is parsed before
+     *      the IPv4 NLRI field, so they go first to keep the parse order.  An UPDATE has one
+     *      MP_REACH, so it never carries both labeled and MP unicast prefixes.
      */
-    for (std::list<bgp::prefix_tuple>::iterator it = adv_prefixes.begin();
+    rib_entry.rpki_state = MsgBusInterface::RPKI_STATE_NOT_CHECKED;
+    for (bgp::prefix_list::iterator it = adv_prefixes.begin();
                                                 it != adv_prefixes.end();
                                                 it++) {
         bgp::prefix_tuple &tuple = (*it);
 
-        memcpy(rib_entry.path_attr_hash_id, path_hash_id, sizeof(rib_entry.path_attr_hash_id));
-        memcpy(rib_entry.peer_hash_id, p_entry->hash_id, sizeof(rib_entry.peer_hash_id));
+        setRibPrefix(rib_entry, tuple.isIPv4, tuple.len, tuple.prefix_bin, tuple.prefix.c_str());
 
-        strncpy(rib_entry.prefix, tuple.prefix.c_str(), sizeof(rib_entry.prefix));
+        rib_entry.path_id = tuple.path_id;
+        snprintf(rib_entry.labels, sizeof(rib_entry.labels), "%s", tuple.labels.c_str());
 
-        rib_entry.prefix_len     = tuple.len;
+        SELF_DEBUG("%s: Adding prefix=%s len=%d", p_entry->peer_addr, rib_entry.prefix, rib_entry.prefix_len);
 
-        rib_entry.isIPv4 = tuple.isIPv4 ? 1 : 0;
+        // Add entry to the list
+        rib_list.push_back(rib_entry);
+    }
 
-        memcpy(rib_entry.prefix_bin, tuple.prefix_bin, sizeof(rib_entry.prefix_bin));
+    /*
+     * Loop through the unicast prefixes; printed form is produced directly into the rib entry
+     */
+    rib_entry.labels[0] = 0;
+    for (size_t i = 0; i < unicast_prefixes.size(); i++) {
+        setRibPrefix(rib_entry, unicast_prefixes.isIPv4[i], unicast_prefixes.len[i],
+                     unicast_prefixes.prefix_bin(i));
+        rib_entry.path_id = unicast_prefixes.path_id[i];
 
-        // Add the ending IP for the prefix based on bits
-        if (rib_entry.isIPv4) {
-            if (tuple.len < 32) {
-                memcpy(&value_32bit, tuple.prefix_bin, 4);
-                bgp::SWAP_BYTES(&value_32bit);
+        SELF_DEBUG("%s: Adding prefix=%s len=%d", p_entry->peer_addr, rib_entry.prefix, rib_entry.prefix_len);
 
-                value_32bit |= 0xFFFFFFFF >> tuple.len;
-                bgp::SWAP_BYTES(&value_32bit);
-                memcpy(rib_entry.prefix_bcast_bin, &value_32bit, 4);
+        rib_list.push_back(rib_entry);
+    }
 
-            } else
-                memcpy(rib_entry.prefix_bcast_bin, tuple.prefix_bin, sizeof(tuple.prefix_bin));
+    // Update the DB, or hold the prefixes in the coalescing window
+    if (rib_list.size() > 0) {
+        /*
+         * Origin validation; a path ending in an AS_SET has no origin ASN (RFC 6811)
+         */
+        RpkiValidator &rpki = RpkiValidator::instance();
+        if (rpki.enabled()) {
+            bool as_set_origin = base_attr.as_path.size() > 0
+                                 and base_attr.as_path[base_attr.as_path.size() - 1] == '}';
 
-        } else {
-            if (tuple.len < 128) {
-                if (tuple.len >= 64) {
-                    // High order bytes are left alone
-                    memcpy(rib_entry.prefix_bcast_bin, tuple.prefix_bin, 8);
+            rpki.validate(rib_list, as_set_origin ? 0 : base_attr.origin_as);
+        }
 
-                    // Low order bytes are updated
-                    memcpy(&value_64bit, &tuple.prefix_bin[8], 8);
-                    bgp::SWAP_BYTES(&value_64bit);
+        ChurnTracker::instance().record(*p_entry, rib_list, base_attr.origin_as, false);
 
-                    value_64bit |= 0xFFFFFFFFFFFFFFFF >> (tuple.len - 64);
-                    bgp::SWAP_BYTES(&value_64bit);
-                    memcpy(&rib_entry.prefix_bcast_bin[8], &value_64bit, 8);
+        RibIndex &rib_index = RibIndex::instance();
+        if (rib_index.enabled()) {
+            if (not base_attr_ref)
+                base_attr_ref = PathAttrTable::instance().intern(base_attr);
 
-                } else {
-                    // Low order types are all ones
-                    value_64bit = 0xFFFFFFFFFFFFFFFF;
-                    memcpy(&rib_entry.prefix_bcast_bin[8], &value_64bit, 8);
+            rib_index.advertise(*p_entry, router_addr.c_str(), rib_list, base_attr_ref, base_attr.origin_as);
+        }
 
-                    // High order bypes are updated
-                    memcpy(&value_64bit, tuple.prefix_bin, 8);
-                    bgp::SWAP_BYTES(&value_64bit);
+        if (p_info != NULL and p_info->loc_rib != NULL and p_info->loc_rib->accepts(*p_entry)) {
+            if (not base_attr_ref)
+                base_attr_ref = PathAttrTable::instance().intern(base_attr);
 
-                    value_64bit |= 0xFFFFFFFFFFFFFFFF >> tuple.len;
-                    bgp::SWAP_BYTES(&value_64bit);
-                    memcpy(rib_entry.prefix_bcast_bin, &value_64bit, 8);
-                }
-            } else
-                memcpy(rib_entry.prefix_bcast_bin, tuple.prefix_bin, sizeof(tuple.prefix_bin));
+            p_info->loc_rib->advertise(mbus_ptr, *p_entry, rib_list, base_attr_ref);
         }
 
-        rib_entry.path_id = tuple.path_id;
-        snprintf(rib_entry.labels, sizeof(rib_entry.labels), "%s", tuple.labels.c_str());
+        if (p_info != NULL and p_info->coalescer != NULL) {
+            if (not base_attr_ref)
+                base_attr_ref = PathAttrTable::instance().intern(base_attr);
 
-        SELF_DEBUG("%s: Adding prefix=%s len=%d", p_entry->peer_addr, rib_entry.prefix, rib_entry.prefix_len);
+            p_info->coalescer->advertise(mbus_ptr, *p_entry, rib_list, base_attr_ref);
 
-        // Add entry to the list
-        rib_list.insert(rib_list.end(), rib_entry);
+        } else
+            mbus_ptr->update_unicastPrefix(*p_entry, rib_list, &base_attr, mbus_ptr->UNICAST_PREFIX_ACTION_ADD);
     }
 
-    // Update the DB
-    if (rib_list.size() > 0)
-        mbus_ptr->update_unicastPrefix(*p_entry, rib_list, &base_attr, mbus_ptr->UNICAST_PREFIX_ACTION_ADD);
-
     rib_list.clear();
+    unicast_prefixes.clear();
     adv_prefixes.clear();
 }
 
@@ -719,29 +909,45 @@ void parseBGP::UpdateDBAdvPrefixes(std::list<bgp::prefix_tuple> &adv_prefixes,
  *
  * \details This method will update the database for the supplied advertised prefixes
  *
- * \param  wdrawn_prefixes         Reference to the list<prefix_tuple> of withdrawn prefixes
+ * \param  unicast_prefixes        Reference to the bulk decoded unicast withdrawn prefixes
+ * \param  wdrawn_prefixes         Reference to the list<prefix_tuple> of withdrawn (labeled) prefixes
  */
-void parseBGP::UpdateDBWdrawnPrefixes(std::list<bgp::prefix_tuple> &wdrawn_prefixes) {
-    vector<MsgBusInterface::obj_rib> rib_list;
+void parseBGP::UpdateDBWdrawnPrefixes(bgp::prefix_array &unicast_prefixes, bgp::prefix_list &wdrawn_prefixes) {
+    MsgBusInterface::rib_vector      rib_list;
     MsgBusInterface::obj_rib         rib_entry;
 
+    rib_list.reserve(unicast_prefixes.size() + wdrawn_prefixes.size());
+
+    memcpy(rib_entry.path_attr_hash_id, path_hash_id, sizeof(rib_entry.path_attr_hash_id));
+    memcpy(rib_entry.peer_hash_id, p_entry->hash_id, sizeof(rib_entry.peer_hash_id));
+
+    /*
+     * Loop through the unicast prefixes; printed form is produced directly into the rib entry.
+     *      The IPv4 withdrawn field is parsed before MP_UNREACH, so unicast goes first to keep
+     *      the parse order.
+     */
+    rib_entry.labels[0] = 0;
+    rib_entry.rpki_state = MsgBusInterface::RPKI_STATE_NOT_CHECKED;
+    for (size_t i = 0; i < unicast_prefixes.size(); i++) {
+        setRibPrefix(rib_entry, unicast_prefixes.isIPv4[i], unicast_prefixes.len[i],
+                     unicast_prefixes.prefix_bin(i));
+        rib_entry.path_id = unicast_prefixes.path_id[i];
+
+        SELF_DEBUG("%s: Removing prefix=%s len=%d", p_entry->peer_addr, rib_entry.prefix, rib_entry.prefix_len);
+
+        rib_list.push_back(rib_entry);
+    }
+
     /*
-     * Loop through all prefixes and add/update them in the DB
+     * Loop through all labeled prefixes
      */
-    for (std::list<bgp::prefix_tuple>::iterator it = wdrawn_prefixes.begin();
+    for (bgp::prefix_list::iterator it = wdrawn_prefixes.begin();
                                                 it != wdrawn_prefixes.end();
                                                 it++) {
 
         bgp::prefix_tuple &tuple = (*it);
-        memcpy(rib_entry.path_attr_hash_id, path_hash_id, sizeof(rib_entry.path_attr_hash_id));
-        memcpy(rib_entry.peer_hash_id, p_entry->hash_id, sizeof(rib_entry.peer_hash_id));
-        strncpy(rib_entry.prefix, tuple.prefix.c_str(), sizeof(rib_entry.prefix));
-
-        rib_entry.prefix_len     = tuple.len;
 
-        rib_entry.isIPv4 = tuple.isIPv4 ? 1 : 0;
-
-        memcpy(rib_entry.prefix_bin, tuple.prefix_bin, sizeof(rib_entry.prefix_bin));
+        setRibPrefix(rib_entry, tuple.isIPv4, tuple.len, tuple.prefix_bin, tuple.prefix.c_str());
 
         rib_entry.path_id = tuple.path_id;
         snprintf(rib_entry.labels, sizeof(rib_entry.labels), "%s", tuple.labels.c_str());
@@ -749,14 +955,27 @@ void parseBGP::UpdateDBWdrawnPrefixes(std::list<bgp::prefix_tuple> &wdrawn_prefi
         SELF_DEBUG("%s: Removing prefix=%s len=%d", p_entry->peer_addr, rib_entry.prefix, rib_entry.prefix_len);
 
         // Add entry to the list
-        rib_list.insert(rib_list.end(), rib_entry);
+        rib_list.push_back(rib_entry);
     }
 
-    // Update the DB
-    if (rib_list.size() > 0)
-        mbus_ptr->update_unicastPrefix(*p_entry, rib_list, NULL, mbus_ptr->UNICAST_PREFIX_ACTION_DEL);
+    // Update the DB, or hold the prefixes in the coalescing window
+    if (rib_list.size() > 0) {
+        ChurnTracker::instance().record(*p_entry, rib_list, 0, true);
+
+        if (RibIndex::instance().enabled())
+            RibIndex::instance().withdraw(*p_entry, rib_list);
+
+        if (p_info != NULL and p_info->loc_rib != NULL)
+            p_info->loc_rib->withdraw(mbus_ptr, *p_entry, rib_list);
+
+        if (p_info != NULL and p_info->coalescer != NULL)
+            p_info->coalescer->withdraw(mbus_ptr, *p_entry, rib_list);
+        else
+            mbus_ptr->update_unicastPrefix(*p_entry, rib_list, NULL, mbus_ptr->UNICAST_PREFIX_ACTION_DEL);
+    }
 
     rib_list.clear();
+    unicast_prefixes.clear();
     wdrawn_prefixes.clear();
 }
 
@@ -17,6 +17,7 @@
 #include "Logger.h"
 #include "bgp_common.h"
 #include "UpdateMsg.h"
+#include "PathAttrTable.h"
 
 
 using namespace std;
@@ -150,6 +151,7 @@ private:
 
     MsgBusInterface::obj_bgp_peer    *p_entry;       ///< peer table entry - will be updated with BMP info
     MsgBusInterface::obj_path_attr   base_attr;      ///< Base attribute object
+    PathAttrTable::ref               base_attr_ref;  ///< Shared table entry for base_attr
 
     MsgBusInterface *mbus_ptr;                       ///< Pointer to open DB implementation
     string                           router_addr;    ///< Router IP address - used for logging
@@ -175,6 +177,12 @@ private:
      */
     u_char parseBgpHeader(u_char *data, size_t size);
 
+    /**
+     * True if a consumer of the advertised prefixes keeps references to the shared
+     *      attribute set (RIB index, Loc-RIB or update coalescer)
+     */
+    bool retainsAttrRefs() const;
+
     /**
      * Update the Database with the parsed updated data
      *
@@ -184,6 +192,17 @@ private:
      */
     void UpdateDB(bgp_msg::UpdateMsg::parsed_update_data &parsed_data);
 
+    /**
+     * Record the update in the per peer rollup counters
+     *
+     * \details Counts the prefixes per address family of the parsed update.  Must be
+     *          called before UpdateDB, which consumes the parsed prefixes.
+     *
+     * \param  parsed_data          Reference to the parsed update data
+     * \param  size                 Size of the BGP message
+     */
+    void RollupUpdate(bgp_msg::UpdateMsg::parsed_update_data &parsed_data, size_t size);
+
     /**
      * Update the Database path attributes
      *
@@ -198,19 +217,36 @@ private:
      *
      * \details This method will update the database for the supplied advertised prefixes
      *
-     * \param  adv_prefixes         Reference to the list<prefix_tuple> of advertised prefixes
+     * \param  unicast_prefixes     Reference to the bulk decoded unicast prefixes
+     * \param  adv_prefixes         Reference to the list<prefix_tuple> of advertised (labeled) prefixes
      * \param  attrs            Reference to the parsed attributes map
      */
-    void UpdateDBAdvPrefixes(std::list<bgp::prefix_tuple> &adv_prefixes, bgp_msg::UpdateMsg::parsed_attrs_map &attrs);
+    void UpdateDBAdvPrefixes(bgp::prefix_array &unicast_prefixes, bgp::prefix_list &adv_prefixes,
+                             bgp_msg::UpdateMsg::parsed_attrs_map &attrs);
 
     /**
      * Update the Database withdrawn prefixes
      *
      * \details This method will update the database for the supplied advertised prefixes
      *
-     * \param  wdrawn_prefixes         Reference to the list<prefix_tuple> of withdrawn prefixes
+     * \param  unicast_prefixes        Reference to the bulk decoded unicast withdrawn prefixes
+     * \param  wdrawn_prefixes         Reference to the list<prefix_tuple> of withdrawn (labeled) prefixes
+     */
+    void UpdateDBWdrawnPrefixes(bgp::prefix_array &unicast_prefixes, bgp::prefix_list &wdrawn_prefixes);
+
+    /**
+     * Set the prefix fields of a rib entry from the binary prefix
+     *
+     * \details Sets the printed prefix, length, binary and broadcast (last address) forms
+     *
+     * \param [out] rib_entry      Rib entry to update
+     * \param [in]  isIPv4         True if IPv4, false if IPv6
+     * \param [in]  len            Prefix length in bits
+     * \param [in]  prefix_bin     Prefix in binary form (16 bytes, IPv4 in first 4 bytes)
+     * \param [in]  prefix         Printed form of the prefix if already known, NULL to print prefix_bin
      */
-    void UpdateDBWdrawnPrefixes(std::list<bgp::prefix_tuple> &wdrawn_prefixes);
+    static void setRibPrefix(MsgBusInterface::obj_rib &rib_entry, bool isIPv4, uint8_t len,
+                             const uint8_t *prefix_bin, const char *prefix=NULL);
 
     /**
      * Update the Database advertised l3vpn 
@@ -221,7 +257,7 @@ private:
      * \param [in] adv_vpn      Reference to the list<vpn_tuple> of advertised vpns
      * \param [in] attrs        Reference to the parsed attributes map
      */ 
-    void UpdateDBL3Vpn(bool remove, std::list<bgp::vpn_tuple> &adv_vpn, bgp_msg::UpdateMsg::parsed_attrs_map &attrs);
+    void UpdateDBL3Vpn(bool remove, bgp::vpn_list &adv_vpn, bgp_msg::UpdateMsg::parsed_attrs_map &attrs);
 
     /**
      * Updates for either advertised or withdrawn Evpn NLRI's
@@ -230,7 +266,7 @@ private:
      * \param [in] nlris           Reference to the list<evpn_tuple>
      * \param [in] attrs           Reference to the parsed attributes map
      */
-    void UpdateDBeVPN(bool remove, std::list<bgp::evpn_tuple> &nlris, bgp_msg::UpdateMsg::parsed_attrs_map &attrs);
+    void UpdateDBeVPN(bool remove, bgp::evpn_list &nlris, bgp_msg::UpdateMsg::parsed_attrs_map &attrs);
 
     /**
      * Update the Database for bgp-ls
@@ -12,12 +12,15 @@
 #include <arpa/inet.h>
 #include <cstdio>
 #include <unistd.h>
+#include <poll.h>
+#include <sys/ioctl.h>
 
 #include <iostream>
 #include <cstring>
 #include <cstdlib>
 #include <string>
 #include <cerrno>
+#include <cinttypes>
 
 #include "BMPListener.h"
 #include "BMPReader.h"
@@ -26,6 +29,10 @@
 #include "MsgBusInterface.hpp"
 #include "Logger.h"
 #include "md5.h"
+#include "RibIndex.h"
+#include "OverloadControl.h"
+#include "IngestScheduler.h"
+#include "CpuPlacement.h"
 
 using namespace std;
 
@@ -36,7 +43,12 @@ using namespace std;
  *  \param [in] config  Pointer to the loaded configuration
  *
  */
-BMPReader::BMPReader(Logger *logPtr, Config *config) {
+BMPReader::BMPReader(Logger *logPtr, Config *config) : intern_cache(config->intern_cache_size),
+                                                        coalescer(config->coalesce_window_ms),
+                                                        rollup(config->rollup_interval),
+                                                        loc_rib(config->best_path, config->best_path_pre_policy),
+                                                        mrt(logPtr, config->mrt_directory, config->mrt_rotate_interval,
+                                                            config->mrt_compress) {
     debug = false;
 
     cfg = config;
@@ -48,6 +60,9 @@ BMPReader::BMPReader(Logger *logPtr, Config *config) {
     
     hasPrevRIBdumpTime = false;
     maxRIBdumpRate = 0;
+    sched_router = NULL;
+    parse_cpu = -1;
+    collector_shutdown = false;
 }
 
 /**
@@ -70,17 +85,125 @@ BMPReader::~BMPReader() {
  * \throw (char const *str) message indicate error
  */
 void BMPReader::readerThreadLoop(bool &run, BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr) {
+    pollfd pfd;
+
+    mrt.setRouter(client->c_ip);
+
+    if (not CpuPlacement::pin(parse_cpu))
+        LOG_WARN("%s: Failed to pin the parse thread to cpu %d", client->c_ip, parse_cpu);
+
+    if (IngestScheduler::instance().enabled())
+        sched_router = IngestScheduler::instance().add();
+
+    int read_fd = client->pipe_sock > 0 ? client->pipe_sock : client->c_sock;
+
     while (run) {
 
         try {
+            /*
+             * While prefix updates or rollup counters are pending, or an MRT file is open, wait for
+             *      the next message only until the oldest coalescing window or the rollup window
+             *      closes, the MRT file is rotated or the message bus batches are due.
+             */
+            int timeout = coalescer.msUntilExpiry();
+            int rollup_timeout = rollup.msUntilExpiry();
+            int mrt_timeout = mrt.msUntilRotation();
+            int mbus_timeout = mbus_ptr->msUntilFlush();
+
+            if (rollup_timeout >= 0 and (timeout < 0 or rollup_timeout < timeout))
+                timeout = rollup_timeout;
+
+            if (mrt_timeout >= 0 and (timeout < 0 or mrt_timeout < timeout))
+                timeout = mrt_timeout;
+
+            if (mbus_timeout >= 0 and (timeout < 0 or mbus_timeout < timeout))
+                timeout = mbus_timeout;
+
+            /*
+             * Scheduled routers hold a worker slot only while the next message is fully
+             *      buffered; otherwise the slot is given up before waiting for data.
+             */
+            size_t msg_len = 0;
+            bool wait = timeout >= 0;
+
+            if (sched_router != NULL and (msg_len = bufferedMsgLen(read_fd)) == 0) {
+                IngestScheduler::instance().release(sched_router);
+                wait = true;
+            }
+
+            if (wait and msg_len == 0) {
+                pfd.fd = read_fd;
+                pfd.events = POLLIN | POLLHUP | POLLERR;
+                pfd.revents = 0;
+
+                if (poll(&pfd, 1, timeout) == 0) {
+                    coalescer.flushExpired(mbus_ptr);
+                    rollup.flushExpired(mbus_ptr);
+                    mrt.rotateExpired();
+                    mbus_ptr->flush();
+                    continue;
+                }
+
+                // A message that is not complete yet is read without a slot
+                if (sched_router != NULL)
+                    msg_len = bufferedMsgLen(read_fd);
+            }
+
+            if (msg_len > 0 and not IngestScheduler::instance().holding(sched_router)) {
+                if (mbus_ptr->routerGroup() != sched_group) {
+                    sched_group = mbus_ptr->routerGroup();
+
+                    std::map<std::string, uint32_t>::iterator it = cfg->router_group_weight.find(sched_group);
+                    IngestScheduler::instance().setWeight(sched_router,
+                                                          it != cfg->router_group_weight.end() ? it->second : 1);
+                }
+
+                IngestScheduler::instance().acquire(sched_router);
+            }
+
             if (not ReadIncomingMsg(client, mbus_ptr))
                 break;
 
+            if (msg_len > 0)
+                IngestScheduler::instance().charge(sched_router, msg_len);
+
+            coalescer.flushExpired(mbus_ptr);
+            rollup.flushExpired(mbus_ptr);
+            mrt.rotateExpired();
+            mbus_ptr->flush();
+
         } catch (char const *str) {
             run = false;
             break;
         }
     }
+
+    IngestScheduler::instance().remove(sched_router);
+    sched_router = NULL;
+}
+
+/**
+ * Length of the next BMP message if it is fully buffered
+ *
+ * \param [in]  fd          Socket to peek
+ *
+ * \return message length, zero if the message is not fully buffered or not BMP v3
+ */
+size_t BMPReader::bufferedMsgLen(int fd) {
+    u_char hdr[5];
+    int buffered = 0;
+    uint32_t len;
+
+    if (recv(fd, hdr, sizeof(hdr), MSG_PEEK | MSG_DONTWAIT) != sizeof(hdr) or hdr[0] != 3)
+        return 0;
+
+    memcpy(&len, hdr + 1, sizeof(len));
+    bgp::SWAP_BYTES(&len);
+
+    if (ioctl(fd, FIONREAD, &buffered) != 0 or buffered < 0 or (uint32_t)buffered < len)
+        return 0;
+
+    return len;
 }
 
 /**
@@ -96,8 +219,15 @@ void BMPReader::readerThreadLoop(bool &run, BMPListener::ClientInfo *client, Msg
  * \throw (char const *str) message indicate error
  */
 bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr) {
+    /*
+     * Parse products for this message are allocated from the arena, which is reset
+     *      in O(1) when the scope ends.  Nothing arena backed may outlive this method.
+     */
+    ParseArena::Scope arena_scope(&arena);
+
     bool rval = true;
-    string peer_info_key;
+    peer_info_key_t peer_info_key;
+    peer_info *p_info = NULL;                       // Persistent info for the peer of this message
 
     parseBGP *pBGP;                                 // Pointer to BGP parser
 
@@ -139,14 +269,25 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
         if (bmp_type < 4) {
             // Update p_entry hash_id now that add_Router updated it.
             memcpy(p_entry.router_hash_id, r_object.hash_id, sizeof(r_object.hash_id));
-            peer_info_key =  p_entry.peer_addr;
-            peer_info_key += p_entry.peer_rd;
+            memcpy(peer_info_key.data, p_entry.peer_addr_bin, sizeof(p_entry.peer_addr_bin));
+            memcpy(peer_info_key.data + sizeof(p_entry.peer_addr_bin), p_entry.peer_rd_bin,
+                   sizeof(p_entry.peer_rd_bin));
+
+            /*
+             * Single lookup per message. The entry is only inserted here, so the pointer
+             *      stays valid for the rest of this message.
+             */
+            p_info = &peer_info_map[peer_info_key];
+            p_info->intern_cache = cfg->intern_cache_size > 0 ? &intern_cache : NULL;
+            p_info->coalescer = coalescer.enabled() ? &coalescer : NULL;
+            p_info->rollup = rollup.enabled() ? &rollup : NULL;
+            p_info->loc_rib = loc_rib.enabled() ? &loc_rib : NULL;
 
             if (bmp_type != parseBMP::TYPE_PEER_UP)
                 mbus_ptr->update_Peer(p_entry, NULL, NULL, mbus_ptr->PEER_ACTION_FIRST);     // add the peer entry
 
-            if (not peer_info_map[peer_info_key].using_2_octet_asn and p_entry.isTwoOctet) {
-                peer_info_map[peer_info_key].using_2_octet_asn = true;
+            if (not p_info->using_2_octet_asn and p_entry.isTwoOctet) {
+                p_info->using_2_octet_asn = true;
             }
         }
 
@@ -162,10 +303,12 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
                 if (pBMP->parsePeerDownEventHdr(read_fd,down_event)) {
                     pBMP->bufferBMPMessage(read_fd);
 
+                    mrt.peerDown(p_entry);
+
 
                     // Prepare the BGP parser
                     pBGP = new parseBGP(logger, mbus_ptr, &p_entry, (char *)r_object.ip_addr,
-                                        &peer_info_map[peer_info_key]);
+                                        p_info);
 
                     if (cfg->debug_bgp)
                        pBGP->enableDebug();
@@ -203,6 +346,16 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
 
                     delete pBGP;            // Free the bgp parser after each use.
 
+                    // Publish pending prefix updates of the peer before it goes down
+                    coalescer.flushPeer(mbus_ptr, p_entry.hash_id);
+
+                    if (RibIndex::instance().enabled())
+                        RibIndex::instance().removePeer(p_entry.hash_id);
+
+                    // Publish the best paths that change without the peer
+                    if (loc_rib.enabled())
+                        loc_rib.removePeer(mbus_ptr, p_entry);
+
                     // Add event to the database
                     mbus_ptr->update_Peer(p_entry, NULL, &down_event, mbus_ptr->PEER_ACTION_DOWN);
 
@@ -226,7 +379,7 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
 
                     // Prepare the BGP parser
                     pBGP = new parseBGP(logger, mbus_ptr, &p_entry, (char *)r_object.ip_addr,
-                                        &peer_info_map[peer_info_key]);
+                                        p_info);
 
                     if (cfg->debug_bgp)
                        pBGP->enableDebug();
@@ -234,6 +387,12 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
                     // Parse the BGP sent/received open messages
                     int read = pBGP->handleUpEvent(pBMP->bmp_data, pBMP->bmp_data_len, &up_event);
 
+                    mrt.peerUp(p_entry, up_event);
+
+                    // eBGP or iBGP session, for the best path
+                    if (loc_rib.enabled())
+                        loc_rib.peerUp(p_entry, up_event.local_asn);
+
                                         // Free the bgp parser
                     delete pBGP;
 
@@ -255,12 +414,27 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
             case parseBMP::TYPE_ROUTE_MON : { // Route monitoring type
                 pBMP->bufferBMPMessage(read_fd);
 
+                // Archive the BGP message as received, before it is parsed
+                mrt.message(p_entry, p_info->using_2_octet_asn, pBMP->bmp_data, pBMP->bmp_data_len);
+
+                if (p_entry.isAdjIn and not p_entry.isPrePolicy)
+                    p_info->post_policy = true;
+
+                /*
+                 * Shed route monitoring when overloaded: all of it, or the pre-policy
+                 *      duplicates of peers that also send post-policy
+                 */
+                if (OverloadControl::instance().shedding(OverloadControl::SHED_ROUTE_MON) or
+                        (p_entry.isAdjIn and p_entry.isPrePolicy and p_info->post_policy and
+                         OverloadControl::instance().shedding(OverloadControl::SHED_PRE_POLICY)))
+                    break;
+
                 /*
                  * Read and parse the the BGP message from the client.
                  *     parseBGP will update mysql directly
                  */
                 pBGP = new parseBGP(logger, mbus_ptr, &p_entry, (char *)r_object.ip_addr,
-                                    &peer_info_map[peer_info_key]);
+                                    p_info);
 
                 if (cfg->debug_bgp)
                     pBGP->enableDebug();
@@ -272,7 +446,7 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
                 //check if client has received init message and Baseline time is not already calculated
 		{
 		    peer_info_map_iter it = peer_info_map.begin();
-		    while (it != peer_info_map.end() && it->second.endOfRIB)
+		    while (it != peer_info_map.end() && it.value().endOfRIB)
 		        ++it;
 
 		    if (it == peer_info_map.end() || checkRIBdumpRate(p_entry.timestamp_secs,mbus_ptr->ribSeq)) {  //End-Of-RIBs are received for all peers.
@@ -316,6 +490,14 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
                 pBMP->handleTermMsg(read_fd, r_object);
 
                 LOG_INFO("Proceeding to disconnect router");
+                flushCoalescer(client, mbus_ptr);
+
+                if (RibIndex::instance().enabled())
+                    RibIndex::instance().removeRouter(router_hash_id);
+
+                loc_rib.clear();
+                mrt.close();
+
                 mbus_ptr->update_Router(r_object, mbus_ptr->ROUTER_ACTION_TERM);
                 close(client->c_sock);
 
@@ -327,7 +509,11 @@ bool BMPReader::ReadIncomingMsg(BMPListener::ClientInfo *client, MsgBusInterface
     } catch (char const *str) {
         // Mark the router as disconnected and update the error to be a local disconnect (no term message received)
         LOG_INFO("%s: Caught: %s", client->c_ip, str);
-        disconnect(client, mbus_ptr, parseBMP::TERM_REASON_OPENBMP_CONN_ERR, str);
+
+        if (collector_shutdown)
+            disconnect(client, mbus_ptr, parseBMP::TERM_REASON_OPENBMP_CONN_CLOSED, "Collector shutdown");
+        else
+            disconnect(client, mbus_ptr, parseBMP::TERM_REASON_OPENBMP_CONN_ERR, str);
 
         delete pBMP;                    // Make sure to free the resource
         throw str;
@@ -392,12 +578,44 @@ void BMPReader::disconnect(BMPListener::ClientInfo *client, MsgBusInterface *mbu
     if (reason_text != NULL)
         snprintf(r_object.term_reason_text, sizeof(r_object.term_reason_text), "%s", reason_text);
 
+    flushCoalescer(client, mbus_ptr);
+
+    if (RibIndex::instance().enabled())
+        RibIndex::instance().removeRouter(router_hash_id);
+
+    loc_rib.clear();
+    mrt.close();
+
     mbus_ptr->update_Router(r_object, mbus_ptr->ROUTER_ACTION_TERM);
 
     close(client->c_sock);
     client->c_sock = 0;
 }
 
+/**
+ * Publish all pending prefix updates, rollup counters and message bus batches, and log the
+ *      coalescing counters
+ *
+ * \param [in]  client      Client information pointer
+ * \param [in]  mbus_ptr    The database pointer referencer - DB should be already initialized
+ */
+void BMPReader::flushCoalescer(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr) {
+    rollup.flushAll(mbus_ptr);
+
+    if (not coalescer.enabled()) {
+        mbus_ptr->flush(true);
+        return;
+    }
+
+    coalescer.flushAll(mbus_ptr);
+    mbus_ptr->flush(true);
+
+    const UpdateCoalescer::counters &stats = coalescer.getCounters();
+    LOG_INFO("%s: coalescing: received=%" PRIu64 " coalesced=%" PRIu64 " flaps=%" PRIu64
+             " published=%" PRIu64 " forced=%" PRIu64, client->c_ip,
+             stats.received, stats.coalesced, stats.flaps, stats.published, stats.forced);
+}
+
 
 /**
  * Generate BMP router HASH
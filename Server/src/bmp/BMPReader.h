@@ -12,11 +12,21 @@
 
 #include "BMPListener.h"
 #include "BMPReader.h"
-#include "AddPathDataContainer.h"
+#include "PeerCapabilities.h"
+#include "UpdateDecoders.h"
+#include "AttrInternCache.h"
+#include "UpdateCoalescer.h"
+#include "PeerRollup.h"
+#include "LocRib.h"
+#include "MrtWriter.h"
 #include "MsgBusInterface.hpp"
 #include "Logger.h"
 #include "Config.h"
+#include "ParseArena.h"
+#include "IngestScheduler.h"
+#include "FlatHashMap.hpp"
 
+#include <atomic>
 #include <map>
 #include <memory>
 
@@ -35,12 +45,16 @@ public:
      *   OPEN and other updates can add/change persistent peer information.
      */
     struct peer_info {
-        bool sent_four_octet_asn;                               ///< Indicates if 4 (true) or 2 (false) octet ASN is being used (sent cap)
-        bool recv_four_octet_asn;                               ///< Indicates if 4 (true) or 2 (false) octet ASN is being used (recv cap)
         bool using_2_octet_asn;                                 ///< Indicates if peer is using two octet ASN format or not (true=2 octet, false=4 octet)
-        AddPathDataContainer add_path_capability;               ///< Stores data about Add Path capability
+        PeerCapabilities capabilities;                          ///< Negotiated Add Path and 4 octet ASN capabilities
+        bgp_msg::UpdateDecoders decoders;                       ///< NLRI/AS_PATH decoders selected from the capabilities
+        bgp_msg::AttrInternCache *intern_cache;                 ///< Formatted attribute cache of the reader, NULL if disabled
+        UpdateCoalescer *coalescer;                             ///< Prefix update coalescer of the reader, NULL if disabled
+        PeerRollup *rollup;                                     ///< Per peer rollup counters of the reader, NULL if disabled
+        LocRib *loc_rib;                                        ///< Best path (Loc-RIB) of the reader, NULL if disabled
         string peer_group;                                      ///< Peer group name of defined
 	bool endOfRIB;						///< Indicates if End-Of-RIB marker is received
+        bool post_policy;                                       ///< True once post-policy Adj-RIB-In route monitoring is received
     };
 
 
@@ -101,6 +115,14 @@ public:
      */
     void disconnect(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr, int reason_code, char const *reason_text);
 
+    /**
+     * Publish all pending prefix updates and rollup counters, and log the coalescing counters
+     *
+     * \param [in]  client      Client information pointer
+     * \param [in]  mbus_ptr    The database pointer referencer - DB should be already initialized
+     */
+    void flushCoalescer(BMPListener::ClientInfo *client, MsgBusInterface *mbus_ptr);
+
 /**
      * Calling BMP router HASH
      *
@@ -111,6 +133,20 @@ public:
 
     void hashRouter(BMPListener::ClientInfo *client, MsgBusInterface::obj_router &r_entry);
 
+    /**
+     * Set the CPU the reader thread pins itself to
+     *
+     * \param [in]  cpu         CPU, -1 to leave the thread unpinned
+     */
+    void setParseCpu(int cpu)               { parse_cpu = cpu; }
+
+    /**
+     * Report the end of the BMP stream as a collector shutdown instead of a connection error
+     *
+     * \details Called by the client thread before it ends the stream on shutdown.
+     */
+    void setCollectorShutdown()             { collector_shutdown = true; }
+
     // Debug methods
     void enableDebug();
     void disableDebug();
@@ -129,11 +165,46 @@ private:
     int32_t 	prevRIBdumpTime;            ///< Stores the time the previous message was received
     int32_t 	maxRIBdumpRate;             ///< Stores the maximum RIB dump rate
     int32_t     belowThresholdInitTime;     ///< Stores the time when the RIB dump rate has dropped below threshold
+
+    ParseArena  arena;                      ///< Backs the parse products of the current BMP message
+
+    bgp_msg::AttrInternCache intern_cache;  ///< Formatted attribute cache shared by all peers of the router
+
+    UpdateCoalescer coalescer;              ///< Prefix update coalescing window shared by all peers of the router
+
+    PeerRollup  rollup;                     ///< Per peer rollup counters of all peers of the router
+
+    LocRib      loc_rib;                    ///< Best path (Loc-RIB) of the router
+
+    MrtWriter   mrt;                        ///< MRT archive of the router
+
+    IngestScheduler::router *sched_router;  ///< Ingest scheduling state of the router, NULL if not scheduled
+    std::string sched_group;                ///< Router group of the current scheduling weight
+
+    int         parse_cpu;                  ///< CPU of the reader thread, -1 if not pinned
+
+    std::atomic<bool> collector_shutdown;   ///< True if the stream is ended by the collector shutdown
+
+    /**
+     * Length of the next BMP message if it is fully buffered
+     *
+     * \param [in]  fd          Socket to peek
+     *
+     * \return message length, zero if the message is not fully buffered or not BMP v3
+     */
+    size_t bufferedMsgLen(int fd);
+
+    /**
+     * Persistent peer info map key: peer address (16) and peer RD (8) as received in the
+     *      BMP per-peer header
+     */
+    typedef BinaryKey<24> peer_info_key_t;
+
     /**
-     * Persistent peer info map, Key is the peer_hash_id.
+     * Persistent peer info map, Key is the binary peer address and RD.
      */
-    std::map<std::string, peer_info> peer_info_map;
-    typedef std::map<std::string, peer_info>::iterator peer_info_map_iter;
+    FlatHashMap<peer_info_key_t, peer_info> peer_info_map;
+    typedef FlatHashMap<peer_info_key_t, peer_info>::iterator peer_info_map_iter;
 
 };
 
@@ -253,6 +253,9 @@ void parseBMP::parseBMPv2(int sock) {
     p_entry->peer_as = strtoll(peer_as, NULL, 16);
     strncpy(p_entry->peer_bgp_id, peer_bgp_id, sizeof(peer_bgp_id));
     strncpy(p_entry->peer_rd, peer_rd, sizeof(peer_rd));
+    memcpy(p_entry->peer_addr_bin, c_hdr.peer_addr, sizeof(p_entry->peer_addr_bin));
+    memcpy(p_entry->peer_rd_bin, c_hdr.peer_dist_id, sizeof(p_entry->peer_rd_bin));
+    p_entry->peer_type = c_hdr.peer_type;
 
     // Save the advertised timestamp
     uint32_t ts = c_hdr.ts_secs;
@@ -487,6 +490,9 @@ void parseBMP::parsePeerHdr(int sock) {
     p_entry->peer_as = strtoll(peer_as, NULL, 16);
     strncpy(p_entry->peer_bgp_id, peer_bgp_id, sizeof(p_entry->peer_bgp_id));
     strncpy(p_entry->peer_rd, peer_rd, sizeof(p_entry->peer_rd));
+    memcpy(p_entry->peer_addr_bin, p_hdr.peer_addr, sizeof(p_entry->peer_addr_bin));
+    memcpy(p_entry->peer_rd_bin, p_hdr.peer_dist_id, sizeof(p_entry->peer_rd_bin));
+    p_entry->peer_type = p_hdr.peer_type;
 
     // Save the advertised timestamp
     bgp::SWAP_BYTES(&p_hdr.ts_secs);
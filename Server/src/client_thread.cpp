@@ -17,6 +17,8 @@
 #include "client_thread.h"
 #include "BMPReader.h"
 #include "Logger.h"
+#include "OverloadControl.h"
+#include "CpuPlacement.h"
 
 
 #include <cxxabi.h>
@@ -43,7 +45,8 @@ void ClientThread_cancel(void *arg) {
             close(cInfo->client->c_sock);
         }
 
-        usleep(50000);
+        // Wake the reader if it is blocked on the pipe
+        shutdown(cInfo->client->pipe_sock, SHUT_RDWR);
 
         close(cInfo->client->pipe_sock);
         close(cInfo->bmp_write_end_sock);
@@ -87,6 +90,20 @@ void *ClientThread(void *arg) {
     pollfd pfd;
     unsigned char *sock_buf = NULL;
 
+    /*
+     * Pin before anything of the session is allocated, so that it is allocated on the
+     *  NUMA node of the session (first touch)
+     */
+    CpuPlacement::placement placement = CpuPlacement::instance().place(cInfo.client->c_sock);
+
+    if (placement.node >= 0) {
+        LOG_INFO("%s: Placed on NUMA node %d, ingest cpu %d, parse cpu %d", cInfo.client->c_ip,
+                 placement.node, placement.ingest_cpu, placement.parse_cpu);
+
+        if (not CpuPlacement::pin(placement.ingest_cpu))
+            LOG_WARN("%s: Failed to pin the ingest thread to cpu %d", cInfo.client->c_ip, placement.ingest_cpu);
+    }
+
     /*
      * Setup the cleanup routine for when the thread is canceled.
      *  A thread is only canceled if openbmpd is terminated.
@@ -101,6 +118,8 @@ void *ClientThread(void *arg) {
             cInfo.mbus->enableDebug();
 
         BMPReader rBMP(logger, thr->cfg);
+        rBMP.setParseCpu(placement.parse_cpu);
+
         LOG_INFO("Thread started to monitor BMP from router %s using socket %d buffer in bytes = %u",
                 cInfo.client->c_ip, cInfo.client->c_sock, thr->cfg->bmp_buffer_size);
 
@@ -126,13 +145,17 @@ void *ClientThread(void *arg) {
         unsigned char *sock_buf_read_ptr = sock_buf;
         unsigned char *sock_buf_write_ptr = sock_buf;
 
+        // Backlog reporting
+        bool overload = OverloadControl::instance().enabled();
+        uint64_t drained_ms = OverloadControl::now();
+
         /*
          * monitor and buffer the client socket
          */
         while (bmp_run) {
 
-            if ((wrap_state and (write_buf_pos + 1) < read_buf_pos) or
-                    (not wrap_state and write_buf_pos < thr->cfg->bmp_buffer_size)) {
+            if (not thr->draining and ((wrap_state and (write_buf_pos + 1) < read_buf_pos) or
+                    (not wrap_state and write_buf_pos < thr->cfg->bmp_buffer_size))) {
 
                 pfd.fd = cInfo.client->c_sock;
                 pfd.events = POLLIN | POLLHUP | POLLERR;
@@ -234,6 +257,40 @@ void *ClientThread(void *arg) {
                 wrap_state = false;
                 //LOG_INFO("read buffer wrapped");
             }
+
+            /*
+             * On shutdown, stop reading the router and end the pipe once the ring buffer is
+             *  written to it.  The reader parses up to the end of the pipe and sends the term.
+             */
+            if (thr->draining and not wrap_state and read_buf_pos >= write_buf_pos) {
+                LOG_INFO("%s: Drained, closing the BMP stream", cInfo.client->c_ip);
+
+                rBMP.setCollectorShutdown();
+                shutdown(cInfo.bmp_write_end_sock, SHUT_WR);
+
+                // The reader thread uses rBMP and bmp_run of this scope, wait for it here
+                cInfo.bmp_reader_thread->join();
+
+                close(sock_fds[0]);
+                close(sock_fds[1]);
+
+                bmp_run = false;
+                break;
+            }
+
+            // Report the backlog of the router to the overload control
+            if (overload) {
+                int used = wrap_state ? thr->cfg->bmp_buffer_size - read_buf_pos + write_buf_pos
+                                      : write_buf_pos - read_buf_pos;
+                uint64_t now_ms = OverloadControl::now();
+
+                if (used <= 0)
+                    drained_ms = now_ms;
+
+                thr->ring_pct = (uint64_t)used * 100 / thr->cfg->bmp_buffer_size;
+                thr->queue_pct = cInfo.mbus->queueFillPct();
+                thr->lag_ms = now_ms - drained_ms;
+            }
         }
 
         LOG_INFO("%s: Thread for sock [%d] ended normally", cInfo.client->c_ip, cInfo.client->c_sock);
@@ -260,6 +317,8 @@ void *ClientThread(void *arg) {
 
     pthread_cleanup_pop(0);
 
+    CpuPlacement::instance().release(placement);
+
     // Indicate that we are no longer running
     thr->running = false;
 
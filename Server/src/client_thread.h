@@ -14,6 +14,7 @@
 #include "BMPListener.h"
 #include "Logger.h"
 #include "Config.h"
+#include <atomic>
 #include <thread>
 
 #define CLIENT_WRITE_BUFFER_BLOCK_SIZE    8192        // Number of bytes to write to BMP reader from buffer
@@ -25,6 +26,12 @@ struct ThreadMgmt {
     Logger *log;
     bool running;                       // true if running, zero if not running
     bool baselineTimeout;		        // true if past the baseline time of the router
+
+    std::atomic<uint32_t> ring_pct;     // Ring buffer fill in percent, set by the client thread
+    std::atomic<uint32_t> queue_pct;    // Producer queue fill in percent, set by the client thread
+    std::atomic<uint32_t> lag_ms;       // Time since the ring buffer was last drained, set by the client thread
+
+    std::atomic<bool> draining;         // Set on shutdown to stop reading the router and drain the buffered messages
 };
 
 struct ClientThreadInfo {
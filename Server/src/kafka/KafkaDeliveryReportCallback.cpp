@@ -11,4 +11,15 @@
 
 void KafkaDeliveryReportCallback::dr_cb (RdKafka::Message &message) {
     //std::cout << "Message delivery for (" << message.len() << " bytes): " << message.errstr() << std::endl;
+
+    if (stats == NULL)
+        return;
+
+    if (message.err() != RdKafka::ERR_NO_ERROR) {
+        ++stats->failed;
+        return;
+    }
+
+    ++stats->delivered;
+    stats->delivery_us.push_back(KafkaProduceStats::now() - (uintptr_t)message.msg_opaque());
 }
\ No newline at end of file
@@ -12,10 +12,20 @@
 
 #include <librdkafka/rdkafkacpp.h>
 #include "Logger.h"
+#include "KafkaProduceStats.h"
 
 class KafkaDeliveryReportCallback : public RdKafka::DeliveryReportCb {
 public:
+    /**
+     * \param [in] stats    Stats to update, NULL for none.  The message opaque is
+     *                      the produce time (KafkaProduceStats::now())
+     */
+    explicit KafkaDeliveryReportCallback(KafkaProduceStats *stats=NULL) : stats(stats) { }
+
     void dr_cb (RdKafka::Message &message);
+
+private:
+    KafkaProduceStats   *stats;
 };
 
 #endif //OPENBMP_KAFKADELIVERYREPORTCALLBACK_H
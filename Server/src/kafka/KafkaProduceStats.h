@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef OPENBMP_KAFKAPRODUCESTATS_H
+#define OPENBMP_KAFKAPRODUCESTATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+/**
+ * \class   KafkaProduceStats
+ *
+ * \brief   Produce counters and latency samples of a message bus instance
+ * \details Used by the Kafka benchmark.  Enqueue latency is the time of the
+ *          producer produce() call; delivery latency is the time from produce()
+ *          to the delivery report.  Both are recorded on the thread that produces,
+ *          since delivery reports are served by its producer poll() calls.
+ */
+class KafkaProduceStats {
+public:
+    uint64_t                produced;           ///< Messages enqueued
+    uint64_t                produced_rows;      ///< Rows of the messages enqueued
+    uint64_t                produced_bytes;     ///< Bytes enqueued, including the message headers
+    uint64_t                rejected;           ///< Messages not enqueued (e.g. queue full)
+    uint64_t                delivered;          ///< Messages acknowledged by the broker
+    uint64_t                failed;             ///< Messages that failed delivery
+    std::vector<uint32_t>   enqueue_us;         ///< Enqueue latency samples in microseconds
+    std::vector<uint32_t>   delivery_us;        ///< Delivery latency samples in microseconds
+
+    KafkaProduceStats() {
+        clear();
+    }
+
+    void clear() {
+        produced = produced_rows = produced_bytes = rejected = delivered = failed = 0;
+        enqueue_us.clear();
+        delivery_us.clear();
+    }
+
+    /**
+     * Current monotonic time in microseconds
+     */
+    static uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * Percentile of latency samples
+     *
+     * \param [in,out] samples  Samples, reordered
+     * \param [in]     pct      Percentile (0 - 100)
+     *
+     * \return the sample at the percentile, zero if there are no samples
+     */
+    static uint32_t percentile(std::vector<uint32_t> &samples, double pct) {
+        if (samples.empty())
+            return 0;
+
+        size_t n = (size_t)(pct / 100.0 * (samples.size() - 1) + 0.5);
+        std::nth_element(samples.begin(), samples.begin() + n, samples.end());
+        return samples[n];
+    }
+};
+
+#endif //OPENBMP_KAFKAPRODUCESTATS_H
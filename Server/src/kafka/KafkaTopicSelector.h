@@ -32,6 +32,9 @@ public:
     #define MSGBUS_TOPIC_LS_PREFIX              "openbmp.parsed.ls_prefix"
     #define MSGBUS_TOPIC_BMP_STAT               "openbmp.parsed.bmp_stat"
     #define MSGBUS_TOPIC_BMP_RAW                "openbmp.bmp_raw"
+    #define MSGBUS_TOPIC_CHURN                  "openbmp.parsed.churn"
+    #define MSGBUS_TOPIC_PEER_ROLLUP            "openbmp.parsed.peer_rollup"
+    #define MSGBUS_TOPIC_LOC_RIB                "openbmp.parsed.loc_rib"
 
     /**
      * MSGBUS_TOPIC_VAR_* defines the topic var/key for the topic maps.
@@ -49,6 +52,9 @@ public:
     #define MSGBUS_TOPIC_VAR_LS_PREFIX          "ls_prefix"
     #define MSGBUS_TOPIC_VAR_BMP_STAT           "bmp_stat"
     #define MSGBUS_TOPIC_VAR_BMP_RAW            "bmp_raw"
+    #define MSGBUS_TOPIC_VAR_CHURN              "churn"
+    #define MSGBUS_TOPIC_VAR_PEER_ROLLUP        "peer_rollup"
+    #define MSGBUS_TOPIC_VAR_LOC_RIB            "loc_rib"
 
 
     /*********************************************************************//**
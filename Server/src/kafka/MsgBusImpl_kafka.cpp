@@ -30,9 +30,135 @@
 
 
 #include "md5.h"
+#include "PathAttrTable.h"
+#include "MrtFile.h"
+#include "OverloadControl.h"
+#include "CpuPlacement.h"
+#include "IngestScheduler.h"
 
 using namespace std;
 
+namespace {
+
+    /*
+     * Arrow batch schemas; the column names match the JSON keys (see docs/MESSAGE_BUS_API.md)
+     */
+    typedef ArrowBatch AB;
+
+    #define ARROW_PEER_COLUMNS                                                             \
+        { "router_hash", AB::COL_HASH }, { "router_ip", AB::COL_UTF8 },                    \
+        { "peer_hash", AB::COL_HASH }, { "peer_ip", AB::COL_UTF8 },                        \
+        { "peer_asn", AB::COL_UINT32 }, { "timestamp", AB::COL_TIMESTAMP }
+
+    #define ARROW_ATTR_COLUMNS                                                             \
+        { "origin", AB::COL_UTF8 }, { "as_path", AB::COL_UTF8 },                           \
+        { "as_path_count", AB::COL_UINT16 }, { "origin_as", AB::COL_UINT32 },              \
+        { "next_hop", AB::COL_UTF8 }, { "MED", AB::COL_UINT32 },                           \
+        { "local_pref", AB::COL_UINT32 }, { "aggregator", AB::COL_UTF8 },                  \
+        { "community_list", AB::COL_UTF8 }, { "ext_community_list", AB::COL_UTF8 },        \
+        { "cluster_list", AB::COL_UTF8 }, { "is_atomic_agg", AB::COL_BOOL },               \
+        { "is_next_hop_IPv4", AB::COL_BOOL }, { "originator_id", AB::COL_UTF8 },           \
+        { "large_community_list", AB::COL_UTF8 }
+
+    #define ARROW_LS_COLUMNS                                                               \
+        { "igp_router_id", AB::COL_UTF8 }, { "router_id", AB::COL_UTF8 },                  \
+        { "routing_id", AB::COL_UINT64 }, { "ls_id", AB::COL_UINT32 },                     \
+        { "ospf_area_id", AB::COL_UTF8 }, { "isis_area_id", AB::COL_UTF8 },                \
+        { "protocol", AB::COL_UTF8 }, { "as_path", AB::COL_UTF8 },                         \
+        { "local_pref", AB::COL_UINT32 }, { "MED", AB::COL_UINT32 },                       \
+        { "next_hop", AB::COL_UTF8 }
+
+    const AB::column_def arrow_unicast_prefix[] = {
+        { "action", AB::COL_UTF8 }, { "sequence", AB::COL_UINT64 }, { "hash", AB::COL_HASH },
+        ARROW_PEER_COLUMNS,
+        { "base_attr_hash", AB::COL_HASH }, { "prefix", AB::COL_UTF8 }, { "prefix_len", AB::COL_UINT8 },
+        { "is_IPv4", AB::COL_BOOL },
+        ARROW_ATTR_COLUMNS,
+        { "path_id", AB::COL_UINT32 }, { "labels", AB::COL_UTF8 }, { "is_pre_policy", AB::COL_BOOL },
+        { "is_adj_rib_in", AB::COL_BOOL }, { "rpki_state", AB::COL_UTF8 }
+    };
+
+    const AB::column_def arrow_l3vpn[] = {
+        { "action", AB::COL_UTF8 }, { "sequence", AB::COL_UINT64 }, { "hash", AB::COL_HASH },
+        ARROW_PEER_COLUMNS,
+        { "base_attr_hash", AB::COL_HASH }, { "prefix", AB::COL_UTF8 }, { "prefix_len", AB::COL_UINT8 },
+        { "is_IPv4", AB::COL_BOOL },
+        ARROW_ATTR_COLUMNS,
+        { "path_id", AB::COL_UINT32 }, { "labels", AB::COL_UTF8 }, { "is_pre_policy", AB::COL_BOOL },
+        { "is_adj_rib_in", AB::COL_BOOL }, { "route_distinguisher", AB::COL_UTF8 }, { "rd_type", AB::COL_UINT8 }
+    };
+
+    const AB::column_def arrow_evpn[] = {
+        { "action", AB::COL_UTF8 }, { "sequence", AB::COL_UINT64 }, { "hash", AB::COL_HASH },
+        ARROW_PEER_COLUMNS,
+        { "base_attr_hash", AB::COL_HASH },
+        ARROW_ATTR_COLUMNS,
+        { "path_id", AB::COL_UINT32 }, { "is_pre_policy", AB::COL_BOOL }, { "is_adj_rib_in", AB::COL_BOOL },
+        { "route_distinguisher", AB::COL_UTF8 }, { "rd_type", AB::COL_UINT8 },
+        { "originating_router_ip_len", AB::COL_UINT8 }, { "originating_router_ip", AB::COL_UTF8 },
+        { "ethernet_tag_id_hex", AB::COL_UTF8 }, { "ethernet_segment_identifier", AB::COL_UTF8 },
+        { "mac_len", AB::COL_UINT8 }, { "mac", AB::COL_UTF8 }, { "ip_len", AB::COL_UINT8 }, { "ip", AB::COL_UTF8 },
+        { "mpls_label_1", AB::COL_UINT32 }, { "mpls_label_2", AB::COL_UINT32 }
+    };
+
+    const AB::column_def arrow_ls_node[] = {
+        { "action", AB::COL_UTF8 }, { "sequence", AB::COL_UINT64 }, { "hash", AB::COL_HASH },
+        { "base_attr_hash", AB::COL_HASH },
+        ARROW_PEER_COLUMNS,
+        ARROW_LS_COLUMNS,
+        { "mt_id", AB::COL_UTF8 }, { "igp_flags", AB::COL_UTF8 }, { "name", AB::COL_UTF8 },
+        { "sr_capabilities", AB::COL_UTF8 }, { "is_pre_policy", AB::COL_BOOL }, { "is_adj_rib_in", AB::COL_BOOL }
+    };
+
+    const AB::column_def arrow_ls_link[] = {
+        { "action", AB::COL_UTF8 }, { "sequence", AB::COL_UINT64 }, { "hash", AB::COL_HASH },
+        { "base_attr_hash", AB::COL_HASH },
+        ARROW_PEER_COLUMNS,
+        ARROW_LS_COLUMNS,
+        { "mt_id", AB::COL_UINT32 }, { "local_link_id", AB::COL_UINT32 }, { "remote_link_id", AB::COL_UINT32 },
+        { "interface_ip", AB::COL_UTF8 }, { "neighbor_ip", AB::COL_UTF8 }, { "igp_metric", AB::COL_UINT32 },
+        { "admin_group", AB::COL_UINT32 }, { "max_link_bw", AB::COL_UINT32 }, { "max_resv_bw", AB::COL_UINT32 },
+        { "unreserved_bw", AB::COL_UTF8 }, { "te_default_metric", AB::COL_UINT32 },
+        { "link_protection", AB::COL_UTF8 }, { "mpls_proto_mask", AB::COL_UTF8 }, { "srlg", AB::COL_UTF8 },
+        { "link_name", AB::COL_UTF8 }, { "remote_node_hash", AB::COL_HASH }, { "local_node_hash", AB::COL_HASH },
+        { "remote_igp_router_id", AB::COL_UTF8 }, { "remote_router_id", AB::COL_UTF8 },
+        { "local_node_asn", AB::COL_UINT32 }, { "remote_node_asn", AB::COL_UINT32 },
+        { "peer_node_sid", AB::COL_UTF8 }, { "peer_adj_sid", AB::COL_UTF8 },
+        { "is_pre_policy", AB::COL_BOOL }, { "is_adj_rib_in", AB::COL_BOOL }
+    };
+
+    const AB::column_def arrow_ls_prefix[] = {
+        { "action", AB::COL_UTF8 }, { "sequence", AB::COL_UINT64 }, { "hash", AB::COL_HASH },
+        { "base_attr_hash", AB::COL_HASH },
+        ARROW_PEER_COLUMNS,
+        ARROW_LS_COLUMNS,
+        { "local_node_hash", AB::COL_HASH }, { "mt_id", AB::COL_UINT32 }, { "ospf_route_type", AB::COL_UTF8 },
+        { "igp_flags", AB::COL_UTF8 }, { "route_tag", AB::COL_UINT32 }, { "ext_route_tag", AB::COL_UINT64 },
+        { "ospf_fwd_addr", AB::COL_UTF8 }, { "igp_metric", AB::COL_UINT32 }, { "prefix", AB::COL_UTF8 },
+        { "prefix_len", AB::COL_UINT8 }, { "prefix_sid", AB::COL_UTF8 },
+        { "is_pre_policy", AB::COL_BOOL }, { "is_adj_rib_in", AB::COL_BOOL }
+    };
+
+    /// Schema and topic of each batch, in msgBus_kafka::arrow_topic order
+    struct arrow_topic_def {
+        const AB::column_def    *columns;
+        size_t                  count;
+        const char              *topic_var;
+    };
+
+    #define ARROW_TOPIC(columns, topic_var)  { columns, sizeof(columns) / sizeof(columns[0]), topic_var }
+
+    const arrow_topic_def arrow_topics[] = {
+        ARROW_TOPIC(arrow_unicast_prefix, MSGBUS_TOPIC_VAR_UNICAST_PREFIX),
+        ARROW_TOPIC(arrow_l3vpn, MSGBUS_TOPIC_VAR_L3VPN),
+        ARROW_TOPIC(arrow_evpn, MSGBUS_TOPIC_VAR_EVPN),
+        ARROW_TOPIC(arrow_ls_node, MSGBUS_TOPIC_VAR_LS_NODE),
+        ARROW_TOPIC(arrow_ls_link, MSGBUS_TOPIC_VAR_LS_LINK),
+        ARROW_TOPIC(arrow_ls_prefix, MSGBUS_TOPIC_VAR_LS_PREFIX)
+    };
+
+} /* anonymous namespace */
+
 /******************************************************************//**
  * \brief This function will initialize and connect to Kafka.
  *
@@ -41,16 +167,26 @@ using namespace std;
  *  \param [in] logPtr      Pointer to Logger instance
  *  \param [in] cfg         Pointer to the config instance
  *  \param [in] c_hash_id   Collector Hash ID
+ *  \param [in] stats       Produce stats to update (benchmark), NULL for none
  ********************************************************************/
-msgBus_kafka::msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id) {
+msgBus_kafka::msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id, KafkaProduceStats *stats) {
     logger = logPtr;
 
     producer_buf = new unsigned char[MSGBUS_WORKING_BUF_SIZE];
     prep_buf = new char[MSGBUS_WORKING_BUF_SIZE];
 
     hash_toStr(c_hash_id, collector_hash);
+    memcpy(collector_hash_bin, c_hash_id, sizeof(collector_hash_bin));
+    binary_format = cfg->msg_format == Config::MSG_FORMAT_BINARY;
+    json_format = cfg->msg_format == Config::MSG_FORMAT_JSON;
+    msg_format = binary_format ? MSGBUS_BINARY_FORMAT : json_format ? MSGBUS_JSON_FORMAT : NULL;
+    arrow_format = cfg->msg_format == Config::MSG_FORMAT_ARROW;
+
+    for (int i = 0; i < ARROW_TOPIC_MAX; i++)
+        arrow_batch[i] = arrow_format ? new ArrowBatch(logger, arrow_topics[i].columns, arrow_topics[i].count) : NULL;
 
     isConnected = false;
+    queue_fill_pct = 0;
     conf = RdKafka::Conf::create(RdKafka::Conf::CONF_GLOBAL);
 
     disableDebug();
@@ -68,8 +204,12 @@ msgBus_kafka::msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id) {
     ls_link_seq         = 0L;
     ls_prefix_seq       = 0L;
     bmp_stat_seq        = 0L;
+    churn_seq           = 0L;
+    peer_rollup_seq     = 0L;
+    loc_rib_seq         = 0L;
 
     this->cfg           = cfg;
+    produce_stats       = stats;
 
     // Make the connection to the server
     event_callback       = NULL;
@@ -78,6 +218,7 @@ msgBus_kafka::msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id) {
     topicSel             = NULL;
 
     router_ip.assign("");
+    router_ip_len = 0;
     bzero(router_hash, sizeof(router_hash));
 
     connect();
@@ -100,6 +241,9 @@ msgBus_kafka::~msgBus_kafka() {
         }
     }
 
+    // Send the pending batches before the router term
+    flush(true);
+
     if (router_defined) {
         bzero(&r_object, sizeof(r_object));
         memcpy(r_object.hash_id, router_hash, sizeof(r_object.hash_id));
@@ -111,11 +255,17 @@ msgBus_kafka::~msgBus_kafka() {
         update_Router(r_object, msgBus_kafka::ROUTER_ACTION_TERM);
     }
 
-    sleep(2);
+    // Wait for the queued messages, including the term, to be delivered
+    if (not flushProducer(cfg->shutdown_flush_ms))
+        LOG_WARN("rtr=%s: %d messages not delivered within %u ms", router_ip.c_str(),
+                 producer != NULL ? producer->outq_len() : 0, cfg->shutdown_flush_ms);
 
     delete [] producer_buf;
     delete [] prep_buf;
 
+    for (int i = 0; i < ARROW_TOPIC_MAX; i++)
+        delete arrow_batch[i];
+
     peer_list.clear();
 
     disconnect(500);
@@ -194,7 +344,7 @@ void msgBus_kafka::connect() {
 
 
     // Batch message number
-    value = "100";
+    value = std::to_string(cfg->q_batch_num_msgs);
     if (conf->set("batch.num.messages", value, errstr) != RdKafka::Conf::CONF_OK) {
         LOG_ERR("Failed to configure batch.num.messages for kafka: %s.", errstr.c_str());
         throw "ERROR: Failed to configure kafka batch.num.messages";
@@ -312,19 +462,31 @@ void msgBus_kafka::connect() {
         throw "ERROR: Failed to configure kafka event callback";
     }
 
-    // Register delivery report callback
-    /*
-    delivery_callback = new KafkaDeliveryReportCallback();
+    // Mock cluster (librdkafka test.mock.num.brokers), replaces the broker list
+    if (cfg->kafka_mock_brokers > 0) {
+        value = std::to_string(cfg->kafka_mock_brokers);
+        if (conf->set("test.mock.num.brokers", value, errstr) != RdKafka::Conf::CONF_OK) {
+            LOG_ERR("Failed to configure kafka mock cluster: %s", errstr.c_str());
+            throw "ERROR: Failed to configure kafka mock cluster";
+        }
+    }
 
-    if (conf->set("dr_cb", delivery_callback, errstr) != RdKafka::Conf::CONF_OK) {
-        LOG_ERR("Failed to configure kafka delivery report callback: %s", errstr.c_str());
-        throw "ERROR: Failed to configure kafka delivery report callback";
+    // Register delivery report callback, only needed for the produce stats
+    if (produce_stats != NULL) {
+        delivery_callback = new KafkaDeliveryReportCallback(produce_stats);
+
+        if (conf->set("dr_cb", delivery_callback, errstr) != RdKafka::Conf::CONF_OK) {
+            LOG_ERR("Failed to configure kafka delivery report callback: %s", errstr.c_str());
+            throw "ERROR: Failed to configure kafka delivery report callback";
+        }
     }
-    */
 
 
-    // Create producer and connect
-    producer = RdKafka::Producer::create(conf, errstr);
+    // Create producer and connect, its threads get the affinity of the produce CPUs
+    {
+        CpuPlacement::ProduceScope produce_affinity;
+        producer = RdKafka::Producer::create(conf, errstr);
+    }
     if (producer == NULL) {
         LOG_ERR("rtr=%s: Failed to create producer: %s", router_ip.c_str(), errstr.c_str());
         throw "ERROR: Failed to create producer";
@@ -365,24 +527,30 @@ void msgBus_kafka::connect() {
  * \param [in] key           Hash key
  * \param [in] peer_group    Peer group name - empty/NULL if not set or used
  * \param [in] peer_asn      Peer ASN
+ * \param [in] format        Data format (F: header), NULL for TSV
  */
 void msgBus_kafka::produce(const char *topic_var, char *msg, size_t msg_size, int rows, string key,
-                           const string *peer_group, uint32_t peer_asn) {
+                           const string *peer_group, uint32_t peer_asn, const char *format) {
     size_t len;
     RdKafka::Topic *topic = NULL;
 
-    while (isConnected == false or topicSel == NULL) {
-        // Do not attempt to reconnect if this is the main process (router ip is null)
-        // Changed on 10/29/15 to support docker startup delay with kafka
-        /*
-        if (router_ip.size() <= 0) {
-            return;
-        }*/
+    if (isConnected == false or topicSel == NULL) {
+        // Reconnecting may take indefinitely; don't hold an ingest slot meanwhile
+        IngestScheduler::BlockingSection blocking;
 
-        LOG_WARN("rtr=%s: Not connected to Kafka, attempting to reconnect", router_ip.c_str());
-        connect();
+        while (isConnected == false or topicSel == NULL) {
+            // Do not attempt to reconnect if this is the main process (router ip is null)
+            // Changed on 10/29/15 to support docker startup delay with kafka
+            /*
+            if (router_ip.size() <= 0) {
+                return;
+            }*/
 
-        sleep(1);
+            LOG_WARN("rtr=%s: Not connected to Kafka, attempting to reconnect", router_ip.c_str());
+            connect();
+
+            sleep(1);
+        }
     }
 
     // if topic is disabled, don't bother producing the message
@@ -391,8 +559,12 @@ void msgBus_kafka::produce(const char *topic_var, char *msg, size_t msg_size, in
         return;
 
     char headers[256];
-    len = snprintf(headers, sizeof(headers), "V: %s\nC_HASH_ID: %s\nT: %s\nL: %lu\nR: %d\n\n",
-            MSGBUS_API_VERSION, collector_hash.c_str(), topic_var, msg_size, rows);
+    if (format != NULL)
+        len = snprintf(headers, sizeof(headers), "V: %s\nF: %s\nC_HASH_ID: %s\nT: %s\nL: %lu\nR: %d\n\n",
+                       MSGBUS_API_VERSION, format, collector_hash.c_str(), topic_var, msg_size, rows);
+    else
+        len = snprintf(headers, sizeof(headers), "V: %s\nC_HASH_ID: %s\nT: %s\nL: %lu\nR: %d\n\n",
+                       MSGBUS_API_VERSION, collector_hash.c_str(), topic_var, msg_size, rows);
 
     memcpy(producer_buf, headers, len);
     memcpy(producer_buf+len, msg, msg_size);
@@ -403,12 +575,27 @@ void msgBus_kafka::produce(const char *topic_var, char *msg, size_t msg_size, in
         SELF_DEBUG("rtr=%s: Producing message: topic=%s key=%s, msg size = %lu", router_ip.c_str(),
                    topic->name().c_str(), key.c_str(), msg_size);
 
+        // The delivery report callback gets the produce time as the message opaque
+        uint64_t start_us = produce_stats != NULL ? KafkaProduceStats::now() : 0;
+
         RdKafka::ErrorCode resp = producer->produce(topic, RdKafka::Topic::PARTITION_UA,
                                                     RdKafka::Producer::RK_MSG_COPY,
                                                     producer_buf, msg_size + len,
-                                                    (const std::string *) &key, NULL);
+                                                    (const std::string *) &key, (void *)(uintptr_t)start_us);
+        if (produce_stats != NULL) {
+            if (resp == RdKafka::ERR_NO_ERROR) {
+                ++produce_stats->produced;
+                produce_stats->produced_rows += rows;
+                produce_stats->produced_bytes += msg_size + len;
+                produce_stats->enqueue_us.push_back(KafkaProduceStats::now() - start_us);
+            } else
+                ++produce_stats->rejected;
+        }
+
         if (resp != RdKafka::ERR_NO_ERROR) {
             LOG_ERR("rtr=%s: Failed to produce message: %s", router_ip.c_str(), RdKafka::err2str(resp).c_str());
+
+            IngestScheduler::BlockingSection blocking;
             producer->poll(100);
         }
     } else {
@@ -416,7 +603,21 @@ void msgBus_kafka::produce(const char *topic_var, char *msg, size_t msg_size, in
                    topic_var, key.c_str(), msg_size);
     }
 
+    pollQueue();
+}
+
+/**
+ * Serve delivery reports and refresh queue_fill_pct
+ *
+ * \details Delivered messages stay in outq_len() until their reports are served,
+ *          so the fill only drops once the producer is polled.
+ */
+void msgBus_kafka::pollQueue() {
+    if (producer == NULL)
+        return;
+
     producer->poll(0);
+    queue_fill_pct.store(producer->outq_len() * 100 / cfg->q_buf_max_msgs, std::memory_order_relaxed);
 }
 
 /**
@@ -443,12 +644,45 @@ void msgBus_kafka::update_Collector(obj_collector &c_object, collector_action_co
         case COLLECTOR_ACTION_STOPPED:
             action = const_cast<char *>("stopped");
             break;
+        case COLLECTOR_ACTION_OVERLOAD:
+            action = const_cast<char *>("overload");
+            break;
+    }
+
+    if (binary_format) {
+        binfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+
+        w.begin().u8(action_code).u64(collector_seq).str(c_object.admin_id).hash(collector_hash_bin);
+        w.str(c_object.routers).u32(c_object.router_count).ts(c_object.timestamp_secs, c_object.timestamp_us);
+        w.u32(c_object.overload_level).str(c_object.overload_shed);
+        w.end();
+
+        produce(MSGBUS_TOPIC_VAR_COLLECTOR, prep_buf, w.length(), 1, collector_hash, NULL, 0, msg_format);
+        collector_seq++;
+        return;
+    }
+
+    if (json_format) {
+        textfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+        jsonfmt::Writer j(w);
+
+        j.begin().key(JSON_KEY("action")).str(action).key(JSON_KEY("sequence")).u64(collector_seq);
+        j.key(JSON_KEY("admin_id")).str(c_object.admin_id).key(JSON_KEY("hash")).str(collector_hash);
+        j.key(JSON_KEY("routers")).str(c_object.routers).key(JSON_KEY("router_count")).u32(c_object.router_count);
+        j.key(JSON_KEY("timestamp")).ts(c_object.timestamp_secs, c_object.timestamp_us);
+        j.key(JSON_KEY("overload_level")).u32(c_object.overload_level).key(JSON_KEY("overload_shed")).str(c_object.overload_shed);
+        j.end();
+
+        produce(MSGBUS_TOPIC_VAR_COLLECTOR, prep_buf, w.length(), 1, collector_hash, NULL, 0, msg_format);
+        collector_seq++;
+        return;
     }
 
     snprintf(buf, sizeof(buf),
-             "%s\t%" PRIu64 "\t%s\t%s\t%s\t%u\t%s\n",
+             "%s\t%" PRIu64 "\t%s\t%s\t%s\t%u\t%s\t%u\t%s\n",
              action, collector_seq, c_object.admin_id, collector_hash.c_str(),
-             c_object.routers, c_object.router_count, ts.c_str());
+             c_object.routers, c_object.router_count, ts.c_str(),
+             c_object.overload_level, c_object.overload_shed);
 
     produce(MSGBUS_TOPIC_VAR_COLLECTOR, buf, strlen(buf), 1, collector_hash, NULL, 0);
 
@@ -499,6 +733,7 @@ void msgBus_kafka::update_Router(obj_router &r_object, router_action_code code)
         memcpy(router_hash, r_object.hash_id, sizeof(router_hash));
 
     router_ip.assign((char *)r_object.ip_addr);                     // Update router IP for logging
+    router_ip_len = binfmt::parseAddr(router_ip.c_str(), router_ip_bin);
 
     string descr((char *)r_object.descr);
     boost::replace_all(descr, "\n", "\\n");
@@ -525,6 +760,38 @@ void msgBus_kafka::update_Router(obj_router &r_object, router_action_code code)
     if (topicSel != NULL)
         topicSel->lookupRouterGroup((char *)r_object.name, (char *)r_object.ip_addr, router_group_name);
 
+    if (binary_format) {
+        binfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+
+        w.begin().u8(code).u64(router_seq).str((char *)r_object.name).hash(r_object.hash_id);
+        w.u8(router_ip_len).bytes(router_ip_bin, router_ip_len).str((char *)r_object.descr);
+        w.u16(r_object.term_reason_code).str(r_object.term_reason_text).str(r_object.initiate_data);
+        w.str(r_object.term_data).ts(r_object.timestamp_secs, r_object.timestamp_us).addr(r_object.bgp_id);
+        w.end();
+
+        produce(MSGBUS_TOPIC_VAR_ROUTER, prep_buf, w.length(), 1, r_hash_str, NULL, 0, msg_format);
+        router_seq++;
+        return;
+    }
+
+    if (json_format) {
+        textfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+        jsonfmt::Writer j(w);
+
+        j.begin().key(JSON_KEY("action")).str(action).key(JSON_KEY("sequence")).u64(router_seq);
+        j.key(JSON_KEY("name")).str((char *)r_object.name).key(JSON_KEY("hash")).str(r_hash_str);
+        j.key(JSON_KEY("ip_address")).str((char *)r_object.ip_addr).key(JSON_KEY("description")).str((char *)r_object.descr);
+        j.key(JSON_KEY("term_code")).u32(r_object.term_reason_code);
+        j.key(JSON_KEY("term_reason")).str(r_object.term_reason_text);
+        j.key(JSON_KEY("init_data")).str(r_object.initiate_data).key(JSON_KEY("term_data")).str(r_object.term_data);
+        j.key(JSON_KEY("timestamp")).str(ts).key(JSON_KEY("bgp_id")).str(r_object.bgp_id);
+        j.end();
+
+        produce(MSGBUS_TOPIC_VAR_ROUTER, prep_buf, w.length(), 1, r_hash_str, NULL, 0, msg_format);
+        router_seq++;
+        return;
+    }
+
     size_t size = snprintf(buf, sizeof(buf),
              "%s\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%" PRIu16 "\t%s\t%s\t%s\t%s\t%s\n", action.c_str(),
              router_seq, r_object.name, r_hash_str.c_str(), r_object.ip_addr, descr.c_str(),
@@ -594,14 +861,13 @@ void msgBus_kafka::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_pe
             action.assign("down");
             add_to_cache = false;
 
-            if (peer_list.find(p_hash_str) != peer_list.end())
-                peer_list.erase(p_hash_str);
+            peer_list.erase(peer_list_key(peer.hash_id));
 
             break;
     }
 
     // Check if we have already processed this entry, if so return
-    if (skip_if_in_cache and peer_list.find(p_hash_str) != peer_list.end()) {
+    if (skip_if_in_cache and peer_list.find(peer_list_key(peer.hash_id)) != NULL) {
         return;
     }
 
@@ -615,7 +881,79 @@ void msgBus_kafka::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_pe
     // Insert/Update map entry
     if (add_to_cache) {
         if (topicSel != NULL)
-            topicSel->lookupPeerGroup(hostname, peer.peer_addr, peer.peer_as, peer_list[p_hash_str]);
+            topicSel->lookupPeerGroup(hostname, peer.peer_addr, peer.peer_as, peer_list[peer_list_key(peer.hash_id)]);
+    }
+
+    if (binary_format) {
+        if ((code == PEER_ACTION_UP and up == NULL) or (code == PEER_ACTION_DOWN and down == NULL))
+            return;
+
+        binfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+
+        w.begin().u8(code).u64(peer_seq).hash(peer.hash_id).hash(peer.router_hash_id).str(hostname);
+        w.addr(peer.peer_bgp_id).u8(router_ip_len).bytes(router_ip_bin, router_ip_len);
+        w.ts(peer.timestamp_secs, peer.timestamp_us).u32(peer.peer_as);
+        w.addr(peer.peer_addr_bin + (peer.isIPv4 ? 12 : 0), peer.isIPv4).str(peer.peer_rd);
+        w.u8(peer.isL3VPN).u8(peer.isPrePolicy).u8(peer.isIPv4).u8(peer.isLocRib).u8(peer.isLocRibFiltered);
+        w.str((char *)peer.table_name);
+
+        if (code == PEER_ACTION_UP) {
+            w.u16(up->remote_port).u32(up->local_asn).addr(up->local_ip).u16(up->local_port);
+            w.addr(up->local_bgp_id).str(up->info_data).str(up->sent_cap).str(up->recv_cap);
+            w.u16(up->remote_hold_time).u16(up->local_hold_time);
+
+        } else if (code == PEER_ACTION_DOWN) {
+            w.u8(down->bmp_reason).u8(down->bgp_err_code).u8(down->bgp_err_subcode).str(down->error_text);
+        }
+
+        w.end();
+
+        produce(MSGBUS_TOPIC_VAR_PEER, prep_buf, w.length(), 1, p_hash_str,
+                &peer_list[peer_list_key(peer.hash_id)], peer.peer_as, msg_format);
+
+        peer_seq++;
+        return;
+    }
+
+    if (json_format) {
+        if ((code == PEER_ACTION_UP and up == NULL) or (code == PEER_ACTION_DOWN and down == NULL))
+            return;
+
+        textfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+        jsonfmt::Writer j(w);
+
+        j.begin().key(JSON_KEY("action")).str(action).key(JSON_KEY("sequence")).u64(peer_seq);
+        j.key(JSON_KEY("hash")).str(p_hash_str).key(JSON_KEY("router_hash")).str(r_hash_str);
+        j.key(JSON_KEY("name")).str(hostname).key(JSON_KEY("remote_bgp_id")).str(peer.peer_bgp_id);
+        j.key(JSON_KEY("router_ip")).str(router_ip).key(JSON_KEY("timestamp")).str(ts);
+        j.key(JSON_KEY("remote_asn")).u32(peer.peer_as).key(JSON_KEY("remote_ip")).str(peer.peer_addr);
+        j.key(JSON_KEY("peer_rd")).str(peer.peer_rd);
+
+        if (code == PEER_ACTION_UP) {
+            j.key(JSON_KEY("remote_port")).u32(up->remote_port).key(JSON_KEY("local_asn")).u32(up->local_asn);
+            j.key(JSON_KEY("local_ip")).str(up->local_ip).key(JSON_KEY("local_port")).u32(up->local_port);
+            j.key(JSON_KEY("local_bgp_id")).str(up->local_bgp_id).key(JSON_KEY("info_data")).str(up->info_data);
+            j.key(JSON_KEY("adv_cap")).str(up->sent_cap).key(JSON_KEY("recv_cap")).str(up->recv_cap);
+            j.key(JSON_KEY("remote_holddown")).u32(up->remote_hold_time);
+            j.key(JSON_KEY("adv_holddown")).u32(up->local_hold_time);
+
+        } else if (code == PEER_ACTION_DOWN) {
+            j.key(JSON_KEY("bmp_reason")).u32(down->bmp_reason).key(JSON_KEY("bgp_error_code")).u32(down->bgp_err_code);
+            j.key(JSON_KEY("bgp_error_subcode")).u32(down->bgp_err_subcode);
+            j.key(JSON_KEY("error_text")).str(down->error_text);
+        }
+
+        j.key(JSON_KEY("is_L3VPN")).boolean(peer.isL3VPN).key(JSON_KEY("is_pre_policy")).boolean(peer.isPrePolicy);
+        j.key(JSON_KEY("is_IPv4")).boolean(peer.isIPv4).key(JSON_KEY("is_loc_rib")).boolean(peer.isLocRib);
+        j.key(JSON_KEY("is_loc_rib_filtered")).boolean(peer.isLocRibFiltered);
+        j.key(JSON_KEY("table_name")).str((char *)peer.table_name);
+        j.end();
+
+        produce(MSGBUS_TOPIC_VAR_PEER, prep_buf, w.length(), 1, p_hash_str,
+                &peer_list[peer_list_key(peer.hash_id)], peer.peer_as, msg_format);
+
+        peer_seq++;
+        return;
     }
 
     switch (code) {
@@ -671,14 +1009,13 @@ void msgBus_kafka::update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_pe
             action.assign("down");
             add_to_cache = false;
 
-            if (peer_list.find(p_hash_str) != peer_list.end())
-                peer_list.erase(p_hash_str);
+            peer_list.erase(peer_list_key(peer.hash_id));
 
             break;
         }
     }
 
-    produce(MSGBUS_TOPIC_VAR_PEER, buf, strlen(buf), 1, p_hash_str, &peer_list[p_hash_str], peer.peer_as);
+    produce(MSGBUS_TOPIC_VAR_PEER, buf, strlen(buf), 1, p_hash_str, &peer_list[peer_list_key(peer.hash_id)], peer.peer_as);
 
     peer_seq++;
 }
@@ -698,23 +1035,14 @@ void msgBus_kafka::update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr,
     hash_toStr(peer.router_hash_id, r_hash_str);
 
 
-    // Generate the hash
+    // Generate the hash, starting from the shared attribute table state when available
     MD5 hash;
 
-    //hash.update(path_object.peer_hash_id, HASH_SIZE);
-    hash.update((unsigned char *) attr.as_path.c_str(), attr.as_path.length());
-    hash.update((unsigned char *) attr.next_hop,
-                strlen(attr.next_hop));
-    hash.update((unsigned char *) attr.aggregator,
-                strlen(attr.aggregator));
-    hash.update((unsigned char *) attr.origin,
-                strlen(attr.origin));
-    hash.update((unsigned char *) &attr.med, sizeof(attr.med));
-    hash.update((unsigned char *) &attr.local_pref,
-                sizeof(attr.local_pref));
-
-    hash.update((unsigned char *) attr.community_list.c_str(), attr.community_list.length());
-    hash.update((unsigned char *) attr.ext_community_list.c_str(), attr.ext_community_list.length());
+    if (attr.attr_md5 != NULL)
+        hash = *attr.attr_md5;
+    else
+        PathAttrTable::hashAttrFields(hash, attr);
+
     hash.update((unsigned char *) p_hash_str.c_str(), p_hash_str.length());
 
     hash.finalize();
@@ -724,22 +1052,59 @@ void msgBus_kafka::update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr,
     memcpy(attr.hash_id, hash_raw, 16);
     delete[] hash_raw;
 
+    // The prefixes still reference the hash when publishing is shed
+    if (OverloadControl::instance().shedding(OverloadControl::SHED_BASE_ATTRIBUTE))
+        return;
+
     hash_toStr(attr.hash_id, path_hash_str);
 
+    if (binary_format) {
+        binfmt::Writer bw(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+
+        bw.begin().u8(code).u64(base_attr_seq).hash(attr.hash_id);
+        appendBinPeerFields(bw, peer);
+        appendBinAttrFields(bw, &attr);
+        bw.end();
+
+        if (not bw.overflow())
+            produce(MSGBUS_TOPIC_VAR_BASE_ATTRIBUTE, prep_buf, bw.length(), 1, p_hash_str,
+                    &peer_list[peer_list_key(peer.hash_id)], peer.peer_as, msg_format);
+
+        ++base_attr_seq;
+        return;
+    }
+
     string ts;
     getTimestamp(peer.timestamp_secs, peer.timestamp_us, ts);
 
-    buf_len =
-            snprintf(prep_buf, MSGBUS_WORKING_BUF_SIZE,
-                     "add\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%s\t%" PRIu16 "\t%" PRIu32
-                             "\t%s\t%" PRIu32 "\t%" PRIu32 "\t%s\t%s\t%s\t%s\t%d\t%d\t%s\t%s\n",
-                     base_attr_seq, path_hash_str.c_str(), r_hash_str.c_str(), router_ip.c_str(), p_hash_str.c_str(),
-                     peer.peer_addr,peer.peer_as, ts.c_str(),
-                     attr.origin, attr.as_path.c_str(), attr.as_path_count, attr.origin_as, attr.next_hop, attr.med,
-                     attr.local_pref, attr.aggregator, attr.community_list.c_str(), attr.ext_community_list.c_str(), attr.cluster_list.c_str(),
-                     attr.atomic_agg, attr.nexthop_isIPv4, attr.originator_id,attr.large_community_list.c_str());
+    textfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+
+    if (json_format) {
+        jsonfmt::Writer j(w);
+
+        j.begin().key(JSON_KEY("action")).str("add", 3).key(JSON_KEY("sequence")).u64(base_attr_seq);
+        j.key(JSON_KEY("hash")).str(path_hash_str);
+        appendJsonPeerFields(j, peer, r_hash_str, p_hash_str, ts);
+        appendJsonAttrFields(j, &attr);
+        j.end();
+
+        if (not w.overflow())
+            produce(MSGBUS_TOPIC_VAR_BASE_ATTRIBUTE, prep_buf, w.length(), 1, p_hash_str,
+                    &peer_list[peer_list_key(peer.hash_id)], peer.peer_as, msg_format);
+
+        ++base_attr_seq;
+        return;
+    }
+
+    w.str("add\t", 4).u64(base_attr_seq).tab().str(path_hash_str).tab();
+    appendPeerFields(w, peer, r_hash_str, NULL, p_hash_str, ts);
+    w.tab();
+    appendAttrFields(w, &attr);
+    w.tab().str(attr.large_community_list).ch('\n');
+
+    buf_len = w.length();
 
-    produce(MSGBUS_TOPIC_VAR_BASE_ATTRIBUTE, prep_buf, buf_len, 1, p_hash_str, &peer_list[p_hash_str], peer.peer_as);
+    produce(MSGBUS_TOPIC_VAR_BASE_ATTRIBUTE, prep_buf, buf_len, 1, p_hash_str, &peer_list[peer_list_key(peer.hash_id)], peer.peer_as);
 
     ++base_attr_seq;
 }
@@ -747,13 +1112,13 @@ void msgBus_kafka::update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr,
 /**
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
-void msgBus_kafka::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn,
+void msgBus_kafka::update_L3Vpn(obj_bgp_peer &peer, vpn_vector &vpn,
                                 obj_path_attr *attr, vpn_action_code code) {
 
-    prep_buf[0] = 0;
-
-    char    buf2[80000];                         // Second working buffer
-    size_t  buf_len = 0;                         // query buffer length
+    textfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    binfmt::Writer bw(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    bool    buf_full = false;                    // True once a row did not fit
+    u_char  label_flag = 1;
 
     string vpn_hash_str;
     string path_hash_str;
@@ -762,7 +1127,8 @@ void msgBus_kafka::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn,
 
     hash_toStr(peer.router_hash_id, r_hash_str);
 
-    if (attr != NULL)
+    // Path hash is only printed for add rows
+    if (attr != NULL and code == VPN_ACTION_ADD)
         hash_toStr(attr->hash_id, path_hash_str);
 
     hash_toStr(peer.hash_id, p_hash_str);
@@ -794,11 +1160,8 @@ void msgBus_kafka::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn,
          *      Withdrawn and updated NLRI's do not carry the original label, therefore we cannot
          *      hash on the label string.  Instead, we has on a constant value of 1.
          */
-        if (vpn[i].labels[0] != 0) {
-            buf2[0] = 1;
-            hash.update((unsigned char *) buf2, 1);
-            buf2[0] = 0;
-        }
+        if (vpn[i].labels[0] != 0)
+            hash.update(&label_flag, 1);
 
         hash.finalize();
 
@@ -810,67 +1173,116 @@ void msgBus_kafka::update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn,
         // Build the query
         hash_toStr(vpn[i].hash_id, vpn_hash_str);
 
-        switch (code) {
-
-            case VPN_ACTION_ADD:
-                if (attr == NULL)
-                    return;
-
-                buf_len += snprintf(buf2, sizeof(buf2),
-                                    "add\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%d\t%d\t%s\t%s\t%" PRIu16
-                                            "\t%" PRIu32 "\t%s\t%" PRIu32 "\t%" PRIu32 "\t%s\t%s\t%s\t%s\t%d\t%d\t%s\t%" PRIu32
-                                            "\t%s\t%d\t%d\t%s:%s\t%d\t%s\n",
-                                    l3vpn_seq, vpn_hash_str.c_str(), r_hash_str.c_str(),
-                                    router_ip.c_str(),path_hash_str.c_str(), p_hash_str.c_str(),
-                                    peer.peer_addr, peer.peer_as, ts.c_str(), vpn[i].prefix, vpn[i].prefix_len,
-                                    vpn[i].isIPv4, attr->origin,
-                                    attr->as_path.c_str(), attr->as_path_count, attr->origin_as, attr->next_hop, attr->med, attr->local_pref,
-                                    attr->aggregator,
-                                    attr->community_list.c_str(), attr->ext_community_list.c_str(), attr->cluster_list.c_str(),
-                                    attr->atomic_agg, attr->nexthop_isIPv4,
-                                    attr->originator_id, vpn[i].path_id, vpn[i].labels, peer.isPrePolicy, peer.isAdjIn,
-                                    vpn[i].rd_administrator_subfield.c_str(), vpn[i].rd_assigned_number.c_str(), vpn[i].rd_type,
-                                    attr->large_community_list.c_str());
-
-                break;
-
-            case VPN_ACTION_DEL:
-                buf_len += snprintf(buf2, sizeof(buf2),
-                                    "del\t%" PRIu64 "\t%s\t%s\t%s\t\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%d\t%d\t\t\t"
-                                            "\t\t\t\t\t\t\t\t\t\t\t\t%" PRIu32
-                                            "\t%s\t%d\t%d\t%s:%s\t%d\t\n",
-                                    l3vpn_seq, vpn_hash_str.c_str(), r_hash_str.c_str(),
-                                    router_ip.c_str(), p_hash_str.c_str(),
-                                    peer.peer_addr, peer.peer_as, ts.c_str(), vpn[i].prefix, vpn[i].prefix_len,
-                                    vpn[i].isIPv4, vpn[i].path_id, vpn[i].labels, peer.isPrePolicy, peer.isAdjIn,
-                                    vpn[i].rd_administrator_subfield.c_str(), vpn[i].rd_assigned_number.c_str(),
-                                    vpn[i].rd_type);
-                break;
+        if (code == VPN_ACTION_ADD and attr == NULL)
+            return;
 
+        if (arrow_format) {
+            ArrowBatch &b = *arrow_batch[ARROW_L3VPN];
+            bool isAdd = code == VPN_ACTION_ADD;
+
+            b.begin().str(isAdd ? "add" : "del", 3).u64(l3vpn_seq).hash(vpn[i].hash_id);
+            appendArrowPeerFields(b, peer);
+            b.hash(isAdd ? attr->hash_id : NULL).str(vpn[i].prefix).u8(vpn[i].prefix_len).boolean(vpn[i].isIPv4);
+            appendArrowAttrFields(b, isAdd ? attr : NULL);
+            b.u32(vpn[i].path_id).str(vpn[i].labels).boolean(peer.isPrePolicy).boolean(peer.isAdjIn);
+            b.str(vpn[i].rd_administrator_subfield, ':', vpn[i].rd_assigned_number).u8(vpn[i].rd_type);
+            b.end();
+            flushArrowIfFull(ARROW_L3VPN);
+
+        } else if (binary_format) {
+            if (not buf_full) {
+                size_t row_start = bw.length();
+                bool isAdd = code == VPN_ACTION_ADD;
+
+                bw.begin().u8(code).u64(l3vpn_seq).hash(vpn[i].hash_id);
+                appendBinPeerFields(bw, peer);
+                bw.hash(isAdd ? attr->hash_id : NULL).addr(vpn[i].prefix).u8(vpn[i].prefix_len);
+                appendBinAttrFields(bw, isAdd ? attr : NULL);
+                bw.u32(vpn[i].path_id).str(vpn[i].labels).u8(peer.isPrePolicy).u8(peer.isAdjIn);
+                bw.str(vpn[i].rd_administrator_subfield + ":" + vpn[i].rd_assigned_number).u8(vpn[i].rd_type);
+                bw.end();
+
+                if (bw.overflow()) {
+                    bw.truncate(row_start);
+                    buf_full = true;
+                }
+            }
+        } else if (json_format) {
+            if (not buf_full) {
+                size_t row_start = w.length();
+                jsonfmt::Writer j(w);
+
+                j.begin().key(JSON_KEY("action")).str(code == VPN_ACTION_ADD ? "add" : "del", 3);
+                j.key(JSON_KEY("sequence")).u64(l3vpn_seq).key(JSON_KEY("hash")).str(vpn_hash_str);
+                appendJsonPeerFields(j, peer, r_hash_str, p_hash_str, ts);
+
+                if (code == VPN_ACTION_ADD)
+                    j.key(JSON_KEY("base_attr_hash")).str(path_hash_str);
+
+                j.key(JSON_KEY("prefix")).str(vpn[i].prefix).key(JSON_KEY("prefix_len")).u32(vpn[i].prefix_len);
+                j.key(JSON_KEY("is_IPv4")).boolean(vpn[i].isIPv4);
+                appendJsonAttrFields(j, code == VPN_ACTION_ADD ? attr : NULL);
+                j.key(JSON_KEY("path_id")).u32(vpn[i].path_id).key(JSON_KEY("labels")).str(vpn[i].labels);
+                j.key(JSON_KEY("is_pre_policy")).boolean(peer.isPrePolicy);
+                j.key(JSON_KEY("is_adj_rib_in")).boolean(peer.isAdjIn);
+                j.key(JSON_KEY("route_distinguisher")).str(vpn[i].rd_administrator_subfield, ':',
+                                                           vpn[i].rd_assigned_number);
+                j.key(JSON_KEY("rd_type")).u32(vpn[i].rd_type);
+                j.end();
+
+                if (w.overflow()) {
+                    w.truncate(row_start);
+                    buf_full = true;
+                }
+            }
+        } else if (not buf_full) {
+            size_t row_start = w.length();
+
+            w.str(code == VPN_ACTION_ADD ? "add\t" : "del\t", 4).u64(l3vpn_seq).tab().str(vpn_hash_str).tab();
+            appendPeerFields(w, peer, r_hash_str, &path_hash_str, p_hash_str, ts);
+            w.tab().str(vpn[i].prefix).tab().u32(vpn[i].prefix_len).tab().u32(vpn[i].isIPv4).tab();
+            appendAttrFields(w, code == VPN_ACTION_ADD ? attr : NULL);
+            w.tab().u32(vpn[i].path_id).tab().str(vpn[i].labels).tab().u32(peer.isPrePolicy).tab().u32(peer.isAdjIn);
+            w.tab().str(vpn[i].rd_administrator_subfield).ch(':').str(vpn[i].rd_assigned_number);
+            w.tab().u32(vpn[i].rd_type).tab();
+
+            if (code == VPN_ACTION_ADD)
+                w.str(attr->large_community_list);
+
+            w.ch('\n');
+
+            // Drop the partial row and stop adding rows once the buffer is full
+            if (w.overflow()) {
+                w.truncate(row_start);
+                buf_full = true;
+            }
         }
 
-        // Cat the entry to the query buff
-        if (buf_len < MSGBUS_WORKING_BUF_SIZE /* size of buf */)
-            strcat(prep_buf, buf2);
-
         ++l3vpn_seq;
     }
 
-    produce(MSGBUS_TOPIC_VAR_L3VPN, prep_buf, strlen(prep_buf), vpn.size(), p_hash_str,
-            &peer_list[p_hash_str], peer.peer_as);
+    // Arrow rows are sent by flushArrow()
+    if (arrow_format)
+        return;
+
+    produce(MSGBUS_TOPIC_VAR_L3VPN, prep_buf, binary_format ? bw.length() : w.length(), vpn.size(), p_hash_str,
+            &peer_list[peer_list_key(peer.hash_id)], peer.peer_as, msg_format);
 }
 
 
 /**
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
-void msgBus_kafka::update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn,
+void msgBus_kafka::update_eVPN(obj_bgp_peer &peer, evpn_vector &vpn,
                               obj_path_attr *attr, vpn_action_code code) {
 
     prep_buf[0] = 0;
 
     char    buf2[80000];                         // Second working buffer
     size_t  buf_len = 0;                         // query buffer length
+    binfmt::Writer bw(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    textfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    bool    buf_full = false;                    // True once a binary or JSON record did not fit
 
     string vpn_hash_str;
     string path_hash_str;
@@ -915,9 +1327,102 @@ void msgBus_kafka::update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn,
         memcpy(vpn[i].hash_id, hash_raw, 16);
         delete[] hash_raw;
 
+        if (arrow_format) {
+            if (code == VPN_ACTION_ADD and attr == NULL)
+                return;
+
+            ArrowBatch &b = *arrow_batch[ARROW_EVPN];
+
+            b.begin().str(code == VPN_ACTION_ADD ? "add" : "del", 3).u64(evpn_seq).hash(vpn[i].hash_id);
+            appendArrowPeerFields(b, peer);
+            b.hash(attr != NULL ? attr->hash_id : NULL);
+            appendArrowAttrFields(b, code == VPN_ACTION_ADD ? attr : NULL);
+            b.u32(vpn[i].path_id).boolean(peer.isPrePolicy).boolean(peer.isAdjIn);
+            b.str(vpn[i].rd_administrator_subfield, ':', vpn[i].rd_assigned_number).u8(vpn[i].rd_type);
+            b.u8(vpn[i].originating_router_ip_len).str(vpn[i].originating_router_ip);
+            b.str(vpn[i].ethernet_tag_id_hex).str(vpn[i].ethernet_segment_identifier);
+            b.u8(vpn[i].mac_len).str(vpn[i].mac).u8(vpn[i].ip_len).str(vpn[i].ip);
+            b.u32(vpn[i].mpls_label_1).u32(vpn[i].mpls_label_2);
+            b.end();
+            flushArrowIfFull(ARROW_EVPN);
+
+            ++evpn_seq;
+            continue;
+        }
+
+        if (binary_format) {
+            if (code == VPN_ACTION_ADD and attr == NULL)
+                return;
+
+            if (not buf_full) {
+                size_t row_start = bw.length();
+
+                bw.begin().u8(code).u64(evpn_seq).hash(vpn[i].hash_id);
+                appendBinPeerFields(bw, peer);
+                bw.hash(attr != NULL ? attr->hash_id : NULL);
+                appendBinAttrFields(bw, code == VPN_ACTION_ADD ? attr : NULL);
+                bw.u32(vpn[i].path_id).u8(peer.isPrePolicy).u8(peer.isAdjIn);
+                bw.str(vpn[i].rd_administrator_subfield + ":" + vpn[i].rd_assigned_number).u8(vpn[i].rd_type);
+                bw.addr(vpn[i].originating_router_ip).str(vpn[i].ethernet_tag_id_hex);
+                bw.str(vpn[i].ethernet_segment_identifier).u8(vpn[i].mac_len).str(vpn[i].mac);
+                bw.u8(vpn[i].ip_len).addr(vpn[i].ip).u32(vpn[i].mpls_label_1).u32(vpn[i].mpls_label_2);
+                bw.end();
+
+                if (bw.overflow()) {
+                    bw.truncate(row_start);
+                    buf_full = true;
+                }
+            }
+
+            ++evpn_seq;
+            continue;
+        }
+
         // Build the query
         hash_toStr(vpn[i].hash_id, vpn_hash_str);
 
+        if (json_format) {
+            if (code == VPN_ACTION_ADD and attr == NULL)
+                return;
+
+            if (not buf_full) {
+                size_t row_start = w.length();
+                jsonfmt::Writer j(w);
+
+                j.begin().key(JSON_KEY("action")).str(code == VPN_ACTION_ADD ? "add" : "del", 3);
+                j.key(JSON_KEY("sequence")).u64(evpn_seq).key(JSON_KEY("hash")).str(vpn_hash_str);
+                appendJsonPeerFields(j, peer, r_hash_str, p_hash_str, ts);
+
+                if (attr != NULL)
+                    j.key(JSON_KEY("base_attr_hash")).str(path_hash_str);
+
+                appendJsonAttrFields(j, code == VPN_ACTION_ADD ? attr : NULL);
+                j.key(JSON_KEY("path_id")).u32(vpn[i].path_id);
+                j.key(JSON_KEY("is_pre_policy")).boolean(peer.isPrePolicy);
+                j.key(JSON_KEY("is_adj_rib_in")).boolean(peer.isAdjIn);
+                j.key(JSON_KEY("route_distinguisher")).str(vpn[i].rd_administrator_subfield, ':',
+                                                           vpn[i].rd_assigned_number);
+                j.key(JSON_KEY("rd_type")).u32(vpn[i].rd_type);
+                j.key(JSON_KEY("originating_router_ip_len")).u32(vpn[i].originating_router_ip_len);
+                j.key(JSON_KEY("originating_router_ip")).str(vpn[i].originating_router_ip);
+                j.key(JSON_KEY("ethernet_tag_id_hex")).str(vpn[i].ethernet_tag_id_hex);
+                j.key(JSON_KEY("ethernet_segment_identifier")).str(vpn[i].ethernet_segment_identifier);
+                j.key(JSON_KEY("mac_len")).u32(vpn[i].mac_len).key(JSON_KEY("mac")).str(vpn[i].mac);
+                j.key(JSON_KEY("ip_len")).u32(vpn[i].ip_len).key(JSON_KEY("ip")).str(vpn[i].ip);
+                j.key(JSON_KEY("mpls_label_1")).u32(vpn[i].mpls_label_1);
+                j.key(JSON_KEY("mpls_label_2")).u32(vpn[i].mpls_label_2);
+                j.end();
+
+                if (w.overflow()) {
+                    w.truncate(row_start);
+                    buf_full = true;
+                }
+            }
+
+            ++evpn_seq;
+            continue;
+        }
+
         switch (code) {
 
             case VPN_ACTION_ADD:
@@ -969,21 +1474,25 @@ void msgBus_kafka::update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn,
         ++evpn_seq;
     }
 
-    produce(MSGBUS_TOPIC_VAR_EVPN, prep_buf, strlen(prep_buf), vpn.size(), p_hash_str,
-            &peer_list[p_hash_str], peer.peer_as);
+    // Arrow rows are sent by flushArrow()
+    if (arrow_format)
+        return;
+
+    produce(MSGBUS_TOPIC_VAR_EVPN, prep_buf,
+            binary_format ? bw.length() : json_format ? w.length() : strlen(prep_buf), vpn.size(),
+            p_hash_str, &peer_list[peer_list_key(peer.hash_id)], peer.peer_as, msg_format);
 }
 
 
 /**
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
-void msgBus_kafka::update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib,
+void msgBus_kafka::update_unicastPrefix(obj_bgp_peer &peer, rib_vector &rib,
                                         obj_path_attr *attr, unicast_prefix_action_code code) {
-    //bzero(prep_buf, MSGBUS_WORKING_BUF_SIZE);
-    prep_buf[0] = 0;
-
-    char    buf2[80000];                         // Second working buffer
-    size_t  buf_len = 0;                         // query buffer length
+    textfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    binfmt::Writer bw(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    bool    buf_full = false;                    // True once a row did not fit
+    u_char  label_flag = 1;
 
     string rib_hash_str;
     string path_hash_str;
@@ -992,7 +1501,8 @@ void msgBus_kafka::update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib>
 
     hash_toStr(peer.router_hash_id, r_hash_str);
 
-    if (attr != NULL)
+    // Path hash is only printed for add rows
+    if (attr != NULL and code == UNICAST_PREFIX_ACTION_ADD)
         hash_toStr(attr->hash_id, path_hash_str);
 
     hash_toStr(peer.hash_id, p_hash_str);
@@ -1029,11 +1539,8 @@ void msgBus_kafka::update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib>
          *      Withdrawn and updated NLRI's do not carry the original label, therefore we cannot
          *      hash on the label string.  Instead, we has on a constant value of 1.
          */
-        if (rib[i].labels[0] != 0) {
-            buf2[0] = 1;
-            hash.update((unsigned char *) buf2, 1);
-            buf2[0] = 0;
-        }
+        if (rib[i].labels[0] != 0)
+            hash.update(&label_flag, 1);
 
         hash.finalize();
 
@@ -1045,50 +1552,120 @@ void msgBus_kafka::update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib>
         // Build the query
         hash_toStr(rib[i].hash_id, rib_hash_str);
 
-        switch (code) {
+        if (code == UNICAST_PREFIX_ACTION_ADD and attr == NULL)
+            return;
 
-            case UNICAST_PREFIX_ACTION_ADD:
-                if (attr == NULL)
-                    return;
+        if (arrow_format) {
+            ArrowBatch &b = *arrow_batch[ARROW_UNICAST_PREFIX];
+            bool isAdd = code == UNICAST_PREFIX_ACTION_ADD;
+
+            b.begin().str(action).u64(unicast_prefix_seq).hash(rib[i].hash_id);
+            appendArrowPeerFields(b, peer);
+            b.hash(isAdd ? attr->hash_id : NULL).str(rib[i].prefix).u8(rib[i].prefix_len).boolean(rib[i].isIPv4);
+            appendArrowAttrFields(b, isAdd ? attr : NULL);
+            b.u32(rib[i].path_id).str(rib[i].labels).boolean(peer.isPrePolicy).boolean(peer.isAdjIn);
+
+            switch (rib[i].rpki_state) {
+                case RPKI_STATE_VALID:   b.str("valid", 5);   break;
+                case RPKI_STATE_INVALID: b.str("invalid", 7); break;
+                case RPKI_STATE_UNKNOWN: b.str("unknown", 7); break;
+                default:                 b.str("", 0);        break;
+            }
 
-                buf_len += snprintf(buf2, sizeof(buf2),
-                                    "%s\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%d\t%d\t%s\t%s\t%" PRIu16
-                                            "\t%" PRIu32 "\t%s\t%" PRIu32 "\t%" PRIu32 "\t%s\t%s\t%s\t%s\t%d\t%d\t%s\t%" PRIu32
-                                            "\t%s\t%d\t%d\t%s\n",
-                                    action.c_str(), unicast_prefix_seq, rib_hash_str.c_str(), r_hash_str.c_str(),
-                                    router_ip.c_str(),path_hash_str.c_str(), p_hash_str.c_str(),
-                                    peer.peer_addr, peer.peer_as, ts.c_str(), rib[i].prefix, rib[i].prefix_len,
-                                    rib[i].isIPv4, attr->origin,
-                                    attr->as_path.c_str(), attr->as_path_count, attr->origin_as, attr->next_hop, attr->med, attr->local_pref,
-                                    attr->aggregator,
-                                    attr->community_list.c_str(), attr->ext_community_list.c_str(), attr->cluster_list.c_str(),
-                                    attr->atomic_agg, attr->nexthop_isIPv4,
-                                    attr->originator_id, rib[i].path_id, rib[i].labels, peer.isPrePolicy, peer.isAdjIn,
-                                    attr->large_community_list.c_str());
-                break;
+            b.end();
+            flushArrowIfFull(ARROW_UNICAST_PREFIX);
+
+        } else if (binary_format) {
+            if (not buf_full) {
+                size_t row_start = bw.length();
+                bool isAdd = code == UNICAST_PREFIX_ACTION_ADD;
+
+                bw.begin().u8(code).u64(unicast_prefix_seq).hash(rib[i].hash_id);
+                appendBinPeerFields(bw, peer);
+                bw.hash(isAdd ? attr->hash_id : NULL).addr(rib[i].prefix_bin, rib[i].isIPv4);
+                bw.u8(rib[i].prefix_len);
+                appendBinAttrFields(bw, isAdd ? attr : NULL);
+                bw.u32(rib[i].path_id).str(rib[i].labels).u8(peer.isPrePolicy).u8(peer.isAdjIn);
+                bw.u8(rib[i].rpki_state).end();
+
+                if (bw.overflow()) {
+                    bw.truncate(row_start);
+                    buf_full = true;
+                }
+            }
+        } else if (json_format) {
+            if (not buf_full) {
+                size_t row_start = w.length();
+                jsonfmt::Writer j(w);
+
+                j.begin().key(JSON_KEY("action")).str(action).key(JSON_KEY("sequence")).u64(unicast_prefix_seq);
+                j.key(JSON_KEY("hash")).str(rib_hash_str);
+                appendJsonPeerFields(j, peer, r_hash_str, p_hash_str, ts);
+
+                if (code == UNICAST_PREFIX_ACTION_ADD)
+                    j.key(JSON_KEY("base_attr_hash")).str(path_hash_str);
+
+                j.key(JSON_KEY("prefix")).str(rib[i].prefix).key(JSON_KEY("prefix_len")).u32(rib[i].prefix_len);
+                j.key(JSON_KEY("is_IPv4")).boolean(rib[i].isIPv4);
+                appendJsonAttrFields(j, code == UNICAST_PREFIX_ACTION_ADD ? attr : NULL);
+                j.key(JSON_KEY("path_id")).u32(rib[i].path_id).key(JSON_KEY("labels")).str(rib[i].labels);
+                j.key(JSON_KEY("is_pre_policy")).boolean(peer.isPrePolicy);
+                j.key(JSON_KEY("is_adj_rib_in")).boolean(peer.isAdjIn);
+
+                switch (rib[i].rpki_state) {
+                    case RPKI_STATE_VALID:   j.key(JSON_KEY("rpki_state")).str("valid", 5);   break;
+                    case RPKI_STATE_INVALID: j.key(JSON_KEY("rpki_state")).str("invalid", 7); break;
+                    case RPKI_STATE_UNKNOWN: j.key(JSON_KEY("rpki_state")).str("unknown", 7); break;
+                    default: break;
+                }
 
-            case UNICAST_PREFIX_ACTION_DEL:
-                buf_len += snprintf(buf2, sizeof(buf2),
-                                    "%s\t%" PRIu64 "\t%s\t%s\t%s\t\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%d\t%d\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t%" PRIu32
-                                            "\t%s\t%d\t%d\t\n",
-                                    action.c_str(), unicast_prefix_seq, rib_hash_str.c_str(), r_hash_str.c_str(),
-                                    router_ip.c_str(), p_hash_str.c_str(),
-                                    peer.peer_addr, peer.peer_as, ts.c_str(), rib[i].prefix, rib[i].prefix_len,
-                                    rib[i].isIPv4, rib[i].path_id, rib[i].labels, peer.isPrePolicy, peer.isAdjIn);
-                break;
-        }
+                j.end();
 
-        // Cat the entry to the query buff
-        if (buf_len < MSGBUS_WORKING_BUF_SIZE /* size of buf */)
-            strcat(prep_buf, buf2);
+                if (w.overflow()) {
+                    w.truncate(row_start);
+                    buf_full = true;
+                }
+            }
+        } else if (not buf_full) {
+            size_t row_start = w.length();
+
+            w.str(action).tab().u64(unicast_prefix_seq).tab().str(rib_hash_str).tab();
+            appendPeerFields(w, peer, r_hash_str, &path_hash_str, p_hash_str, ts);
+            w.tab().str(rib[i].prefix).tab().u32(rib[i].prefix_len).tab().u32(rib[i].isIPv4).tab();
+            appendAttrFields(w, code == UNICAST_PREFIX_ACTION_ADD ? attr : NULL);
+            w.tab().u32(rib[i].path_id).tab().str(rib[i].labels).tab().u32(peer.isPrePolicy).tab().u32(peer.isAdjIn);
+            w.tab();
+
+            if (code == UNICAST_PREFIX_ACTION_ADD)
+                w.str(attr->large_community_list);
+
+            w.tab();
+            switch (rib[i].rpki_state) {
+                case RPKI_STATE_VALID:   w.str("valid");   break;
+                case RPKI_STATE_INVALID: w.str("invalid"); break;
+                case RPKI_STATE_UNKNOWN: w.str("unknown"); break;
+                default: break;
+            }
+
+            w.ch('\n');
+
+            // Drop the partial row and stop adding rows once the buffer is full
+            if (w.overflow()) {
+                w.truncate(row_start);
+                buf_full = true;
+            }
+        }
 
         ++unicast_prefix_seq;
 	++ribSeq;
     }
 
+    // Arrow rows are sent by flushArrow()
+    if (arrow_format)
+        return;
 
-    produce(MSGBUS_TOPIC_VAR_UNICAST_PREFIX, prep_buf, strlen(prep_buf), rib.size(), p_hash_str,
-            &peer_list[p_hash_str], peer.peer_as);
+    produce(MSGBUS_TOPIC_VAR_UNICAST_PREFIX, prep_buf, binary_format ? bw.length() : w.length(), rib.size(),
+            p_hash_str, &peer_list[peer_list_key(peer.hash_id)], peer.peer_as, msg_format);
 }
 
 /**
@@ -1115,10 +1692,197 @@ void msgBus_kafka::add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats) {
              stats.routes_adj_rib_in, stats.routes_loc_rib);
 
 
-    produce(MSGBUS_TOPIC_VAR_BMP_STAT, buf, strlen(buf), 1, p_hash_str, &peer_list[p_hash_str], peer.peer_as);
+    produce(MSGBUS_TOPIC_VAR_BMP_STAT, buf, strlen(buf), 1, p_hash_str, &peer_list[peer_list_key(peer.hash_id)], peer.peer_as);
     ++bmp_stat_seq;
 }
 
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_kafka::add_ChurnReport(obj_churn_report &report) {
+    textfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    static const char *types[] = { "total", "prefix", "origin_as", "peer" };
+
+    string ts;
+    getTimestamp(report.timestamp_secs, report.timestamp_us, ts);
+
+    size_t rows = 0;
+    for (size_t i = 0; i < report.rows.size(); i++) {
+        obj_churn &row = report.rows[i];
+        size_t row_start = w.length();
+
+        w.str(types[row.type]).tab().u64(churn_seq).tab().str(ts).tab().u32(report.interval_secs);
+        w.tab().u32(row.rank).tab().str(row.key).tab();
+
+        if (row.type == CHURN_TYPE_PEER) {
+            w.hex(row.router_hash_id, sizeof(row.router_hash_id)).tab();
+            w.hex(row.peer_hash_id, sizeof(row.peer_hash_id));
+        } else
+            w.tab();
+
+        w.tab().u64(row.updates).tab().u64(row.withdraws).ch('\n');
+
+        if (w.overflow()) {
+            w.truncate(row_start);
+            LOG_NOTICE("churn report truncated to %zu of %zu rows", rows, report.rows.size());
+            break;
+        }
+
+        ++rows;
+    }
+
+    if (rows > 0) {
+        produce(MSGBUS_TOPIC_VAR_CHURN, prep_buf, w.length(), rows, collector_hash, NULL, 0);
+        ++churn_seq;
+    }
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_kafka::add_PeerRollup(std::vector<obj_peer_rollup> &rows) {
+    textfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    size_t count = 0;
+
+    if (rows.empty())
+        return;
+
+    string r_hash_str;
+    hash_toStr(rows[0].router_hash_id, r_hash_str);
+
+    string ts;
+    getTimestamp(rows[0].window_start, 0, ts);
+
+    for (size_t i = 0; i < rows.size(); i++) {
+        obj_peer_rollup &row = rows[i];
+        size_t row_start = w.length();
+
+        w.str("add").tab().u64(peer_rollup_seq).tab().str(r_hash_str).tab().str(router_ip).tab();
+        w.hex(row.peer_hash_id, sizeof(row.peer_hash_id)).tab().str(row.peer_addr).tab().u32(row.peer_as);
+        w.tab().u32(row.afi).tab().u32(row.safi).tab().str(ts).tab().u32(row.interval);
+        w.tab().u64(row.prefixes_added).tab().u64(row.prefixes_withdrawn).tab().u64(row.attr_sets);
+        w.tab().u64(row.messages).tab().u64(row.bytes).ch('\n');
+
+        if (w.overflow()) {
+            w.truncate(row_start);
+            LOG_NOTICE("rtr=%s: peer rollup truncated to %zu of %zu rows", router_ip.c_str(), count, rows.size());
+            break;
+        }
+
+        ++count;
+    }
+
+    if (count > 0) {
+        produce(MSGBUS_TOPIC_VAR_PEER_ROLLUP, prep_buf, w.length(), count, r_hash_str, NULL, 0);
+        ++peer_rollup_seq;
+    }
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_kafka::update_LocRib(std::vector<obj_loc_rib> &rows) {
+    textfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    binfmt::Writer bw(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    size_t count = 0;
+
+    if (rows.empty())
+        return;
+
+    string r_hash_str;
+    hash_toStr(rows[0].router_hash_id, r_hash_str);
+
+    string ts;
+    for (size_t i = 0; i < rows.size(); i++) {
+        obj_loc_rib &row = rows[i];
+        bool add = row.action == LOC_RIB_ACTION_ADD;
+        size_t row_start = binary_format ? bw.length() : w.length();
+        bool overflow;
+
+        if (binary_format) {
+            bw.begin().u8(row.action).u64(loc_rib_seq).hash(row.router_hash_id);
+            bw.u8(router_ip_len).bytes(router_ip_bin, router_ip_len);
+            bw.hash(add ? row.peer_hash_id : NULL).addr(add ? row.peer_addr : "").u32(add ? row.peer_as : 0);
+            bw.ts(row.timestamp_secs, row.timestamp_us).addr(row.prefix).u8(row.prefix_len);
+            appendBinAttrFields(bw, row.attr);
+            bw.u32(row.path_id).u8(row.isLabeled).u32(row.paths).end();
+
+            overflow = bw.overflow();
+
+        } else if (json_format) {
+            jsonfmt::Writer j(w);
+
+            j.begin().key(JSON_KEY("action")).str(add ? "add" : "del", 3).key(JSON_KEY("sequence")).u64(loc_rib_seq);
+            j.key(JSON_KEY("router_hash")).str(r_hash_str).key(JSON_KEY("router_ip")).str(router_ip);
+
+            if (add) {
+                j.key(JSON_KEY("peer_hash")).hash(row.peer_hash_id).key(JSON_KEY("peer_ip")).str(row.peer_addr);
+                j.key(JSON_KEY("peer_asn")).u32(row.peer_as);
+            }
+
+            j.key(JSON_KEY("timestamp")).ts(row.timestamp_secs, row.timestamp_us);
+            j.key(JSON_KEY("prefix")).str(row.prefix).key(JSON_KEY("prefix_len")).u32(row.prefix_len);
+            j.key(JSON_KEY("is_IPv4")).boolean(row.isIPv4);
+            appendJsonAttrFields(j, row.attr);
+            j.key(JSON_KEY("path_id")).u32(row.path_id).key(JSON_KEY("is_labeled")).boolean(row.isLabeled);
+            j.key(JSON_KEY("paths")).u32(row.paths);
+            j.end();
+
+            overflow = w.overflow();
+
+        } else {
+            getTimestamp(row.timestamp_secs, row.timestamp_us, ts);
+
+            w.str(add ? "add" : "del").tab().u64(loc_rib_seq).tab().str(r_hash_str).tab().str(router_ip).tab();
+
+            if (add)
+                w.hex(row.peer_hash_id, sizeof(row.peer_hash_id)).tab().str(row.peer_addr).tab().u32(row.peer_as);
+            else
+                w.tab().tab();
+
+            w.tab().str(ts).tab().str(row.prefix).tab().u32(row.prefix_len).tab().u32(row.isIPv4).tab();
+            appendAttrFields(w, row.attr);
+            w.tab().u32(row.path_id).tab().u32(row.isLabeled).tab().u32(row.paths).tab();
+
+            if (add)
+                w.str(row.attr->large_community_list);
+
+            w.ch('\n');
+
+            overflow = w.overflow();
+        }
+
+        /*
+         * Best path changes are not dropped; publish the rows that fit and continue
+         *      with a new message.
+         */
+        if (overflow) {
+            w.truncate(row_start);
+            bw.truncate(row_start);
+
+            if (count > 0) {
+                produce(MSGBUS_TOPIC_VAR_LOC_RIB, prep_buf, binary_format ? bw.length() : w.length(), count,
+                        r_hash_str, NULL, 0, msg_format);
+                count = 0;
+                w.truncate(0);
+                bw.truncate(0);
+                --i;                // Retry the row in the empty buffer
+
+            } else
+                LOG_NOTICE("rtr=%s: loc_rib row of %s/%d is too large, dropped", router_ip.c_str(),
+                           row.prefix, row.prefix_len);
+            continue;
+        }
+
+        ++count;
+        ++loc_rib_seq;
+    }
+
+    if (count > 0)
+        produce(MSGBUS_TOPIC_VAR_LOC_RIB, prep_buf, binary_format ? bw.length() : w.length(), count,
+                r_hash_str, NULL, 0, msg_format);
+}
+
 /**
  * Abstract method Implementation - See MsgBusInterface.hpp for details
  */
@@ -1129,6 +1893,9 @@ void msgBus_kafka::update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::l
     char    buf2[8192];                          // Second working buffer
     int     buf_len = 0;                         // query buffer length
     int     i;
+    binfmt::Writer bw(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    textfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    bool    buf_full = false;                    // True once a binary or JSON record did not fit
 
     string hash_str;
     string r_hash_str;
@@ -1212,6 +1979,77 @@ void msgBus_kafka::update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::l
                 }
         }
 
+        if (arrow_format) {
+            ArrowBatch &b = *arrow_batch[ARROW_LS_NODE];
+
+            b.begin().str(action).u64(ls_node_seq).hash(node.hash_id).hash(attr.hash_id);
+            appendArrowPeerFields(b, peer);
+            b.str(igp_router_id).str(router_id).u64(node.id).u32(node.bgp_ls_id).str(ospf_area_id).str(isis_area_id);
+            b.str(node.protocol).str(attr.as_path).u32(attr.local_pref).u32(attr.med).str(attr.next_hop);
+            b.str(node.mt_id).str(node.flags).str(node.name).str(node.sr_capabilities_tlv);
+            b.boolean(peer.isPrePolicy).boolean(peer.isAdjIn);
+            b.end();
+            flushArrowIfFull(ARROW_LS_NODE);
+
+            ++ls_node_seq;
+            continue;
+        }
+
+        if (binary_format) {
+            if (not buf_full) {
+                size_t  row_start = bw.length();
+                uint8_t isis_len = node.isis_area_id[8] <= 8 ? node.isis_area_id[8] : 0;
+
+                bw.begin().u8(code).u64(ls_node_seq).hash(node.hash_id).hash(attr.hash_id);
+                appendBinPeerFields(bw, peer);
+                bw.bytes(node.igp_router_id, 8).addr(node.router_id, node.isIPv4).u64(node.id).u32(node.bgp_ls_id);
+                bw.bytes(node.ospf_area_Id, 4).u8(isis_len).bytes(node.isis_area_id, isis_len);
+                bw.str(node.protocol).str(attr.as_path).u32(attr.local_pref).u32(attr.med).addr(attr.next_hop);
+                bw.str(node.mt_id).str(node.flags).str(node.name).u8(peer.isPrePolicy).u8(peer.isAdjIn);
+                bw.str(node.sr_capabilities_tlv);
+                bw.end();
+
+                if (bw.overflow()) {
+                    bw.truncate(row_start);
+                    buf_full = true;
+                }
+            }
+
+            ++ls_node_seq;
+            continue;
+        }
+
+        if (json_format) {
+            if (not buf_full) {
+                size_t row_start = w.length();
+                jsonfmt::Writer j(w);
+
+                j.begin().key(JSON_KEY("action")).str(action).key(JSON_KEY("sequence")).u64(ls_node_seq);
+                j.key(JSON_KEY("hash")).str(hash_str).key(JSON_KEY("base_attr_hash")).str(path_hash_str);
+                appendJsonPeerFields(j, peer, r_hash_str, peer_hash_str, ts);
+                j.key(JSON_KEY("igp_router_id")).str(igp_router_id).key(JSON_KEY("router_id")).str(router_id);
+                j.key(JSON_KEY("routing_id")).u64(node.id).key(JSON_KEY("ls_id")).u32(node.bgp_ls_id);
+                j.key(JSON_KEY("ospf_area_id")).str(ospf_area_id).key(JSON_KEY("isis_area_id")).str(isis_area_id);
+                j.key(JSON_KEY("protocol")).str(node.protocol).key(JSON_KEY("as_path")).str(attr.as_path);
+                j.key(JSON_KEY("local_pref")).u32(attr.local_pref).key(JSON_KEY("MED")).u32(attr.med);
+                j.key(JSON_KEY("next_hop")).str(attr.next_hop);
+                j.key(JSON_KEY("mt_id")).str(node.mt_id).key(JSON_KEY("igp_flags")).str(node.flags);
+                j.key(JSON_KEY("name")).str(node.name);
+                j.key(JSON_KEY("sr_capabilities")).str(node.sr_capabilities_tlv);
+                j.key(JSON_KEY("is_pre_policy")).boolean(peer.isPrePolicy);
+                j.key(JSON_KEY("is_adj_rib_in")).boolean(peer.isAdjIn);
+                j.end();
+
+                if (w.overflow()) {
+                    w.truncate(row_start);
+                    buf_full = true;
+                }
+            }
+
+            ++ls_node_seq;
+            continue;
+        }
+
         buf_len += snprintf(buf2, sizeof(buf2),
                         "%s\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%s\t%" PRIx64 "\t%" PRIx32 "\t%s"
                                 "\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%" PRIu32 "\t%s\t%s\t%d\t%d\t%s\n",
@@ -1228,8 +2066,12 @@ void msgBus_kafka::update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::l
         ++ls_node_seq;
     }
 
+    // Arrow rows are sent by flushArrow()
+    if (arrow_format)
+        return;
 
-    produce(MSGBUS_TOPIC_VAR_LS_NODE, prep_buf, buf_len, rows, peer_hash_str, &peer_list[peer_hash_str], peer.peer_as);
+    produce(MSGBUS_TOPIC_VAR_LS_NODE, prep_buf, binary_format ? bw.length() : json_format ? w.length() : buf_len,
+            rows, peer_hash_str, &peer_list[peer_list_key(peer.hash_id)], peer.peer_as, msg_format);
 }
 
 /**
@@ -1242,6 +2084,9 @@ void msgBus_kafka::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::l
     char    buf2[8192];                          // Second working buffer
     int     buf_len = 0;                         // query buffer length
     int     i;
+    binfmt::Writer bw(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    textfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    bool    buf_full = false;                    // True once a binary or JSON record did not fit
 
     string hash_str;
     string r_hash_str;
@@ -1374,6 +2219,107 @@ void msgBus_kafka::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::l
         }
 
 
+        if (arrow_format) {
+            ArrowBatch &b = *arrow_batch[ARROW_LS_LINK];
+
+            b.begin().str(action).u64(ls_link_seq).hash(link.hash_id).hash(attr.hash_id);
+            appendArrowPeerFields(b, peer);
+            b.str(igp_router_id).str(router_id).u64(link.id).u32(link.bgp_ls_id).str(ospf_area_id).str(isis_area_id);
+            b.str(link.protocol).str(attr.as_path).u32(attr.local_pref).u32(attr.med).str(attr.next_hop);
+            b.u32(link.mt_id).u32(link.local_link_id).u32(link.remote_link_id).str(intf_ip).str(nei_ip);
+            b.u32(link.igp_metric).u32(link.admin_group).u32(link.max_link_bw).u32(link.max_resv_bw);
+            b.str(link.unreserved_bw).u32(link.te_def_metric).str(link.protection_type).str(link.mpls_proto_mask);
+            b.str(link.srlg).str(link.name).hash(link.remote_node_hash_id).hash(link.local_node_hash_id);
+            b.str(remote_igp_router_id).str(remote_router_id).u32(link.local_node_asn).u32(link.remote_node_asn);
+            b.str(link.peer_node_sid).str(link.peer_adj_sid).boolean(peer.isPrePolicy).boolean(peer.isAdjIn);
+            b.end();
+            flushArrowIfFull(ARROW_LS_LINK);
+
+            ++ls_link_seq;
+            continue;
+        }
+
+        if (binary_format) {
+            if (not buf_full) {
+                // Router IDs of links that are not from an IGP (e.g. EPE) are the BGP router IDs
+                bool    igp = strncmp(link.protocol, "OSPF", 4) == 0 or strncmp(link.protocol, "IS-IS", 5) == 0;
+                bool    rid_isIPv4 = igp ? link.isIPv4 : true;
+                const u_char *local_rid = igp ? link.router_id : (const u_char *)&link.local_bgp_router_id;
+                const u_char *remote_rid = igp ? link.remote_router_id : (const u_char *)&link.remote_bgp_router_id;
+                size_t  row_start = bw.length();
+                uint8_t isis_len = link.isis_area_id[8] <= 8 ? link.isis_area_id[8] : 0;
+
+                bw.begin().u8(code).u64(ls_link_seq).hash(link.hash_id).hash(attr.hash_id);
+                appendBinPeerFields(bw, peer);
+                bw.bytes(link.igp_router_id, 8).addr(local_rid, rid_isIPv4).u64(link.id).u32(link.bgp_ls_id);
+                bw.bytes(link.ospf_area_Id, 4).u8(isis_len).bytes(link.isis_area_id, isis_len);
+                bw.str(link.protocol).str(attr.as_path).u32(attr.local_pref).u32(attr.med).addr(attr.next_hop);
+                bw.u32(link.mt_id).u32(link.local_link_id).u32(link.remote_link_id);
+                bw.addr(link.intf_addr, link.isIPv4).addr(link.nei_addr, link.isIPv4).u32(link.igp_metric);
+                bw.u32(link.admin_group).u32(link.max_link_bw).u32(link.max_resv_bw).str(link.unreserved_bw);
+                bw.u32(link.te_def_metric).str(link.protection_type).str(link.mpls_proto_mask).str(link.srlg);
+                bw.str(link.name).hash(link.remote_node_hash_id).hash(link.local_node_hash_id);
+                bw.bytes(link.remote_igp_router_id, 8).addr(remote_rid, rid_isIPv4);
+                bw.u32(link.local_node_asn).u32(link.remote_node_asn).str(link.peer_node_sid);
+                bw.u8(peer.isPrePolicy).u8(peer.isAdjIn).str(link.peer_adj_sid);
+                bw.end();
+
+                if (bw.overflow()) {
+                    bw.truncate(row_start);
+                    buf_full = true;
+                }
+            }
+
+            ++ls_link_seq;
+            continue;
+        }
+
+        if (json_format) {
+            if (not buf_full) {
+                size_t row_start = w.length();
+                jsonfmt::Writer j(w);
+
+                j.begin().key(JSON_KEY("action")).str(action).key(JSON_KEY("sequence")).u64(ls_link_seq);
+                j.key(JSON_KEY("hash")).str(hash_str).key(JSON_KEY("base_attr_hash")).str(path_hash_str);
+                appendJsonPeerFields(j, peer, r_hash_str, peer_hash_str, ts);
+                j.key(JSON_KEY("igp_router_id")).str(igp_router_id).key(JSON_KEY("router_id")).str(router_id);
+                j.key(JSON_KEY("routing_id")).u64(link.id).key(JSON_KEY("ls_id")).u32(link.bgp_ls_id);
+                j.key(JSON_KEY("ospf_area_id")).str(ospf_area_id).key(JSON_KEY("isis_area_id")).str(isis_area_id);
+                j.key(JSON_KEY("protocol")).str(link.protocol).key(JSON_KEY("as_path")).str(attr.as_path);
+                j.key(JSON_KEY("local_pref")).u32(attr.local_pref).key(JSON_KEY("MED")).u32(attr.med);
+                j.key(JSON_KEY("next_hop")).str(attr.next_hop);
+                j.key(JSON_KEY("mt_id")).u32(link.mt_id).key(JSON_KEY("local_link_id")).u32(link.local_link_id);
+                j.key(JSON_KEY("remote_link_id")).u32(link.remote_link_id);
+                j.key(JSON_KEY("interface_ip")).str(intf_ip).key(JSON_KEY("neighbor_ip")).str(nei_ip);
+                j.key(JSON_KEY("igp_metric")).u32(link.igp_metric).key(JSON_KEY("admin_group")).u32(link.admin_group);
+                j.key(JSON_KEY("max_link_bw")).u32(link.max_link_bw).key(JSON_KEY("max_resv_bw")).u32(link.max_resv_bw);
+                j.key(JSON_KEY("unreserved_bw")).str(link.unreserved_bw);
+                j.key(JSON_KEY("te_default_metric")).u32(link.te_def_metric);
+                j.key(JSON_KEY("link_protection")).str(link.protection_type);
+                j.key(JSON_KEY("mpls_proto_mask")).str(link.mpls_proto_mask).key(JSON_KEY("srlg")).str(link.srlg);
+                j.key(JSON_KEY("link_name")).str(link.name);
+                j.key(JSON_KEY("remote_node_hash")).str(remote_node_hash_id);
+                j.key(JSON_KEY("local_node_hash")).str(local_node_hash_id);
+                j.key(JSON_KEY("remote_igp_router_id")).str(remote_igp_router_id);
+                j.key(JSON_KEY("remote_router_id")).str(remote_router_id);
+                j.key(JSON_KEY("local_node_asn")).u32(link.local_node_asn);
+                j.key(JSON_KEY("remote_node_asn")).u32(link.remote_node_asn);
+                j.key(JSON_KEY("peer_node_sid")).str(link.peer_node_sid);
+                j.key(JSON_KEY("peer_adj_sid")).str(link.peer_adj_sid);
+                j.key(JSON_KEY("is_pre_policy")).boolean(peer.isPrePolicy);
+                j.key(JSON_KEY("is_adj_rib_in")).boolean(peer.isAdjIn);
+                j.end();
+
+                if (w.overflow()) {
+                    w.truncate(row_start);
+                    buf_full = true;
+                }
+            }
+
+            ++ls_link_seq;
+            continue;
+        }
+
         buf_len += snprintf(buf2, sizeof(buf2),
                 "%s\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%s\t%" PRIx64 "\t%" PRIx32 "\t%s\t%s\t%s\t%s\t%"
                         PRIu32 "\t%" PRIu32 "\t%s\t%" PRIx32 "\t%" PRIu32 "\t%" PRIu32 "\t%s\t%s\t%" PRIu32 "\t%" PRIu32
@@ -1397,8 +2343,13 @@ void msgBus_kafka::update_LsLink(obj_bgp_peer &peer, obj_path_attr &attr, std::l
         ++ls_link_seq;
     }
 
-    produce(MSGBUS_TOPIC_VAR_LS_LINK, prep_buf, strlen(prep_buf), rows, peer_hash_str,
-            &peer_list[peer_hash_str], peer.peer_as);
+    // Arrow rows are sent by flushArrow()
+    if (arrow_format)
+        return;
+
+    produce(MSGBUS_TOPIC_VAR_LS_LINK, prep_buf,
+            binary_format ? bw.length() : json_format ? w.length() : strlen(prep_buf), rows, peer_hash_str,
+            &peer_list[peer_list_key(peer.hash_id)], peer.peer_as, msg_format);
 }
 
 /**
@@ -1411,6 +2362,9 @@ void msgBus_kafka::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std:
     char    buf2[8192];                          // Second working buffer
     int     buf_len = 0;                         // query buffer length
     int     i;
+    binfmt::Writer bw(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    textfmt::Writer w(prep_buf, MSGBUS_WORKING_BUF_SIZE);
+    bool    buf_full = false;                    // True once a binary or JSON record did not fit
 
     string hash_str;
     string r_hash_str;
@@ -1520,6 +2474,85 @@ void msgBus_kafka::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std:
         }
 
 
+        if (arrow_format) {
+            ArrowBatch &b = *arrow_batch[ARROW_LS_PREFIX];
+
+            b.begin().str(action).u64(ls_prefix_seq).hash(prefix.hash_id).hash(attr.hash_id);
+            appendArrowPeerFields(b, peer);
+            b.str(igp_router_id).str(router_id).u64(prefix.id).u32(prefix.bgp_ls_id).str(ospf_area_id).str(isis_area_id);
+            b.str(prefix.protocol).str(attr.as_path).u32(attr.local_pref).u32(attr.med).str(attr.next_hop);
+            b.hash(prefix.local_node_hash_id).u32(prefix.mt_id).str(prefix.ospf_route_type).str(prefix.igp_flags);
+            b.u32(prefix.route_tag).u64(prefix.ext_route_tag).str(ospf_fwd_addr).u32(prefix.metric);
+            b.str(prefix_ip).u8(prefix.prefix_len).str(prefix.sid_tlv).boolean(peer.isPrePolicy).boolean(peer.isAdjIn);
+            b.end();
+            flushArrowIfFull(ARROW_LS_PREFIX);
+
+            ++ls_prefix_seq;
+            continue;
+        }
+
+        if (binary_format) {
+            if (not buf_full) {
+                size_t  row_start = bw.length();
+                uint8_t isis_len = prefix.isis_area_id[8] <= 8 ? prefix.isis_area_id[8] : 0;
+
+                bw.begin().u8(code).u64(ls_prefix_seq).hash(prefix.hash_id).hash(attr.hash_id);
+                appendBinPeerFields(bw, peer);
+                bw.bytes(prefix.igp_router_id, 8).addr(prefix.router_id, prefix.isIPv4).u64(prefix.id).u32(prefix.bgp_ls_id);
+                bw.bytes(prefix.ospf_area_Id, 4).u8(isis_len).bytes(prefix.isis_area_id, isis_len);
+                bw.str(prefix.protocol).str(attr.as_path).u32(attr.local_pref).u32(attr.med).addr(attr.next_hop);
+                bw.hash(prefix.local_node_hash_id).u32(prefix.mt_id).str(prefix.ospf_route_type);
+                bw.str(prefix.igp_flags).u32(prefix.route_tag).u64(prefix.ext_route_tag);
+                bw.addr(prefix.ospf_fwd_addr, prefix.isIPv4).u32(prefix.metric);
+                bw.addr(prefix.prefix_bin, prefix.isIPv4).u8(prefix.prefix_len).u8(peer.isPrePolicy).u8(peer.isAdjIn);
+                bw.str(prefix.sid_tlv);
+                bw.end();
+
+                if (bw.overflow()) {
+                    bw.truncate(row_start);
+                    buf_full = true;
+                }
+            }
+
+            ++ls_prefix_seq;
+            continue;
+        }
+
+        if (json_format) {
+            if (not buf_full) {
+                size_t row_start = w.length();
+                jsonfmt::Writer j(w);
+
+                j.begin().key(JSON_KEY("action")).str(action).key(JSON_KEY("sequence")).u64(ls_prefix_seq);
+                j.key(JSON_KEY("hash")).str(hash_str).key(JSON_KEY("base_attr_hash")).str(path_hash_str);
+                appendJsonPeerFields(j, peer, r_hash_str, peer_hash_str, ts);
+                j.key(JSON_KEY("igp_router_id")).str(igp_router_id).key(JSON_KEY("router_id")).str(router_id);
+                j.key(JSON_KEY("routing_id")).u64(prefix.id).key(JSON_KEY("ls_id")).u32(prefix.bgp_ls_id);
+                j.key(JSON_KEY("ospf_area_id")).str(ospf_area_id).key(JSON_KEY("isis_area_id")).str(isis_area_id);
+                j.key(JSON_KEY("protocol")).str(prefix.protocol).key(JSON_KEY("as_path")).str(attr.as_path);
+                j.key(JSON_KEY("local_pref")).u32(attr.local_pref).key(JSON_KEY("MED")).u32(attr.med);
+                j.key(JSON_KEY("next_hop")).str(attr.next_hop);
+                j.key(JSON_KEY("local_node_hash")).str(local_node_hash_id).key(JSON_KEY("mt_id")).u32(prefix.mt_id);
+                j.key(JSON_KEY("ospf_route_type")).str(prefix.ospf_route_type);
+                j.key(JSON_KEY("igp_flags")).str(prefix.igp_flags).key(JSON_KEY("route_tag")).u32(prefix.route_tag);
+                j.key(JSON_KEY("ext_route_tag")).u64(prefix.ext_route_tag);
+                j.key(JSON_KEY("ospf_fwd_addr")).str(ospf_fwd_addr).key(JSON_KEY("igp_metric")).u32(prefix.metric);
+                j.key(JSON_KEY("prefix")).str(prefix_ip).key(JSON_KEY("prefix_len")).u32(prefix.prefix_len);
+                j.key(JSON_KEY("prefix_sid")).str(prefix.sid_tlv);
+                j.key(JSON_KEY("is_pre_policy")).boolean(peer.isPrePolicy);
+                j.key(JSON_KEY("is_adj_rib_in")).boolean(peer.isAdjIn);
+                j.end();
+
+                if (w.overflow()) {
+                    w.truncate(row_start);
+                    buf_full = true;
+                }
+            }
+
+            ++ls_prefix_seq;
+            continue;
+        }
+
         buf_len += snprintf(buf2, sizeof(buf2),
                 "%s\t%" PRIu64 "\t%s\t%s\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%s\t%s\t%s\t%" PRIx64 "\t%" PRIx32
                         "\t%s\t%s\t%s\t%s\t%" PRIu32 "\t%" PRIu32 "\t%s\t%s\t%" PRIx32 "\t%s\t%s\t%" PRIu32 "\t%" PRIx64
@@ -1539,8 +2572,13 @@ void msgBus_kafka::update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std:
         ++ls_prefix_seq;
     }
 
-    produce(MSGBUS_TOPIC_VAR_LS_PREFIX, prep_buf, strlen(prep_buf), rows, peer_hash_str,
-            &peer_list[peer_hash_str], peer.peer_as);
+    // Arrow rows are sent by flushArrow()
+    if (arrow_format)
+        return;
+
+    produce(MSGBUS_TOPIC_VAR_LS_PREFIX, prep_buf,
+            binary_format ? bw.length() : json_format ? w.length() : strlen(prep_buf), rows, peer_hash_str,
+            &peer_list[peer_list_key(peer.hash_id)], peer.peer_as, msg_format);
 }
 
 /**
@@ -1553,12 +2591,12 @@ void msgBus_kafka::send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data
     string p_hash_str;
     RdKafka::Topic *topic = NULL;
 
+    if (data_len == 0 or OverloadControl::instance().shedding(OverloadControl::SHED_BMP_RAW))
+        return;
+
     hash_toStr(peer.hash_id, p_hash_str);
     hash_toStr(r_hash, r_hash_str);
 
-    if (data_len == 0)
-        return;
-
     while (isConnected == false) {
         LOG_WARN("rtr=%s: Not connected to Kafka, attempting to reconnect", router_ip.c_str());
         connect();
@@ -1577,7 +2615,7 @@ void msgBus_kafka::send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data
     memcpy(producer_buf, headers, hdr_len);
     memcpy(producer_buf+hdr_len, data, data_len);
 
-    topic = topicSel->getTopic(MSGBUS_TOPIC_VAR_BMP_RAW, &router_group_name, &peer_list[p_hash_str], peer.peer_as);
+    topic = topicSel->getTopic(MSGBUS_TOPIC_VAR_BMP_RAW, &router_group_name, &peer_list[peer_list_key(peer.hash_id)], peer.peer_as);
     if (topic != NULL) {
         SELF_DEBUG("rtr=%s: Producing bmp raw message: topic=%s key=%s, msg size = %lu", router_ip.c_str(),
                    topic->name().c_str(), r_hash_str.c_str(), data_len);
@@ -1600,6 +2638,269 @@ void msgBus_kafka::send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data
     producer->poll(0);
 }
 
+/**
+ * Append the common peer columns (router hash through timestamp)
+ *
+ * \param [out] w              Writer to append to
+ * \param [in]  peer           Peer object
+ * \param [in]  r_hash_str     Router hash in printed form
+ * \param [in]  path_hash_str  Path attribute hash in printed form, NULL to omit the column
+ * \param [in]  p_hash_str     Peer hash in printed form
+ * \param [in]  ts             Timestamp in printed form
+ */
+void msgBus_kafka::appendPeerFields(textfmt::Writer &w, const obj_bgp_peer &peer, const string &r_hash_str,
+                                    const string *path_hash_str, const string &p_hash_str, const string &ts) {
+    w.str(r_hash_str).tab().str(router_ip).tab();
+
+    if (path_hash_str != NULL)
+        w.str(*path_hash_str).tab();
+
+    w.str(p_hash_str).tab().str(peer.peer_addr).tab().u32(peer.peer_as).tab().str(ts);
+}
+
+/**
+ * Append the path attribute columns (origin through originator id)
+ *
+ * \param [out] w              Writer to append to
+ * \param [in]  attr           Path attributes, NULL to write empty columns
+ */
+void msgBus_kafka::appendAttrFields(textfmt::Writer &w, const obj_path_attr *attr) {
+    if (attr == NULL) {
+        w.str("\t\t\t\t\t\t\t\t\t\t\t\t\t", 13);
+        return;
+    }
+
+    w.str(attr->origin).tab().str(attr->as_path).tab().u32(attr->as_path_count).tab().u32(attr->origin_as);
+    w.tab().str(attr->next_hop).tab().u32(attr->med).tab().u32(attr->local_pref).tab().str(attr->aggregator);
+    w.tab().str(attr->community_list).tab().str(attr->ext_community_list).tab().str(attr->cluster_list);
+    w.tab().u32(attr->atomic_agg).tab().u32(attr->nexthop_isIPv4).tab().str(attr->originator_id);
+}
+
+/**
+ * Append the common peer fields of a binary record (router hash through timestamp)
+ *
+ * \param [out] w              Writer to append to
+ * \param [in]  peer           Peer object
+ */
+void msgBus_kafka::appendBinPeerFields(binfmt::Writer &w, const obj_bgp_peer &peer) {
+    w.hash(peer.router_hash_id).u8(router_ip_len).bytes(router_ip_bin, router_ip_len).hash(peer.hash_id);
+    w.addr(peer.peer_addr_bin + (peer.isIPv4 ? 12 : 0), peer.isIPv4).u32(peer.peer_as);
+    w.ts(peer.timestamp_secs, peer.timestamp_us);
+}
+
+/**
+ * Append the path attribute fields of a binary record
+ *
+ * \param [out] w              Writer to append to
+ * \param [in]  attr           Path attributes, NULL if none (only the presence flag is written)
+ */
+void msgBus_kafka::appendBinAttrFields(binfmt::Writer &w, const obj_path_attr *attr) {
+    if (attr == NULL) {
+        w.u8(0);
+        return;
+    }
+
+    uint8_t origin = 2;
+    if (strcmp(attr->origin, "igp") == 0)
+        origin = 0;
+    else if (strcmp(attr->origin, "egp") == 0)
+        origin = 1;
+
+    w.u8(1).u8(origin).str(attr->as_path).u16(attr->as_path_count).u32(attr->origin_as);
+    w.addr(attr->next_hop).u32(attr->med).u32(attr->local_pref).str(attr->aggregator);
+    w.str(attr->community_list).str(attr->ext_community_list).str(attr->cluster_list);
+    w.u8(attr->atomic_agg).addr(attr->originator_id).str(attr->large_community_list);
+}
+
+/**
+ * Append the common peer members of a JSON object (router hash through timestamp)
+ *
+ * \param [out] j              Writer to append to
+ * \param [in]  peer           Peer object
+ * \param [in]  r_hash_str     Router hash in printed form
+ * \param [in]  p_hash_str     Peer hash in printed form
+ * \param [in]  ts             Timestamp in printed form
+ */
+void msgBus_kafka::appendJsonPeerFields(jsonfmt::Writer &j, const obj_bgp_peer &peer, const string &r_hash_str,
+                                        const string &p_hash_str, const string &ts) {
+    j.key(JSON_KEY("router_hash")).str(r_hash_str).key(JSON_KEY("router_ip")).str(router_ip);
+    j.key(JSON_KEY("peer_hash")).str(p_hash_str).key(JSON_KEY("peer_ip")).str(peer.peer_addr);
+    j.key(JSON_KEY("peer_asn")).u32(peer.peer_as).key(JSON_KEY("timestamp")).str(ts);
+}
+
+/**
+ * Append the path attribute members of a JSON object
+ *
+ * \param [out] j              Writer to append to
+ * \param [in]  attr           Path attributes, NULL to add none
+ */
+void msgBus_kafka::appendJsonAttrFields(jsonfmt::Writer &j, const obj_path_attr *attr) {
+    if (attr == NULL)
+        return;
+
+    j.key(JSON_KEY("origin")).str(attr->origin).key(JSON_KEY("as_path")).str(attr->as_path);
+    j.key(JSON_KEY("as_path_count")).u32(attr->as_path_count).key(JSON_KEY("origin_as")).u32(attr->origin_as);
+    j.key(JSON_KEY("next_hop")).str(attr->next_hop).key(JSON_KEY("MED")).u32(attr->med);
+    j.key(JSON_KEY("local_pref")).u32(attr->local_pref).key(JSON_KEY("aggregator")).str(attr->aggregator);
+    j.key(JSON_KEY("community_list")).str(attr->community_list);
+    j.key(JSON_KEY("ext_community_list")).str(attr->ext_community_list);
+    j.key(JSON_KEY("cluster_list")).str(attr->cluster_list);
+    j.key(JSON_KEY("is_atomic_agg")).boolean(attr->atomic_agg);
+    j.key(JSON_KEY("is_next_hop_IPv4")).boolean(attr->nexthop_isIPv4);
+    j.key(JSON_KEY("originator_id")).str(attr->originator_id);
+    j.key(JSON_KEY("large_community_list")).str(attr->large_community_list);
+}
+
+/**
+ * Append the common peer columns of an Arrow row (router hash through timestamp)
+ *
+ * \param [out] b              Batch to append to
+ * \param [in]  peer           Peer object
+ */
+void msgBus_kafka::appendArrowPeerFields(ArrowBatch &b, const obj_bgp_peer &peer) {
+    b.hash(peer.router_hash_id).str(router_ip).hash(peer.hash_id).str(peer.peer_addr).u32(peer.peer_as);
+    b.ts(peer.timestamp_secs, peer.timestamp_us);
+}
+
+/**
+ * Append the path attribute columns of an Arrow row
+ *
+ * \param [out] b              Batch to append to
+ * \param [in]  attr           Path attributes, NULL to write empty values
+ */
+void msgBus_kafka::appendArrowAttrFields(ArrowBatch &b, const obj_path_attr *attr) {
+    if (attr == NULL) {
+        b.str("", 0).str("", 0).u16(0).u32(0).str("", 0).u32(0).u32(0).str("", 0);
+        b.str("", 0).str("", 0).str("", 0).boolean(false).boolean(false).str("", 0).str("", 0);
+        return;
+    }
+
+    b.str(attr->origin).str(attr->as_path).u16(attr->as_path_count).u32(attr->origin_as);
+    b.str(attr->next_hop).u32(attr->med).u32(attr->local_pref).str(attr->aggregator);
+    b.str(attr->community_list).str(attr->ext_community_list).str(attr->cluster_list);
+    b.boolean(attr->atomic_agg).boolean(attr->nexthop_isIPv4).str(attr->originator_id);
+    b.str(attr->large_community_list);
+}
+
+/**
+ * Send the Arrow batch of a topic once it has the maximum rows or bytes
+ *
+ * \param [in]  t              Topic of the batch
+ */
+void msgBus_kafka::flushArrowIfFull(arrow_topic t) {
+    if (arrow_batch[t]->rows() >= cfg->arrow_batch_rows or arrow_batch[t]->bytes() >= MSGBUS_ARROW_MAX_BYTES)
+        flushArrow(t);
+}
+
+/**
+ * Send the Arrow batch of a topic, to Kafka or to a file in arrow.directory
+ *
+ * \param [in]  t              Topic of the batch
+ */
+void msgBus_kafka::flushArrow(arrow_topic t) {
+    size_t rows = arrow_batch[t]->rows();
+
+    if (rows == 0)
+        return;
+
+    arrow_batch[t]->encode(arrow_out);
+
+    if (cfg->arrow_directory.empty()) {
+        string r_hash_str;
+        hash_toStr(router_hash, r_hash_str);
+
+        // Batches hold the rows of all peers, so only the router group applies to the topic name
+        produce(arrow_topics[t].topic_var, &arrow_out[0], arrow_out.size(), rows, r_hash_str,
+                NULL, 0, MSGBUS_ARROW_FORMAT);
+        return;
+    }
+
+    /*
+     * One file per batch: <directory>/<router ip>/<topic>.YYYYMMDD.HHMMSS.arrows
+     */
+    char    name[128];
+    time_t  now = time(NULL);
+    struct tm tm_now;
+
+    gmtime_r(&now, &tm_now);
+    size_t len = snprintf(name, sizeof(name), "%s.", arrow_topics[t].topic_var);
+    strftime(name + len, sizeof(name) - len, "%Y%m%d.%H%M%S.arrows", &tm_now);
+
+    MrtFile file(logger, false);
+
+    if (not file.open(cfg->arrow_directory + "/" + (router_ip.size() ? router_ip : "unknown"), name)) {
+        LOG_ERR("rtr=%s: Failed to write %zu %s rows, cannot open Arrow file", router_ip.c_str(),
+                rows, arrow_topics[t].topic_var);
+        return;
+    }
+
+    for (size_t off = 0; off < arrow_out.size(); ) {
+        size_t chunk = arrow_out.size() - off < MRT_WRITE_BUF_SIZE ? arrow_out.size() - off : MRT_WRITE_BUF_SIZE;
+        u_char *p = file.reserve(chunk);
+
+        if (p == NULL) {
+            file.discard();
+            return;
+        }
+
+        memcpy(p, arrow_out.data() + off, chunk);
+        file.commit(chunk);
+        off += chunk;
+    }
+
+    file.close();
+}
+
+/**
+ * Wait for the messages on the producer queue to be delivered
+ *
+ * \param [in] timeout_ms   Maximum time to wait
+ *
+ * \return true if all messages were delivered (or failed), false on timeout
+ */
+bool msgBus_kafka::flushProducer(int timeout_ms) {
+    if (producer == NULL)
+        return true;
+
+    producer->flush(timeout_ms);
+    return producer->outq_len() == 0;
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+int msgBus_kafka::msUntilFlush() {
+    // Keep polling the producer until the queue drains; see queueFillPct()
+    int timeout = queue_fill_pct.load(std::memory_order_relaxed) > 0 ? MSGBUS_QUEUE_POLL_MS : -1;
+
+    if (not arrow_format)
+        return timeout;
+
+    for (int i = 0; i < ARROW_TOPIC_MAX; i++) {
+        int ms = arrow_batch[i]->msUntilAge(cfg->arrow_batch_ms);
+
+        if (ms >= 0 and (timeout < 0 or ms < timeout))
+            timeout = ms;
+    }
+
+    return timeout;
+}
+
+/**
+ * Abstract method Implementation - See MsgBusInterface.hpp for details
+ */
+void msgBus_kafka::flush(bool force) {
+    pollQueue();
+
+    if (not arrow_format)
+        return;
+
+    for (int i = 0; i < ARROW_TOPIC_MAX; i++) {
+        if (arrow_batch[i]->rows() > 0 and (force or arrow_batch[i]->msUntilAge(cfg->arrow_batch_ms) == 0))
+            flushArrow((arrow_topic) i);
+    }
+}
+
 /**
 * \brief Method to resolve the IP address to a hostname
 *
@@ -16,6 +16,7 @@
 #include "Logger.h"
 #include <string>
 #include <map>
+#include <atomic>
 #include <vector>
 #include <ctime>
 
@@ -23,8 +24,14 @@
 
 #include <thread>
 #include "safeQueue.hpp"
+#include "FlatHashMap.hpp"
+#include "TextFormat.h"
+#include "BinaryFormat.h"
+#include "JsonFormat.h"
+#include "ArrowBatch.h"
 #include "KafkaEventCallback.h"
 #include "KafkaDeliveryReportCallback.h"
+#include "KafkaProduceStats.h"
 #include "KafkaTopicSelector.h"
 
 #include "Config.h"
@@ -38,6 +45,11 @@ class msgBus_kafka: public MsgBusInterface {
 public:
     #define MSGBUS_WORKING_BUF_SIZE         1800000
     #define MSGBUS_API_VERSION              "1.7"
+    #define MSGBUS_BINARY_FORMAT            "binary/1"      // F: header of binary messages (format/schema version)
+    #define MSGBUS_JSON_FORMAT              "json/1"        // F: header of JSON messages
+    #define MSGBUS_ARROW_FORMAT             "arrow/1"       // F: header of Arrow IPC stream messages
+    #define MSGBUS_ARROW_MAX_BYTES          (MSGBUS_WORKING_BUF_SIZE / 2)   // Column data per Arrow batch
+    #define MSGBUS_QUEUE_POLL_MS            100             // Producer poll interval while the queue is filled
 
     /******************************************************************//**
      * \brief This function will initialize and connect to Kafka.
@@ -47,8 +59,9 @@ public:
      *  \param [in] logPtr      Pointer to Logger instance
      *  \param [in] cfg         Pointer to the config instance
      *  \param [in] c_hash_id   Collector Hash ID
+     *  \param [in] stats       Produce stats to update (benchmark), NULL for none
      ********************************************************************/
-    msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id);
+    msgBus_kafka(Logger *logPtr, Config *cfg, u_char *c_hash_id, KafkaProduceStats *stats=NULL);
     ~msgBus_kafka();
 
     /*
@@ -59,8 +72,11 @@ public:
     void update_Router(struct obj_router &r_entry, router_action_code code);
     void update_Peer(obj_bgp_peer &peer, obj_peer_up_event *up, obj_peer_down_event *down, peer_action_code code);
     void update_baseAttribute(obj_bgp_peer &peer, obj_path_attr &attr, base_attr_action_code code);
-    void update_unicastPrefix(obj_bgp_peer &peer, std::vector<obj_rib> &rib, obj_path_attr *attr, unicast_prefix_action_code code);
+    void update_unicastPrefix(obj_bgp_peer &peer, rib_vector &rib, obj_path_attr *attr, unicast_prefix_action_code code);
     void add_StatReport(obj_bgp_peer &peer, obj_stats_report &stats);
+    void add_ChurnReport(obj_churn_report &report);
+    void add_PeerRollup(std::vector<obj_peer_rollup> &rows);
+    void update_LocRib(std::vector<obj_loc_rib> &rows);
 
     void update_LsNode(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_node> &nodes,
                      ls_action_code code);
@@ -69,12 +85,35 @@ public:
     void update_LsPrefix(obj_bgp_peer &peer, obj_path_attr &attr, std::list<MsgBusInterface::obj_ls_prefix> &prefixes,
                       ls_action_code code);
     
-    void update_L3Vpn(obj_bgp_peer &peer, std::vector<obj_vpn> &vpn, obj_path_attr *attr, vpn_action_code code);
+    void update_L3Vpn(obj_bgp_peer &peer, vpn_vector &vpn, obj_path_attr *attr, vpn_action_code code);
 
-    void update_eVPN(obj_bgp_peer &peer, std::vector<obj_evpn> &vpn, obj_path_attr *attr, vpn_action_code code);
+    void update_eVPN(obj_bgp_peer &peer, evpn_vector &vpn, obj_path_attr *attr, vpn_action_code code);
 
     void send_bmp_raw(u_char *r_hash, obj_bgp_peer &peer, u_char *data, size_t data_len);
 
+    int msUntilFlush();
+    void flush(bool force=false);
+    const std::string &routerGroup()    { return router_group_name; }
+
+    /**
+     * Wait for the messages on the producer queue to be delivered
+     *
+     * \param [in] timeout_ms   Maximum time to wait
+     *
+     * \return true if all messages were delivered (or failed), false on timeout
+     */
+    bool flushProducer(int timeout_ms);
+
+    /**
+     * Producer queue fill in percent of queue.buffering.max.messages
+     *
+     * \details Refreshed on each produce and flush().  While the queue is filled,
+     *          msUntilFlush() asks the reader to call flush() at least every
+     *          MSGBUS_QUEUE_POLL_MS, so the value drops as the queue drains even
+     *          if nothing more is produced.  Safe to call from another thread.
+     */
+    uint32_t queueFillPct() const       { return queue_fill_pct.load(std::memory_order_relaxed); }
+
     // Debug methods
     void enableDebug();
     void disableDebug();
@@ -86,6 +125,25 @@ private:
     Logger          *logger;                    ///< Logging class pointer
 
     std::string     collector_hash;             ///< collector hash string value
+    u_char          collector_hash_bin[16];     ///< collector hash binary value
+    bool            binary_format;              ///< True to produce update_* messages as binary records
+    bool            json_format;                ///< True to produce update_* messages as JSON
+    const char      *msg_format;                ///< F: header of update_* messages, NULL for TSV
+    bool            arrow_format;               ///< True to batch the prefix and BGP-LS rows as Arrow IPC streams
+
+    /// Topics batched in Arrow format
+    enum arrow_topic {
+        ARROW_UNICAST_PREFIX=0,
+        ARROW_L3VPN,
+        ARROW_EVPN,
+        ARROW_LS_NODE,
+        ARROW_LS_LINK,
+        ARROW_LS_PREFIX,
+        ARROW_TOPIC_MAX
+    };
+
+    ArrowBatch      *arrow_batch[ARROW_TOPIC_MAX];  ///< Pending Arrow batch of each topic, NULL if not Arrow format
+    std::string     arrow_out;                  ///< Encoded Arrow IPC stream of the batch being sent
 
     uint64_t        router_seq;                 ///< Router add/del sequence
     uint64_t        collector_seq;              ///< Collector add/del sequence
@@ -93,6 +151,9 @@ private:
     uint64_t        base_attr_seq;              ///< Base attribute sequence
     uint64_t        unicast_prefix_seq;         ///< Unicast prefix sequence
     uint64_t        bmp_stat_seq;               ///< BMP stats sequence
+    uint64_t        churn_seq;                  ///< Churn report sequence
+    uint64_t        peer_rollup_seq;            ///< Peer rollup sequence
+    uint64_t        loc_rib_seq;                ///< Loc-RIB sequence
     uint64_t        ls_node_seq;                ///< LS node sequence
     uint64_t        ls_link_seq;                ///< LS link sequence
     uint64_t        ls_prefix_seq;              ///< LS prefix sequence
@@ -100,6 +161,7 @@ private:
     uint64_t        evpn_seq;                   ///< evpn sequence
 
     Config          *cfg;                       ///< Pointer to config instance
+    KafkaProduceStats *produce_stats;           ///< Produce stats to update, NULL for none
 
     /**
      * Kafka Configuration object (global)
@@ -115,12 +177,18 @@ private:
     KafkaDeliveryReportCallback     *delivery_callback;
 
     bool isConnected;                           ///< Indicates if Kafka is connected or not
+    std::atomic<uint32_t> queue_fill_pct;       ///< Producer queue fill in percent, read by the client thread
 
-    // array of hashes
-    std::map<std::string, std::string> peer_list;
-    typedef std::map<std::string, std::string>::iterator peer_list_iter;
+    /**
+     * Peer cache, Key is the binary peer hash_id and value is the matched peer group name
+     */
+    typedef BinaryKey<HASH_SIZE> peer_list_key;
+    FlatHashMap<peer_list_key, std::string> peer_list;
+    typedef FlatHashMap<peer_list_key, std::string>::iterator peer_list_iter;
 
     std::string router_ip;                      ///< Router IP in printed format
+    u_char      router_ip_bin[16];              ///< Router IP in binary format
+    uint8_t     router_ip_len;                  ///< Length of router_ip_bin (4 or 16), zero if not known
     u_char      router_hash[16];                ///< Router Hash in binary format
     std::string router_group_name;              ///< Router group name - if matched
 
@@ -149,9 +217,15 @@ private:
      * \param [in] key           Hash key
      * \param [in] peer_group    Peer group name - empty/NULL if not set or used
      * \param [in] peer_asn      Peer ASN
+     * \param [in] format        Data format (F: header), NULL for TSV
      */
     void produce(const char *topic_var, char *msg, size_t msg_size, int rows,
-                 std::string key, const std::string *peer_group, uint32_t);
+                 std::string key, const std::string *peer_group, uint32_t, const char *format=NULL);
+
+    /**
+     * Serve delivery reports and refresh queue_fill_pct
+     */
+    void pollQueue();
 
     /**
     * \brief Method to resolve the IP address to a hostname
@@ -163,6 +237,93 @@ private:
     */
     bool resolveIp(std::string name, std::string &hostname);
 
+    /**
+     * Append the common peer columns (router hash through timestamp)
+     *
+     * \param [out] w              Writer to append to
+     * \param [in]  peer           Peer object
+     * \param [in]  r_hash_str     Router hash in printed form
+     * \param [in]  path_hash_str  Path attribute hash in printed form, NULL to omit the column
+     * \param [in]  p_hash_str     Peer hash in printed form
+     * \param [in]  ts             Timestamp in printed form
+     */
+    void appendPeerFields(textfmt::Writer &w, const obj_bgp_peer &peer, const std::string &r_hash_str,
+                          const std::string *path_hash_str, const std::string &p_hash_str, const std::string &ts);
+
+    /**
+     * Append the path attribute columns (origin through originator id)
+     *
+     * \param [out] w              Writer to append to
+     * \param [in]  attr           Path attributes, NULL to write empty columns
+     */
+    void appendAttrFields(textfmt::Writer &w, const obj_path_attr *attr);
+
+    /**
+     * Append the common peer fields of a binary record (router hash through timestamp)
+     *
+     * \param [out] w              Writer to append to
+     * \param [in]  peer           Peer object
+     */
+    void appendBinPeerFields(binfmt::Writer &w, const obj_bgp_peer &peer);
+
+    /**
+     * Append the path attribute fields of a binary record
+     *
+     * \param [out] w              Writer to append to
+     * \param [in]  attr           Path attributes, NULL if none (only the presence flag is written)
+     */
+    void appendBinAttrFields(binfmt::Writer &w, const obj_path_attr *attr);
+
+    /**
+     * Append the common peer members of a JSON object (router hash through timestamp)
+     *
+     * \param [out] j              Writer to append to
+     * \param [in]  peer           Peer object
+     * \param [in]  r_hash_str     Router hash in printed form
+     * \param [in]  p_hash_str     Peer hash in printed form
+     * \param [in]  ts             Timestamp in printed form
+     */
+    void appendJsonPeerFields(jsonfmt::Writer &j, const obj_bgp_peer &peer, const std::string &r_hash_str,
+                              const std::string &p_hash_str, const std::string &ts);
+
+    /**
+     * Append the path attribute members of a JSON object
+     *
+     * \param [out] j              Writer to append to
+     * \param [in]  attr           Path attributes, NULL to add none
+     */
+    void appendJsonAttrFields(jsonfmt::Writer &j, const obj_path_attr *attr);
+
+    /**
+     * Append the common peer columns of an Arrow row (router hash through timestamp)
+     *
+     * \param [out] b              Batch to append to
+     * \param [in]  peer           Peer object
+     */
+    void appendArrowPeerFields(ArrowBatch &b, const obj_bgp_peer &peer);
+
+    /**
+     * Append the path attribute columns of an Arrow row
+     *
+     * \param [out] b              Batch to append to
+     * \param [in]  attr           Path attributes, NULL to write empty values
+     */
+    void appendArrowAttrFields(ArrowBatch &b, const obj_path_attr *attr);
+
+    /**
+     * Send the Arrow batch of a topic once it has the maximum rows or bytes
+     *
+     * \param [in]  t              Topic of the batch
+     */
+    void flushArrowIfFull(arrow_topic t);
+
+    /**
+     * Send the Arrow batch of a topic, to Kafka or to a file in arrow.directory
+     *
+     * \param [in]  t              Topic of the batch
+     */
+    void flushArrow(arrow_topic t);
+
 
 };
 
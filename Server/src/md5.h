@@ -39,6 +39,9 @@ documentation and/or software.
 
 */
 
+#ifndef MD5_H_
+#define MD5_H_
+
 #include <stdio.h>
 #include <iostream>
 #include <fstream>
@@ -110,3 +113,5 @@ private:
 			    uint4 s, uint4 ac);
 
 };
+
+#endif /* MD5_H_ */
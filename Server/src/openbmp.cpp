@@ -21,11 +21,21 @@
 #include "client_thread.h"
 #include "openbmpd_version.h"
 #include "Config.h"
+#include "ChurnTracker.h"
+#include "PathAttrTable.h"
+#include "RpkiValidator.h"
+#include "RibIndex.h"
+#include "QueryServer.h"
+#include "MrtSnapshot.h"
+#include "OverloadControl.h"
+#include "IngestScheduler.h"
+#include "CpuPlacement.h"
 
 #include <unistd.h>
 #include <fstream>
 #include <csignal>
 #include <cstring>
+#include <algorithm>
 #include <sys/stat.h>
 #include "md5.h"
 
@@ -38,8 +48,9 @@ const char *cfg_filename    = NULL;                 // Configuration file name t
 const char *log_filename    = NULL;                 // Output file to log messages to
 const char *debug_filename  = NULL;                 // Debug file to log messages to
 const char *pid_filename    = NULL;                 // PID file to record the daemon pid
-bool        run             = true;                 // Indicates if server should run
+volatile sig_atomic_t run  = 1;                     // Indicates if server should run, cleared by signals to shut down
 bool        run_foreground  = false;                // Indicates if server should run in forground
+volatile sig_atomic_t rpki_reload = 0;              // Set by SIGHUP to reload the RPKI VRP file
 
 
 // Global thread list
@@ -154,20 +165,12 @@ void signal_handler(int signum)
         case SIGINT  :
         case SIGCHLD : // Handle the child cleanup
 
-            for (size_t i=0; i < thr_list.size(); i++) {
-                if (thr_list.at(i)->running) {
-                    pthread_cancel(thr_list.at(i)->thr);
-                    thr_list.at(i)->running = false;
-                    pthread_join(thr_list.at(i)->thr, NULL);
-                }
-            }
-
-            thr_list.clear();
-
-            LOG_INFO("Done closing all active BMP connections");
+            // The server loop ends and shuts down the routers (shutdown_routers)
+            run = 0;
+            break;
 
-            run = false;
-            exit(0);
+        case SIGHUP :
+            rpki_reload = 1;
             break;
 
         default:
@@ -176,6 +179,68 @@ void signal_handler(int signum)
     }
 }
 
+/**
+ * Shut down all router threads in parallel
+ *
+ * \details All routers stop reading their sockets at the same time, parse what they have
+ *          buffered, send their term messages and flush their producers.  Routers that
+ *          have not finished by the drain deadline are canceled and given flush_ms to
+ *          close; threads that still have not ended are left to exit().
+ *
+ * \param [in] cfg      Reference to the config options
+ */
+void shutdown_routers(Config &cfg) {
+    uint64_t deadline = OverloadControl::now() + (uint64_t)cfg.shutdown_drain_secs * 1000;
+    size_t running = 0;
+
+    for (size_t i=0; i < thr_list.size(); i++) {
+        thr_list.at(i)->draining = true;
+
+        if (thr_list.at(i)->running)
+            ++running;
+    }
+
+    LOG_NOTICE("Shutting down, draining %zu routers within %u seconds", running, cfg.shutdown_drain_secs);
+
+    while (running > 0 and OverloadControl::now() < deadline) {
+        usleep(10000);
+
+        running = 0;
+        for (size_t i=0; i < thr_list.size(); i++) {
+            if (thr_list.at(i)->running)
+                ++running;
+        }
+    }
+
+    // Cancel all late routers first so they close at the same time
+    for (size_t i=0; i < thr_list.size(); i++) {
+        if (thr_list.at(i)->running) {
+            LOG_WARN("%s: Not drained within %u seconds, canceling", thr_list.at(i)->client.c_ip,
+                     cfg.shutdown_drain_secs);
+            pthread_cancel(thr_list.at(i)->thr);
+        }
+    }
+
+    struct timespec join_deadline;
+    clock_gettime(CLOCK_REALTIME, &join_deadline);
+    join_deadline.tv_sec += cfg.shutdown_flush_ms / 1000 + 1;
+
+    size_t abandoned = 0;
+    for (size_t i=0; i < thr_list.size(); i++) {
+        if (pthread_timedjoin_np(thr_list.at(i)->thr, NULL, &join_deadline) == 0)
+            delete thr_list.at(i);
+        else
+            ++abandoned;
+    }
+
+    thr_list.clear();
+
+    if (abandoned > 0)
+        LOG_WARN("%zu router threads did not end in time", abandoned);
+
+    LOG_INFO("Done closing all active BMP connections");
+}
+
 /**
  * Parse and handle the command line args
  *
@@ -358,6 +423,27 @@ bool ReadCmdArgs(int argc, char **argv, Config &cfg) {
     return false;
 }
 
+/**
+ * Load the RPKI VRP file
+ *
+ * \details On failure the previously loaded set (if any) stays in use.
+ *
+ * \param [in] cfg                   Reference to configuration
+ */
+void rpki_load(Config &cfg) {
+    size_t skipped = 0;
+
+    try {
+        size_t loaded = RpkiValidator::instance().load(cfg.rpki_file, skipped);
+
+        LOG_INFO("Loaded %zu RPKI VRPs from %s, skipped %zu invalid entries", loaded,
+                 cfg.rpki_file.c_str(), skipped);
+
+    } catch (char const *str) {
+        LOG_ERR("Failed to load RPKI file %s: %s", cfg.rpki_file.c_str(), str);
+    }
+}
+
 /**
  * Collector Update Message
  *
@@ -390,6 +476,9 @@ void collector_update_msg(msgBus_kafka *kafka, Config &cfg,
     oc.timestamp_secs = tv.tv_sec;
     oc.timestamp_us = tv.tv_usec;
 
+    oc.overload_level = OverloadControl::instance().level();
+    snprintf(oc.overload_shed, sizeof(oc.overload_shed), "%s", OverloadControl::instance().shedList().c_str());
+
     kafka->update_Collector(oc, code);
 }
 
@@ -403,6 +492,8 @@ void runServer(Config &cfg) {
     int active_connections = 0;                 // Number of active connections/threads
     int concurrent_routers = 0;			// Number of concurrent routers
     time_t last_heartbeat_time = 0;
+    time_t last_churn_time = 0;
+    time_t last_rpki_check_time = 0;
    
     LOG_INFO("Initializing server");
 
@@ -426,13 +517,97 @@ void runServer(Config &cfg) {
         collector_update_msg(kafka, cfg, MsgBusInterface::COLLECTOR_ACTION_STARTED);
         last_heartbeat_time = time(NULL);
 
+        PathAttrTable::instance().setMaxBytes(cfg.attr_table_size);
+
+        if (cfg.churn_interval > 0) {
+            ChurnTracker::instance().enable(cfg.churn_top_k, cfg.churn_sketch_width);
+            last_churn_time = time(NULL);
+        }
+
+        if (cfg.rpki_file.size() > 0) {
+            rpki_load(cfg);
+            last_rpki_check_time = time(NULL);
+        }
+
+        if (cfg.overload_enabled)
+            OverloadControl::instance().enable(cfg.overload_levels, cfg.overload_ring_pct, cfg.overload_queue_pct,
+                                               cfg.overload_lag_ms, cfg.overload_raise_secs,
+                                               cfg.overload_recover_secs);
+
+        if (cfg.scheduler_enabled) {
+            uint32_t workers = cfg.scheduler_workers > 0 ? cfg.scheduler_workers : std::thread::hardware_concurrency();
+
+            IngestScheduler::instance().enable(workers > 0 ? workers : 1, cfg.scheduler_quantum_kb * 1024);
+            LOG_INFO("Ingest scheduler enabled with %u workers", workers > 0 ? workers : 1);
+        }
+
+        if (cfg.affinity_enabled) {
+            CpuPlacement::instance().enable(cfg.affinity_ingest_cpus, cfg.affinity_parse_cpus,
+                                            cfg.affinity_produce_cpus, cfg.affinity_irq_aware);
+
+            if (not CpuPlacement::instance().enabled())
+                LOG_WARN("CPU affinity enabled without any cpus, routers are not pinned");
+        }
+
+        // Local query socket over the in-memory prefix index
+        QueryServer *query_svr = NULL;
+        if (cfg.query_socket.size() > 0) {
+            RibIndex::instance().enable();
+
+            query_svr = new QueryServer(logger, cfg.query_socket, cfg.query_max_rows);
+            try {
+                query_svr->start();
+            } catch (char const *str) {
+                LOG_ERR("%s: %s", str, cfg.query_socket.c_str());
+            }
+        }
+
+        // Periodic MRT RIB snapshots from the in-memory prefix index
+        MrtSnapshot *mrt_snapshot = NULL;
+        if (cfg.mrt_directory.size() > 0 and cfg.mrt_snapshot_interval > 0) {
+            RibIndex::instance().enable();
+
+            mrt_snapshot = new MrtSnapshot(logger, cfg.mrt_directory, cfg.mrt_snapshot_interval, cfg.mrt_compress);
+            mrt_snapshot->start();
+        }
+
         LOG_INFO("Ready. Waiting for connections");
 
         // Loop to accept new connections
         while (run) {
+            /*
+             * Publish the churn report if the interval has passed
+             */
+            if (cfg.churn_interval > 0 and (time(NULL) - last_churn_time) >= cfg.churn_interval) {
+                MsgBusInterface::obj_churn_report report;
+
+                ChurnTracker::instance().report(report);
+                kafka->add_ChurnReport(report);
+                last_churn_time = time(NULL);
+            }
+
+            /*
+             * Reload the RPKI VRP file on SIGHUP or when it has changed
+             */
+            if (cfg.rpki_file.size() > 0) {
+                if (rpki_reload) {
+                    rpki_reload = 0;
+                    rpki_load(cfg);
+
+                } else if (cfg.rpki_reload_interval > 0
+                           and (time(NULL) - last_rpki_check_time) >= cfg.rpki_reload_interval) {
+                    if (RpkiValidator::instance().changed())
+                        rpki_load(cfg);
+
+                    last_rpki_check_time = time(NULL);
+                }
+            }
+
             /*
              * Check for any stale threads/connections
              */
+            OverloadControl::backlog worst = { 0, 0, 0 };
+
              for (size_t i=0; i < thr_list.size(); i++) {
 
                 // If thread is not running, it means it terminated, so close it out
@@ -474,6 +649,22 @@ void runServer(Config &cfg) {
 		        }
 
                 //TODO: Add code to check for a socket that is open, but not really connected/half open
+                if (i < thr_list.size() and thr_list.at(i)->running) {
+                    worst.ring_pct = max(worst.ring_pct, thr_list.at(i)->ring_pct.load());
+                    worst.queue_pct = max(worst.queue_pct, thr_list.at(i)->queue_pct.load());
+                    worst.lag_ms = max(worst.lag_ms, thr_list.at(i)->lag_ms.load());
+                }
+            }
+
+            /*
+             * Step the overload level from the worst router backlog
+             */
+            if (OverloadControl::instance().update(worst, OverloadControl::now())) {
+                LOG_NOTICE("Overload level changed to %d (ring buffer %u%%, producer queue %u%%, lag %u ms), shedding: %s",
+                           OverloadControl::instance().level(), worst.ring_pct, worst.queue_pct, worst.lag_ms,
+                           OverloadControl::instance().shedList().c_str());
+
+                collector_update_msg(kafka, cfg, MsgBusInterface::COLLECTOR_ACTION_OVERLOAD);
             }
 
             /*
@@ -485,6 +676,10 @@ void runServer(Config &cfg) {
                     ThreadMgmt *thr = new ThreadMgmt;
                     thr->cfg = &cfg;
                     thr->log = logger;
+                    thr->ring_pct = 0;
+                    thr->queue_pct = 0;
+                    thr->lag_ms = 0;
+                    thr->draining = false;
 
                     // wait for a new connection and accept
                     if (bmp_svr->wait_and_accept_connection(thr->client, 500)) {
@@ -542,6 +737,14 @@ void runServer(Config &cfg) {
 	        }
 	    }
 
+        shutdown_routers(cfg);
+
+        if (query_svr != NULL)
+            delete query_svr;
+
+        if (mrt_snapshot != NULL)
+            delete mrt_snapshot;
+
         collector_update_msg(kafka, cfg, MsgBusInterface::COLLECTOR_ACTION_STOPPED);
         delete kafka;
 
@@ -0,0 +1,454 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * ArrowBatch IPC stream tests
+ *
+ * The stream is decoded with a minimal flatbuffer reader following the Arrow
+ * Schema.fbs and Message.fbs tables, and the record batch bodies are compared
+ * against expected bytes.
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ArrowBatch.h"
+#include "test_util.h"
+
+namespace {
+
+const ArrowBatch::column_def columns[] = {
+    { "action",     ArrowBatch::COL_UTF8 },
+    { "is_ipv4",    ArrowBatch::COL_BOOL },
+    { "prefix_len", ArrowBatch::COL_UINT8 },
+    { "code",       ArrowBatch::COL_UINT16 },
+    { "peer_asn",   ArrowBatch::COL_UINT32 },
+    { "sequence",   ArrowBatch::COL_UINT64 },
+    { "hash",       ArrowBatch::COL_HASH },
+    { "timestamp",  ArrowBatch::COL_TIMESTAMP },
+};
+
+const size_t COLUMNS = sizeof(columns) / sizeof(columns[0]);
+
+/**
+ * Read only view of a flatbuffer
+ */
+class FbReader {
+public:
+    explicit FbReader(const std::string &buf) : buf(buf) {
+    }
+
+    template <typename T>
+    T get(size_t pos) const {
+        T value = 0;
+
+        EXPECT_LE(pos + sizeof(T), buf.size());
+        if (pos + sizeof(T) <= buf.size())
+            for (size_t i = 0; i < sizeof(T); i++)
+                value |= (T)(uint64_t)(u_char)buf[pos + i] << (8 * i);
+
+        return value;
+    }
+
+    size_t root() const {
+        return get<uint32_t>(0);
+    }
+
+    /**
+     * Position of a table field, zero if not present
+     */
+    size_t field(size_t table, uint16_t id) const {
+        size_t vtable = table - get<int32_t>(table);
+        uint16_t vtable_len = get<uint16_t>(vtable);
+
+        if (4u + id * 2u >= vtable_len)
+            return 0;
+
+        uint16_t offset = get<uint16_t>(vtable + 4 + id * 2);
+        return offset != 0 ? table + offset : 0;
+    }
+
+    template <typename T>
+    T scalar(size_t table, uint16_t id, T def) const {
+        size_t pos = field(table, id);
+        return pos != 0 ? get<T>(pos) : def;
+    }
+
+    /**
+     * Table, string or vector referred to by a field
+     */
+    size_t ref(size_t table, uint16_t id) const {
+        size_t pos = field(table, id);
+        EXPECT_NE(0u, pos) << "field " << id << " not present";
+        return pos != 0 ? pos + get<uint32_t>(pos) : 0;
+    }
+
+    std::string string(size_t table, uint16_t id) const {
+        size_t pos = ref(table, id);
+        return buf.substr(pos + 4, get<uint32_t>(pos));
+    }
+
+    size_t vectorLen(size_t vec) const {
+        return get<uint32_t>(vec);
+    }
+
+    /// Table element of an offset vector
+    size_t tableAt(size_t vec, size_t i) const {
+        size_t pos = vec + 4 + i * 4;
+        return pos + get<uint32_t>(pos);
+    }
+
+private:
+    const std::string &buf;
+};
+
+/**
+ * One encapsulated message of the stream
+ */
+struct message {
+    std::string     metadata;       ///< Flatbuffer of the Message table
+    std::string     body;           ///< Body, bodyLength bytes
+    size_t          offset;         ///< Offset of the message in the stream
+};
+
+/**
+ * Split a stream into its messages; the end of stream marker is checked and not returned
+ */
+std::vector<message> splitStream(const std::string &stream) {
+    std::vector<message> msgs;
+    size_t pos = 0;
+
+    while (pos + 8 <= stream.size()) {
+        FbReader r(stream);
+
+        EXPECT_EQ(0xFFFFFFFFu, r.get<uint32_t>(pos)) << "continuation at " << pos;
+        uint32_t len = r.get<uint32_t>(pos + 4);
+
+        if (len == 0) {
+            EXPECT_EQ(stream.size(), pos + 8) << "data after the end of stream marker";
+            return msgs;
+        }
+
+        message m;
+        m.offset = pos;
+        m.metadata = stream.substr(pos + 8, len);
+
+        FbReader meta(m.metadata);
+        int64_t body_len = meta.scalar<int64_t>(meta.root(), 3, 0);
+
+        m.body = stream.substr(pos + 8 + len, body_len);
+        msgs.push_back(m);
+
+        pos += 8 + len + body_len;
+    }
+
+    ADD_FAILURE() << "no end of stream marker";
+    return msgs;
+}
+
+/**
+ * Record batch buffers of a message, as (offset, length) pairs
+ */
+std::vector<std::pair<int64_t, int64_t> > buffers(const message &m, int64_t &rows,
+                                                  std::vector<std::pair<int64_t, int64_t> > &nodes) {
+    FbReader r(m.metadata);
+    size_t msg = r.root();
+
+    EXPECT_EQ(3, r.scalar<uint8_t>(msg, 1, 0));                     // header_type: RecordBatch
+
+    size_t batch = r.ref(msg, 2);
+    size_t node_vec = r.ref(batch, 1);
+    size_t buffer_vec = r.ref(batch, 2);
+    std::vector<std::pair<int64_t, int64_t> > out;
+
+    rows = r.scalar<int64_t>(batch, 0, -1);
+
+    nodes.clear();
+    for (size_t i = 0; i < r.vectorLen(node_vec); i++) {
+        size_t pos = node_vec + 4 + i * 16;
+        nodes.push_back(std::make_pair(r.get<int64_t>(pos), r.get<int64_t>(pos + 8)));
+    }
+
+    for (size_t i = 0; i < r.vectorLen(buffer_vec); i++) {
+        size_t pos = buffer_vec + 4 + i * 16;
+        out.push_back(std::make_pair(r.get<int64_t>(pos), r.get<int64_t>(pos + 8)));
+    }
+
+    return out;
+}
+
+/**
+ * Bytes of a buffer of the body
+ */
+std::string bufferBytes(const message &m, const std::pair<int64_t, int64_t> &b) {
+    return m.body.substr(b.first, b.second);
+}
+
+/**
+ * Append the three test rows
+ */
+void addRows(ArrowBatch &batch) {
+    u_char hash_id[16];
+
+    for (int i = 0; i < 16; i++)
+        hash_id[i] = 0xA0 + i;
+
+    batch.begin().str("add").boolean(true).u8(24).u16(0x0102).u32(65001).u64(1).hash(hash_id);
+    batch.ts(1500000000, 123456).end();
+
+    batch.begin().str("del").boolean(false).u8(32).u16(0xFFFF).u32(4200000000U).u64(0x0102030405060708ULL);
+    batch.hash(NULL).ts(0, 0).end();
+
+    batch.begin().str(std::string("100"), ':', std::string("7")).boolean(true).u8(0).u16(0).u32(0).u64(0);
+    batch.hash(hash_id).ts(1, 1).end();
+}
+
+/**
+ * Test fixture with a batch of the test columns
+ */
+class ArrowBatchTest : public ::testing::Test {
+protected:
+    Logger      logger;
+    ArrowBatch  batch;
+
+    ArrowBatchTest() : logger(NULL, NULL), batch(&logger, columns, COLUMNS) {
+    }
+};
+
+} // namespace
+
+TEST_F(ArrowBatchTest, Schema) {
+    std::string stream;
+
+    addRows(batch);
+    batch.encode(stream);
+
+    std::vector<message> msgs = splitStream(stream);
+    ASSERT_EQ(2u, msgs.size());
+
+    FbReader r(msgs[0].metadata);
+    size_t msg = r.root();
+
+    EXPECT_EQ(4, r.scalar<int16_t>(msg, 0, 0));                     // version: V5
+    EXPECT_EQ(1, r.scalar<uint8_t>(msg, 1, 0));                     // header_type: Schema
+    EXPECT_EQ(0, r.scalar<int64_t>(msg, 3, 0));                     // bodyLength
+    EXPECT_TRUE(msgs[0].body.empty());
+
+    size_t schema = r.ref(msg, 2);
+    size_t fields = r.ref(schema, 1);
+
+    ASSERT_EQ(COLUMNS, r.vectorLen(fields));
+
+    /*
+     * Expected Arrow type of each column: Type union id and its table fields
+     */
+    struct {
+        uint8_t     type_type;
+        int32_t     width;          ///< bitWidth (Int) or byteWidth (FixedSizeBinary)
+    } expected[] = {
+        { 5, 0 },                   // Utf8
+        { 6, 0 },                   // Bool
+        { 2, 8 },                   // Int
+        { 2, 16 },
+        { 2, 32 },
+        { 2, 64 },
+        { 15, 16 },                 // FixedSizeBinary
+        { 10, 0 },                  // Timestamp
+    };
+
+    for (size_t i = 0; i < COLUMNS; i++) {
+        size_t field = r.tableAt(fields, i);
+        size_t type = r.ref(field, 3);
+
+        EXPECT_EQ(columns[i].name, r.string(field, 0));
+        EXPECT_EQ(0, r.scalar<uint8_t>(field, 1, 1)) << columns[i].name << " is nullable";
+        EXPECT_EQ(expected[i].type_type, r.scalar<uint8_t>(field, 2, 0)) << columns[i].name;
+        EXPECT_EQ(0u, r.vectorLen(r.ref(field, 5))) << columns[i].name << " children";
+
+        switch (expected[i].type_type) {
+            case 2:
+                EXPECT_EQ(expected[i].width, r.scalar<int32_t>(type, 0, 0)) << columns[i].name;
+                EXPECT_EQ(0, r.scalar<uint8_t>(type, 1, 0)) << columns[i].name << " is signed";
+                break;
+
+            case 15:
+                EXPECT_EQ(16, r.scalar<int32_t>(type, 0, 0));
+                break;
+
+            case 10:
+                EXPECT_EQ(2, r.scalar<int16_t>(type, 0, 0));        // unit: MICROSECOND
+                EXPECT_EQ("UTC", r.string(type, 1));
+                break;
+        }
+    }
+}
+
+TEST_F(ArrowBatchTest, RecordBatch) {
+    std::string stream;
+
+    addRows(batch);
+    batch.encode(stream);
+
+    std::vector<message> msgs = splitStream(stream);
+    ASSERT_EQ(2u, msgs.size());
+
+    int64_t rows;
+    std::vector<std::pair<int64_t, int64_t> > nodes;
+    std::vector<std::pair<int64_t, int64_t> > bufs = buffers(msgs[1], rows, nodes);
+
+    EXPECT_EQ(3, rows);
+    ASSERT_EQ(COLUMNS, nodes.size());
+
+    for (size_t i = 0; i < COLUMNS; i++) {
+        EXPECT_EQ(3, nodes[i].first) << columns[i].name << " length";
+        EXPECT_EQ(0, nodes[i].second) << columns[i].name << " null_count";
+    }
+
+    // Validity, offsets and values for utf8; validity and values for the others
+    ASSERT_EQ(COLUMNS * 2 + 1, bufs.size());
+
+    for (size_t i = 0; i < bufs.size(); i++) {
+        EXPECT_EQ(0, bufs[i].first % 8) << "buffer " << i << " is not aligned";
+        EXPECT_LE(bufs[i].first + bufs[i].second, (int64_t)msgs[1].body.size());
+    }
+
+    // No nulls, so the validity bitmaps are empty
+    size_t validity[] = { 0, 3, 5, 7, 9, 11, 13, 15 };
+    for (size_t i = 0; i < COLUMNS; i++)
+        EXPECT_EQ(0, bufs[validity[i]].second) << columns[i].name << " validity";
+
+    EXPECT_EQ(hex("00000000 03000000 06000000 0b000000"), bufferBytes(msgs[1], bufs[1]));
+    EXPECT_EQ(std::string("adddel100:7"), bufferBytes(msgs[1], bufs[2]));
+    EXPECT_EQ(hex("05"), bufferBytes(msgs[1], bufs[4]));           // rows 0 and 2 set
+    EXPECT_EQ(hex("18 20 00"), bufferBytes(msgs[1], bufs[6]));
+    EXPECT_EQ(hex("0201 ffff 0000"), bufferBytes(msgs[1], bufs[8]));
+    EXPECT_EQ(hex("e9fd0000 00ea56fa 00000000"), bufferBytes(msgs[1], bufs[10]));
+    EXPECT_EQ(hex("0100000000000000 0807060504030201 0000000000000000"), bufferBytes(msgs[1], bufs[12]));
+    EXPECT_EQ(hex("a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+                  "00000000000000000000000000000000"
+                  "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"), bufferBytes(msgs[1], bufs[14]));
+    EXPECT_EQ(hex("40a22bf73d540500 0000000000000000 41420f0000000000"), bufferBytes(msgs[1], bufs[16]));
+
+    // Padding between buffers is zero
+    std::string body = msgs[1].body;
+    for (size_t i = 0; i < bufs.size(); i++)
+        body.replace(bufs[i].first, bufs[i].second, bufs[i].second, '\0');
+    EXPECT_EQ(std::string(body.size(), '\0'), body);
+}
+
+TEST_F(ArrowBatchTest, MessagesAligned) {
+    std::string stream;
+
+    addRows(batch);
+    batch.encode(stream);
+
+    std::vector<message> msgs = splitStream(stream);
+
+    EXPECT_EQ(0u, stream.size() % 8);
+    for (size_t i = 0; i < msgs.size(); i++) {
+        EXPECT_EQ(0u, msgs[i].offset % 8) << "message " << i;
+        EXPECT_EQ(0u, msgs[i].metadata.size() % 8) << "message " << i;
+        EXPECT_EQ(0u, msgs[i].body.size() % 8) << "message " << i;
+    }
+}
+
+TEST_F(ArrowBatchTest, BoolBitmapSpansBytes) {
+    const ArrowBatch::column_def flag[] = { { "flag", ArrowBatch::COL_BOOL } };
+    ArrowBatch bools(&logger, flag, 1);
+    std::string stream;
+
+    for (int i = 0; i < 10; i++)
+        bools.begin().boolean(i == 0 or i == 7 or i == 9).end();
+
+    bools.encode(stream);
+
+    std::vector<message> msgs = splitStream(stream);
+    ASSERT_EQ(2u, msgs.size());
+
+    int64_t rows;
+    std::vector<std::pair<int64_t, int64_t> > nodes;
+    std::vector<std::pair<int64_t, int64_t> > bufs = buffers(msgs[1], rows, nodes);
+
+    EXPECT_EQ(10, rows);
+    ASSERT_EQ(2u, bufs.size());
+    EXPECT_EQ(hex("81 02"), bufferBytes(msgs[1], bufs[1]));
+}
+
+TEST_F(ArrowBatchTest, SecondBatchAfterClear) {
+    std::string first, second;
+
+    addRows(batch);
+    batch.encode(first);
+
+    EXPECT_EQ(0u, batch.rows());
+    EXPECT_EQ(0u, batch.bytes());
+
+    // Rows added and cleared are not in the next batch
+    addRows(batch);
+    batch.clear();
+
+    batch.begin().str("up").boolean(false).u8(1).u16(2).u32(3).u64(4).hash(NULL).ts(0, 5).end();
+    batch.encode(second);
+
+    std::vector<message> a = splitStream(first);
+    std::vector<message> b = splitStream(second);
+    ASSERT_EQ(2u, a.size());
+    ASSERT_EQ(2u, b.size());
+
+    // Same schema message
+    EXPECT_EQ(a[0].metadata, b[0].metadata);
+
+    int64_t rows;
+    std::vector<std::pair<int64_t, int64_t> > nodes;
+    std::vector<std::pair<int64_t, int64_t> > bufs = buffers(b[1], rows, nodes);
+
+    EXPECT_EQ(1, rows);
+    ASSERT_EQ(COLUMNS * 2 + 1, bufs.size());
+    EXPECT_EQ(1, nodes[0].first);
+    EXPECT_EQ(hex("00000000 02000000"), bufferBytes(b[1], bufs[1]));
+    EXPECT_EQ(std::string("up"), bufferBytes(b[1], bufs[2]));
+    EXPECT_EQ(hex("00"), bufferBytes(b[1], bufs[4]));
+    EXPECT_EQ(hex("01"), bufferBytes(b[1], bufs[6]));
+    EXPECT_EQ(hex("0200"), bufferBytes(b[1], bufs[8]));
+    EXPECT_EQ(hex("03000000"), bufferBytes(b[1], bufs[10]));
+    EXPECT_EQ(hex("0400000000000000"), bufferBytes(b[1], bufs[12]));
+    EXPECT_EQ(hex("00000000000000000000000000000000"), bufferBytes(b[1], bufs[14]));
+    EXPECT_EQ(hex("0500000000000000"), bufferBytes(b[1], bufs[16]));
+}
+
+TEST_F(ArrowBatchTest, MismatchedRowDropped) {
+    std::string stream;
+
+    addRows(batch);
+    size_t bytes = batch.bytes();
+
+    // u32 where the u16 column is expected
+    batch.begin().str("bad").boolean(true).u8(1).u32(2).u32(3).u64(4).hash(NULL).ts(0, 0);
+    EXPECT_FALSE(batch.end());
+
+    // Missing the last column
+    batch.begin().str("short").boolean(true).u8(1).u16(2).u32(3).u64(4).hash(NULL);
+    EXPECT_FALSE(batch.end());
+
+    EXPECT_EQ(3u, batch.rows());
+    EXPECT_EQ(2u, batch.droppedRows());
+    EXPECT_EQ(bytes, batch.bytes());
+
+    std::string expected;
+    ArrowBatch good(&logger, columns, COLUMNS);
+
+    addRows(good);
+    good.encode(expected);
+    batch.encode(stream);
+
+    EXPECT_EQ(expected, stream);
+}
@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * binfmt::Writer encoding tests
+ *
+ * Expected bytes are commented hex, one field per line.
+ */
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "BinaryFormat.h"
+#include "test_util.h"
+
+namespace {
+
+std::string output(const binfmt::Writer &w) {
+    return std::string(w.data(), w.length());
+}
+
+/**
+ * Append one prefix row the way the message bus does: drop the row and stop once
+ *      the buffer is full
+ *
+ * \return number of rows written
+ */
+size_t writeRows(binfmt::Writer &w, const std::vector<std::string> &prefixes) {
+    size_t rows = 0;
+
+    for (size_t i = 0; i < prefixes.size(); i++) {
+        size_t row_start = w.length();
+
+        w.begin().u8(0).u64(i).addr(prefixes[i].c_str()).end();
+
+        if (w.overflow()) {
+            w.truncate(row_start);
+            break;
+        }
+
+        ++rows;
+    }
+
+    return rows;
+}
+
+} // namespace
+
+TEST(BinaryFormatTest, FieldEncodings) {
+    char buf[256];
+    binfmt::Writer w(buf, sizeof(buf));
+    u_char hash_id[16];
+
+    for (int i = 0; i < 16; i++)
+        hash_id[i] = i;
+
+    w.begin();
+    w.u8(0x01).u16(0x0203).u32(0x04050607).u64(0x08090A0B0C0D0E0FULL);
+    w.hash(hash_id).hash(NULL);
+    w.str("ab").str("");
+    w.addr("192.0.2.1").addr("2001:db8::1").addr("").addr("not an address");
+    w.ts(0x5A000000, 999999);
+    w.end();
+
+    EXPECT_FALSE(w.overflow());
+    EXPECT_EQ(hex("00000059"                                   // record length (89)
+                  "01 0203 04050607 08090a0b0c0d0e0f"           // u8, u16, u32, u64
+                  "000102030405060708090a0b0c0d0e0f"            // hash
+                  "00000000000000000000000000000000"            // NULL hash
+                  "00000002 6162"                               // str "ab"
+                  "00000000"                                    // empty str
+                  "04 c0000201"                                 // IPv4 address
+                  "10 20010db8000000000000000000000001"         // IPv6 address
+                  "00"                                          // empty address
+                  "00"                                          // invalid address
+                  "5a000000 000f423f"),                         // ts
+              output(w));
+}
+
+TEST(BinaryFormatTest, BinaryAddress) {
+    char buf[64];
+    binfmt::Writer w(buf, sizeof(buf));
+    u_char addr[16] = { 198, 51, 100, 7, 0xFF, 0xFF };
+
+    w.addr(addr, true).addr(addr, false);
+
+    EXPECT_EQ(hex("04 c6336407"
+                  "10 c6336407ffff00000000000000000000"),
+              output(w));
+}
+
+TEST(BinaryFormatTest, ConsecutiveRecords) {
+    char buf[64];
+    binfmt::Writer w(buf, sizeof(buf));
+    std::vector<std::string> prefixes;
+
+    prefixes.push_back("10.0.0.0");
+    prefixes.push_back("");
+
+    EXPECT_EQ(2u, writeRows(w, prefixes));
+    EXPECT_EQ(hex("0000000e 00 0000000000000000 04 0a000000"
+                  "0000000a 00 0000000000000001 00"),
+              output(w));
+}
+
+TEST(BinaryFormatTest, EmptyVector) {
+    char buf[64];
+    binfmt::Writer w(buf, sizeof(buf));
+
+    EXPECT_EQ(0u, writeRows(w, std::vector<std::string>()));
+    EXPECT_EQ(0u, w.length());
+    EXPECT_FALSE(w.overflow());
+}
+
+TEST(BinaryFormatTest, RecordFillsBufferExactly) {
+    char buf[18];                                           // One IPv4 row is 4 + 14 bytes
+    binfmt::Writer w(buf, sizeof(buf));
+    std::vector<std::string> prefixes(3, "10.0.0.0");
+
+    EXPECT_EQ(1u, writeRows(w, prefixes));
+    EXPECT_EQ(hex("0000000e 00 0000000000000000 04 0a000000"), output(w));
+    EXPECT_FALSE(w.overflow());
+}
+
+TEST(BinaryFormatTest, PartialRecordDropped) {
+    char buf[18 + 10];                                      // Second row ends 8 bytes past the buffer
+    binfmt::Writer w(buf, sizeof(buf));
+    std::vector<std::string> prefixes(3, "10.0.0.0");
+
+    EXPECT_EQ(1u, writeRows(w, prefixes));
+    EXPECT_EQ(18u, w.length());
+    EXPECT_FALSE(w.overflow());
+
+    // Only the first u64 fits; nothing is written after an overflow
+    w.u64(0).u64(0).u8(1);
+    EXPECT_TRUE(w.overflow());
+    EXPECT_EQ(18u + 8u, w.length());
+
+    w.truncate(18);
+    w.u8(0xAB);
+    EXPECT_EQ(hex("0000000e 00 0000000000000000 04 0a000000 ab"), output(w));
+}
+
+TEST(BinaryFormatTest, OverflowLeavesRecordLength) {
+    char buf[8];
+    binfmt::Writer w(buf, sizeof(buf));
+
+    // end() of an overflowed record must not write the length
+    w.begin().u32(0x01020304).u8(5).end();
+
+    EXPECT_TRUE(w.overflow());
+    EXPECT_EQ(hex("00000000 01020304"), output(w));
+}
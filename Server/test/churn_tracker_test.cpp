@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * ChurnTracker tests
+ *
+ * The tracker is process wide; each test enables it again and reads a report
+ * first to start from an empty interval.  The sketches are wide enough that the
+ * few keys used are counted exactly.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "ChurnTracker.h"
+#include "test_util.h"
+
+namespace {
+
+const size_t TOP_K = 5;
+
+MsgBusInterface::obj_bgp_peer peer(uint8_t id) {
+    MsgBusInterface::obj_bgp_peer p;
+
+    memset(&p, 0, sizeof(p));
+    p.hash_id[0] = id;
+    p.router_hash_id[0] = 0xAA;
+    snprintf(p.peer_addr, sizeof(p.peer_addr), "203.0.113.%u", id);
+
+    return p;
+}
+
+/**
+ * 10.0.{octet}.0/24 prefixes, octet repeated for each prefix
+ */
+MsgBusInterface::rib_vector prefixes(const std::vector<uint8_t> &octets) {
+    MsgBusInterface::rib_vector rib(octets.size());
+
+    for (size_t i = 0; i < octets.size(); i++) {
+        memset(&rib[i], 0, sizeof(rib[i]));
+        rib[i].isIPv4 = 1;
+        rib[i].prefix_len = 24;
+        rib[i].prefix_bin[0] = 10;
+        rib[i].prefix_bin[2] = octets[i];
+    }
+
+    return rib;
+}
+
+ChurnTracker &tracker() {
+    MsgBusInterface::obj_churn_report report;
+
+    ChurnTracker::instance().enable(TOP_K, CHURN_DEFAULT_SKETCH_WIDTH);
+    ChurnTracker::instance().report(report);
+
+    return ChurnTracker::instance();
+}
+
+std::vector<MsgBusInterface::obj_churn> rows(const MsgBusInterface::obj_churn_report &report,
+                                             MsgBusInterface::churn_type type) {
+    std::vector<MsgBusInterface::obj_churn> out;
+
+    for (size_t i = 0; i < report.rows.size(); i++) {
+        if (report.rows[i].type == type)
+            out.push_back(report.rows[i]);
+    }
+
+    return out;
+}
+
+} // namespace
+
+TEST(ChurnTrackerTest, TopKMergedAcrossShards) {
+    ChurnTracker &ct = tracker();
+    MsgBusInterface::obj_bgp_peer p1 = peer(1), p2 = peer(2);
+    std::vector<uint8_t> octets;
+
+    // Prefix k is advertised k + 1 times; 200 keys cover every shard
+    for (int k = 0; k < 200; k++)
+        octets.insert(octets.end(), k + 1, (uint8_t)k);
+
+    ct.record(p1, prefixes(octets), 65001, false);
+    ct.record(p2, prefixes(std::vector<uint8_t>(3, 199)), 65002, false);
+    ct.record(p2, prefixes(std::vector<uint8_t>(1, 7)), 0, true);
+
+    MsgBusInterface::obj_churn_report report;
+    ct.report(report);
+
+    std::vector<MsgBusInterface::obj_churn> total = rows(report, MsgBusInterface::CHURN_TYPE_TOTAL);
+    ASSERT_EQ(1u, total.size());
+    EXPECT_EQ(octets.size() + 3, total[0].updates);
+    EXPECT_EQ(1u, total[0].withdraws);
+
+    std::vector<MsgBusInterface::obj_churn> pfx = rows(report, MsgBusInterface::CHURN_TYPE_PREFIX);
+    ASSERT_EQ(TOP_K, pfx.size());
+    EXPECT_STREQ("10.0.199.0/24", pfx[0].key);
+    EXPECT_EQ(203u, pfx[0].updates);
+    for (size_t i = 1; i < TOP_K; i++) {
+        char key[32];
+        snprintf(key, sizeof(key), "10.0.%zu.0/24", 199 - i);
+
+        EXPECT_EQ(i + 1, pfx[i].rank);
+        EXPECT_STREQ(key, pfx[i].key);
+        EXPECT_EQ(200 - i, pfx[i].updates);
+        EXPECT_EQ(0u, pfx[i].withdraws);
+    }
+
+    std::vector<MsgBusInterface::obj_churn> origins = rows(report, MsgBusInterface::CHURN_TYPE_ORIGIN_AS);
+    ASSERT_EQ(2u, origins.size());
+    EXPECT_STREQ("65001", origins[0].key);
+    EXPECT_EQ(octets.size(), origins[0].updates);
+    EXPECT_STREQ("65002", origins[1].key);
+    EXPECT_EQ(3u, origins[1].updates);
+
+    std::vector<MsgBusInterface::obj_churn> peers = rows(report, MsgBusInterface::CHURN_TYPE_PEER);
+    ASSERT_EQ(2u, peers.size());
+    EXPECT_STREQ("203.0.113.1", peers[0].key);
+    EXPECT_EQ(1, peers[0].rank);
+    EXPECT_EQ(octets.size(), peers[0].updates);
+    EXPECT_STREQ("203.0.113.2", peers[1].key);
+    EXPECT_EQ(3u, peers[1].updates);
+    EXPECT_EQ(1u, peers[1].withdraws);
+    EXPECT_EQ(0xAA, peers[1].router_hash_id[0]);
+    EXPECT_EQ(2, peers[1].peer_hash_id[0]);
+}
+
+TEST(ChurnTrackerTest, ReportStartsNewInterval) {
+    ChurnTracker &ct = tracker();
+    MsgBusInterface::obj_churn_report report;
+
+    ct.record(peer(1), prefixes(std::vector<uint8_t>(2, 1)), 65001, false);
+    ct.report(report);
+    ct.report(report);
+
+    ASSERT_EQ(1u, report.rows.size());
+    EXPECT_EQ(MsgBusInterface::CHURN_TYPE_TOTAL, report.rows[0].type);
+    EXPECT_EQ(0u, report.rows[0].updates);
+}
+
+TEST(ChurnTrackerTest, ConcurrentRecord) {
+    ChurnTracker &ct = tracker();
+    std::vector<std::thread> threads;
+    std::vector<uint8_t> octets;
+
+    for (int k = 0; k < 64; k++)
+        octets.push_back(k);
+
+    // Every thread records the same prefixes from its own peer
+    for (uint8_t t = 1; t <= 4; t++) {
+        threads.push_back(std::thread([&ct, &octets, t]() {
+            MsgBusInterface::obj_bgp_peer p = peer(t);
+            MsgBusInterface::rib_vector rib = prefixes(octets);
+
+            for (int i = 0; i < 100; i++)
+                ct.record(p, rib, 65000 + t, i % 2);
+        }));
+    }
+
+    for (size_t i = 0; i < threads.size(); i++)
+        threads[i].join();
+
+    MsgBusInterface::obj_churn_report report;
+    ct.report(report);
+
+    EXPECT_EQ(4u * 50 * 64, report.rows[0].updates);
+    EXPECT_EQ(4u * 50 * 64, report.rows[0].withdraws);
+
+    std::vector<MsgBusInterface::obj_churn> pfx = rows(report, MsgBusInterface::CHURN_TYPE_PREFIX);
+    ASSERT_EQ(TOP_K, pfx.size());
+    for (size_t i = 0; i < pfx.size(); i++) {
+        EXPECT_EQ(4u * 50, pfx[i].updates);
+        EXPECT_EQ(4u * 50, pfx[i].withdraws);
+    }
+
+    std::vector<MsgBusInterface::obj_churn> peers = rows(report, MsgBusInterface::CHURN_TYPE_PEER);
+    ASSERT_EQ(4u, peers.size());
+    for (size_t i = 0; i < peers.size(); i++) {
+        EXPECT_EQ(50u * 64, peers[i].updates);
+        EXPECT_EQ(50u * 64, peers[i].withdraws);
+    }
+}
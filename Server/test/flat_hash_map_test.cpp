@@ -0,0 +1,220 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * FlatHashMap unit tests
+ *
+ * Random inserts and erases are checked against std::unordered_map, with the
+ * real key hash and with a hash of few values that makes long probe runs, so
+ * that backward shift deletion moves entries across runs and the table wrap.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "FlatHashMap.hpp"
+
+namespace {
+
+/// Prefix key like the Loc-RIB uses: prefix (16), prefix length (1), IPv4 (1), labeled (1)
+typedef BinaryKey<19> prefix_key_t;
+
+prefix_key_t prefixKey(uint32_t addr, uint8_t prefix_len) {
+    prefix_key_t key;
+
+    memcpy(key.data, &addr, sizeof(addr));
+    key.data[16] = prefix_len;
+    key.data[17] = 1;
+
+    return key;
+}
+
+/**
+ * Hash with only a few distinct values, all keys collide into long probe runs
+ */
+struct CollidingHash {
+    size_t operator()(const prefix_key_t &key) const {
+        return BinaryKeyHash<19>()(key) % 5;
+    }
+};
+
+struct StdHash {
+    size_t operator()(const prefix_key_t &key) const {
+        return BinaryKeyHash<19>()(key);
+    }
+};
+
+typedef std::unordered_map<prefix_key_t, uint32_t, StdHash> reference_map;
+
+/**
+ * Check that map and reference have the same entries, by lookup and by iteration
+ */
+template <typename Map>
+void expectSame(const Map &map, const reference_map &reference) {
+    ASSERT_EQ(reference.size(), map.size());
+
+    for (reference_map::const_iterator it = reference.begin(); it != reference.end(); ++it) {
+        const uint32_t *value = map.find(it->first);
+
+        ASSERT_TRUE(value != NULL);
+        EXPECT_EQ(it->second, *value);
+    }
+
+    size_t iterated = 0;
+    for (typename Map::const_iterator it = map.begin(); it != map.end(); ++it) {
+        reference_map::const_iterator ref = reference.find(it.key());
+
+        ASSERT_TRUE(ref != reference.end());
+        EXPECT_EQ(ref->second, it.value());
+        ++iterated;
+    }
+
+    EXPECT_EQ(reference.size(), iterated);
+}
+
+/**
+ * Random inserts, overwrites and erases over a small key space
+ */
+template <typename Map>
+void randomOps(Map &map, size_t ops, uint32_t keys, unsigned seed) {
+    reference_map reference;
+    std::mt19937 rng(seed);
+
+    for (size_t i = 0; i < ops; i++) {
+        prefix_key_t key = prefixKey(rng() % keys, 24);
+        uint32_t op = rng() % 8;
+
+        if (op < 5) {
+            uint32_t value = rng();
+            map[key] = value;
+            reference[key] = value;
+
+        } else {
+            EXPECT_EQ(reference.erase(key) == 1, map.erase(key));
+        }
+
+        // Full check walks the whole map, do it periodically
+        if (i % 997 == 0)
+            expectSame(map, reference);
+    }
+
+    expectSame(map, reference);
+
+    // Erase everything in random order
+    std::vector<prefix_key_t> remaining;
+    for (reference_map::const_iterator it = reference.begin(); it != reference.end(); ++it)
+        remaining.push_back(it->first);
+
+    std::shuffle(remaining.begin(), remaining.end(), rng);
+
+    for (size_t i = 0; i < remaining.size(); i++) {
+        EXPECT_TRUE(map.erase(remaining[i]));
+        reference.erase(remaining[i]);
+
+        if (i % 97 == 0)
+            expectSame(map, reference);
+    }
+
+    EXPECT_TRUE(map.empty());
+    EXPECT_TRUE(map.begin() == map.end());
+}
+
+TEST(FlatHashMapTest, RandomAgainstUnorderedMap) {
+    FlatHashMap<prefix_key_t, uint32_t> map;
+
+    randomOps(map, 200000, 5000, 1);
+}
+
+TEST(FlatHashMapTest, RandomWithCollidingHash) {
+    FlatHashMap<prefix_key_t, uint32_t, CollidingHash> map;
+
+    randomOps(map, 20000, 300, 2);
+}
+
+TEST(FlatHashMapTest, GrowthKeepsEntries) {
+    FlatHashMap<prefix_key_t, uint32_t> map(1);
+    reference_map reference;
+
+    // Starts at 8 slots and doubles past 3/4 load many times
+    for (uint32_t i = 0; i < 100000; i++) {
+        map[prefixKey(i, 32)] = i;
+        reference[prefixKey(i, 32)] = i;
+    }
+
+    expectSame(map, reference);
+
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_TRUE(map.find(prefixKey(1, 32)) == NULL);
+
+    map[prefixKey(1, 32)] = 7;
+    EXPECT_EQ(1u, map.size());
+    EXPECT_EQ(7u, *map.find(prefixKey(1, 32)));
+}
+
+TEST(FlatHashMapTest, MissingKeyIsValueInitialized) {
+    FlatHashMap<prefix_key_t, uint32_t> map;
+
+    EXPECT_EQ(0u, map[prefixKey(1, 8)]);
+    EXPECT_EQ(1u, map.size());
+    EXPECT_FALSE(map.erase(prefixKey(2, 8)));
+    EXPECT_EQ(1u, map.size());
+}
+
+TEST(FlatHashMapTest, KeysDifferingOnlyInLength) {
+    FlatHashMap<prefix_key_t, uint32_t> map;
+
+    // Same address bytes, one key per prefix length
+    for (uint32_t len = 0; len <= 32; len++)
+        map[prefixKey(0x0A000000, len)] = len;
+
+    ASSERT_EQ(33u, map.size());
+
+    for (uint32_t len = 0; len <= 32; len++)
+        EXPECT_EQ(len, *map.find(prefixKey(0x0A000000, len)));
+
+    EXPECT_TRUE(map.erase(prefixKey(0x0A000000, 24)));
+    EXPECT_TRUE(map.find(prefixKey(0x0A000000, 24)) == NULL);
+    EXPECT_EQ(25u, *map.find(prefixKey(0x0A000000, 25)));
+    EXPECT_EQ(23u, *map.find(prefixKey(0x0A000000, 23)));
+}
+
+TEST(FlatHashMapTest, BinaryKeyTailBytes) {
+    u_char a[13], b[13];
+
+    memset(a, 0x55, sizeof(a));
+    memcpy(b, a, sizeof(b));
+
+    // Key sizes that are not a multiple of 8 are hashed with a partial last word
+    EXPECT_TRUE(BinaryKey<13>(a) == BinaryKey<13>(b));
+    EXPECT_EQ(BinaryKeyHash<13>()(BinaryKey<13>(a)), BinaryKeyHash<13>()(BinaryKey<13>(b)));
+
+    b[12] ^= 1;
+    EXPECT_TRUE(BinaryKey<13>(a) != BinaryKey<13>(b));
+    EXPECT_NE(BinaryKeyHash<13>()(BinaryKey<13>(a)), BinaryKeyHash<13>()(BinaryKey<13>(b)));
+
+    // Bytes beyond the key size are not part of the key
+    EXPECT_TRUE(BinaryKey<12>(a) == BinaryKey<12>(b));
+
+    FlatHashMap<BinaryKey<13>, int> map;
+    map[BinaryKey<13>(a)] = 1;
+    map[BinaryKey<13>(b)] = 2;
+
+    EXPECT_EQ(2u, map.size());
+    EXPECT_EQ(1, *map.find(BinaryKey<13>(a)));
+    EXPECT_EQ(2, *map.find(BinaryKey<13>(b)));
+}
+
+} // namespace
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * IngestScheduler slot tests
+ *
+ * The scheduler is process wide and runs with a single worker slot, so a
+ * router that keeps its slot makes the other router's acquire() wait.
+ */
+
+#include <atomic>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "IngestScheduler.h"
+
+namespace {
+
+const uint32_t QUANTUM = 1024 * 1024;
+
+/**
+ * Take the slot as another router and give it back
+ */
+void otherRouter(std::atomic<bool> &granted) {
+    IngestScheduler &sched = IngestScheduler::instance();
+    IngestScheduler::router *r = sched.add();
+
+    sched.acquire(r);
+    granted = sched.holding(r);
+
+    sched.release(r);
+    sched.remove(r);
+}
+
+} // namespace
+
+TEST(IngestSchedulerTest, BlockingSectionHandsOffSlot) {
+    IngestScheduler &sched = IngestScheduler::instance();
+    std::atomic<bool> granted(false);
+
+    sched.enable(1, QUANTUM);
+
+    IngestScheduler::router *r = sched.add();
+    sched.acquire(r);
+    ASSERT_TRUE(sched.holding(r));
+
+    {
+        IngestScheduler::BlockingSection blocking;
+        EXPECT_FALSE(sched.holding(r));
+
+        // Would wait forever if the section kept the only slot
+        std::thread other(otherRouter, std::ref(granted));
+        other.join();
+    }
+
+    EXPECT_TRUE(granted);
+    EXPECT_TRUE(sched.holding(r));
+
+    sched.remove(r);
+}
+
+TEST(IngestSchedulerTest, BlockingSectionWithoutSlot) {
+    IngestScheduler &sched = IngestScheduler::instance();
+
+    sched.enable(1, QUANTUM);
+
+    // No router on this thread
+    {
+        IngestScheduler::BlockingSection blocking;
+    }
+
+    // Router not holding a slot is not given one at the section end
+    IngestScheduler::router *r = sched.add();
+    {
+        IngestScheduler::BlockingSection blocking;
+    }
+    EXPECT_FALSE(sched.holding(r));
+
+    sched.remove(r);
+
+    // The slot is still free
+    std::atomic<bool> granted(false);
+    std::thread other(otherRouter, std::ref(granted));
+    other.join();
+    EXPECT_TRUE(granted);
+}
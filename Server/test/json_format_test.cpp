@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * jsonfmt::Writer string escaping tests
+ *
+ * Each case writes one string value and compares the bytes between the quotes.
+ */
+
+#include <ostream>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "JsonFormat.h"
+
+namespace {
+
+struct escape_case {
+    const char  *name;
+    std::string input;
+    std::string expected;
+};
+
+void PrintTo(const escape_case &c, std::ostream *os) {
+    *os << c.name;
+}
+
+const std::string FFFD = "\xEF\xBF\xBD";
+
+const escape_case cases[] = {
+    { "plain ASCII",            "router-1 IOS-XR 6.1", "router-1 IOS-XR 6.1" },
+    { "quote and backslash",    "a\"b\\c", "a\\\"b\\\\c" },
+    { "control characters",     "a\tb\nc\rd", "a\\tb\\nc\\rd" },
+    { "other control as \\u",   std::string("a\x01" "b\x1f", 4), "a\\u0001b\\u001f" },
+    { "NUL as \\u",             std::string("a\0b", 3), "a\\u0000b" },
+    { "DEL copied",             "a\x7f", "a\x7f" },
+    { "2 byte UTF-8",           "caf\xC3\xA9", "caf\xC3\xA9" },
+    { "3 byte UTF-8",           "\xE2\x82\xAC 5", "\xE2\x82\xAC 5" },
+    { "4 byte UTF-8",           "\xF0\x9F\x98\x80", "\xF0\x9F\x98\x80" },
+    { "highest code point",     "\xF4\x8F\xBF\xBF", "\xF4\x8F\xBF\xBF" },
+    { "Latin-1 byte",           "caf\xE9 au lait", "caf" + FFFD + " au lait" },
+    { "lone continuation",      "a\x80" "b", "a" + FFFD + "b" },
+    { "overlong 2 byte",        "\xC0\xAF", FFFD + FFFD },
+    { "overlong 3 byte",        "\xE0\x80\xAF", FFFD + FFFD + FFFD },
+    { "surrogate",              "\xED\xA0\x80", FFFD + FFFD + FFFD },
+    { "above U+10FFFF",         "\xF4\x90\x80\x80", FFFD + FFFD + FFFD + FFFD },
+    { "invalid lead byte",      "\xFF" "a", FFFD + "a" },
+    { "truncated at end",       "ab\xE2\x82", "ab" + FFFD + FFFD },
+    { "truncated by ASCII",     "\xE2\x82" "a", FFFD + FFFD + "a" },
+    { "invalid then escape",    "\xE9\"", FFFD + "\\\"" },
+};
+
+} // namespace
+
+class JsonEscapeTest : public ::testing::TestWithParam<escape_case> {
+};
+
+TEST_P(JsonEscapeTest, Str) {
+    const escape_case &c = GetParam();
+    char buf[256];
+    textfmt::Writer tw(buf, sizeof(buf));
+    jsonfmt::Writer jw(tw);
+
+    jw.str(c.input);
+
+    ASSERT_FALSE(tw.overflow());
+    EXPECT_EQ("\"" + c.expected + "\"", std::string(buf, tw.length())) << c.name;
+}
+
+INSTANTIATE_TEST_CASE_P(Escaping, JsonEscapeTest, ::testing::ValuesIn(cases));
+
+TEST(JsonFormatTest, JoinedStringsValidatedSeparately) {
+    char buf[256];
+    textfmt::Writer tw(buf, sizeof(buf));
+    jsonfmt::Writer jw(tw);
+
+    // A sequence split across the two parts is not valid in either part
+    jw.str(std::string("a\xC3"), ':', std::string("\xA9" "b"));
+
+    EXPECT_EQ("\"a" + FFFD + ":" + FFFD + "b\"", std::string(buf, tw.length()));
+}
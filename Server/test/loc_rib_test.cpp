@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * LocRib decision process tests
+ *
+ * Each case advertises the same prefix from a set of candidate paths, in both
+ * orders, and checks which path the Loc-RIB publishes as best.
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+
+#include <gtest/gtest.h>
+
+#include "LocRib.h"
+#include "test_util.h"
+
+namespace {
+
+/**
+ * Message bus that keeps the published best path changes
+ */
+class LocRibBus : public NullMsgBus {
+public:
+    std::vector<obj_loc_rib> rows;
+
+    void update_LocRib(std::vector<obj_loc_rib> &rows) {
+        this->rows.insert(this->rows.end(), rows.begin(), rows.end());
+    }
+};
+
+const int ABSENT = -1;                      ///< LOCAL_PREF not present
+
+/**
+ * Candidate path; each path is advertised by its own peer
+ */
+struct candidate {
+    uint32_t    peer_as;
+    uint32_t    local_as;                   ///< Local ASN of the session, zero for no peer up
+    int         local_pref;                 ///< ABSENT if not present
+    uint16_t    as_path_len;
+    const char  *origin;
+    uint32_t    med;
+    uint32_t    neighbor_as;
+    const char  *next_hop;
+    const char  *bgp_id;                    ///< Peer BGP ID
+};
+
+struct decision_case {
+    const char              *name;
+    std::vector<candidate>  paths;
+    size_t                  best;           ///< Index of the expected best path
+};
+
+void PrintTo(const decision_case &c, std::ostream *os) {
+    *os << c.name;
+}
+
+const decision_case cases[] = {
+    { "highest local pref", {
+        { 65001, 65000, 100, 1, "igp", 0, 65001, "192.0.2.1", "10.0.0.1" },
+        { 65002, 65000, 200, 3, "incomplete", 50, 65002, "192.0.2.2", "10.0.0.2" },
+    }, 1 },
+    { "absent local pref is 100", {
+        { 65001, 65000, ABSENT, 1, "igp", 0, 65001, "192.0.2.1", "10.0.0.1" },
+        { 65002, 65000, 99, 1, "igp", 0, 65002, "192.0.2.2", "10.0.0.2" },
+    }, 0 },
+    { "absent local pref loses to 101", {
+        { 65001, 65000, ABSENT, 1, "igp", 0, 65001, "192.0.2.1", "10.0.0.1" },
+        { 65002, 65000, 101, 2, "igp", 0, 65002, "192.0.2.2", "10.0.0.2" },
+    }, 1 },
+    { "shortest AS path", {
+        { 65001, 65000, 100, 3, "igp", 0, 65001, "192.0.2.1", "10.0.0.1" },
+        { 65002, 65000, 100, 2, "incomplete", 100, 65002, "192.0.2.2", "10.0.0.2" },
+        { 65003, 65000, 100, 4, "igp", 0, 65003, "192.0.2.3", "10.0.0.3" },
+    }, 1 },
+    { "lowest origin", {
+        { 65001, 65000, 100, 2, "incomplete", 0, 65001, "192.0.2.1", "10.0.0.1" },
+        { 65002, 65000, 100, 2, "egp", 100, 65002, "192.0.2.2", "10.0.0.2" },
+        { 65003, 65000, 100, 2, "igp", 200, 65003, "192.0.2.3", "10.0.0.3" },
+    }, 2 },
+    { "lowest MED from the same neighbor AS", {
+        { 65001, 65000, 100, 2, "igp", 20, 65010, "192.0.2.1", "10.0.0.1" },
+        { 65002, 65000, 100, 2, "igp", 10, 65010, "192.0.2.2", "10.0.0.2" },
+    }, 1 },
+    { "MED not compared between neighbor ASes", {
+        // Path 1 has the lowest MED but a different neighbor AS; path 0 wins on next hop
+        { 65001, 65000, 100, 2, "igp", 20, 65010, "192.0.2.1", "10.0.0.1" },
+        { 65002, 65000, 100, 2, "igp", 10, 65020, "192.0.2.2", "10.0.0.2" },
+    }, 0 },
+    { "MED removes only paths of its neighbor AS", {
+        { 65001, 65000, 100, 2, "igp", 30, 65010, "192.0.2.1", "10.0.0.1" },
+        { 65002, 65000, 100, 2, "igp", 50, 65020, "192.0.2.2", "10.0.0.2" },
+        { 65003, 65000, 100, 2, "igp", 20, 65010, "192.0.2.3", "10.0.0.3" },
+    }, 1 },
+    { "eBGP over iBGP", {
+        { 65000, 65000, 100, 2, "igp", 0, 65010, "192.0.2.1", "10.0.0.1" },
+        { 65002, 65000, 100, 2, "igp", 0, 65002, "192.0.2.2", "10.0.0.2" },
+    }, 1 },
+    { "no peer up is iBGP", {
+        { 65001, 0, 100, 2, "igp", 0, 65001, "192.0.2.1", "10.0.0.1" },
+        { 65002, 65000, 100, 2, "igp", 0, 65002, "192.0.2.2", "10.0.0.2" },
+    }, 1 },
+    { "lowest next hop", {
+        { 65001, 65000, 100, 2, "igp", 0, 65001, "192.0.2.9", "10.0.0.1" },
+        { 65002, 65000, 100, 2, "igp", 0, 65002, "192.0.2.5", "10.0.0.2" },
+    }, 1 },
+    { "lowest router ID", {
+        { 65001, 65000, 100, 2, "igp", 0, 65001, "192.0.2.1", "10.0.0.9" },
+        { 65002, 65000, 100, 2, "igp", 0, 65002, "192.0.2.1", "10.0.0.3" },
+        { 65003, 65000, 100, 2, "igp", 0, 65003, "192.0.2.1", "10.0.0.5" },
+    }, 1 },
+    { "router ID compared as a number", {
+        { 65001, 65000, 100, 2, "igp", 0, 65001, "192.0.2.1", "10.0.0.10" },
+        { 65002, 65000, 100, 2, "igp", 0, 65002, "192.0.2.1", "10.0.0.9" },
+    }, 1 },
+};
+
+/**
+ * Runs the decision cases
+ */
+class LocRibDecisionTest : public ::testing::TestWithParam<decision_case> {
+protected:
+    static MsgBusInterface::obj_bgp_peer peer(size_t idx, const candidate &c) {
+        MsgBusInterface::obj_bgp_peer p;
+
+        memset(&p, 0, sizeof(p));
+        p.hash_id[0] = idx + 1;
+        p.peer_addr_bin[15] = idx + 1;
+        snprintf(p.peer_addr, sizeof(p.peer_addr), "203.0.113.%zu", idx + 1);
+        snprintf(p.peer_bgp_id, sizeof(p.peer_bgp_id), "%s", c.bgp_id);
+        p.peer_as = c.peer_as;
+        p.isIPv4 = true;
+        p.isAdjIn = true;
+        p.isPrePolicy = true;
+
+        return p;
+    }
+
+    static PathAttrTable::ref attr(const candidate &c) {
+        MsgBusInterface::obj_path_attr a = MsgBusInterface::obj_path_attr();
+
+        a.local_pref_present = c.local_pref != ABSENT;
+        a.local_pref = c.local_pref != ABSENT ? c.local_pref : 0;
+        a.as_path_count = c.as_path_len;
+        snprintf(a.origin, sizeof(a.origin), "%s", c.origin);
+        a.med = c.med;
+        a.neighbor_as = c.neighbor_as;
+        a.nexthop_isIPv4 = true;
+        snprintf(a.next_hop, sizeof(a.next_hop), "%s", c.next_hop);
+
+        return PathAttrTable::instance().intern(a);
+    }
+
+    /**
+     * Advertise the paths in the given order
+     *
+     * \return index of the published best path, or -1 if none
+     */
+    static int best(const std::vector<candidate> &paths, const std::vector<size_t> &order) {
+        LocRib loc_rib(true, true);
+        LocRibBus bus;
+        MsgBusInterface::rib_vector rib(1);
+
+        memset(&rib[0], 0, sizeof(rib[0]));
+        rib[0].isIPv4 = 1;
+        rib[0].prefix_len = 24;
+        inet_pton(AF_INET, "198.51.100.0", rib[0].prefix_bin);
+
+        for (size_t i = 0; i < order.size(); i++) {
+            const candidate &c = paths[order[i]];
+            MsgBusInterface::obj_bgp_peer p = peer(order[i], c);
+
+            if (c.local_as != 0)
+                loc_rib.peerUp(p, c.local_as);
+
+            loc_rib.advertise(&bus, p, rib, attr(c));
+        }
+
+        if (bus.rows.empty() or bus.rows.back().action != MsgBusInterface::LOC_RIB_ACTION_ADD)
+            return -1;
+
+        return bus.rows.back().peer_hash_id[0] - 1;
+    }
+};
+
+TEST_P(LocRibDecisionTest, Best) {
+    const decision_case &c = GetParam();
+    std::vector<size_t> order;
+
+    for (size_t i = 0; i < c.paths.size(); i++)
+        order.push_back(i);
+
+    EXPECT_EQ((int)c.best, best(c.paths, order)) << c.name;
+
+    std::reverse(order.begin(), order.end());
+    EXPECT_EQ((int)c.best, best(c.paths, order)) << c.name << " (reverse order)";
+}
+
+INSTANTIATE_TEST_CASE_P(DecisionProcess, LocRibDecisionTest, ::testing::ValuesIn(cases));
+
+TEST(LocRibTest, WithdrawSelectsNextBest) {
+    LocRib loc_rib(true, true);
+    LocRibBus bus;
+    MsgBusInterface::rib_vector rib(1);
+    MsgBusInterface::obj_bgp_peer p[2];
+    MsgBusInterface::obj_path_attr a = MsgBusInterface::obj_path_attr();
+
+    memset(&rib[0], 0, sizeof(rib[0]));
+    rib[0].isIPv4 = 1;
+    rib[0].prefix_len = 24;
+
+    snprintf(a.origin, sizeof(a.origin), "igp");
+
+    for (int i = 0; i < 2; i++) {
+        memset(&p[i], 0, sizeof(p[i]));
+        p[i].hash_id[0] = i + 1;
+        p[i].isAdjIn = true;
+        p[i].isPrePolicy = true;
+
+        a.local_pref_present = true;
+        a.local_pref = 200 - i * 100;
+        loc_rib.advertise(&bus, p[i], rib, PathAttrTable::instance().intern(a));
+    }
+
+    ASSERT_EQ(1u, bus.rows.size());                         // Second path is not better
+    EXPECT_EQ(1, bus.rows[0].peer_hash_id[0]);
+
+    loc_rib.withdraw(&bus, p[0], rib);
+    ASSERT_EQ(2u, bus.rows.size());
+    EXPECT_EQ(MsgBusInterface::LOC_RIB_ACTION_ADD, bus.rows[1].action);
+    EXPECT_EQ(2, bus.rows[1].peer_hash_id[0]);
+
+    loc_rib.removePeer(&bus, p[1]);
+    ASSERT_EQ(3u, bus.rows.size());
+    EXPECT_EQ(MsgBusInterface::LOC_RIB_ACTION_DEL, bus.rows[2].action);
+}
+
+TEST(LocRibTest, AcceptsOnlyAdjRibInOfPolicy) {
+    LocRib loc_rib(true, false);
+    MsgBusInterface::obj_bgp_peer p;
+
+    memset(&p, 0, sizeof(p));
+    p.isAdjIn = true;
+    EXPECT_TRUE(loc_rib.accepts(p));
+
+    p.isAdjIn = false;                                      // Adj-RIB-Out
+    EXPECT_FALSE(loc_rib.accepts(p));
+
+    p.isAdjIn = true;
+    p.isPrePolicy = true;
+    EXPECT_FALSE(loc_rib.accepts(p));
+
+    p.isPrePolicy = false;
+    p.isL3VPN = true;
+    EXPECT_FALSE(loc_rib.accepts(p));
+
+    p.isL3VPN = false;
+    p.isLocRib = true;
+    EXPECT_FALSE(loc_rib.accepts(p));
+}
+
+} // namespace
@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * MrtSnapshot unit tests
+ *
+ * A router with an IPv4 and an IPv6 peer is added to the process wide index and
+ * its snapshot is compared byte for byte with hand encoded TABLE_DUMP_V2
+ * records (RFC 6396 4.3, RFC 8050).  RIB records are in index order, so they
+ * are compared as a set with the sequence numbers checked separately.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "MrtSnapshot.h"
+#include "test_util.h"
+
+#define ROUTER_ADDR     "198.51.100.254"
+
+/**
+ * Test fixture, snapshots to a temporary directory
+ */
+class MrtSnapshotTest : public ::testing::Test {
+protected:
+    Logger              logger;
+    std::string         dir;
+    RibIndex            &index;
+    u_char              router_hash_id[16];
+
+    MrtSnapshotTest() : logger(NULL, NULL), index(RibIndex::instance()) {
+        char tmpl[] = "/tmp/openbmpd_rib_XXXXXX";
+
+        if (mkdtemp(tmpl) != NULL)
+            dir = tmpl;
+
+        index.enable();
+        memset(router_hash_id, 0xC0, sizeof(router_hash_id));
+    }
+
+    ~MrtSnapshotTest() {
+        index.removeRouter(router_hash_id);
+
+        // Other routers in the index are written to the directory as well
+        std::vector<std::string> routers = list(dir);
+
+        for (size_t r = 0; r < routers.size(); r++) {
+            std::string router_dir = dir + "/" + routers[r];
+            std::vector<std::string> files = list(router_dir);
+
+            for (size_t i = 0; i < files.size(); i++)
+                unlink((router_dir + "/" + files[i]).c_str());
+
+            rmdir(router_dir.c_str());
+        }
+
+        rmdir(dir.c_str());
+    }
+
+    static std::vector<std::string> list(const std::string &path) {
+        std::vector<std::string> names;
+        DIR *d = opendir(path.c_str());
+
+        if (d != NULL) {
+            dirent *e;
+            while ((e = readdir(d)) != NULL) {
+                if (e->d_name[0] != '.')
+                    names.push_back(e->d_name);
+            }
+            closedir(d);
+        }
+
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    /**
+     * Write a snapshot of all routers without the snapshot thread
+     */
+    bool write(uint32_t start_secs) {
+        MrtSnapshot writer(&logger, dir, 7200, false);
+
+        writer.running = true;
+        return writer.writeSnapshot(start_secs);
+    }
+
+    /**
+     * Write a snapshot and read back the file of the router
+     */
+    std::string snapshot(uint32_t start_secs) {
+        std::string router_dir = dir + "/" ROUTER_ADDR;
+        std::string data;
+
+        EXPECT_TRUE(write(start_secs));
+
+        std::vector<std::string> files = list(router_dir);
+        EXPECT_EQ(1u, files.size());
+
+        for (size_t i = 0; i < files.size(); i++) {
+            std::ifstream in((router_dir + "/" + files[i]).c_str(), std::ios::binary);
+            std::ostringstream content;
+
+            content << in.rdbuf();
+            data.append(content.str());
+        }
+
+        return data;
+    }
+
+    MsgBusInterface::obj_bgp_peer peer(const char *addr, uint32_t peer_as, const char *bgp_id) {
+        MsgBusInterface::obj_bgp_peer p;
+
+        memset(&p, 0, sizeof(p));
+        p.isIPv4 = strchr(addr, ':') == NULL;
+        memcpy(p.hash_id, router_hash_id, sizeof(p.hash_id));
+        memcpy(p.router_hash_id, router_hash_id, sizeof(p.router_hash_id));
+        p.hash_id[15] = p.isIPv4 ? 4 : 6;
+        snprintf(p.peer_addr, sizeof(p.peer_addr), "%s", addr);
+        inet_pton(p.isIPv4 ? AF_INET : AF_INET6, addr, p.peer_addr_bin + (p.isIPv4 ? 12 : 0));
+        snprintf(p.peer_bgp_id, sizeof(p.peer_bgp_id), "%s", bgp_id);
+        p.peer_as = peer_as;
+        p.timestamp_secs = 0x5F000000;
+
+        return p;
+    }
+
+    void advertise(const MsgBusInterface::obj_bgp_peer &p, const char *prefix, uint8_t prefix_len,
+                   uint32_t path_id, const MsgBusInterface::obj_path_attr &attr) {
+        MsgBusInterface::rib_vector rib(1);
+
+        memset(&rib[0], 0, sizeof(rib[0]));
+        rib[0].isIPv4 = strchr(prefix, ':') == NULL;
+        rib[0].prefix_len = prefix_len;
+        rib[0].path_id = path_id;
+        inet_pton(rib[0].isIPv4 ? AF_INET : AF_INET6, prefix, rib[0].prefix_bin);
+
+        index.advertise(p, ROUTER_ADDR, rib, PathAttrTable::instance().intern(attr), 0);
+    }
+
+    /**
+     * Split records, the sequence number of RIB records is moved to seqs
+     */
+    static std::vector<std::string> records(const std::string &data, std::vector<uint32_t> &seqs) {
+        std::vector<std::string> out;
+
+        for (size_t pos = 0; pos + 12 <= data.size(); ) {
+            const u_char *hdr = (const u_char *)data.data() + pos;
+            size_t len = 12 + ((hdr[8] << 24) | (hdr[9] << 16) | (hdr[10] << 8) | hdr[11]);
+            std::string rec = data.substr(pos, len);
+
+            if (hdr[7] != 1 and rec.size() >= 16) {
+                const u_char *seq = (const u_char *)rec.data() + 12;
+
+                seqs.push_back((seq[0] << 24) | (seq[1] << 16) | (seq[2] << 8) | seq[3]);
+                rec.replace(12, 4, 4, '\0');
+            }
+
+            out.push_back(rec);
+            pos += len;
+        }
+
+        return out;
+    }
+};
+
+namespace {
+
+TEST_F(MrtSnapshotTest, PeerIndexAndRibRecords) {
+    MsgBusInterface::obj_bgp_peer p4 = peer("192.0.2.1", 65001, "10.0.0.1");
+    MsgBusInterface::obj_bgp_peer p6 = peer("2001:db8::2", 4200000000u, "10.0.0.2");
+    MsgBusInterface::obj_path_attr a = MsgBusInterface::obj_path_attr();
+    MsgBusInterface::obj_path_attr b = MsgBusInterface::obj_path_attr();
+
+    ASSERT_FALSE(dir.empty());
+
+    // MED of zero is present, LOCAL_PREF is not
+    snprintf(a.origin, sizeof(a.origin), "igp");
+    a.as_path = " 65001 64512";
+    a.nexthop_isIPv4 = true;
+    snprintf(a.next_hop, sizeof(a.next_hop), "192.0.2.1");
+    a.med_present = true;
+    a.community_list = "65001:100";
+
+    // LOCAL_PREF of zero is present, MED is not
+    snprintf(b.origin, sizeof(b.origin), "incomplete");
+    b.as_path = " 4200000000 { 1 2 }";
+    snprintf(b.next_hop, sizeof(b.next_hop), "2001:db8::2");
+    b.local_pref_present = true;
+
+    advertise(p4, "203.0.113.0", 24, 0, a);
+    advertise(p4, "198.51.100.0", 25, 1, a);
+    advertise(p4, "198.51.100.0", 25, 2, a);
+    advertise(p6, "2001:db8:1::", 48, 0, b);
+    advertise(p6, "2001:db8:2::", 48, 7, b);
+
+    const char *attrs_a =
+            "0026"                                  // Attribute length
+            "40 01 01 00"                           // ORIGIN igp
+            "40 02 0a 02 02 0000fde9 0000fc00"      // AS_PATH sequence 65001 64512
+            "40 03 04 c0000201"                     // NEXT_HOP
+            "80 04 04 00000000"                     // MED
+            "c0 08 04 fde9 0064";                   // COMMUNITIES
+
+    const char *attrs_b =
+            "0032"
+            "40 01 01 02"                           // ORIGIN incomplete
+            "40 02 10 02 01 fa56ea00 01 02 00000001 00000002"
+            "80 0e 11 10 20010db8 00000000 00000000 00000002"   // MP_REACH_NLRI next hop only
+            "40 05 04 00000000";                    // LOCAL_PREF
+
+    std::vector<std::string> expected;
+
+    // RIB_IPV4_UNICAST
+    expected.push_back(hex("5f5e1000 000d 0002 00000038  00000000 18 cb0071 0001"
+                           "0000 5f000000") + hex(attrs_a));
+
+    // RIB_IPV4_UNICAST_ADDPATH, two paths of the peer
+    expected.push_back(hex("5f5e1000 000d 0008 0000006f  00000000 19 c6336400 0002"
+                           "0000 5f000000 00000001") + hex(attrs_a)
+                       + hex("0000 5f000000 00000002") + hex(attrs_a));
+
+    // RIB_IPV6_UNICAST
+    expected.push_back(hex("5f5e1000 000d 0004 00000047  00000000 30 20010db80001 0001"
+                           "0001 5f000000") + hex(attrs_b));
+
+    // RIB_IPV6_UNICAST_ADDPATH
+    expected.push_back(hex("5f5e1000 000d 000a 0000004b  00000000 30 20010db80002 0001"
+                           "0001 5f000000 00000007") + hex(attrs_b));
+
+    std::string peer_table = hex(
+            "5f5e1000 000d 0001 0000003c"           // Timestamp, TABLE_DUMP_V2, PEER_INDEX_TABLE, length
+            "00000000"                              // Collector BGP ID
+            "000e 3139382e35312e3130302e323534"     // View name (router address)
+            "0002"
+            "02 0a000001 c0000201 0000fde9"         // AS4 IPv4 peer
+            "03 0a000002 20010db8 00000000 00000000 00000002 fa56ea00");
+
+    std::vector<uint32_t> seqs;
+    std::vector<std::string> recs = records(snapshot(0x5F5E1000), seqs);
+
+    ASSERT_EQ(5u, recs.size());
+    EXPECT_EQ(peer_table, recs[0]);
+
+    recs.erase(recs.begin());
+    std::sort(recs.begin(), recs.end());
+    std::sort(expected.begin(), expected.end());
+    EXPECT_EQ(expected, recs);
+
+    std::sort(seqs.begin(), seqs.end());
+    for (size_t i = 0; i < seqs.size(); i++)
+        EXPECT_EQ(i, seqs[i]);
+}
+
+TEST_F(MrtSnapshotTest, WithdrawnPeerNotWritten) {
+    MsgBusInterface::obj_bgp_peer p4 = peer("192.0.2.1", 65001, "10.0.0.1");
+    MsgBusInterface::obj_path_attr a = MsgBusInterface::obj_path_attr();
+
+    ASSERT_FALSE(dir.empty());
+
+    snprintf(a.origin, sizeof(a.origin), "igp");
+    advertise(p4, "203.0.113.0", 24, 0, a);
+    index.removePeer(p4.hash_id);
+
+    EXPECT_TRUE(write(0x5F5E1000));
+
+    EXPECT_TRUE(list(dir + "/" ROUTER_ADDR).empty());
+}
+
+} // namespace
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * MrtWriter unit tests
+ *
+ * Records are written to an uncompressed archive in a temporary directory and
+ * compared byte for byte with hand encoded BGP4MP_ET records (RFC 6396 4.4).
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "MrtWriter.h"
+#include "test_util.h"
+
+namespace {
+
+/**
+ * Test fixture, archives to a temporary directory
+ */
+class MrtWriterTest : public ::testing::Test {
+protected:
+    Logger              logger;
+    std::string         dir;
+    MrtWriter           *writer;
+
+    MrtWriterTest() : logger(NULL, NULL), writer(NULL) {
+        char tmpl[] = "/tmp/openbmpd_mrt_XXXXXX";
+
+        if (mkdtemp(tmpl) != NULL)
+            dir = tmpl;
+
+        writer = new MrtWriter(&logger, dir, 900, false);
+        writer->setRouter("192.0.2.254");
+    }
+
+    ~MrtWriterTest() {
+        delete writer;
+
+        std::string router_dir = dir + "/192.0.2.254";
+        std::vector<std::string> files = list(router_dir);
+
+        for (size_t i = 0; i < files.size(); i++)
+            unlink((router_dir + "/" + files[i]).c_str());
+
+        rmdir(router_dir.c_str());
+        rmdir(dir.c_str());
+    }
+
+    static std::vector<std::string> list(const std::string &path) {
+        std::vector<std::string> names;
+        DIR *d = opendir(path.c_str());
+
+        if (d != NULL) {
+            dirent *e;
+            while ((e = readdir(d)) != NULL) {
+                if (e->d_name[0] != '.')
+                    names.push_back(e->d_name);
+            }
+            closedir(d);
+        }
+
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    /**
+     * Complete the archive and read back all of its files
+     */
+    std::string archived() {
+        std::string router_dir = dir + "/192.0.2.254";
+        std::string data;
+
+        writer->close();
+
+        std::vector<std::string> files = list(router_dir);
+        for (size_t i = 0; i < files.size(); i++) {
+            std::ifstream in((router_dir + "/" + files[i]).c_str(), std::ios::binary);
+            std::ostringstream content;
+
+            content << in.rdbuf();
+            data.append(content.str());
+        }
+
+        return data;
+    }
+
+    static MsgBusInterface::obj_bgp_peer peer(const char *addr, uint32_t peer_as) {
+        MsgBusInterface::obj_bgp_peer p;
+
+        memset(&p, 0, sizeof(p));
+        p.isIPv4 = strchr(addr, ':') == NULL;
+        p.hash_id[0] = p.isIPv4 ? 4 : 6;
+        snprintf(p.peer_addr, sizeof(p.peer_addr), "%s", addr);
+        inet_pton(p.isIPv4 ? AF_INET : AF_INET6, addr, p.peer_addr_bin + (p.isIPv4 ? 12 : 0));
+        p.peer_as = peer_as;
+        p.timestamp_secs = 0x5F000000;
+        p.timestamp_us = 123456;
+
+        return p;
+    }
+
+    static MsgBusInterface::obj_peer_up_event upEvent(const char *local_ip, uint32_t local_asn) {
+        MsgBusInterface::obj_peer_up_event up;
+
+        memset(&up, 0, sizeof(up));
+        snprintf(up.local_ip, sizeof(up.local_ip), "%s", local_ip);
+        up.local_asn = local_asn;
+
+        return up;
+    }
+};
+
+/// BGP KEEPALIVE message
+const std::string keepalive = hex("ffffffff ffffffff ffffffff ffffffff 0013 04");
+
+TEST_F(MrtWriterTest, PeerUpAndMessageAs4) {
+    MsgBusInterface::obj_bgp_peer p = peer("192.0.2.1", 65001);
+
+    ASSERT_FALSE(dir.empty());
+
+    writer->peerUp(p, upEvent("192.0.2.2", 65000));
+    writer->message(p, false, (const u_char *)keepalive.data(), keepalive.size());
+
+    std::string expected = hex(
+            // STATE_CHANGE_AS4, Idle to Established
+            "5f000000 0011 0005 0000001c"       // Timestamp, BGP4MP_ET, subtype, length
+            "0001e240"                          // Microseconds
+            "0000fde9 0000fde8 0000 0001"       // Peer AS, local AS, interface, AFI
+            "c0000201 c0000202"                 // Peer IP, local IP
+            "0001 0006"
+            // MESSAGE_AS4
+            "5f000000 0011 0004 0000002b"
+            "0001e240"
+            "0000fde9 0000fde8 0000 0001"
+            "c0000201 c0000202") + keepalive;
+
+    EXPECT_EQ(expected, archived());
+}
+
+TEST_F(MrtWriterTest, MessageTwoOctetAsn) {
+    MsgBusInterface::obj_bgp_peer p = peer("192.0.2.1", 4200000000u);
+
+    ASSERT_FALSE(dir.empty());
+
+    writer->peerUp(p, upEvent("192.0.2.2", 65000));
+    writer->message(p, true, (const u_char *)keepalive.data(), keepalive.size());
+
+    std::string data = archived();
+    std::string expected = hex(
+            // MESSAGE with AS_TRANS for the 4 octet peer ASN
+            "5f000000 0011 0001 00000027"
+            "0001e240"
+            "5ba0 fde8 0000 0001"
+            "c0000201 c0000202") + keepalive;
+
+    ASSERT_EQ(40u + expected.size(), data.size());         // After the peer up state change
+    EXPECT_EQ(expected, data.substr(40));
+}
+
+TEST_F(MrtWriterTest, PeerDownIPv6WithoutPeerUp) {
+    MsgBusInterface::obj_bgp_peer p = peer("2001:db8::1", 65001);
+
+    ASSERT_FALSE(dir.empty());
+
+    writer->peerDown(p);
+
+    std::string expected = hex(
+            // STATE_CHANGE_AS4, Established to Idle; local side not known
+            "5f000000 0011 0005 00000034"
+            "0001e240"
+            "0000fde9 00000000 0000 0002"
+            "20010db8 00000000 00000000 00000001"
+            "00000000 00000000 00000000 00000000"
+            "0006 0001");
+
+    EXPECT_EQ(expected, archived());
+}
+
+TEST_F(MrtWriterTest, Disabled) {
+    MrtWriter disabled(&logger, "", 900, false);
+    MsgBusInterface::obj_bgp_peer p = peer("192.0.2.1", 65001);
+
+    disabled.setRouter("192.0.2.254");
+    disabled.peerUp(p, upEvent("192.0.2.2", 65000));
+    disabled.message(p, false, (const u_char *)keepalive.data(), keepalive.size());
+    disabled.close();
+
+    EXPECT_FALSE(disabled.enabled());
+    EXPECT_EQ(-1, disabled.msUntilRotation());
+}
+
+} // namespace
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * OverloadControl level stepping tests
+ *
+ * Time is passed explicitly as T0 plus milliseconds (zero means unset to the
+ * control).  Raise is 1 second and recover 2 seconds.  The control is process
+ * wide, so each test enables it again to reset it.
+ */
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "OverloadControl.h"
+
+namespace {
+
+const uint32_t RING_PCT = 80;
+const uint32_t QUEUE_PCT = 80;
+const uint32_t LAG_MS = 5000;
+const uint64_t T0 = 1000000;
+
+OverloadControl &control() {
+    std::vector<OverloadControl::shed_action> levels;
+
+    levels.push_back(OverloadControl::SHED_BMP_RAW);
+    levels.push_back(OverloadControl::SHED_BASE_ATTRIBUTE);
+
+    OverloadControl::instance().enable(levels, RING_PCT, QUEUE_PCT, LAG_MS, 1, 2);
+    return OverloadControl::instance();
+}
+
+OverloadControl::backlog queue(uint32_t pct) {
+    OverloadControl::backlog b = { 0, pct, 0 };
+    return b;
+}
+
+} // namespace
+
+TEST(OverloadControlTest, RaisesWhileQueueFilled) {
+    OverloadControl &oc = control();
+
+    EXPECT_FALSE(oc.update(queue(90), T0 + 0));
+    EXPECT_FALSE(oc.update(queue(90), T0 + 999));
+    EXPECT_TRUE(oc.update(queue(90), T0 + 1000));
+    EXPECT_EQ(1, oc.level());
+    EXPECT_TRUE(oc.shedding(OverloadControl::SHED_BMP_RAW));
+    EXPECT_FALSE(oc.shedding(OverloadControl::SHED_BASE_ATTRIBUTE));
+
+    EXPECT_TRUE(oc.update(queue(90), T0 + 2000));
+    EXPECT_EQ(2, oc.level());
+    EXPECT_EQ("bmp_raw,base_attribute", oc.shedList());
+
+    // No level beyond the configured ones
+    EXPECT_FALSE(oc.update(queue(90), T0 + 5000));
+    EXPECT_EQ(2, oc.level());
+}
+
+TEST(OverloadControlTest, DropsLevelAfterQueueDrains) {
+    OverloadControl &oc = control();
+
+    oc.update(queue(90), T0 + 0);
+    oc.update(queue(90), T0 + 1000);
+    oc.update(queue(90), T0 + 2000);
+    ASSERT_EQ(2, oc.level());
+
+    /*
+     * The router stops producing; the queue fill is refreshed on the reader's poll
+     *      timeout as the queue drains
+     */
+    EXPECT_FALSE(oc.update(queue(40), T0 + 2100));
+    EXPECT_FALSE(oc.update(queue(0), T0 + 4099));
+    EXPECT_TRUE(oc.update(queue(0), T0 + 4100));
+    EXPECT_EQ(1, oc.level());
+    EXPECT_FALSE(oc.shedding(OverloadControl::SHED_BASE_ATTRIBUTE));
+
+    EXPECT_TRUE(oc.update(queue(0), T0 + 6100));
+    EXPECT_EQ(0, oc.level());
+    EXPECT_EQ("", oc.shedList());
+}
+
+TEST(OverloadControlTest, RefillRestartsRecovery) {
+    OverloadControl &oc = control();
+
+    oc.update(queue(90), T0 + 0);
+    oc.update(queue(90), T0 + 1000);
+    ASSERT_EQ(1, oc.level());
+
+    oc.update(queue(0), T0 + 1100);
+    oc.update(queue(90), T0 + 2000);        // Over again before the recover time
+    EXPECT_FALSE(oc.update(queue(0), T0 + 2100));
+    EXPECT_FALSE(oc.update(queue(0), T0 + 4000));
+    EXPECT_EQ(1, oc.level());
+
+    EXPECT_TRUE(oc.update(queue(0), T0 + 4100));
+    EXPECT_EQ(0, oc.level());
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * PathAttrTable interning and sweep tests
+ *
+ * The table is process wide; tests use AS paths no other test uses and restore
+ * the default maximum.
+ */
+
+#include <cstdio>
+
+#include <gtest/gtest.h>
+
+#include "PathAttrTable.h"
+
+namespace {
+
+MsgBusInterface::obj_path_attr attr(uint32_t n) {
+    MsgBusInterface::obj_path_attr a = MsgBusInterface::obj_path_attr();
+    char as_path[64];
+
+    snprintf(as_path, sizeof(as_path), " 64512 64513 %u", n);
+    a.as_path = as_path;
+    snprintf(a.origin, sizeof(a.origin), "igp");
+    snprintf(a.next_hop, sizeof(a.next_hop), "198.51.100.1");
+
+    return a;
+}
+
+} // namespace
+
+TEST(PathAttrTableTest, EqualSetsShareEntry) {
+    PathAttrTable &table = PathAttrTable::instance();
+    size_t entries = table.size();
+    size_t bytes = table.memoryBytes();
+
+    PathAttrTable::ref a = table.intern(attr(1));
+    PathAttrTable::ref b = table.intern(attr(1));
+    PathAttrTable::ref c = table.intern(attr(2));
+
+    EXPECT_EQ(a.get(), b.get());
+    EXPECT_NE(a.get(), c.get());
+    EXPECT_EQ(entries + 2, table.size());
+    EXPECT_GE(table.memoryBytes(), bytes + 2 * sizeof(PathAttrTable::entry));
+    EXPECT_EQ(a.get(), table.find(attr(1)).get());
+}
+
+TEST(PathAttrTableTest, SweepsUnreferencedAboveMaxBytes) {
+    PathAttrTable &table = PathAttrTable::instance();
+    const size_t MAX_BYTES = 64 * 1024;
+
+    table.setMaxBytes(MAX_BYTES);
+
+    PathAttrTable::ref kept = table.intern(attr(100));
+
+    // Each set is unreferenced as soon as it is interned
+    for (uint32_t n = 101; n < 3000; n++) {
+        table.intern(attr(n));
+        ASSERT_LE(table.memoryBytes(), MAX_BYTES);
+    }
+
+    EXPECT_LT(table.size(), 3000u - 101);
+    EXPECT_EQ(kept.get(), table.find(attr(100)).get());
+
+    table.setMaxBytes(PATH_ATTR_TABLE_DEFAULT_MAX_BYTES);
+}
@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * RibIndex unit tests
+ *
+ * Each test uses its own router and peers in the process wide index and removes
+ * them at the end.
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+
+#include <gtest/gtest.h>
+
+#include "RibIndex.h"
+
+namespace {
+
+/**
+ * Test fixture, adds and removes prefixes given as strings
+ */
+class RibIndexTest : public ::testing::Test {
+protected:
+    RibIndex            &index;
+    u_char              router_hash_id[16];
+
+    RibIndexTest() : index(RibIndex::instance()) {
+        static uint8_t router = 0;
+
+        index.enable();
+
+        memset(router_hash_id, 0xA0, sizeof(router_hash_id));
+        router_hash_id[0] = ++router;
+    }
+
+    ~RibIndexTest() {
+        index.removeRouter(router_hash_id);
+    }
+
+    MsgBusInterface::obj_bgp_peer peer(uint8_t id) {
+        MsgBusInterface::obj_bgp_peer p;
+
+        memset(&p, 0, sizeof(p));
+        memcpy(p.hash_id, router_hash_id, sizeof(p.hash_id));
+        memcpy(p.router_hash_id, router_hash_id, sizeof(p.router_hash_id));
+        p.hash_id[15] = id;
+        p.isIPv4 = true;
+        p.peer_as = 65000 + id;
+
+        return p;
+    }
+
+    static MsgBusInterface::obj_rib rib(const std::string &prefix, uint32_t path_id = 0) {
+        MsgBusInterface::obj_rib r;
+        size_t slash = prefix.find('/');
+        std::string ip = prefix.substr(0, slash);
+
+        memset(&r, 0, sizeof(r));
+        r.isIPv4 = ip.find(':') == std::string::npos;
+        r.prefix_len = atoi(prefix.c_str() + slash + 1);
+        r.path_id = path_id;
+        inet_pton(r.isIPv4 ? AF_INET : AF_INET6, ip.c_str(), r.prefix_bin);
+
+        return r;
+    }
+
+    void advertise(const MsgBusInterface::obj_bgp_peer &p, const std::string &prefix, uint32_t origin_as,
+                   uint32_t path_id = 0) {
+        MsgBusInterface::rib_vector v(1, rib(prefix, path_id));
+        MsgBusInterface::obj_path_attr attr = MsgBusInterface::obj_path_attr();
+
+        attr.origin_as = origin_as;
+        index.advertise(p, "192.0.2.1", v, PathAttrTable::instance().intern(attr), origin_as);
+    }
+
+    void withdraw(const MsgBusInterface::obj_bgp_peer &p, const std::string &prefix, uint32_t path_id = 0) {
+        MsgBusInterface::rib_vector v(1, rib(prefix, path_id));
+
+        index.withdraw(p, v);
+    }
+
+    std::vector<uint32_t> originRoutes(uint32_t origin_as, size_t max_routes, bool *truncated = NULL) {
+        RibIndex::ReadGuard guard(index);
+        std::vector<const RibIndex::route *> routes;
+        std::vector<uint32_t> path_ids;
+
+        bool t = index.findOrigin(origin_as, max_routes, routes);
+        if (truncated != NULL)
+            *truncated = t;
+
+        for (size_t i = 0; i < routes.size(); i++) {
+            EXPECT_EQ(origin_as, routes[i]->origin_as);
+            path_ids.push_back(routes[i]->path_id);
+        }
+
+        std::sort(path_ids.begin(), path_ids.end());
+        return path_ids;
+    }
+
+    size_t exactRoutes(const std::string &prefix) {
+        RibIndex::ReadGuard guard(index);
+        std::vector<const RibIndex::route *> routes;
+        MsgBusInterface::obj_rib r = rib(prefix);
+
+        index.findExact(r.prefix_bin, r.prefix_len, r.isIPv4, -1, routes);
+        return routes.size();
+    }
+};
+
+TEST_F(RibIndexTest, ExactAndWithdraw) {
+    MsgBusInterface::obj_bgp_peer p1 = peer(1), p2 = peer(2);
+
+    advertise(p1, "10.1.0.0/16", 64501);
+    advertise(p2, "10.1.0.0/16", 64501);
+    advertise(p1, "10.1.0.0/24", 64501);
+
+    EXPECT_EQ(2u, exactRoutes("10.1.0.0/16"));
+    EXPECT_EQ(2u, exactRoutes("10.1.255.255/16"));          // Host bits are masked
+    EXPECT_EQ(1u, exactRoutes("10.1.0.0/24"));
+
+    withdraw(p1, "10.1.0.0/16");
+    EXPECT_EQ(1u, exactRoutes("10.1.0.0/16"));
+
+    index.removePeer(p2.hash_id);
+    EXPECT_EQ(0u, exactRoutes("10.1.0.0/16"));
+    EXPECT_EQ(1u, exactRoutes("10.1.0.0/24"));
+}
+
+TEST_F(RibIndexTest, LongestMatchPerPeer) {
+    MsgBusInterface::obj_bgp_peer p1 = peer(1), p2 = peer(2);
+
+    advertise(p1, "10.2.0.0/16", 64502);
+    advertise(p1, "10.2.3.0/24", 64502);
+    advertise(p2, "10.2.0.0/16", 64502);
+
+    RibIndex::ReadGuard guard(index);
+    std::vector<const RibIndex::route *> routes;
+    uint8_t addr[16] = { 10, 2, 3, 4 };
+
+    index.findLongest(addr, true, -1, routes);
+
+    ASSERT_EQ(2u, routes.size());
+    EXPECT_EQ(24, routes[0]->prefix_len);
+    EXPECT_EQ(16, routes[1]->prefix_len);
+}
+
+TEST_F(RibIndexTest, Origin) {
+    MsgBusInterface::obj_bgp_peer p1 = peer(1);
+
+    advertise(p1, "10.3.0.0/24", 64503, 1);
+    advertise(p1, "10.3.1.0/24", 64503, 2);
+    advertise(p1, "10.3.2.0/24", 64504, 3);
+    advertise(p1, "2001:db8:3::/48", 64503, 4);
+
+    EXPECT_EQ(std::vector<uint32_t>({ 1, 2, 4 }), originRoutes(64503, 100));
+    EXPECT_EQ(std::vector<uint32_t>({ 3 }), originRoutes(64504, 100));
+    EXPECT_TRUE(originRoutes(64505, 100).empty());
+
+    bool truncated;
+    EXPECT_EQ(2u, originRoutes(64503, 2, &truncated).size());
+    EXPECT_TRUE(truncated);
+
+    originRoutes(64503, 3, &truncated);
+    EXPECT_FALSE(truncated);
+}
+
+TEST_F(RibIndexTest, OriginFollowsReplaceAndWithdraw) {
+    MsgBusInterface::obj_bgp_peer p1 = peer(1), p2 = peer(2);
+
+    advertise(p1, "10.4.0.0/24", 64506, 1);
+    advertise(p1, "10.4.1.0/24", 64506, 2);
+    advertise(p2, "10.4.2.0/24", 64506, 3);
+
+    // Replacing a route with a new origin moves it to the new origin
+    advertise(p1, "10.4.0.0/24", 64507, 1);
+    EXPECT_EQ(std::vector<uint32_t>({ 2, 3 }), originRoutes(64506, 100));
+    EXPECT_EQ(std::vector<uint32_t>({ 1 }), originRoutes(64507, 100));
+
+    withdraw(p1, "10.4.1.0/24", 2);
+    EXPECT_EQ(std::vector<uint32_t>({ 3 }), originRoutes(64506, 100));
+
+    index.removePeer(p2.hash_id);
+    EXPECT_TRUE(originRoutes(64506, 100).empty());
+    EXPECT_EQ(std::vector<uint32_t>({ 1 }), originRoutes(64507, 100));
+}
+
+} // namespace
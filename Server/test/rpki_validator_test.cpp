@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * RpkiValidator unit tests
+ *
+ * Loads small VRP sets from temporary files into the process wide validator and
+ * checks the RFC 6811 origin validation state of prefixes against them.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include <gtest/gtest.h>
+
+#include "RpkiValidator.h"
+
+namespace {
+
+/**
+ * Test fixture, loads a VRP set and looks up prefixes given as strings
+ */
+class RpkiValidatorTest : public ::testing::Test {
+protected:
+    /**
+     * Load a VRP set from a string
+     *
+     * \return number of VRPs loaded
+     */
+    size_t load(const std::string &data, size_t &skipped) {
+        char path[] = "/tmp/rpki_validator_test.XXXXXX";
+        int fd = mkstemp(path);
+        EXPECT_GE(fd, 0);
+
+        EXPECT_EQ((ssize_t)data.size(), write(fd, data.data(), data.size()));
+        close(fd);
+
+        size_t loaded = 0;
+        try {
+            loaded = RpkiValidator::instance().load(path, skipped);
+        } catch (char const *str) {
+            ADD_FAILURE() << str;
+        }
+
+        unlink(path);
+        return loaded;
+    }
+
+    size_t load(const std::string &data) {
+        size_t skipped;
+        return load(data, skipped);
+    }
+
+    /**
+     * Origin validation state of a prefix in the form address/length
+     */
+    static int state(const std::string &prefix, uint32_t origin_as) {
+        uint8_t addr[16] = { 0 };
+        size_t slash = prefix.find('/');
+        std::string ip = prefix.substr(0, slash);
+        bool isIPv4 = ip.find(':') == std::string::npos;
+
+        EXPECT_EQ(1, inet_pton(isIPv4 ? AF_INET : AF_INET6, ip.c_str(), addr));
+
+        return RpkiValidator::instance().lookup(addr, atoi(prefix.c_str() + slash + 1), isIPv4, origin_as);
+    }
+};
+
+const int VALID     = MsgBusInterface::RPKI_STATE_VALID;
+const int INVALID   = MsgBusInterface::RPKI_STATE_INVALID;
+const int NOT_FOUND = MsgBusInterface::RPKI_STATE_UNKNOWN;
+
+TEST_F(RpkiValidatorTest, ExactMatch) {
+    ASSERT_EQ(1u, load("65001,10.0.0.0/16,16\n"));
+
+    EXPECT_EQ(VALID, state("10.0.0.0/16", 65001));
+    EXPECT_EQ(INVALID, state("10.0.0.0/16", 65002));
+    EXPECT_EQ(NOT_FOUND, state("10.1.0.0/16", 65001));
+    EXPECT_EQ(NOT_FOUND, state("10.0.0.0/8", 65001));           // Less specific is not covered
+}
+
+TEST_F(RpkiValidatorTest, MaxLengthEdges) {
+    ASSERT_EQ(1u, load("65001,10.0.0.0/16,24\n"));
+
+    EXPECT_EQ(VALID, state("10.0.0.0/16", 65001));
+    EXPECT_EQ(VALID, state("10.0.255.0/24", 65001));            // At max length
+    EXPECT_EQ(INVALID, state("10.0.255.128/25", 65001));        // One past max length
+    EXPECT_EQ(INVALID, state("10.0.0.1/32", 65001));
+}
+
+TEST_F(RpkiValidatorTest, MaxLengthDefaultsToPrefixLength) {
+    ASSERT_EQ(1u, load("65001,10.0.0.0/16\n"));
+
+    EXPECT_EQ(VALID, state("10.0.0.0/16", 65001));
+    EXPECT_EQ(INVALID, state("10.0.0.0/17", 65001));
+}
+
+TEST_F(RpkiValidatorTest, CoveringRoaWrongOrigin) {
+    ASSERT_EQ(1u, load("65001,10.0.0.0/8,32\n"));
+
+    EXPECT_EQ(INVALID, state("10.20.0.0/16", 65002));
+    EXPECT_EQ(INVALID, state("10.20.30.0/24", 0));              // No origin, e.g. AS_SET
+    EXPECT_EQ(NOT_FOUND, state("11.0.0.0/8", 65002));
+}
+
+TEST_F(RpkiValidatorTest, AnyMatchingVrpIsValid) {
+    ASSERT_EQ(3u, load("65001,10.0.0.0/8,8\n"
+                       "65002,10.1.0.0/16,24\n"
+                       "65003,10.1.2.0/24,24\n"));
+
+    EXPECT_EQ(VALID, state("10.1.2.0/24", 65002));              // Less specific VRP matches
+    EXPECT_EQ(VALID, state("10.1.2.0/24", 65003));
+    EXPECT_EQ(INVALID, state("10.1.2.0/24", 65001));            // Covered, but max length 8
+    EXPECT_EQ(VALID, state("10.0.0.0/8", 65001));
+}
+
+TEST_F(RpkiValidatorTest, As0) {
+    ASSERT_EQ(2u, load("0,192.0.2.0/24,32\n"
+                       "65001,198.51.100.0/24,24\n"));
+
+    // AS0 VRPs only invalidate, and an origin of zero never matches (RFC 6483)
+    EXPECT_EQ(INVALID, state("192.0.2.0/24", 65001));
+    EXPECT_EQ(INVALID, state("192.0.2.0/24", 0));
+    EXPECT_EQ(INVALID, state("198.51.100.0/24", 0));
+}
+
+TEST_F(RpkiValidatorTest, AddressFamiliesAreSeparate) {
+    // 2001:db8:: and 32.1.13.184 have the same leading bits
+    ASSERT_EQ(2u, load("65001,2001:db8::/32,48\n"
+                       "65002,32.1.13.184/29,32\n"));
+
+    EXPECT_EQ(VALID, state("2001:db8:1::/48", 65001));
+    EXPECT_EQ(INVALID, state("2001:db8:1::/48", 65002));
+    EXPECT_EQ(INVALID, state("2001:db8:1::/49", 65001));
+    EXPECT_EQ(NOT_FOUND, state("2001:db9::/32", 65001));
+
+    EXPECT_EQ(VALID, state("32.1.13.184/29", 65002));
+    EXPECT_EQ(INVALID, state("32.1.13.184/29", 65001));
+    EXPECT_EQ(NOT_FOUND, state("32.1.0.0/16", 65001));
+}
+
+TEST_F(RpkiValidatorTest, DefaultRoutes) {
+    ASSERT_EQ(2u, load("65001,0.0.0.0/0,0\n"
+                       "65002,::/0,0\n"));
+
+    EXPECT_EQ(VALID, state("0.0.0.0/0", 65001));
+    EXPECT_EQ(INVALID, state("10.0.0.0/8", 65001));
+    EXPECT_EQ(INVALID, state("0.0.0.0/0", 65002));
+    EXPECT_EQ(VALID, state("::/0", 65002));
+    EXPECT_EQ(INVALID, state("2001:db8::/32", 65002));
+}
+
+TEST_F(RpkiValidatorTest, InvalidEntriesAreSkipped) {
+    size_t skipped;
+
+    ASSERT_EQ(2u, load("ASN,IP Prefix,Max Length,Trust Anchor\n"
+                       "AS65001,10.0.0.0/16,24,ripe\n"
+                       "AS65002,10.1.0.0/16,8,ripe\n"              // Max length below prefix length
+                       "AS65003,10.2.0.0/16,33,ripe\n"             // Max length above 32
+                       "AS65004,10.3.0.0/33,,ripe\n"
+                       "ASx,10.4.0.0/16,24,ripe\n"
+                       "AS65005,2001:db8::/32,128,ripe\n", skipped));
+
+    EXPECT_EQ(4u, skipped);
+    EXPECT_EQ(VALID, state("10.0.1.0/24", 65001));
+    EXPECT_EQ(NOT_FOUND, state("10.1.0.0/16", 65002));
+    EXPECT_EQ(VALID, state("2001:db8::1/128", 65005));
+}
+
+TEST_F(RpkiValidatorTest, Json) {
+    size_t skipped;
+
+    ASSERT_EQ(2u, load("{ \"metadata\": { \"generated\": 1 },\n"
+                       "  \"roas\": [\n"
+                       "    { \"asn\": \"AS65001\", \"prefix\": \"10.0.0.0/16\", \"maxLength\": 24, \"ta\": \"ripe\" },\n"
+                       "    { \"asn\": 65002, \"prefix\": \"2001:db8::/32\", \"maxLength\": 32 },\n"
+                       "    { \"asn\": \"bad\", \"prefix\": \"10.1.0.0/16\", \"maxLength\": 16 }\n"
+                       "  ] }\n", skipped));
+
+    EXPECT_EQ(1u, skipped);
+    EXPECT_EQ(VALID, state("10.0.0.0/24", 65001));
+    EXPECT_EQ(INVALID, state("10.0.0.0/25", 65001));
+    EXPECT_EQ(VALID, state("2001:db8::/32", 65002));
+    EXPECT_EQ(NOT_FOUND, state("10.1.0.0/16", 65001));
+}
+
+TEST_F(RpkiValidatorTest, ReloadReplacesSet) {
+    ASSERT_EQ(1u, load("65001,10.0.0.0/16,16\n"));
+    ASSERT_EQ(1u, load("65002,10.1.0.0/16,16\n"));
+
+    EXPECT_EQ(NOT_FOUND, state("10.0.0.0/16", 65001));
+    EXPECT_EQ(VALID, state("10.1.0.0/16", 65002));
+}
+
+} // namespace
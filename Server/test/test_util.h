@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+#ifndef TEST_UTIL_H_
+#define TEST_UTIL_H_
+
+#include <cctype>
+#include <cstdlib>
+#include <list>
+#include <string>
+#include <vector>
+
+#include "MsgBusInterface.hpp"
+
+/**
+ * Convert hex digits to bytes, other characters are ignored
+ *
+ * \details Used to write expected wire format as readable, commented hex.
+ */
+inline std::string hex(const char *digits) {
+    std::string out;
+    std::string nibbles;
+
+    for (const char *p = digits; *p; p++) {
+        if (isxdigit((unsigned char)*p))
+            nibbles.push_back(*p);
+    }
+
+    for (size_t i = 0; i + 1 < nibbles.size(); i += 2)
+        out.push_back((char)strtoul(nibbles.substr(i, 2).c_str(), NULL, 16));
+
+    return out;
+}
+
+/**
+ * Message bus that drops everything
+ *
+ * \details Tests derive from it and override only the callbacks they record.
+ */
+class NullMsgBus : public MsgBusInterface {
+public:
+    void update_Collector(struct obj_collector &, collector_action_code) { }
+    void update_Router(struct obj_router &, router_action_code) { }
+    void update_Peer(obj_bgp_peer &, obj_peer_up_event *, obj_peer_down_event *, peer_action_code) { }
+    void update_baseAttribute(obj_bgp_peer &, obj_path_attr &, base_attr_action_code) { }
+    void update_unicastPrefix(obj_bgp_peer &, rib_vector &, obj_path_attr *, unicast_prefix_action_code) { }
+    void update_L3Vpn(obj_bgp_peer &, vpn_vector &, obj_path_attr *, vpn_action_code) { }
+    void update_eVPN(obj_bgp_peer &, evpn_vector &, obj_path_attr *, vpn_action_code) { }
+    void add_StatReport(obj_bgp_peer &, obj_stats_report &) { }
+    void add_ChurnReport(obj_churn_report &) { }
+    void add_PeerRollup(std::vector<obj_peer_rollup> &) { }
+    void update_LocRib(std::vector<obj_loc_rib> &) { }
+    void update_LsNode(obj_bgp_peer &, obj_path_attr &, std::list<obj_ls_node> &, ls_action_code) { }
+    void update_LsLink(obj_bgp_peer &, obj_path_attr &, std::list<obj_ls_link> &, ls_action_code) { }
+    void update_LsPrefix(obj_bgp_peer &, obj_path_attr &, std::list<obj_ls_prefix> &, ls_action_code) { }
+    void send_bmp_raw(u_char *, obj_bgp_peer &, u_char *, size_t) { }
+};
+
+#endif /* TEST_UTIL_H_ */
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * UpdateCoalescer tests
+ *
+ * The window is long enough that nothing expires during a test; pending
+ * prefixes are only published by the flush calls.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "UpdateCoalescer.h"
+#include "test_util.h"
+
+namespace {
+
+/**
+ * Message bus that keeps the published unicast prefixes
+ */
+class CoalescerBus : public NullMsgBus {
+public:
+    struct published {
+        uint8_t     peer;                   ///< First byte of the peer hash
+        uint8_t     prefix;                 ///< Third octet of the prefix
+        bool        advertised;
+    };
+
+    std::vector<published> prefixes;
+
+    void update_unicastPrefix(obj_bgp_peer &peer, rib_vector &rib, obj_path_attr *attr,
+                              unicast_prefix_action_code code) {
+        for (size_t i = 0; i < rib.size(); i++) {
+            published p = { peer.hash_id[0], rib[i].prefix_bin[2], code == UNICAST_PREFIX_ACTION_ADD };
+            EXPECT_EQ(p.advertised, attr != NULL);
+            prefixes.push_back(p);
+        }
+    }
+};
+
+const uint32_t WINDOW_MS = 600000;
+
+MsgBusInterface::obj_bgp_peer peer(uint8_t id) {
+    MsgBusInterface::obj_bgp_peer p;
+
+    memset(&p, 0, sizeof(p));
+    p.hash_id[0] = id;
+    snprintf(p.peer_addr, sizeof(p.peer_addr), "203.0.113.%u", id);
+
+    return p;
+}
+
+/**
+ * One 10.0.{octet}.0/24 prefix of a peer
+ */
+MsgBusInterface::rib_vector prefix(const MsgBusInterface::obj_bgp_peer &p, uint8_t octet) {
+    MsgBusInterface::rib_vector rib(1);
+
+    memset(&rib[0], 0, sizeof(rib[0]));
+    memcpy(rib[0].peer_hash_id, p.hash_id, sizeof(rib[0].peer_hash_id));
+    rib[0].isIPv4 = 1;
+    rib[0].prefix_len = 24;
+    rib[0].prefix_bin[0] = 10;
+    rib[0].prefix_bin[2] = octet;
+
+    return rib;
+}
+
+PathAttrTable::ref attr() {
+    MsgBusInterface::obj_path_attr a = MsgBusInterface::obj_path_attr();
+
+    snprintf(a.origin, sizeof(a.origin), "igp");
+    return PathAttrTable::instance().intern(a);
+}
+
+} // namespace
+
+TEST(UpdateCoalescerTest, KeepsFinalState) {
+    UpdateCoalescer coalescer(WINDOW_MS);
+    CoalescerBus bus;
+    MsgBusInterface::obj_bgp_peer p = peer(1);
+
+    coalescer.advertise(&bus, p, prefix(p, 1), attr());
+    coalescer.withdraw(&bus, p, prefix(p, 1));
+    coalescer.advertise(&bus, p, prefix(p, 1), attr());
+    coalescer.withdraw(&bus, p, prefix(p, 1));
+
+    EXPECT_TRUE(bus.prefixes.empty());
+    EXPECT_EQ(1u, coalescer.size());
+
+    coalescer.flushAll(&bus);
+
+    ASSERT_EQ(1u, bus.prefixes.size());
+    EXPECT_FALSE(bus.prefixes[0].advertised);
+    EXPECT_EQ(4u, coalescer.getCounters().received);
+    EXPECT_EQ(3u, coalescer.getCounters().coalesced);
+    EXPECT_EQ(3u, coalescer.getCounters().flaps);
+    EXPECT_EQ(1u, coalescer.getCounters().published);
+}
+
+TEST(UpdateCoalescerTest, FlushPeerLeavesOtherPeersPending) {
+    UpdateCoalescer coalescer(WINDOW_MS);
+    CoalescerBus bus;
+    MsgBusInterface::obj_bgp_peer p1 = peer(1), p2 = peer(2);
+
+    // Interleave the peers so the flushed entries are not contiguous in the window order
+    coalescer.advertise(&bus, p1, prefix(p1, 1), attr());
+    coalescer.advertise(&bus, p2, prefix(p2, 2), attr());
+    coalescer.withdraw(&bus, p1, prefix(p1, 3));
+    coalescer.advertise(&bus, p2, prefix(p2, 4), attr());
+
+    coalescer.flushPeer(&bus, p1.hash_id);
+
+    ASSERT_EQ(2u, bus.prefixes.size());
+    EXPECT_EQ(1, bus.prefixes[0].peer);
+    EXPECT_EQ(1, bus.prefixes[0].prefix);
+    EXPECT_TRUE(bus.prefixes[0].advertised);
+    EXPECT_EQ(1, bus.prefixes[1].peer);
+    EXPECT_EQ(3, bus.prefixes[1].prefix);
+    EXPECT_FALSE(bus.prefixes[1].advertised);
+    EXPECT_EQ(2u, coalescer.size());
+
+    // A new update of a flushed prefix opens a new window
+    coalescer.advertise(&bus, p1, prefix(p1, 1), attr());
+    EXPECT_EQ(3u, coalescer.size());
+    EXPECT_EQ(0u, coalescer.getCounters().coalesced);
+
+    bus.prefixes.clear();
+    coalescer.flushAll(&bus);
+
+    ASSERT_EQ(3u, bus.prefixes.size());
+    EXPECT_EQ(2, bus.prefixes[0].prefix);
+    EXPECT_EQ(4, bus.prefixes[1].prefix);
+    EXPECT_EQ(1, bus.prefixes[2].prefix);
+    EXPECT_EQ(0u, coalescer.size());
+}
+
+TEST(UpdateCoalescerTest, FlushUnknownPeer) {
+    UpdateCoalescer coalescer(WINDOW_MS);
+    CoalescerBus bus;
+    MsgBusInterface::obj_bgp_peer p1 = peer(1), p2 = peer(2);
+
+    coalescer.advertise(&bus, p1, prefix(p1, 1), attr());
+    coalescer.flushPeer(&bus, p2.hash_id);
+
+    EXPECT_TRUE(bus.prefixes.empty());
+    EXPECT_EQ(1u, coalescer.size());
+}
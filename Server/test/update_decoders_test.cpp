@@ -0,0 +1,321 @@
+/*
+ * Copyright (c) 2013-2016 Cisco Systems, Inc. and others.  All rights reserved.
+ *
+ * This program and the accompanying materials are made available under the
+ * terms of the Eclipse Public License v1.0 which accompanies this distribution,
+ * and is available at http://www.eclipse.org/legal/epl-v10.html
+ *
+ */
+
+/**
+ * UpdateDecoders unit tests
+ *
+ * Table driven: each case is NLRI or AS_PATH attribute bytes with the expected
+ * decoded entries.  Well formed unicast NLRI is also decoded with the per prefix
+ * parser that the bulk decoder replaced, and both must give the same prefixes.
+ * Malformed NLRI has to stop with an error, keeping the prefixes before it.
+ */
+
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <arpa/inet.h>
+
+#include <gtest/gtest.h>
+
+#include "UpdateDecoders.h"
+#include "OpenMsg.h"
+#include "ParseArena.h"
+#include "test_util.h"
+
+namespace {
+
+std::string printAddr(bool isIPv4, const uint8_t *prefix_bin) {
+    char ip[INET6_ADDRSTRLEN];
+
+    inet_ntop(isIPv4 ? AF_INET : AF_INET6, prefix_bin, ip, sizeof(ip));
+    return ip;
+}
+
+/**
+ * Print a decoded prefix as "<prefix>/<len>[ id <path id>]"
+ */
+std::string printPrefix(bool isIPv4, const uint8_t *prefix_bin, int len, uint32_t path_id) {
+    char out[80];
+
+    if (path_id != 0)
+        snprintf(out, sizeof(out), "%s/%d id %u", printAddr(isIPv4, prefix_bin).c_str(), len, path_id);
+    else
+        snprintf(out, sizeof(out), "%s/%d", printAddr(isIPv4, prefix_bin).c_str(), len);
+
+    return out;
+}
+
+/**
+ * Per prefix unicast NLRI parser replaced by the bulk decoder
+ *
+ * \details Same loop as the former MPReachAttr::parseNlriData_IPv4IPv6, which did
+ *          not bound check; only used for well formed NLRI.
+ */
+std::vector<std::string> baselineUnicast(bool isIPv4, bool add_path, u_char *data, uint16_t len) {
+    std::vector<std::string> prefixes;
+    u_char ip_raw[16];
+    uint32_t path_id;
+    uint8_t prefix_len;
+    u_char addr_bytes;
+
+    for (size_t read_size = 0; read_size < len; read_size++) {
+        bzero(ip_raw, sizeof(ip_raw));
+
+        if (add_path and (len - read_size) >= 4) {
+            memcpy(&path_id, data, 4);
+            path_id = ntohl(path_id);
+            data += 4; read_size += 4;
+        } else
+            path_id = 0;
+
+        prefix_len = *data++;
+
+        addr_bytes = prefix_len / 8;
+        if (prefix_len % 8)
+            ++addr_bytes;
+
+        memcpy(ip_raw, data, addr_bytes);
+        data += addr_bytes;
+        read_size += addr_bytes;
+
+        prefixes.push_back(printPrefix(isIPv4, ip_raw, prefix_len, path_id));
+    }
+
+    return prefixes;
+}
+
+/**
+ * Decoder selection with or without add-path for all NLRI types
+ */
+bgp_msg::UpdateDecoders decoders(bool add_path) {
+    bgp_msg::UpdateDecoders d;
+
+    if (add_path) {
+        PeerCapabilities caps;
+        const int afis[] = { bgp::BGP_AFI_IPV4, bgp::BGP_AFI_IPV6 };
+        const int safis[] = { bgp::BGP_SAFI_UNICAST, bgp::BGP_SAFI_NLRI_LABEL };
+
+        for (size_t a = 0; a < 2; a++) {
+            for (size_t s = 0; s < 2; s++) {
+                caps.setAddPath(afis[a], safis[s], bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_SEND_RECEIVE, true);
+                caps.setAddPath(afis[a], safis[s], bgp_msg::OpenMsg::BGP_CAP_ADD_PATH_SEND_RECEIVE, false);
+            }
+        }
+
+        d.select(caps);
+    }
+
+    return d;
+}
+
+struct nlri_case {
+    const char                  *name;
+    bool                        isIPv4;
+    bool                        add_path;
+    const char                  *nlri;          ///< NLRI bytes in hex
+    bool                        valid;          ///< Expected decoder result
+    std::vector<std::string>    prefixes;       ///< Expected prefixes, those before the error if not valid
+};
+
+void PrintTo(const nlri_case &c, std::ostream *os) {
+    *os << c.name;
+}
+
+const nlri_case unicast_cases[] = {
+    { "v4 empty", true, false, "", true, { } },
+    { "v4 default", true, false, "00", true, { "0.0.0.0/0" } },
+    { "v4 /8 /24 /32", true, false, "08 0a  18 c0a801  20 c0a80101", true,
+      { "10.0.0.0/8", "192.168.1.0/24", "192.168.1.1/32" } },
+    { "v4 /25", true, false, "19 c0a80180", true, { "192.168.1.128/25" } },
+    { "v4 /32 at end of data", true, false, "08 0a 20 c0a80101", true, { "10.0.0.0/8", "192.168.1.1/32" } },
+    { "v4 /33", true, false, "21 0a000000 00", false, { } },
+    { "v4 truncated address", true, false, "08 0a 18 c0a8", false, { "10.0.0.0/8" } },
+    { "v4 add-path", true, true, "00000001 18 c0a801  00000002 00", true,
+      { "192.168.1.0/24 id 1", "0.0.0.0/0 id 2" } },
+    { "v4 add-path /32", true, true, "ffffffff 20 c0a80101", true, { "192.168.1.1/32 id 4294967295" } },
+    { "v4 add-path without prefix", true, true, "00000001", false, { } },
+    { "v4 add-path short tail", true, true, "00000001 08 0a  08 0b", true,
+      { "10.0.0.0/8 id 1", "11.0.0.0/8" } },
+    { "v6 default", false, false, "00", true, { "::/0" } },
+    { "v6 /32 /48 /64 /128", false, false,
+      "20 20010db8  30 20010db80001  40 20010db800010002  80 20010db8000000000000000000000001", true,
+      { "2001:db8::/32", "2001:db8:1::/48", "2001:db8:1:2::/64", "2001:db8::1/128" } },
+    { "v6 /128 at end of data", false, false, "80 20010db8000000000000000000000001", true,
+      { "2001:db8::1/128" } },
+    { "v6 /129", false, false, "81 20010db8000000000000000000000001 00", false, { } },
+    { "v6 truncated /128", false, false, "30 20010db80001  80 20010db80000000000000000000000", false,
+      { "2001:db8:1::/48" } },
+    { "v6 add-path", false, true, "00000007 80 20010db8000000000000000000000001  00000008 00", true,
+      { "2001:db8::1/128 id 7", "::/0 id 8" } },
+};
+
+class UnicastDecoderTest : public ::testing::TestWithParam<nlri_case> {
+protected:
+    ParseArena          arena;
+};
+
+TEST_P(UnicastDecoderTest, Decode) {
+    const nlri_case &c = GetParam();
+    ParseArena::Scope scope(&arena);
+    std::string nlri = hex(c.nlri);
+    bgp::prefix_array prefixes;
+    bgp_msg::UpdateDecoders d = decoders(c.add_path);
+
+    bool valid = d.unicast[bgp_msg::UpdateDecoders::afiIndex(c.isIPv4)]((u_char *)&nlri[0], nlri.size(),
+                                                                          prefixes);
+    EXPECT_EQ(c.valid, valid);
+
+    std::vector<std::string> decoded;
+    for (size_t i = 0; i < prefixes.size(); i++) {
+        EXPECT_EQ(c.isIPv4, prefixes.isIPv4[i] != 0);
+        decoded.push_back(printPrefix(c.isIPv4, prefixes.prefix_bin(i), prefixes.len[i], prefixes.path_id[i]));
+    }
+
+    EXPECT_EQ(c.prefixes, decoded);
+
+    if (c.valid) {
+        EXPECT_EQ(baselineUnicast(c.isIPv4, c.add_path, (u_char *)&nlri[0], nlri.size()), decoded);
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(Nlri, UnicastDecoderTest, ::testing::ValuesIn(unicast_cases));
+
+TEST(UnicastDecoderTest, AppendsToArray) {
+    std::string nlri = hex("18 c0a801 08 0a");
+    bgp::prefix_array prefixes;
+    bgp_msg::UpdateDecoders d = decoders(false);
+
+    ASSERT_TRUE(d.unicast[bgp_msg::UpdateDecoders::AFI_INDEX_IPV4]((u_char *)&nlri[0], nlri.size(), prefixes));
+    ASSERT_TRUE(d.unicast[bgp_msg::UpdateDecoders::AFI_INDEX_IPV4]((u_char *)&nlri[0], nlri.size(), prefixes));
+    ASSERT_EQ(4u, prefixes.size());
+    EXPECT_EQ(4u * bgp::prefix_array::ADDR_SIZE, prefixes.addr.size());
+
+    // Bytes past the prefix length are zero, not the bytes after the prefix in the NLRI
+    const uint8_t expected[bgp::prefix_array::ADDR_SIZE] = { 192, 168, 1 };
+    EXPECT_EQ(0, memcmp(expected, prefixes.prefix_bin(0), sizeof(expected)));
+    EXPECT_EQ(0, memcmp(expected, prefixes.prefix_bin(2), sizeof(expected)));
+}
+
+const nlri_case labeled_cases[] = {
+    { "v4 labeled /24", true, false, "30 03e801 c0a801", true, { "192.168.1.0/24 label 16000" } },
+    { "v4 labeled default", true, false, "18 03e801", true, { "0.0.0.0/0 label 16000" } },
+    { "v4 label stack", true, false, "48 03e800 03e811 c0a801", true, { "192.168.1.0/24 label 16000,16001" } },
+    { "v4 labeled truncated", true, false, "30 03e801 c0", false, { } },
+    { "v4 labeled add-path", true, true, "00000003 30 03e801 c0a801", true, { "192.168.1.0/24 id 3 label 16000" } },
+    { "v6 labeled /128", false, false, "98 03e801 20010db8000000000000000000000001", true,
+      { "2001:db8::1/128 label 16000" } },
+    { "v6 labeled /129", false, false, "99 03e801 20010db8000000000000000000000001 00", false, { } },
+};
+
+class LabeledDecoderTest : public ::testing::TestWithParam<nlri_case> {
+protected:
+    ParseArena          arena;
+};
+
+TEST_P(LabeledDecoderTest, Decode) {
+    const nlri_case &c = GetParam();
+    ParseArena::Scope scope(&arena);
+    std::string nlri = hex(c.nlri);
+    bgp::prefix_list prefixes;
+    bgp_msg::UpdateDecoders d = decoders(c.add_path);
+
+    bool valid = d.labeled[bgp_msg::UpdateDecoders::afiIndex(c.isIPv4)]((u_char *)&nlri[0], nlri.size(),
+                                                                          prefixes);
+    EXPECT_EQ(c.valid, valid);
+
+    std::vector<std::string> decoded;
+    for (bgp::prefix_list::iterator it = prefixes.begin(); it != prefixes.end(); ++it) {
+        EXPECT_EQ(printAddr(c.isIPv4, it->prefix_bin), it->prefix.c_str());
+        decoded.push_back(printPrefix(c.isIPv4, it->prefix_bin, it->len, it->path_id)
+                          + " label " + it->labels.c_str());
+    }
+
+    EXPECT_EQ(c.prefixes, decoded);
+}
+
+INSTANTIATE_TEST_CASE_P(Nlri, LabeledDecoderTest, ::testing::ValuesIn(labeled_cases));
+
+TEST(VpnDecoderTest, RouteDistinguisher) {
+    ParseArena arena;
+    ParseArena::Scope scope(&arena);
+    std::string nlri = hex("70 03e801 0000fde900000064 c0a801");
+    bgp::vpn_list prefixes;
+
+    // VPN NLRI never uses add-path, even if negotiated for unicast
+    bgp_msg::UpdateDecoders d = decoders(true);
+
+    ASSERT_TRUE(d.vpn[bgp_msg::UpdateDecoders::AFI_INDEX_IPV4]((u_char *)&nlri[0], nlri.size(), prefixes));
+    ASSERT_EQ(1u, prefixes.size());
+
+    const bgp::vpn_tuple &t = prefixes.front();
+    EXPECT_EQ("192.168.1.0", std::string(t.prefix.c_str()));
+    EXPECT_EQ(24, t.len);
+    EXPECT_EQ(0u, t.path_id);
+    EXPECT_EQ("16000", std::string(t.labels.c_str()));
+    EXPECT_EQ(0, t.rd_type);
+    EXPECT_EQ("100", t.rd_assigned_number);
+}
+
+struct as_path_case {
+    const char      *name;
+    int             asn_octets;
+    const char      *attr;              ///< AS_PATH attribute data in hex
+    bool            valid;
+    const char      *path;              ///< Printed path
+    uint16_t        count;
+    uint32_t        last_asn;
+    uint32_t        neighbor_asn;
+};
+
+void PrintTo(const as_path_case &c, std::ostream *os) {
+    *os << c.name;
+}
+
+const as_path_case as_path_cases[] = {
+    { "empty", 4, "", true, "", 0, 0, 0 },
+    { "sequence", 4, "02 02 0000fde9 0000fc00", true, " 65001 64512", 2, 64512, 65001 },
+    { "4 octet ASN", 4, "02 01 fa56ea00", true, " 4200000000", 1, 4200000000u, 4200000000u },
+    { "set", 4, "01 02 00000001 00000002", true, " { 1 2 }", 2, 2, 0 },
+    { "sequence then set", 4, "02 01 0000fde9 01 02 00000001 00000002", true, " 65001 { 1 2 }", 3, 2, 65001 },
+    { "confed sequence skipped", 4, "03 01 0000fde8 02 01 000000ae", true, " 65000 174", 2, 174, 174 },
+    { "confed set skipped", 4, "04 01 0000fde8 02 01 000000ae", true, " 65000 174", 2, 174, 174 },
+    { "truncated segment", 4, "02 02 0000fde9", false, "", 0, 0, 0 },
+    { "truncated header", 4, "02", false, "", 0, 0, 0 },
+    { "2 octet path as 4 octet", 4, "02 02 fde9 fc00", false, "", 0, 0, 0 },
+    { "2 octet sequence", 2, "02 02 fde9 fc00", true, " 65001 64512", 2, 64512, 65001 },
+    { "2 octet set", 2, "01 02 0001 0002", true, " { 1 2 }", 2, 2, 0 },
+};
+
+class AsPathDecoderTest : public ::testing::TestWithParam<as_path_case> { };
+
+TEST_P(AsPathDecoderTest, Decode) {
+    const as_path_case &c = GetParam();
+    std::string attr = hex(c.attr);
+    bgp_msg::UpdateDecoders d;
+    bgp_msg::UpdateDecoders::as_path_decoder decode = c.asn_octets == 4 ? d.as_path_4octet : d.as_path_2octet;
+    std::string path;
+    uint16_t count = 0;
+    uint32_t last_asn = 0;
+    uint32_t neighbor_asn = 0;
+
+    ASSERT_EQ(c.valid, decode((u_char *)attr.data(), attr.size(), path, count, last_asn, neighbor_asn));
+
+    if (c.valid) {
+        EXPECT_EQ(c.path, path);
+        EXPECT_EQ(c.count, count);
+        EXPECT_EQ(c.last_asn, last_asn);
+        EXPECT_EQ(c.neighbor_asn, neighbor_asn);
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(AsPath, AsPathDecoderTest, ::testing::ValuesIn(as_path_cases));
+
+} // namespace